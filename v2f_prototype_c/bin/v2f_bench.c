@@ -0,0 +1,825 @@
+/**
+ * @file
+ *
+ * @brief Microbenchmark of each stage of the compression and decompression pipelines.
+ *
+ * Each stage (sample reading and writing, quantization for several step sizes, forward and
+ * inverse decorrelation for each mode, and entropy coding and decoding) is run repeatedly
+ * on a block of samples after some warm-up runs. For each stage, the median and percentiles
+ * of the run times are reported, together with the throughput in samples per second and
+ * the number of cycles per sample.
+ */
+
+#include <assert.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/v2f.h"
+#include "../src/log.h"
+#include "../src/v2f_build.h"
+#include "../src/v2f_file.h"
+#include "bin_common.h"
+#include "v2f_bench_usage.h" // May be automatically generated
+
+/// Maximum number of sample sources that can be benchmarked in one execution
+#define V2F_BENCH_MAX_SOURCE_COUNT 16
+/// Maximum number of repetitions of each stage
+#define V2F_BENCH_MAX_REPETITION_COUNT 100000
+/// Maximum length of the parameter string of a stage
+#define V2F_BENCH_PARAMETER_SIZE 32
+
+/**
+ * @enum v2f_bench_source_kind_t
+ *
+ * Kinds of sample sources.
+ */
+typedef enum {
+    /// Synthetic prediction residuals with a (discretized) Laplacian distribution
+    V2F_BENCH_SOURCE_LAPLACIAN = 0,
+    /// Synthetic prediction residuals with a geometric distribution
+    V2F_BENCH_SOURCE_GEOMETRIC = 1,
+    /// Samples read from a raw file
+    V2F_BENCH_SOURCE_FILE = 2,
+} v2f_bench_source_kind_t;
+
+/**
+ * @struct v2f_bench_source_t
+ *
+ * Source of the samples of a benchmark.
+ */
+typedef struct {
+    /// Kind of source
+    v2f_bench_source_kind_t kind;
+    /// Path of the raw file of @ref V2F_BENCH_SOURCE_FILE sources
+    char const *path;
+} v2f_bench_source_t;
+
+/**
+ * @enum v2f_bench_stage_kind_t
+ *
+ * Stages that can be benchmarked.
+ */
+typedef enum {
+    V2F_BENCH_STAGE_READ = 0,
+    V2F_BENCH_STAGE_WRITE,
+    V2F_BENCH_STAGE_QUANTIZE,
+    V2F_BENCH_STAGE_DECORRELATE,
+    V2F_BENCH_STAGE_INVERT,
+    V2F_BENCH_STAGE_CODE,
+    V2F_BENCH_STAGE_DECODE,
+} v2f_bench_stage_kind_t;
+
+/**
+ * @struct v2f_bench_t
+ *
+ * Configuration and buffers of a benchmark.
+ */
+typedef struct {
+    /// Entropy coder of the benchmarked codec
+    v2f_entropy_coder_t *entropy_coder;
+    /// Entropy decoder of the benchmarked codec
+    v2f_entropy_decoder_t *entropy_decoder;
+    /// Number of bytes used to store each sample in raw files
+    uint8_t bytes_per_sample;
+    /// Number of samples of the benchmarked block
+    uint64_t sample_count;
+    /// Number of samples per row for the two-dimensional decorrelator modes
+    uint64_t samples_per_row;
+    /// Number of untimed runs before the timed ones
+    uint32_t warmup_count;
+    /// Number of timed runs
+    uint32_t repetition_count;
+
+    /// Samples of the source, which are not modified by the stages
+    v2f_sample_t *source_samples;
+    /// Samples to be coded by the entropy coder
+    v2f_sample_t *residual_samples;
+    /// Samples modified by each run
+    v2f_sample_t *work_samples;
+    /// Words produced by the entropy coder from `residual_samples`
+    uint8_t *compressed_block;
+    /// Number of bytes in `compressed_block`
+    uint64_t compressed_size;
+    /// Temporary file used by the read and write stages
+    FILE *raw_file;
+
+    /// Run times in nanoseconds of the current stage
+    uint64_t *run_ns;
+    /// Cycle counts of the current stage, or NULL if they are not available
+    uint64_t *run_cycles;
+} v2f_bench_t;
+
+/**
+ * Entry point of the benchmark.
+ *
+ * @param argc number of command line arguments.
+ * @param argv command line arguments.
+ *
+ * @return 0 when successful, a different value otherwise.
+ */
+int main(int argc, char *argv[]);
+
+/**
+ * Print the help message for this tool.
+ *
+ * @param file the file where the message is to be printed
+ */
+static void print_help(FILE *file) {
+    fputs(show_usage_string, file);
+}
+
+/**
+ * @return the value of the monotonic clock, in nanoseconds
+ */
+static uint64_t v2f_bench_get_ns(void) {
+    struct timespec time;
+    if (clock_gettime(CLOCK_MONOTONIC, &time)) {
+        return 0; // LCOV_EXCL_LINE
+    }
+    return (uint64_t) time.tv_sec * 1000000000 + (uint64_t) time.tv_nsec;
+}
+
+/**
+ * @return true if and only if v2f_bench_get_cycles() counts cycles on this target
+ */
+static bool v2f_bench_has_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @return the time-stamp counter of the processor, or 0 if it is not available
+ */
+static uint64_t v2f_bench_get_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Update a xorshift64* generator and return a uniform value in (0, 1).
+ *
+ * @param state generator state, which must not be 0
+ * @return the next value of the generator
+ */
+static double v2f_bench_uniform(uint64_t *const state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    const uint64_t value = *state * UINT64_C(2685821657736338717);
+    return ((double) (value >> 11) + 0.5) / 9007199254740992.0;
+}
+
+/**
+ * Fill a block with synthetic prediction residuals, mapped to non-negative values
+ * as done by the decorrelator, and clipped to `max_sample_value`.
+ *
+ * @param kind @ref V2F_BENCH_SOURCE_LAPLACIAN or @ref V2F_BENCH_SOURCE_GEOMETRIC
+ * @param mean mean magnitude of the residuals
+ * @param max_sample_value maximum sample value
+ * @param samples buffer of at least `sample_count` samples
+ * @param sample_count number of samples to be generated
+ */
+static void v2f_bench_generate(
+        v2f_bench_source_kind_t kind,
+        double mean,
+        v2f_sample_t max_sample_value,
+        v2f_sample_t *const samples,
+        uint64_t sample_count) {
+    uint64_t state = UINT64_C(0x9E3779B97F4A7C15);
+    const double log_ratio = log(mean / (1 + mean));
+    for (uint64_t i = 0; i < sample_count; i++) {
+        double value;
+        if (kind == V2F_BENCH_SOURCE_LAPLACIAN) {
+            // Signed residual, mapped as 0, -1, 1, -2, 2, ...
+            const double magnitude = floor(-mean * log(v2f_bench_uniform(&state)) + 0.5);
+            value = v2f_bench_uniform(&state) < 0.5 ? 2 * magnitude : (magnitude > 0 ? 2 * magnitude - 1 : 0);
+        } else {
+            // P(k) = (1 - p) * p^k, with p = mean / (1 + mean)
+            value = floor(log(v2f_bench_uniform(&state)) / log_ratio);
+        }
+        samples[i] = value >= (double) max_sample_value ? max_sample_value : (v2f_sample_t) value;
+    }
+}
+
+/**
+ * Load the samples of a source into `bench->source_samples`, and the samples to be
+ * entropy coded into `bench->residual_samples`.
+ *
+ * Synthetic sources are residuals, so they are coded as they are. Samples read from a file
+ * are quantized and decorrelated first with the quantizer and decorrelator of `compressor`.
+ *
+ * @param bench benchmark whose buffers are filled
+ * @param source source to be loaded
+ * @param mean mean magnitude of synthetic residuals
+ * @param compressor compressor of the benchmarked codec
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The source was loaded
+ *  - @ref V2F_E_IO : The file could not be read
+ *  - @ref V2F_E_INVALID_PARAMETER : The file samples could not be quantized or decorrelated
+ */
+static v2f_error_t v2f_bench_load_source(
+        v2f_bench_t *const bench,
+        v2f_bench_source_t const *const source,
+        double mean,
+        v2f_compressor_t *const compressor) {
+    if (source->kind != V2F_BENCH_SOURCE_FILE) {
+        v2f_bench_generate(source->kind, mean, bench->entropy_coder->max_expected_value,
+                           bench->source_samples, bench->sample_count);
+        memcpy(bench->residual_samples, bench->source_samples, sizeof(v2f_sample_t) * bench->sample_count);
+        return V2F_E_NONE;
+    }
+
+    FILE *input_file = fopen(source->path, "r");
+    if (input_file == NULL) {
+        log_error("Cannot open file = %s", source->path);
+        return V2F_E_IO;
+    }
+    uint64_t read_sample_count;
+    const v2f_error_t status = v2f_file_read_big_endian(
+            input_file, bench->source_samples, bench->sample_count, bench->bytes_per_sample, &read_sample_count);
+    fclose(input_file);
+    if (status != V2F_E_NONE && status != V2F_E_UNEXPECTED_END_OF_FILE) {
+        log_error("Error reading %s: %s", source->path, v2f_strerror(status));
+        return status;
+    }
+    // Blocks of the file are repeated if it is too small
+    for (uint64_t i = read_sample_count; i < bench->sample_count && read_sample_count > 0; i++) {
+        bench->source_samples[i] = bench->source_samples[i - read_sample_count];
+    }
+    if (read_sample_count == 0) {
+        log_error("File %s has no samples", source->path);
+        return V2F_E_IO;
+    }
+    for (uint64_t i = 0; i < bench->sample_count; i++) {
+        if (bench->source_samples[i] > bench->entropy_coder->max_expected_value) {
+            bench->source_samples[i] = bench->entropy_coder->max_expected_value;
+        }
+    }
+
+    memcpy(bench->residual_samples, bench->source_samples, sizeof(v2f_sample_t) * bench->sample_count);
+    RETURN_IF_FAIL(v2f_quantizer_quantize(compressor->quantizer, bench->residual_samples, bench->sample_count));
+    RETURN_IF_FAIL(v2f_decorrelator_decorrelate_block(
+            compressor->decorrelator, bench->residual_samples, bench->sample_count));
+    return V2F_E_NONE;
+}
+
+/**
+ * Run a stage once, storing its time and cycle count. Work that is needed
+ * to prepare each run (e.g., restoring the input samples) is not measured.
+ *
+ * @param bench benchmark
+ * @param kind stage to be run
+ * @param quantizer quantizer of @ref V2F_BENCH_STAGE_QUANTIZE stages
+ * @param decorrelator decorrelator of @ref V2F_BENCH_STAGE_DECORRELATE and @ref V2F_BENCH_STAGE_INVERT stages
+ * @param run_ns pointer where the run time in nanoseconds is stored
+ * @param run_cycles pointer where the cycle count is stored
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The stage was run
+ *  - Any error produced by the stage
+ */
+static v2f_error_t v2f_bench_run_stage(
+        v2f_bench_t *const bench,
+        v2f_bench_stage_kind_t kind,
+        v2f_quantizer_t *const quantizer,
+        v2f_decorrelator_t *const decorrelator,
+        uint64_t *const run_ns,
+        uint64_t *const run_cycles) {
+    const uint64_t sample_count = bench->sample_count;
+    const size_t block_size = sizeof(v2f_sample_t) * sample_count;
+    switch (kind) {
+        case V2F_BENCH_STAGE_READ:
+        case V2F_BENCH_STAGE_WRITE:
+            if (fseeko(bench->raw_file, 0, SEEK_SET) != 0) {
+                return V2F_E_IO; // LCOV_EXCL_LINE
+            }
+            break;
+        case V2F_BENCH_STAGE_QUANTIZE:
+        case V2F_BENCH_STAGE_DECORRELATE:
+            memcpy(bench->work_samples, bench->source_samples, block_size);
+            break;
+        case V2F_BENCH_STAGE_INVERT:
+            memcpy(bench->work_samples, bench->source_samples, block_size);
+            RETURN_IF_FAIL(v2f_decorrelator_decorrelate_block(decorrelator, bench->work_samples, sample_count));
+            break;
+        default:
+            break;
+    }
+
+    const uint64_t cycles_before = v2f_bench_get_cycles();
+    const uint64_t ns_before = v2f_bench_get_ns();
+    v2f_error_t status;
+    uint64_t written_count;
+    switch (kind) {
+        case V2F_BENCH_STAGE_READ:
+            status = v2f_file_read_big_endian(
+                    bench->raw_file, bench->work_samples, sample_count, bench->bytes_per_sample, NULL);
+            break;
+        case V2F_BENCH_STAGE_WRITE:
+            status = v2f_file_write_big_endian(
+                    bench->raw_file, bench->source_samples, sample_count, bench->bytes_per_sample);
+            if (status == V2F_E_NONE && fflush(bench->raw_file) != 0) {
+                status = V2F_E_IO; // LCOV_EXCL_LINE
+            }
+            break;
+        case V2F_BENCH_STAGE_QUANTIZE:
+            status = v2f_quantizer_quantize(quantizer, bench->work_samples, sample_count);
+            break;
+        case V2F_BENCH_STAGE_DECORRELATE:
+            status = v2f_decorrelator_decorrelate_block(decorrelator, bench->work_samples, sample_count);
+            break;
+        case V2F_BENCH_STAGE_INVERT:
+            status = v2f_decorrelator_invert_block(decorrelator, bench->work_samples, sample_count);
+            break;
+        case V2F_BENCH_STAGE_CODE:
+            status = v2f_entropy_coder_compress_block(
+                    bench->entropy_coder, bench->residual_samples, sample_count,
+                    bench->compressed_block, &written_count);
+            break;
+        case V2F_BENCH_STAGE_DECODE:
+            status = v2f_entropy_decoder_decompress_block(
+                    bench->entropy_decoder, bench->compressed_block, bench->compressed_size,
+                    bench->work_samples, sample_count, &written_count);
+            break;
+        default:
+            status = V2F_E_INVALID_PARAMETER; // LCOV_EXCL_LINE
+    }
+    *run_ns = v2f_bench_get_ns() - ns_before;
+    *run_cycles = v2f_bench_get_cycles() - cycles_before;
+
+    return status;
+}
+
+/**
+ * Compare two uint64_t values for qsort().
+ *
+ * @param a pointer to the first value
+ * @param b pointer to the second value
+ * @return a negative, zero or positive value if the first value is smaller, equal or larger
+ */
+static int v2f_bench_compare(void const *a, void const *b) {
+    const uint64_t value_a = *((uint64_t const *) a);
+    const uint64_t value_b = *((uint64_t const *) b);
+    return value_a < value_b ? -1 : (value_a > value_b ? 1 : 0);
+}
+
+/**
+ * Get a percentile of sorted values, using the nearest-rank method.
+ *
+ * @param sorted_values values in non-decreasing order
+ * @param count number of values, at least 1
+ * @param percent percentile, between 0 and 100
+ * @return the percentile
+ */
+static uint64_t v2f_bench_percentile(uint64_t const *const sorted_values, uint32_t count, uint32_t percent) {
+    const uint64_t rank = (percent * (uint64_t) count + 99) / 100;
+    return sorted_values[rank > 0 ? rank - 1 : 0];
+}
+
+/**
+ * Benchmark a stage and report its statistics.
+ *
+ * @param bench benchmark
+ * @param output_file file where the results are reported
+ * @param json true for JSON output, false for CSV
+ * @param first_record true if no stage has been reported yet
+ * @param source_name name of the sample source
+ * @param kind stage to be run
+ * @param stage_name name of the stage
+ * @param parameter parameter of the stage, e.g., a step size or mode, or an empty string
+ * @param quantizer quantizer of @ref V2F_BENCH_STAGE_QUANTIZE stages, or NULL
+ * @param decorrelator decorrelator of decorrelation stages, or NULL
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The stage was benchmarked
+ *  - Any error produced by the stage
+ */
+static v2f_error_t v2f_bench_stage(
+        v2f_bench_t *const bench,
+        FILE *const output_file,
+        bool json,
+        bool first_record,
+        char const *const source_name,
+        v2f_bench_stage_kind_t kind,
+        char const *const stage_name,
+        char const *const parameter,
+        v2f_quantizer_t *const quantizer,
+        v2f_decorrelator_t *const decorrelator) {
+    uint64_t ns;
+    uint64_t cycles;
+    for (uint32_t i = 0; i < bench->warmup_count; i++) {
+        RETURN_IF_FAIL(v2f_bench_run_stage(bench, kind, quantizer, decorrelator, &ns, &cycles));
+    }
+    for (uint32_t i = 0; i < bench->repetition_count; i++) {
+        RETURN_IF_FAIL(v2f_bench_run_stage(
+                bench, kind, quantizer, decorrelator, &bench->run_ns[i], &bench->run_cycles[i]));
+    }
+    qsort(bench->run_ns, bench->repetition_count, sizeof(uint64_t), v2f_bench_compare);
+    qsort(bench->run_cycles, bench->repetition_count, sizeof(uint64_t), v2f_bench_compare);
+
+    const uint64_t median_ns = v2f_bench_percentile(bench->run_ns, bench->repetition_count, 50);
+    const uint64_t p10_ns = v2f_bench_percentile(bench->run_ns, bench->repetition_count, 10);
+    const uint64_t p90_ns = v2f_bench_percentile(bench->run_ns, bench->repetition_count, 90);
+    const uint64_t min_ns = bench->run_ns[0];
+    const double samples_per_s = median_ns > 0 ? (double) bench->sample_count * 1e9 / (double) median_ns : 0;
+    const double cycles_per_sample =
+            (double) v2f_bench_percentile(bench->run_cycles, bench->repetition_count, 50)
+            / (double) bench->sample_count;
+
+    if (json) {
+        fprintf(output_file,
+                "%s\n  {\"source\": \"%s\", \"stage\": \"%s\", \"parameter\": \"%s\", \"sample_count\": %lu, "
+                "\"repetitions\": %u, \"median_ns\": %lu, \"p10_ns\": %lu, \"p90_ns\": %lu, \"min_ns\": %lu, "
+                "\"samples_per_s\": %.1lf, \"cycles_per_sample\": ",
+                first_record ? "" : ",", source_name, stage_name, parameter, bench->sample_count,
+                bench->repetition_count, median_ns, p10_ns, p90_ns, min_ns, samples_per_s);
+        if (v2f_bench_has_cycles()) {
+            fprintf(output_file, "%.3lf}", cycles_per_sample);
+        } else {
+            fprintf(output_file, "null}");
+        }
+    } else {
+        fprintf(output_file, "%s,%s,%s,%lu,%u,%lu,%lu,%lu,%lu,%.1lf,",
+                source_name, stage_name, parameter, bench->sample_count, bench->repetition_count,
+                median_ns, p10_ns, p90_ns, min_ns, samples_per_s);
+        if (v2f_bench_has_cycles()) {
+            fprintf(output_file, "%.3lf\n", cycles_per_sample);
+        } else {
+            fprintf(output_file, "\n");
+        }
+    }
+    fflush(output_file);
+    return V2F_E_NONE;
+}
+
+/**
+ * Benchmark all stages for one source of samples.
+ *
+ * @param bench benchmark, whose buffers are filled with the source samples
+ * @param output_file file where the results are reported
+ * @param json true for JSON output, false for CSV
+ * @param first_record true if no stage has been reported yet
+ * @param source_name name of the sample source
+ * @param step_sizes quantization step sizes to be benchmarked
+ * @param step_size_count number of elements in `step_sizes`
+ *
+ * @return
+ *  - @ref V2F_E_NONE : All stages were benchmarked
+ *  - Any error produced by the stages
+ */
+static v2f_error_t v2f_bench_all_stages(
+        v2f_bench_t *const bench,
+        FILE *const output_file,
+        bool json,
+        bool first_record,
+        char const *const source_name,
+        uint32_t const *const step_sizes,
+        uint32_t step_size_count) {
+    char const *const mode_names[V2F_C_DECORRELATOR_MODE_COUNT] = {"none", "left", "2_left", "jpeg_ls", "fgij"};
+    const v2f_sample_t max_sample_value = bench->entropy_coder->max_expected_value;
+    char parameter[V2F_BENCH_PARAMETER_SIZE];
+
+    // The compressed block and the raw file are the inputs of the decoding and reading stages
+    RETURN_IF_FAIL(v2f_entropy_coder_compress_block(
+            bench->entropy_coder, bench->residual_samples, bench->sample_count,
+            bench->compressed_block, &bench->compressed_size));
+    RETURN_IF_FAIL(v2f_bench_stage(bench, output_file, json, first_record, source_name,
+                                   V2F_BENCH_STAGE_WRITE, "write", "", NULL, NULL));
+    RETURN_IF_FAIL(v2f_bench_stage(bench, output_file, json, false, source_name,
+                                   V2F_BENCH_STAGE_READ, "read", "", NULL, NULL));
+
+    for (uint32_t i = 0; i < step_size_count; i++) {
+        v2f_quantizer_t quantizer;
+        RETURN_IF_FAIL(v2f_quantizer_create(
+                &quantizer, step_sizes[i] == 1 ? V2F_C_QUANTIZER_MODE_NONE : V2F_C_QUANTIZER_MODE_UNIFORM,
+                step_sizes[i], max_sample_value));
+        snprintf(parameter, V2F_BENCH_PARAMETER_SIZE, "step_%u", step_sizes[i]);
+        RETURN_IF_FAIL(v2f_bench_stage(bench, output_file, json, false, source_name,
+                                       V2F_BENCH_STAGE_QUANTIZE, "quantize", parameter, &quantizer, NULL));
+    }
+
+    for (v2f_decorrelator_mode_t mode = V2F_C_DECORRELATOR_MODE_NONE; mode < V2F_C_DECORRELATOR_MODE_COUNT; mode++) {
+        v2f_decorrelator_t decorrelator;
+        RETURN_IF_FAIL(v2f_decorrelator_create(&decorrelator, mode, max_sample_value, bench->samples_per_row));
+        RETURN_IF_FAIL(v2f_bench_stage(bench, output_file, json, false, source_name,
+                                       V2F_BENCH_STAGE_DECORRELATE, "decorrelate", mode_names[mode],
+                                       NULL, &decorrelator));
+        RETURN_IF_FAIL(v2f_bench_stage(bench, output_file, json, false, source_name,
+                                       V2F_BENCH_STAGE_INVERT, "invert", mode_names[mode], NULL, &decorrelator));
+    }
+
+    snprintf(parameter, V2F_BENCH_PARAMETER_SIZE, "%lu_bytes",
+             (unsigned long) bench->compressed_size);
+    RETURN_IF_FAIL(v2f_bench_stage(bench, output_file, json, false, source_name,
+                                   V2F_BENCH_STAGE_CODE, "entropy_code", parameter, NULL, NULL));
+    RETURN_IF_FAIL(v2f_bench_stage(bench, output_file, json, false, source_name,
+                                   V2F_BENCH_STAGE_DECODE, "entropy_decode", parameter, NULL, NULL));
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Allocate the buffers of a benchmark and run it for all sources.
+ *
+ * @param bench benchmark with its configuration set
+ * @param compressor compressor of the benchmarked codec
+ * @param sources sources of samples
+ * @param source_count number of elements in `sources`
+ * @param mean mean magnitude of synthetic residuals
+ * @param step_sizes quantization step sizes to be benchmarked
+ * @param step_size_count number of elements in `step_sizes`
+ * @param output_file file where the results are reported
+ * @param json true for JSON output, false for CSV
+ *
+ * @return
+ *  - @ref V2F_E_NONE : All sources were benchmarked
+ *  - @ref V2F_E_OUT_OF_MEMORY : The buffers could not be allocated
+ *  - @ref V2F_E_IO : The temporary file could not be created
+ *  - Any error produced by the stages
+ */
+static v2f_error_t v2f_bench_run(
+        v2f_bench_t *const bench,
+        v2f_compressor_t *const compressor,
+        v2f_bench_source_t const *const sources,
+        uint32_t source_count,
+        double mean,
+        uint32_t const *const step_sizes,
+        uint32_t step_size_count,
+        FILE *const output_file,
+        bool json) {
+    const size_t block_size = sizeof(v2f_sample_t) * bench->sample_count;
+    bench->source_samples = malloc(block_size);
+    bench->residual_samples = malloc(block_size);
+    bench->work_samples = malloc(block_size);
+    bench->compressed_block = malloc(bench->sample_count * bench->entropy_coder->bytes_per_word);
+    bench->run_ns = malloc(sizeof(uint64_t) * bench->repetition_count);
+    bench->run_cycles = malloc(sizeof(uint64_t) * bench->repetition_count);
+    bench->raw_file = tmpfile();
+
+    v2f_error_t status = V2F_E_NONE;
+    if (bench->source_samples == NULL || bench->residual_samples == NULL || bench->work_samples == NULL
+        || bench->compressed_block == NULL || bench->run_ns == NULL || bench->run_cycles == NULL) {
+        status = V2F_E_OUT_OF_MEMORY; // LCOV_EXCL_LINE
+    } else if (bench->raw_file == NULL) {
+        status = V2F_E_IO; // LCOV_EXCL_LINE
+    }
+
+    char const *const source_names[] = {"laplacian", "geometric"};
+    if (json && status == V2F_E_NONE) {
+        fprintf(output_file, "[");
+    } else if (status == V2F_E_NONE) {
+        fprintf(output_file, "source,stage,parameter,sample_count,repetitions,median_ns,p10_ns,p90_ns,min_ns,"
+                             "samples_per_s,cycles_per_sample\n");
+    }
+    for (uint32_t i = 0; i < source_count && status == V2F_E_NONE; i++) {
+        status = v2f_bench_load_source(bench, &sources[i], mean, compressor);
+        if (status == V2F_E_NONE) {
+            status = v2f_bench_all_stages(
+                    bench, output_file, json, i == 0,
+                    sources[i].kind == V2F_BENCH_SOURCE_FILE ? sources[i].path : source_names[sources[i].kind],
+                    step_sizes, step_size_count);
+        }
+    }
+    if (json && status == V2F_E_NONE) {
+        fprintf(output_file, "\n]\n");
+    }
+
+    free(bench->source_samples);
+    free(bench->residual_samples);
+    free(bench->work_samples);
+    free(bench->compressed_block);
+    free(bench->run_ns);
+    free(bench->run_cycles);
+    if (bench->raw_file != NULL) {
+        fclose(bench->raw_file);
+    }
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    // Default argument values
+    v2f_bench_source_t sources[V2F_BENCH_MAX_SOURCE_COUNT];
+    uint32_t source_count = 0;
+    uint32_t sample_count = 1 << 20;
+    uint32_t samples_per_row = 1024;
+    uint32_t repetition_count = 11;
+    uint32_t warmup_count = 2;
+    double mean = 4;
+    uint32_t default_step_sizes[] = {1, 2, 3, 4, 5, 8};
+    uint32_t *step_sizes = NULL;
+    uint32_t step_size_count = 0;
+    bool json = false;
+    char const *output_path = NULL;
+
+    // Optional argument parsing
+    int opt;
+    while ((opt = getopt(argc, argv, "S:i:n:w:r:u:m:s:f:o:hv")) != -1) {
+        switch (opt) {
+            case 'S':
+            case 'i':
+                if (source_count == V2F_BENCH_MAX_SOURCE_COUNT) {
+                    fprintf(stderr, "At most %d sources can be benchmarked.\n", V2F_BENCH_MAX_SOURCE_COUNT);
+                    free(step_sizes);
+                    return 1;
+                }
+                if (opt == 'i') {
+                    sources[source_count].kind = V2F_BENCH_SOURCE_FILE;
+                    sources[source_count].path = optarg;
+                } else if (strcmp(optarg, "laplacian") == 0) {
+                    sources[source_count].kind = V2F_BENCH_SOURCE_LAPLACIAN;
+                } else if (strcmp(optarg, "geometric") == 0) {
+                    sources[source_count].kind = V2F_BENCH_SOURCE_GEOMETRIC;
+                } else {
+                    fprintf(stderr, "Invalid synthetic source. Invoke with -h for help.\n");
+                    free(step_sizes);
+                    return 1;
+                }
+                source_count++;
+                break;
+
+            case 'n':
+                if (parse_positive_integer(optarg, &sample_count, "sample_count") != 0
+                    || sample_count < V2F_C_MIN_BLOCK_SIZE || sample_count > V2F_C_MAX_BLOCK_SIZE) {
+                    fprintf(stderr, "Invalid number of samples. Invoke with -h for help.\n");
+                    free(step_sizes);
+                    return 1;
+                }
+                break;
+
+            case 'w':
+                if (parse_positive_integer(optarg, &samples_per_row, "samples_per_row") != 0
+                    || samples_per_row < 3) {
+                    fprintf(stderr, "Invalid number of samples per row. Invoke with -h for help.\n");
+                    free(step_sizes);
+                    return 1;
+                }
+                break;
+
+            case 'r':
+                if (parse_positive_integer(optarg, &repetition_count, "repetition_count") != 0
+                    || repetition_count < 1 || repetition_count > V2F_BENCH_MAX_REPETITION_COUNT) {
+                    fprintf(stderr, "Invalid number of repetitions. Invoke with -h for help.\n");
+                    free(step_sizes);
+                    return 1;
+                }
+                break;
+
+            case 'u':
+                if (parse_positive_integer(optarg, &warmup_count, "warmup_count") != 0
+                    || warmup_count > V2F_BENCH_MAX_REPETITION_COUNT) {
+                    fprintf(stderr, "Invalid number of warm-up runs. Invoke with -h for help.\n");
+                    free(step_sizes);
+                    return 1;
+                }
+                break;
+
+            case 'm': {
+                char *end;
+                mean = strtod(optarg, &end);
+                if (*optarg == '\0' || *end != '\0' || !(mean > 0) || mean > 1e6) {
+                    fprintf(stderr, "Invalid mean residual magnitude. Invoke with -h for help.\n");
+                    free(step_sizes);
+                    return 1;
+                }
+                break;
+            }
+
+            case 's':
+                free(step_sizes);
+                step_sizes = NULL;
+                if (parse_positive_integer_list(optarg, &step_sizes, &step_size_count) != 0) {
+                    fprintf(stderr, "Could not parse s argument '%s'. "
+                                    "It must be a comma-separated list of positive integers.\n", optarg);
+                    return 1;
+                }
+                for (uint32_t i = 0; i < step_size_count; i++) {
+                    if (step_sizes[i] < 1
+                        || step_sizes[i] > V2F_C_QUANTIZER_MODE_MAX_STEP_SIZE) {
+                        fprintf(stderr, "Invalid step size. Invoke with -h for help.\n");
+                        free(step_sizes);
+                        return 1;
+                    }
+                }
+                break;
+
+            case 'f':
+                if (strcmp(optarg, "csv") != 0 && strcmp(optarg, "json") != 0) {
+                    fprintf(stderr, "Invalid output format. Invoke with -h for help.\n");
+                    free(step_sizes);
+                    return 1;
+                }
+                json = strcmp(optarg, "json") == 0;
+                break;
+
+            case 'o':
+                output_path = optarg;
+                break;
+
+            case 'h':
+            case 'v':
+                show_banner();
+                print_help(stderr);
+                free(step_sizes);
+                return 64;
+            case '?':
+                fprintf(stderr, "Invalid option: -%c\n", optopt);
+                print_help(stderr);
+                free(step_sizes);
+                return 1;
+            default: // LCOV_EXCL_LINE
+                assert(false); // LCOV_EXCL_LINE
+        }
+    }
+
+    if (optind + 1 < argc) {
+        log_error("Invalid number of positional arguments");
+        print_help(stderr);
+        free(step_sizes);
+        return 1;
+    }
+    if (source_count == 0) {
+        sources[0].kind = V2F_BENCH_SOURCE_LAPLACIAN;
+        sources[1].kind = V2F_BENCH_SOURCE_GEOMETRIC;
+        source_count = 2;
+    }
+    if (step_sizes == NULL) {
+        step_size_count = sizeof(default_step_sizes) / sizeof(uint32_t);
+    }
+
+    // Load the codec, or use the minimal one for 2 bytes per word
+    v2f_compressor_t compressor;
+    v2f_decompressor_t decompressor;
+    const bool codec_file_set = optind < argc;
+    v2f_error_t status;
+    if (codec_file_set) {
+        FILE *codec_file = fopen(argv[optind], "r");
+        if (codec_file == NULL) {
+            log_error("Cannot open file = %s", argv[optind]);
+            free(step_sizes);
+            return 1;
+        }
+        status = v2f_file_read_codec(codec_file, &compressor, &decompressor);
+        fclose(codec_file);
+    } else {
+        status = v2f_build_minimal_codec(2, &compressor, &decompressor);
+    }
+    if (status != V2F_E_NONE) {
+        log_error("Error loading codec: %s", v2f_strerror(status));
+        free(step_sizes);
+        return 1;
+    }
+
+    v2f_bench_t bench;
+    bench.entropy_coder = compressor.entropy_coder;
+    bench.entropy_decoder = decompressor.entropy_decoder;
+    bench.bytes_per_sample = decompressor.entropy_decoder->bytes_per_sample;
+    // Two-dimensional modes need complete rows
+    bench.sample_count = sample_count - sample_count % samples_per_row;
+    bench.samples_per_row = samples_per_row;
+    bench.warmup_count = warmup_count;
+    bench.repetition_count = repetition_count;
+    if (bench.sample_count == 0) {
+        log_error("At least one row of %u samples is needed", samples_per_row);
+        status = V2F_E_INVALID_PARAMETER;
+    }
+
+    FILE *output_file = stdout;
+    if (status == V2F_E_NONE && output_path != NULL) {
+        output_file = fopen(output_path, "w");
+        if (output_file == NULL) {
+            log_error("Cannot open file = %s", output_path);
+            status = V2F_E_IO;
+        }
+    }
+    if (status == V2F_E_NONE) {
+        status = v2f_bench_run(&bench, &compressor, sources, source_count, mean,
+                               step_sizes != NULL ? step_sizes : default_step_sizes, step_size_count,
+                               output_file, json);
+        if (status != V2F_E_NONE) {
+            log_error("Error running the benchmark: %s", v2f_strerror(status));
+        }
+    }
+    if (output_file != NULL && output_file != stdout) {
+        fclose(output_file);
+    }
+
+    if (codec_file_set) {
+        v2f_file_destroy_read_codec(&compressor, &decompressor);
+    } else {
+        v2f_build_destroy_minimal_codec(&compressor, &decompressor);
+    }
+    free(step_sizes);
+
+    return status == V2F_E_NONE ? 0 : 1;
+}
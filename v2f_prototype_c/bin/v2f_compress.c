@@ -43,10 +43,16 @@ int main(int argc, char *argv[]) {
     uint32_t y_shadow_count = 0;
     bool time_file_set = false;
     char *time_file_path = NULL;
+    bool thread_count_set = false;
+    uint32_t thread_count = 1;
+    char *forest_cache_path = NULL;
+    bool write_block_index = false;
+    bool map_files = false;
+    bool pipeline = false;
 
     // Optional argument parsing
     int opt;
-    while ((opt = getopt(argc, argv, "q:s:d:t:w:y:hv")) != -1) {
+    while ((opt = getopt(argc, argv, "q:s:d:t:w:y:j:c:imphv")) != -1) {
         switch (opt) {
             case 'q':
                 if (quantizer_mode_set) {
@@ -161,6 +167,42 @@ int main(int argc, char *argv[]) {
                 }
                 break;
 
+            case 'j':
+                if (thread_count_set) {
+                    log_warning("Found repeated parameter j. Last value will prevail.");
+                }
+                if (parse_positive_integer(
+                        optarg, &thread_count, "thread_count") != 0
+                    || thread_count < 1 || thread_count > V2F_C_MAX_THREAD_COUNT) {
+                    fprintf(stderr,
+                            "Invalid number of threads. Invoke with -h for help.\n");
+                    if (shadow_y_positions != NULL) {
+                        free(shadow_y_positions);
+                    }
+                    return 1;
+                }
+                thread_count_set = true;
+                break;
+
+            case 'c':
+                if (forest_cache_path != NULL) {
+                    log_warning("Found repeated parameter c. Last value will prevail.");
+                }
+                forest_cache_path = optarg;
+                break;
+
+            case 'i':
+                write_block_index = true;
+                break;
+
+            case 'm':
+                map_files = true;
+                break;
+
+            case 'p':
+                pipeline = true;
+                break;
+
             case 't':
                 if (time_file_set) {
                     log_warning("Found repeated parameter t. Last value will prevail.");
@@ -222,12 +264,21 @@ int main(int argc, char *argv[]) {
     char const *const output_file_path = argv[optind + 2];
 
     // Perform compression
-    const int status = v2f_file_compress_from_path(
-            raw_file_path, header_file_path, output_file_path,
-            quantizer_mode_set, quantizer_mode,
-            step_size_set, step_size,
-            decorrelator_mode_set, decorrelator_mode, samples_per_row,
-            shadow_y_positions, y_shadow_count);
+    v2f_file_options_t options;
+    int status = (int) v2f_file_init_options(&options);
+    if (status == 0) {
+        options.thread_count = thread_count;
+        options.pipeline = pipeline;
+        options.forest_cache_path = forest_cache_path;
+        options.write_block_index = write_block_index;
+        options.map_files = map_files;
+        status = v2f_file_compress_from_path(
+                raw_file_path, header_file_path, output_file_path,
+                quantizer_mode_set, quantizer_mode,
+                step_size_set, step_size,
+                decorrelator_mode_set, decorrelator_mode, samples_per_row,
+                shadow_y_positions, y_shadow_count, &options);
+    }
 
     // Report results
     log_info("Compression of %s completed with status %d.",
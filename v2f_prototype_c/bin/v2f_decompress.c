@@ -7,6 +7,7 @@
 #include <assert.h>
 #include <getopt.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "../src/v2f.h"
 #include "../src/log.h"
@@ -33,10 +34,18 @@ int main(int argc, char *argv[]) {
     v2f_decorrelator_mode_t decorrelator_mode = V2F_C_DECORRELATOR_MODE_LEFT;
     v2f_sample_t samples_per_row = 0;
     bool samples_per_row_set = false;
+    bool thread_count_set = false;
+    uint32_t thread_count = 1;
+    char *forest_cache_path = NULL;
+    bool select_rows = false;
+    uint32_t first_row = 0;
+    uint32_t last_row = 0;
+    bool map_files = false;
+    bool pipeline = false;
 
     // Optional argument parsing
     int opt;
-    while ((opt = getopt(argc, argv, "q:s:d:w:hv")) != -1) {
+    while ((opt = getopt(argc, argv, "q:s:d:w:j:c:r:mphv")) != -1) {
         switch (opt) {
             case 'q':
                 if (quantizer_mode_set) {
@@ -89,6 +98,58 @@ int main(int argc, char *argv[]) {
                 samples_per_row_set = true;
                 break;
 
+            case 'j':
+                if (thread_count_set) {
+                    log_warning("Found repeated parameter j. Last value will prevail.");
+                }
+                if (parse_positive_integer(
+                        optarg, &thread_count, "thread_count") != 0
+                    || thread_count < 1 || thread_count > V2F_C_MAX_THREAD_COUNT) {
+                    fprintf(stderr, "Invalid number of threads. Invoke with -h for help.\n");
+                    return 1;
+                }
+                thread_count_set = true;
+                break;
+
+            case 'c':
+                if (forest_cache_path != NULL) {
+                    log_warning("Found repeated parameter c. Last value will prevail.");
+                }
+                forest_cache_path = optarg;
+                break;
+
+            case 'm':
+                map_files = true;
+                break;
+
+            case 'p':
+                pipeline = true;
+                break;
+
+            case 'r': {
+                if (select_rows) {
+                    log_warning("Found repeated parameter r. Last value will prevail.");
+                }
+                uint32_t *row_range = NULL;
+                uint32_t row_range_length = 0;
+                if (parse_positive_integer_list(optarg, &row_range, &row_range_length) != 0) {
+                    fprintf(stderr, "Could not parse r argument '%s'. "
+                                    "It must be a first,last pair of positive integers.\n", optarg);
+                    return 1;
+                }
+                if (row_range_length != 2 || row_range[0] > row_range[1]) {
+                    fprintf(stderr, "The -r argument accepts only a first,last pair of rows, "
+                                    "with first not larger than last.\n");
+                    free(row_range);
+                    return 1;
+                }
+                first_row = row_range[0];
+                last_row = row_range[1];
+                free(row_range);
+                select_rows = true;
+                break;
+            }
+
             case 'h':
                 show_banner();
                 puts(show_usage_string);
@@ -113,6 +174,11 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (select_rows && (!samples_per_row_set || samples_per_row == 0)) {
+        fprintf(stderr, "Error! The -r parameter requires a non-zero -w parameter. Invoke with -h for help.\n");
+        return 1;
+    }
+
     // Mandatory argument
     if (optind + 3 != argc) {
         fprintf(stderr, "Invalid number of parameters. Invoke with -h for help.\n");
@@ -124,11 +190,22 @@ int main(int argc, char *argv[]) {
     char const *const header_file_path = argv[optind+1];
     char const *const reconstructed_file_path = argv[optind + 2];
 
-    int status = v2f_file_decompress_from_path(
-            compressed_file_path, header_file_path, reconstructed_file_path,
-            quantizer_mode_set, quantizer_mode,
-            step_size_set, step_size,
-            decorrelator_mode_set, decorrelator_mode, samples_per_row);
+    v2f_file_options_t options;
+    int status = (int) v2f_file_init_options(&options);
+    if (status == 0) {
+        options.thread_count = thread_count;
+        options.pipeline = pipeline;
+        options.forest_cache_path = forest_cache_path;
+        options.select_rows = select_rows;
+        options.first_row = first_row;
+        options.last_row = last_row;
+        options.map_files = map_files;
+        status = v2f_file_decompress_from_path(
+                compressed_file_path, header_file_path, reconstructed_file_path,
+                quantizer_mode_set, quantizer_mode,
+                step_size_set, step_size,
+                decorrelator_mode_set, decorrelator_mode, samples_per_row, &options);
+    }
 
     log_info("Decompression completed with status %d.", status);
 
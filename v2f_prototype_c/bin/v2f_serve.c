@@ -0,0 +1,138 @@
+/**
+ * @file
+ *
+ * @brief Compression service that keeps codecs and buffers loaded across jobs.
+ *
+ * The codecs given in the command line are read once, and jobs submitted with v2f_submit
+ * (or with v2f_server_submit()) are run on a pool of worker threads until the service
+ * receives SIGINT or SIGTERM. See v2f_server.h for a description of the protocol.
+ */
+
+#include <assert.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/v2f.h"
+#include "../src/log.h"
+#include "../src/v2f_server.h"
+#include "bin_common.h"
+#include "v2f_serve_usage.h" // May be automatically generated
+
+/**
+ * Entry point of the compression service.
+ *
+ * @param argc number of command line arguments.
+ * @param argv command line arguments.
+ *
+ * @return 0 when successful, a different value otherwise.
+ */
+int main(int argc, char *argv[]);
+
+/**
+ * Print the help message for this tool.
+ *
+ * @param file the file where the message is to be printed
+ */
+static void print_help(FILE *file) {
+    fputs(show_usage_string, file);
+}
+
+int main(int argc, char *argv[]) {
+    // Default argument values
+    char const *socket_path = V2F_SERVER_DEFAULT_SOCKET_PATH;
+    uint32_t worker_count = 1;
+
+    // Optional argument parsing
+    int opt;
+    while ((opt = getopt(argc, argv, "S:j:hv")) != -1) {
+        switch (opt) {
+            case 'S':
+                socket_path = optarg;
+                break;
+
+            case 'j':
+                if (parse_positive_integer(optarg, &worker_count, "worker_count") != 0
+                    || worker_count < 1 || worker_count > V2F_C_MAX_THREAD_COUNT) {
+                    fprintf(stderr, "Invalid number of workers. Invoke with -h for help.\n");
+                    return 1;
+                }
+                break;
+
+            case 'h':
+            case 'v':
+                show_banner();
+                print_help(stderr);
+                return 64;
+            case '?':
+                fprintf(stderr, "Invalid option: -%c\n", optopt);
+                print_help(stderr);
+                return 1;
+            default: // LCOV_EXCL_LINE
+                assert(false); // LCOV_EXCL_LINE
+        }
+    }
+
+    if (optind == argc) {
+        log_error("At least one codec must be given");
+        print_help(stderr);
+        return 1;
+    }
+
+    // Signals are handled by the main thread only, so they are blocked before any worker is created.
+    // Writing to a descriptor closed by a client must not kill the service.
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    if (pthread_sigmask(SIG_BLOCK, &stop_signals, NULL) != 0 || signal(SIGPIPE, SIG_IGN) == SIG_ERR) {
+        log_error("Cannot set up signal handling"); // LCOV_EXCL_LINE
+        return 1; // LCOV_EXCL_LINE
+    }
+
+    v2f_server_t server;
+    v2f_error_t status = v2f_server_create(socket_path, worker_count, &server);
+    if (status != V2F_E_NONE) {
+        log_error("Cannot listen at %s: %s", socket_path, v2f_strerror(status));
+        return 1;
+    }
+
+    // Codecs, given as name=path
+    for (int i = optind; i < argc && status == V2F_E_NONE; i++) {
+        char name[V2F_SERVER_MAX_NAME_SIZE];
+        char const *const separator = strchr(argv[i], '=');
+        if (separator == NULL || separator == argv[i] || separator - argv[i] >= V2F_SERVER_MAX_NAME_SIZE) {
+            fprintf(stderr, "Invalid codec '%s'. It must be given as name=path. Invoke with -h for help.\n",
+                    argv[i]);
+            status = V2F_E_INVALID_PARAMETER;
+            break;
+        }
+        memcpy(name, argv[i], (size_t) (separator - argv[i]));
+        name[separator - argv[i]] = '\0';
+        status = v2f_server_add_codec(&server, name, separator + 1, NULL);
+        if (status != V2F_E_NONE) {
+            log_error("Cannot load codec %s: %s", argv[i], v2f_strerror(status));
+        }
+    }
+
+    if (status == V2F_E_NONE) {
+        status = v2f_server_start(&server);
+    }
+    if (status == V2F_E_NONE) {
+        log_info("Listening at %s with %u workers", socket_path, worker_count);
+        int signal_number;
+        if (sigwait(&stop_signals, &signal_number) == 0) {
+            log_info("Received signal %d, stopping", signal_number);
+        }
+    }
+
+    // Running jobs are completed before the server is destroyed
+    const v2f_error_t destroy_status = v2f_server_destroy(&server);
+    if (status == V2F_E_NONE) {
+        status = destroy_status;
+    }
+
+    return status == V2F_E_NONE ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file
+ *
+ * @brief Thin client that submits compression and decompression jobs to v2f_serve.
+ *
+ * The options have the same meaning as in v2f_compress and v2f_decompress,
+ * and are validated by the server.
+ */
+
+#include <assert.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/v2f.h"
+#include "../src/log.h"
+#include "../src/v2f_server.h"
+#include "bin_common.h"
+#include "v2f_submit_usage.h" // May be automatically generated
+
+/// Maximum size of an option field, including its key
+#define V2F_SUBMIT_MAX_OPTION_SIZE 1024
+
+/**
+ * Entry point of the client.
+ *
+ * @param argc number of command line arguments.
+ * @param argv command line arguments.
+ *
+ * @return the status of the job (0 when successful), or a different value if it could not be submitted.
+ */
+int main(int argc, char *argv[]);
+
+/**
+ * Print the help message for this tool.
+ *
+ * @param file the file where the message is to be printed
+ */
+static void print_help(FILE *file) {
+    fputs(show_usage_string, file);
+}
+
+int main(int argc, char *argv[]) {
+    // Default argument values
+    char const *socket_path = V2F_SERVER_DEFAULT_SOCKET_PATH;
+    bool pass_descriptors = false;
+    char options[V2F_SERVER_MAX_FIELD_COUNT - 4][V2F_SUBMIT_MAX_OPTION_SIZE];
+    uint32_t option_count = 0;
+
+    // Optional argument parsing
+    int opt;
+    while ((opt = getopt(argc, argv, "S:q:s:d:w:y:ir:phv")) != -1) {
+        char const *key = NULL;
+        char const *value = optarg;
+        switch (opt) {
+            case 'S':
+                socket_path = optarg;
+                break;
+
+            case 'p':
+                pass_descriptors = true;
+                break;
+
+            case 'q':
+                key = "quantizer_mode";
+                break;
+            case 's':
+                key = "step_size";
+                break;
+            case 'd':
+                key = "decorrelator_mode";
+                break;
+            case 'w':
+                key = "samples_per_row";
+                break;
+            case 'y':
+                key = "shadow_y";
+                break;
+            case 'i':
+                key = "block_index";
+                value = "1";
+                break;
+            case 'r':
+                key = "rows";
+                break;
+
+            case 'h':
+            case 'v':
+                show_banner();
+                print_help(stderr);
+                return 64;
+            case '?':
+                fprintf(stderr, "Invalid option: -%c\n", optopt);
+                print_help(stderr);
+                return 1;
+            default: // LCOV_EXCL_LINE
+                assert(false); // LCOV_EXCL_LINE
+        }
+        if (key != NULL) {
+            // Options are forwarded to the server, where the last repeated one prevails
+            if (option_count == V2F_SERVER_MAX_FIELD_COUNT - 4) {
+                fprintf(stderr, "Too many options. Invoke with -h for help.\n");
+                return 1;
+            }
+            const int size = snprintf(options[option_count], V2F_SUBMIT_MAX_OPTION_SIZE, "%s=%s", key, value);
+            if (size < 0 || size >= V2F_SUBMIT_MAX_OPTION_SIZE) {
+                fprintf(stderr, "Invalid -%c parameter. Invoke with -h for help.\n", opt);
+                return 1;
+            }
+            option_count++;
+        }
+    }
+
+    // Mandatory arguments
+    if (optind + 4 != argc
+        || (strcmp(argv[optind], "compress") != 0 && strcmp(argv[optind], "decompress") != 0)) {
+        fprintf(stderr, "Invalid parameters. Invoke with -h for help.\n");
+        return 1;
+    }
+    char const *const operation = argv[optind];
+    char const *const codec_name = argv[optind + 1];
+    char const *const input_path = argv[optind + 2];
+    char const *const output_path = argv[optind + 3];
+
+    char const *fields[V2F_SERVER_MAX_FIELD_COUNT];
+    fields[0] = operation;
+    fields[1] = codec_name;
+    fields[2] = input_path;
+    fields[3] = output_path;
+    for (uint32_t i = 0; i < option_count; i++) {
+        fields[4 + i] = options[i];
+    }
+
+    // With -p, the files are opened here, with the permissions of the client
+    FILE *input_file = NULL;
+    FILE *output_file = NULL;
+    int passed_fds[2];
+    uint32_t passed_fd_count = 0;
+    if (pass_descriptors) {
+        input_file = fopen(input_path, "r");
+        if (input_file == NULL) {
+            log_error("Cannot open %s for reading", input_path);
+            return V2F_E_IO;
+        }
+        output_file = fopen(output_path, "w");
+        if (output_file == NULL) {
+            log_error("Cannot open %s for writing", output_path);
+            fclose(input_file);
+            return V2F_E_IO;
+        }
+        passed_fds[0] = fileno(input_file);
+        passed_fds[1] = fileno(output_file);
+        passed_fd_count = 2;
+        fields[2] = "-";
+        fields[3] = "-";
+    }
+
+    int socket_fd;
+    v2f_error_t job_status = V2F_E_IO;
+    v2f_error_t status = v2f_server_connect(socket_path, &socket_fd);
+    if (status == V2F_E_NONE) {
+        status = v2f_server_submit(socket_fd, fields, 4 + option_count, passed_fds, passed_fd_count, &job_status);
+        close(socket_fd);
+    }
+    if (pass_descriptors) {
+        fclose(input_file);
+        fclose(output_file);
+    }
+    if (status != V2F_E_NONE) {
+        log_error("Cannot submit job to %s: %s", socket_path, v2f_strerror(status));
+        return 1;
+    }
+
+    log_info("Job %s of %s completed with status %d.", operation, input_path, job_status);
+    if (job_status != V2F_E_NONE) {
+        fprintf(stderr, "Job failed: %s\n", v2f_strerror(job_status));
+    }
+
+    return (int) job_status;
+}
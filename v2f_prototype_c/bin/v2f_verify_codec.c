@@ -176,7 +176,11 @@ int main(int argc, char *argv[]) {
              compressor.decorrelator->max_sample_value);
     log_info("\tOutput word size: %d byte(s)",
              (int) decompressor.entropy_decoder->bytes_per_word);
-    {
+    if (decompressor.entropy_decoder->forest_id != 0) {
+        // Only the compiled tables of built-in forests are available
+        log_info("\tThe V2F forest is the built-in forest with id %u.",
+                 decompressor.entropy_decoder->forest_id);
+    } else {
         uint32_t different_trees = 1;
         void *last_root = decompressor.entropy_decoder->roots[0];
         for (uint32_t i = 1;
@@ -190,31 +194,31 @@ int main(int argc, char *argv[]) {
                 "\tThe V2F forest has %u trees. At most %u of these are different.",
                 decompressor.entropy_decoder->root_count,
                 different_trees);
-    }
-    uint32_t included_nodes = decompressor.entropy_decoder->roots[0]->root_included_count;
-    bool any_different = false;
-    for (uint32_t i = 1; i < decompressor.entropy_decoder->root_count; i++) {
-        if (decompressor.entropy_decoder->roots[0]->root_included_count !=
-            included_nodes) {
-            any_different = true;
-            break;
+        uint32_t included_nodes = decompressor.entropy_decoder->roots[0]->root_included_count;
+        bool any_different = false;
+        for (uint32_t i = 1; i < decompressor.entropy_decoder->root_count; i++) {
+            if (decompressor.entropy_decoder->roots[0]->root_included_count !=
+                included_nodes) {
+                any_different = true;
+                break;
+            }
+        }
+        if (any_different) {
+            log_info("\tThe first tree has %u included nodes. "
+                     "Others have different amounts.", included_nodes);
+        } else {
+            log_info("\tAll trees have %u included nodes.", included_nodes);
+        }
+        const uint32_t optimal_included_nodes =
+                (uint32_t) (UINT64_C(1)
+                        << (8 * decompressor.entropy_decoder->bytes_per_word));
+        if (any_different || (included_nodes != optimal_included_nodes)) {
+            log_warning(
+                    "\tTree size is NOT optimal: all trees should have included exactly %u nodes.",
+                    optimal_included_nodes);
+        } else {
+            log_info("\tTree size IS optimal.");
         }
-    }
-    if (any_different) {
-        log_info("\tThe first tree has %u included nodes. "
-                 "Others have different amounts.", included_nodes);
-    } else {
-        log_info("\tAll trees have %u included nodes.", included_nodes);
-    }
-    const uint32_t optimal_included_nodes =
-            (uint32_t) (UINT64_C(1)
-                    << (8 * decompressor.entropy_decoder->bytes_per_word));
-    if (any_different || (included_nodes != optimal_included_nodes)) {
-        log_warning(
-                "\tTree size is NOT optimal: all trees should have included exactly %u nodes.",
-                optimal_included_nodes);
-    } else {
-        log_info("\tTree size IS optimal.");
     }
 
     log_info("\tQuantizer mode: %d.", compressor.quantizer->mode);
@@ -290,7 +294,7 @@ int main(int argc, char *argv[]) {
         timer_report_human(stdout);
     }
 
-    if (_LOG_LEVEL >= LOG_DEBUG_LEVEL) {
+    if (_LOG_LEVEL >= LOG_DEBUG_LEVEL && compressor.entropy_coder->roots != NULL) {
         log_debug("The codec V2F forest contents are shown next:");
         log_debug("There are %u trees in the forest.",
                  compressor.entropy_coder->root_count);
@@ -65,9 +65,15 @@ int main(int argc, char *argv[]);
 
 void run_one_case(FILE *samples_file, FILE *header_file,
                   FILE *compressed_file, FILE *reconstructed_file) {
-    // Compress
+    // Compress, with a block index so that it is fuzzed too
+    v2f_file_options_t options;
+    if (v2f_file_init_options(&options) != V2F_E_NONE) {
+        abort();
+    }
+    options.thread_count = 1;
+    options.write_block_index = true;
     if (v2f_file_compress_from_file(samples_file, header_file, compressed_file,
-                                    false, 0, false, 0, false, 0, 1, NULL, 0)
+                                    false, 0, false, 0, false, 0, 1, NULL, 0, &options)
         != V2F_E_NONE) {
         log_info("Error compressing with the input data. That's fine.");
         return;
@@ -85,7 +91,7 @@ void run_one_case(FILE *samples_file, FILE *header_file,
     // Decompress
     if (v2f_file_decompress_from_file(
             compressed_file, header_file, reconstructed_file,
-            false, 0, false, 0, false, 0, 1) != 0) {
+            false, 0, false, 0, false, 0, 1, &options) != 0) {
         log_error("Error decompressing. It should not have failed.");
         abort();
     }
@@ -7,14 +7,199 @@
 #include "timer.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
-#include <assert.h>
 #include <sys/time.h>
+#include <pthread.h>
 
 // LCOV_EXCL_START
 
-/// Global instance to keep track of named timers
-global_timer_t global_timer = {.entry_count = 0};
+/**
+ * @struct timer_accumulator_t
+ *
+ * Measurements of one timer.
+ */
+typedef struct {
+    /// @name Current run values (only used by the thread that owns the accumulator)
+
+    /// Number of start calls not yet matched by a stop call.
+    uint32_t running;
+    /// Monotonic clock value when the timer was started, in nanoseconds.
+    uint64_t wall_before_ns;
+    /// Thread CPU clock value when the timer was started, in nanoseconds.
+    uint64_t cpu_before_ns;
+
+    /// @name Global run tracking
+
+    /// Number of times the timer has been stopped
+    uint64_t count;
+    /// Total CPU time in nanoseconds for all start/stop cycles
+    uint64_t total_cpu_ns;
+    /// Total wall time in nanoseconds for all start/stop cycles
+    uint64_t total_wall_ns;
+} timer_accumulator_t;
+
+/**
+ * @struct timer_thread_t
+ *
+ * Accumulators of a thread that has used timers. They are linked in a list
+ * so that they can be merged, and released when the thread exits.
+ */
+typedef struct timer_thread_t {
+    /// Protects the global run tracking members of the accumulators
+    pthread_mutex_t mutex;
+    /// Previous element in the list of threads, or NULL
+    struct timer_thread_t *previous;
+    /// Next element in the list of threads, or NULL
+    struct timer_thread_t *next;
+    /// Accumulators indexed by timer handle
+    timer_accumulator_t accumulators[MAX_TIMERS];
+} timer_thread_t;
+
+/// Names of the registered timers, indexed by handle
+static char timer_names[MAX_TIMERS][NAME_SIZE];
+/// Number of registered timers
+static uint16_t timer_count = 0;
+/// Measurements of threads that have exited, indexed by handle
+static timer_accumulator_t timer_exited_totals[MAX_TIMERS];
+/// List of the accumulators of live threads
+static timer_thread_t *timer_threads = NULL;
+/// Serializes registration, the list of threads and the merge of measurements
+static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/// Key of the accumulators of each thread
+static pthread_key_t timer_thread_key;
+/// Creates @ref timer_thread_key once
+static pthread_once_t timer_thread_key_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Add the measurements of the global run tracking members of `source` to `target`.
+ *
+ * @param target accumulator to be updated
+ * @param source accumulator to be added
+ */
+static void timer_add_totals(timer_accumulator_t *const target, timer_accumulator_t const *const source) {
+    target->count += source->count;
+    target->total_cpu_ns += source->total_cpu_ns;
+    target->total_wall_ns += source->total_wall_ns;
+}
+
+/**
+ * Merge the accumulators of an exiting thread into @ref timer_exited_totals and release them.
+ *
+ * @param thread_pointer accumulators of the thread
+ */
+static void timer_thread_exit(void *thread_pointer) {
+    timer_thread_t *const thread = (timer_thread_t *) thread_pointer;
+    pthread_mutex_lock(&timer_mutex);
+    for (uint16_t i = 0; i < MAX_TIMERS; i++) {
+        timer_add_totals(&timer_exited_totals[i], &thread->accumulators[i]);
+    }
+    if (thread->previous != NULL) {
+        thread->previous->next = thread->next;
+    } else {
+        timer_threads = thread->next;
+    }
+    if (thread->next != NULL) {
+        thread->next->previous = thread->previous;
+    }
+    pthread_mutex_unlock(&timer_mutex);
+    pthread_mutex_destroy(&thread->mutex);
+    free(thread);
+}
+
+/// True if and only if @ref timer_thread_key could be created
+static bool timer_thread_key_created = false;
+
+/**
+ * Create @ref timer_thread_key. If it cannot be created, timers have no effect.
+ */
+static void timer_create_thread_key(void) {
+    if (pthread_key_create(&timer_thread_key, timer_thread_exit) != 0) {
+        fprintf(stderr, "[WARNING] Cannot create the timer thread key - ignoring timers.\n");
+        return;
+    }
+    timer_thread_key_created = true;
+}
+
+/**
+ * Get the accumulators of the calling thread, optionally creating them.
+ *
+ * @param create if true, the accumulators are created if the thread has none
+ *
+ * @return the accumulators of the calling thread, or NULL if there are none
+ */
+static timer_thread_t *timer_get_thread(bool create) {
+    pthread_once(&timer_thread_key_once, timer_create_thread_key);
+    if (!timer_thread_key_created) {
+        return NULL;
+    }
+    timer_thread_t *thread = (timer_thread_t *) pthread_getspecific(timer_thread_key);
+    if (thread != NULL || !create) {
+        return thread;
+    }
+
+    thread = (timer_thread_t *) calloc(1, sizeof(timer_thread_t));
+    if (thread == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&thread->mutex, NULL);
+    if (pthread_setspecific(timer_thread_key, thread) != 0) {
+        pthread_mutex_destroy(&thread->mutex);
+        free(thread);
+        return NULL;
+    }
+    pthread_mutex_lock(&timer_mutex);
+    thread->next = timer_threads;
+    if (timer_threads != NULL) {
+        timer_threads->previous = thread;
+    }
+    timer_threads = thread;
+    pthread_mutex_unlock(&timer_mutex);
+    return thread;
+}
+
+/**
+ * @param clock_id clock to be read
+ * @return the current value of the clock in nanoseconds, or 0 if it cannot be read
+ */
+static uint64_t timer_get_clock_ns(clockid_t clock_id) {
+    struct timespec time;
+    if (clock_gettime(clock_id, &time)) {
+        return 0;
+    }
+    return (uint64_t) time.tv_sec * 1000000000 + (uint64_t) time.tv_nsec;
+}
+
+/**
+ * Find a registered timer by name. @ref timer_mutex must be held.
+ *
+ * @param name name of the timer
+ * @return the handle of the timer, or @ref TIMER_INVALID_HANDLE if it is not registered
+ */
+static timer_handle_t timer_find(char const *const name) {
+    for (uint16_t i = 0; i < timer_count; i++) {
+        if (strcmp(timer_names[i], name) == 0) {
+            return i;
+        }
+    }
+    return TIMER_INVALID_HANDLE;
+}
+
+/**
+ * Merge the measurements of a timer in all threads. @ref timer_mutex must be held.
+ *
+ * @param handle handle of a registered timer
+ * @param totals accumulator where the merged measurements are stored
+ */
+static void timer_merge(timer_handle_t handle, timer_accumulator_t *const totals) {
+    *totals = timer_exited_totals[handle];
+    for (timer_thread_t *thread = timer_threads; thread != NULL; thread = thread->next) {
+        pthread_mutex_lock(&thread->mutex);
+        timer_add_totals(totals, &thread->accumulators[handle]);
+        pthread_mutex_unlock(&thread->mutex);
+    }
+}
 
 double timer_get_wall_time() {
     struct timeval time;
@@ -24,142 +209,163 @@ double timer_get_wall_time() {
     return (double) time.tv_sec + (double) time.tv_usec * .000001;
 }
 
-void timer_start(char const *const name) {
-    bool add_new = true;
-    uint16_t target_index = global_timer.entry_count;
-    for (uint16_t i = 0; i < global_timer.entry_count; i++) {
-        if (strcmp(global_timer.entries[i].name, name) == 0) {
-            add_new = false;
-            target_index = i;
-            break;
+timer_handle_t timer_register(char const *const name) {
+    if (strlen(name) >= NAME_SIZE) {
+        fprintf(stderr, "[WARNING] Name %s too long - ignoring\n", name);
+        return TIMER_INVALID_HANDLE;
+    }
+
+    pthread_mutex_lock(&timer_mutex);
+    timer_handle_t handle = timer_find(name);
+    if (handle == TIMER_INVALID_HANDLE) {
+        if (timer_count == MAX_TIMERS) {
+            fprintf(stderr, "[WARNING] Cannot add any more timers - ignoring.\n");
+        } else {
+            strncpy(timer_names[timer_count], name, NAME_SIZE - 1);
+            handle = timer_count;
+            timer_count++;
         }
     }
+    pthread_mutex_unlock(&timer_mutex);
+
+    return handle;
+}
 
-    if (add_new && global_timer.entry_count == MAX_TIMERS) {
-        fprintf(stderr, "[WARNING] Cannot add any more timers - ignoring.\n");
+void timer_start_handle(timer_handle_t handle) {
+    if (handle >= MAX_TIMERS) {
         return;
     }
-
-    if (strlen(name) >= NAME_SIZE) {
-        fprintf(stderr, "[WARNING] Name %s too long - ignoring\n", name);
+    timer_thread_t *const thread = timer_get_thread(true);
+    if (thread == NULL) {
         return;
     }
 
-    if (!add_new && global_timer.entries[target_index].running) {
-        fprintf(stderr, "[ERROR] Timer %s was already running\n", name);
+    timer_accumulator_t *const accumulator = &thread->accumulators[handle];
+    if (accumulator->running++ > 0) {
         return;
     }
+    accumulator->cpu_before_ns = timer_get_clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    accumulator->wall_before_ns = timer_get_clock_ns(CLOCK_MONOTONIC);
+}
 
-    global_timer.entries[target_index].clock_before =
-            clock();
-    global_timer.entries[target_index].clock_after = 0;
-    global_timer.entries[target_index].wall_before = timer_get_wall_time();
-    global_timer.entries[target_index].wall_after = 0;
-    strncpy(global_timer.entries[target_index].name,
-            name, NAME_SIZE - 1);
+void timer_stop_handle(timer_handle_t handle) {
+    if (handle >= MAX_TIMERS) {
+        return;
+    }
+    timer_thread_t *const thread = timer_get_thread(false);
+    if (thread == NULL || thread->accumulators[handle].running == 0) {
+        return;
+    }
 
-    global_timer.entries[target_index].running = true;
+    timer_accumulator_t *const accumulator = &thread->accumulators[handle];
+    accumulator->running--;
+    const uint64_t wall_after_ns = accumulator->running == 0 ? timer_get_clock_ns(CLOCK_MONOTONIC) : 0;
+    const uint64_t cpu_after_ns = accumulator->running == 0 ? timer_get_clock_ns(CLOCK_THREAD_CPUTIME_ID) : 0;
 
-    if (add_new) {
-        global_timer.entries[target_index].count = 0;
-        global_timer.entries[target_index].total_cpu_s = 0;
-        global_timer.entries[target_index].total_wall_s = 0;
-        assert(target_index == global_timer.entry_count);
-        global_timer.entry_count++;
+    // Only merges and resets from other threads can contend for this lock
+    pthread_mutex_lock(&thread->mutex);
+    accumulator->count++;
+    if (accumulator->running == 0) {
+        accumulator->total_wall_ns += wall_after_ns - accumulator->wall_before_ns;
+        accumulator->total_cpu_ns += cpu_after_ns - accumulator->cpu_before_ns;
     }
+    pthread_mutex_unlock(&thread->mutex);
+}
+
+void timer_start(char const *const name) {
+    timer_start_handle(timer_register(name));
 }
 
 void timer_stop(char const *const name) {
-    bool found = false;
-    for (uint16_t i = 0; i < global_timer.entry_count; i++) {
-        if (strcmp(global_timer.entries[i].name, name) == 0) {
-            if (! global_timer.entries[i].running) {
-                return;
-            }
-
-            global_timer.entries[i].clock_after = clock();
-            global_timer.entries[i].wall_after = timer_get_wall_time();
-            global_timer.entries[i].total_cpu_s +=
-                    ((double) global_timer.entries[i].clock_after -
-                     (double) global_timer.entries[i].clock_before)
-                    / (double) CLOCKS_PER_SEC;
-            global_timer.entries[i].total_wall_s += (
-                    global_timer.entries[i].wall_after -
-                    global_timer.entries[i].wall_before);
-            global_timer.entries[i].running = false;
-            global_timer.entries[i].count++;
-            found = true;
-            break;
-        }
-    }
-    assert(found);
+    timer_stop_handle(timer_register(name));
 }
 
 double timer_get_cpu_s(char const *const name) {
-    for (uint16_t i = 0; i < global_timer.entry_count; i++) {
-        if (strcmp(global_timer.entries[i].name, name) == 0) {
-            if (global_timer.entries[i].clock_after == 0) {
-                return ((double) clock()
-                        - (double) global_timer.entries[i].clock_before)
-                       / (double) CLOCKS_PER_SEC;
-            } else {
-                return ((double) global_timer.entries[i].clock_after
-                        - (double) global_timer.entries[i].clock_before)
-                       / (double) CLOCKS_PER_SEC;
-            }
-        }
+    pthread_mutex_lock(&timer_mutex);
+    const timer_handle_t handle = timer_find(name);
+    timer_accumulator_t totals = {0};
+    if (handle != TIMER_INVALID_HANDLE) {
+        timer_merge(handle, &totals);
     }
+    pthread_mutex_unlock(&timer_mutex);
 
-    // Not found
-    return -1;
+    return handle == TIMER_INVALID_HANDLE ? -1 : (double) totals.total_cpu_ns / 1e9;
 }
 
 double timer_get_wall_s(char const *const name) {
-    for (uint16_t i = 0; i < global_timer.entry_count; i++) {
-        if (strcmp(global_timer.entries[i].name, name) == 0) {
-            if (global_timer.entries[i].wall_after == 0) {
-                return ((double) timer_get_wall_time()
-                        - (double) global_timer.entries[i].wall_before);
-            } else {
-                return ((double) global_timer.entries[i].wall_after
-                        - (double) global_timer.entries[i].wall_before);
-            }
-        }
+    pthread_mutex_lock(&timer_mutex);
+    const timer_handle_t handle = timer_find(name);
+    timer_accumulator_t totals = {0};
+    if (handle != TIMER_INVALID_HANDLE) {
+        timer_merge(handle, &totals);
     }
+    pthread_mutex_unlock(&timer_mutex);
 
-    // Not found
-    return -1;
+    return handle == TIMER_INVALID_HANDLE ? -1 : (double) totals.total_wall_ns / 1e9;
+}
+
+uint64_t timer_get_count(char const *const name) {
+    pthread_mutex_lock(&timer_mutex);
+    const timer_handle_t handle = timer_find(name);
+    timer_accumulator_t totals = {0};
+    if (handle != TIMER_INVALID_HANDLE) {
+        timer_merge(handle, &totals);
+    }
+    pthread_mutex_unlock(&timer_mutex);
+
+    return totals.count;
 }
 
 void timer_report_csv(FILE *const output_file) {
     fprintf(output_file, "name,finished,total_cpu_seconds,total_wall_seconds,"
                          "exec_count,cpu_s_per_exec,wall_s_per_exec\n");
-    for (uint16_t i = 0; i < global_timer.entry_count; i++) {
-        double cpu_seconds = ((double) global_timer.entries[i].clock_after
-                              - (double) global_timer.entries[i].clock_before)
-                             / (double) CLOCKS_PER_SEC;
-        fprintf(output_file, "%s,%3.4lf,%.4lf,%s,%ld,%.4lf,%.4lf\n",
-                global_timer.entries[i].name,
-                global_timer.entries[i].total_cpu_s,
-                global_timer.entries[i].total_wall_s,
-                cpu_seconds >= 0 ? "true" : "false",
-                global_timer.entries[i].count,
-                global_timer.entries[i].total_cpu_s / (double) global_timer.entries[i].count,
-                global_timer.entries[i].total_wall_s / (double) global_timer.entries[i].count);
+    pthread_mutex_lock(&timer_mutex);
+    for (uint16_t i = 0; i < timer_count; i++) {
+        timer_accumulator_t totals;
+        timer_merge(i, &totals);
+        const double total_cpu_s = (double) totals.total_cpu_ns / 1e9;
+        const double total_wall_s = (double) totals.total_wall_ns / 1e9;
+        fprintf(output_file, "%s,%s,%.4lf,%.4lf,%lu,%.4lf,%.4lf\n",
+                timer_names[i],
+                totals.count > 0 ? "true" : "false",
+                total_cpu_s,
+                total_wall_s,
+                totals.count,
+                totals.count > 0 ? total_cpu_s / (double) totals.count : 0,
+                totals.count > 0 ? total_wall_s / (double) totals.count : 0);
     }
+    pthread_mutex_unlock(&timer_mutex);
 }
 
 void timer_report_human(FILE *const output_file) {
-    for (uint16_t i = 0; i < global_timer.entry_count; i++) {
+    pthread_mutex_lock(&timer_mutex);
+    for (uint16_t i = 0; i < timer_count; i++) {
+        timer_accumulator_t totals;
+        timer_merge(i, &totals);
         fprintf(output_file, "%s: total %.06lfs (%lu times)\n",
-                global_timer.entries[i].name,
-                global_timer.entries[i].total_cpu_s,
-                global_timer.entries[i].count);
+                timer_names[i],
+                (double) totals.total_cpu_ns / 1e9,
+                totals.count);
     }
+    pthread_mutex_unlock(&timer_mutex);
 }
 
 void timer_reset() {
-    global_timer.entry_count = 0;
+    pthread_mutex_lock(&timer_mutex);
+    const timer_accumulator_t empty = {0};
+    for (uint16_t i = 0; i < MAX_TIMERS; i++) {
+        timer_exited_totals[i] = empty;
+    }
+    for (timer_thread_t *thread = timer_threads; thread != NULL; thread = thread->next) {
+        pthread_mutex_lock(&thread->mutex);
+        for (uint16_t i = 0; i < MAX_TIMERS; i++) {
+            thread->accumulators[i].count = 0;
+            thread->accumulators[i].total_cpu_ns = 0;
+            thread->accumulators[i].total_wall_ns = 0;
+        }
+        pthread_mutex_unlock(&thread->mutex);
+    }
+    pthread_mutex_unlock(&timer_mutex);
 }
 
 // LCOV_EXCL_STOP
@@ -2,6 +2,15 @@
  * @file
  *
  * @brief Tools to measure execution time.
+ *
+ * Timers are registered once by name with timer_register(), which returns a handle
+ * used to start and stop them. Each thread accumulates its own measurements,
+ * without any lock when a timer is started and only an uncontended one when it is stopped,
+ * so timers can be kept in multi-threaded code. The measurements of all threads
+ * are merged when they are queried or reported.
+ *
+ * Wall time is measured with CLOCK_MONOTONIC and CPU time with the CPU-time clock
+ * of each thread, so the CPU time of a timer is the sum over all threads that used it.
  */
 
 #ifndef TIMER_H
@@ -12,68 +21,81 @@
 #include <string.h>
 #include <stdint.h>
 #include <time.h>
+#include <pthread.h>
 
 /// Maximum tolerance stored in the timer, in seconds
 #define TIMER_TOLERANCE ((double) 1e-2)
 
-/// Maximum number of concurrent timers
+/// Maximum number of registered timers
 #define MAX_TIMERS 256
 /// Maximum name size for each timer
 #define NAME_SIZE 256
 
+/// Handle of a registered timer.
+typedef uint16_t timer_handle_t;
+
+/// Handle returned when a timer cannot be registered. Starting or stopping it has no effect.
+#define TIMER_INVALID_HANDLE ((timer_handle_t) MAX_TIMERS)
+
 /**
- * @struct timer_entry_t
+ * @return the current wall time
+ */
+double timer_get_wall_time(void);
+
+/**
+ * Register a named timer, or find the one already registered with that name.
+ *
+ * Registration takes a global lock and compares names, so it should be done once,
+ * e.g., with pthread_once(), and the handle kept for timer_start_handle()
+ * and timer_stop_handle().
+ *
+ * @param name \0 ended string, case sensitive, that identifies this timer.
+ *   Must have length <= 255.
  *
- * Structure representing one timer entry.
+ * @return the handle of the timer, which is the same for all registrations of `name`,
+ *   or @ref TIMER_INVALID_HANDLE if the name is too long or there are already
+ *   @ref MAX_TIMERS timers.
  */
-typedef struct {
-    /// Timer name
-    char name[NAME_SIZE];
-
-    /// @name Current run values (for the last start/stop cycle)
-
-    /// Is the timer running?
-    bool running;
-    /// Clock value when the timer was started.
-    clock_t clock_before;
-    /// Clock value when the timer was stopped (if it was stoppeD).
-    clock_t clock_after;
-    /// Wall time value when the timer was started.
-    double wall_before;
-    /// Wall time value when the timer was stopped (if it was stoppeD).
-    double wall_after;
-
-    /// @name Global run tracking
-
-    /// Number of start/stop cycles a timer has been run
-    uint64_t count;
-    /// Total CPU time in seconds for all start/stop cycles
-    double total_cpu_s;
-    /// Total wall time in seconds for all start/stop cycles
-    double total_wall_s;
-} timer_entry_t;
+timer_handle_t timer_register(char const *const name);
 
 /**
- * @struct global_timer_t
+ * Define a static function `getter(void)` that returns the handle of the timer `name`,
+ * registering it the first time it is called from any thread.
+ * It must be used at file scope, without a trailing semicolon.
  *
- * Struct holding timer entries.
+ * @param getter name of the defined function
+ * @param name name of the timer
  */
-typedef struct {
-    /// Timer entries
-    timer_entry_t entries[MAX_TIMERS];
-    /// Number of used entries
-    uint16_t entry_count;
-} global_timer_t;
+#define TIMER_DEFINE(getter, name) \
+    static timer_handle_t getter##_handle = TIMER_INVALID_HANDLE; \
+    static pthread_once_t getter##_once = PTHREAD_ONCE_INIT; \
+    static void getter##_register(void) { getter##_handle = timer_register(name); } \
+    static timer_handle_t getter(void) { \
+        pthread_once(&getter##_once, getter##_register); \
+        return getter##_handle; \
+    }
 
-extern global_timer_t global_timer;
+/**
+ * Start a registered timer in the calling thread.
+ *
+ * A timer can be started again by the same thread while it is running;
+ * the current run then lasts from the first start until the last matching stop.
+ *
+ * @param handle handle returned by timer_register()
+ */
+void timer_start_handle(timer_handle_t handle);
 
 /**
- * @return the current wall time
+ * Stop a registered timer started by the calling thread.
+ * Stopping a timer that is not running in the calling thread has no effect.
+ *
+ * @param handle handle returned by timer_register()
  */
-double timer_get_wall_time(void);
+void timer_stop_handle(timer_handle_t handle);
 
 /**
- * Start a named timer. The name must be unique.
+ * Start a named timer, registering it if needed.
+ * This is equivalent to timer_start_handle(timer_register(name)).
  *
  * @param name \0 ended string, case sensitive, that identifies this timer.
  *   Must have length <= 255.
@@ -81,7 +103,8 @@ double timer_get_wall_time(void);
 void timer_start(char const *const name);
 
 /**
- * Stop a named timer. The name must have been used.
+ * Stop a named timer.
+ * This is equivalent to timer_stop_handle(timer_register(name)).
  *
  * @param name \0 ended string, case sensitive, that identifies this timer.
  *   Must have length <= 255.
@@ -89,21 +112,26 @@ void timer_start(char const *const name);
 void timer_stop(char const *const name);
 
 /**
- * Get the current or total process time of a started or finished named timer.
+ * Get the total CPU time of all finished runs of a named timer, in all threads.
  * @param name name of the timer
- * @return CPU execution time in seconds, or -1 if the name is not found in
- *   @ref global_timer.
+ * @return CPU execution time in seconds, or -1 if the name is not registered.
  */
 double timer_get_cpu_s(char const *const name);
 
 /**
- * Get the current or total wall time of a started or finished named timer.
+ * Get the total wall time of all finished runs of a named timer, in all threads.
  * @param name name of the timer
- * @return wall execution time, or -1 if the name is not found in
- *   @ref global_timer
+ * @return wall execution time in seconds, or -1 if the name is not registered.
  */
 double timer_get_wall_s(char const *const name);
 
+/**
+ * Get the number of times a named timer has been stopped, in all threads.
+ * @param name name of the timer
+ * @return the number of stops, or 0 if the name is not registered.
+ */
+uint64_t timer_get_count(char const *const name);
+
 /**
  * Report the timer state into @a output_file in CSV format.
  * @param output_file file where the report is output (e.g., stdout)
@@ -117,7 +145,7 @@ void timer_report_csv(FILE *const output_file);
 void timer_report_human(FILE *const output_file);
 
 /**
- * Resets the timer erasing any previous information
+ * Erase the measurements of all timers. Timers stay registered with the same handles.
  */
 void timer_reset(void);
 
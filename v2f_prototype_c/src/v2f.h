@@ -35,6 +35,15 @@ typedef uint32_t v2f_sample_t;
 /// Maximum value that can be stored in this type
 #define V2F_SAMPLE_T_MAX UINT32_MAX
 
+/**
+ * Unsigned 16-bit sample value. Blocks with at most 2 bytes per sample can be
+ * processed with the *_16 variants of the pipeline functions, which
+ * halve the memory traffic with respect to v2f_sample_t buffers.
+ */
+typedef uint16_t v2f_sample16_t;
+/// Maximum value that can be stored in this type
+#define V2F_SAMPLE16_T_MAX UINT16_MAX
+
 /**
  * Signed sample value. Decorrelation may produce these as intermediate values
  * before sign coding back to v2f_sample_t. Note that in the general pipeline
@@ -67,6 +76,9 @@ typedef enum {
 /// Maximum number of entries in a V2F tree or forest
 #define V2F_C_MAX_ENTRY_COUNT (UINT32_MAX - 1)
 
+/// Maximum number of threads that can be used to compress or decompress a file
+#define V2F_C_MAX_THREAD_COUNT 256
+
 /**
  * @enum v2f_entropy_constants_t
  *
@@ -223,6 +235,15 @@ typedef struct {
      * this value to perform their computations.
      */
     uint64_t samples_per_row;
+
+    /**
+     * Number of threads used to invert each block, at most @ref V2F_C_MAX_THREAD_COUNT.
+     * It is 1 after v2f_decorrelator_create(), and can be increased afterwards.
+     * Only the JPEG-LS mode uses more than one thread: its rows are reconstructed
+     * concurrently as a wavefront, each trailing the previous row.
+     * The output does not depend on this value.
+     */
+    uint32_t thread_count;
 } v2f_decorrelator_t;
 
 /// @name Entropy coding definitions
@@ -245,10 +266,32 @@ typedef struct v2f_entropy_coder_entry_t {
     uint8_t *word_bytes;
 } v2f_entropy_coder_entry_t;
 
+/**
+ * @struct v2f_entropy_coder_state_t
+ *
+ * One state of the compiled transition table of a coder
+ * (see v2f_entropy_coder_compile()). There is one state per node of the forest,
+ * including the roots.
+ */
+typedef struct {
+    /// Position in the coder's transition table of the next state for sample 0.
+    uint64_t first_transition;
+    /**
+     * Number of children of the node. Input samples equal or greater than
+     * this value cause the emission of this state's word.
+     */
+    uint32_t children_count;
+    /// Word bytes emitted when leaving this state, in big endian order.
+    uint8_t word_bytes[V2F_C_MAX_BYTES_PER_WORD];
+} v2f_entropy_coder_state_t;
+
 /**
  * @struct v2f_entropy_coder_t
  *
  * Represent a generic variable to fixed (V2F) coder
+ *
+ * Coders are not modified when compressing: the state of each block is kept in
+ * a v2f_entropy_coder_stream_t, so a coder can be used by several threads at the same time.
  */
 typedef struct {
     /// @name General coder parameters
@@ -265,12 +308,43 @@ typedef struct {
     /// Number of root entries in the coder.
     uint32_t root_count;
 
-    /// @name Auxiliary for efficient coding
+    /// @name Compiled transition table (see v2f_entropy_coder_compile())
 
-    /// Current node in the V2F forest
-    v2f_entropy_coder_entry_t *current_entry;
+    /// Contiguous array of `state_count` states. State 0 is the first root.
+    v2f_entropy_coder_state_t *states;
+    /// Number of states in `states`.
+    uint32_t state_count;
+    /**
+     * Contiguous array of `transition_count` next-state indices.
+     * For a state and an input sample that does not emit a word, the next state
+     * is `transitions[state->first_transition + sample]`. When the word is emitted,
+     * it is `transitions[root_transition_offsets[state->children_count] + sample]`.
+     */
+    uint32_t *transitions;
+    /// Number of elements in `transitions`.
+    uint64_t transition_count;
+    /**
+     * For each possible children count c (0 to max_expected_value + 1),
+     * position in `transitions` of the block of next states of root c.
+     */
+    uint64_t *root_transition_offsets;
 } v2f_entropy_coder_t;
 
+/**
+ * @struct v2f_entropy_coder_stream_t
+ *
+ * State of the compression of a block whose samples are provided in several
+ * calls (see v2f_entropy_coder_stream_start()).
+ */
+typedef struct {
+    /// Index in the coder's `states` of the current state.
+    uint32_t state_index;
+    /// Buffer where the compressed block is written.
+    uint8_t *output_buffer;
+    /// Position in `output_buffer` of the next emitted word.
+    uint8_t *position;
+} v2f_entropy_coder_stream_t;
+
 /// @name Entropy decoding definitions
 
 /**
@@ -298,7 +372,7 @@ typedef struct {
  *
  * This type gives access to all entries within a V2F tree.
  */
-typedef struct {
+typedef struct v2f_entropy_decoder_root_t {
     /// Array of entries ordered by index value
     v2f_entropy_decoder_entry_t *entries_by_index;
     /// Total number of entries in `entries_by_index`.
@@ -317,12 +391,59 @@ typedef struct {
      */
     uint32_t root_included_count;
 
+    /**
+     * Position in the decoder's compiled word table (see v2f_entropy_decoder_compile())
+     * of the word 0 of this root. The `root_included_count` words of the root are
+     * followed by an invalid word.
+     */
+    uint64_t first_word;
 } v2f_entropy_decoder_root_t;
 
+/**
+ * @struct v2f_entropy_decoder_state_t
+ *
+ * Root with which the next word is decoded, as found in the compiled
+ * word table of a decoder (see v2f_entropy_decoder_compile()).
+ */
+typedef struct {
+    /**
+     * Position in the word table of the word 0 of the root. The first element
+     * of the table is the invalid word of the error root, which is
+     * never left once reached.
+     */
+    uint64_t first_word;
+    /// Number of valid words of the root. Larger words are invalid.
+    uint32_t included_count;
+} v2f_entropy_decoder_state_t;
+
+/**
+ * @struct v2f_entropy_decoder_word_t
+ *
+ * Element of the compiled word table of a decoder. There is one
+ * per codeword of each root, plus the invalid words.
+ *
+ * Words only contain positions within the decoder's tables,
+ * so that the tables can be stored in a file and mapped back to memory
+ * (see v2f_file_map_forest_cache()).
+ */
+typedef struct {
+    /// Position of the first sample of the word in the decoder's sample pool.
+    uint64_t sample_offset;
+    /// `first_word` of the state to be used for the next word.
+    uint64_t next_first_word;
+    /// Number of samples represented by the word (0 for invalid words).
+    uint32_t sample_count;
+    /// `included_count` of the state to be used for the next word.
+    uint32_t next_included_count;
+} v2f_entropy_decoder_word_t;
+
 /**
  * @struct v2f_entropy_decoder_t
  *
  * Represent a V2F decoder
+ *
+ * Decoders are not modified when decompressing: the state of each block is kept in
+ * a v2f_entropy_decoder_stream_t, so a decoder can be used by several threads at the same time.
  */
 typedef struct {
     /// Number of bytes per index expected in the compressed data
@@ -340,13 +461,66 @@ typedef struct {
     v2f_entropy_decoder_root_t **roots;
     /// Number of roots in this decoder
     uint32_t root_count;
-    /// Auxiliary pointer to the current root, useful for efficient decoding.
-    v2f_entropy_decoder_root_t *current_root;
-
     /// Auxiliary pointer to the the null entry, needed to avoid memory leaks.
     v2f_entropy_coder_entry_t **null_entry;
+    /// Memory of the forest if read with v2f_file_read_forest(), NULL otherwise.
+    void *forest_arena;
+
+    /// @name Compiled word table (see v2f_entropy_decoder_compile())
+
+    /// Contiguous array with the samples of all words of all roots.
+    v2f_sample_t *sample_pool;
+    /**
+     * Copy of `sample_pool` with 16 bits per sample, used by
+     * v2f_entropy_decoder_decompress_block_16(). NULL if any sample does not fit in 16 bits.
+     */
+    v2f_sample16_t *sample_pool_16;
+    /// Number of samples in `sample_pool` (and in `sample_pool_16`, if not NULL).
+    uint64_t sample_pool_size;
+    /**
+     * Contiguous array of `word_count` elements. The element for `word` read with
+     * root `r` is `words[roots[r]->first_word + word]` if `word` is valid for `r`,
+     * and `words[roots[r]->first_word + roots[r]->root_included_count]` otherwise.
+     * The first element is the invalid word of the error root.
+     */
+    v2f_entropy_decoder_word_t *words;
+    /// Number of elements in `words`.
+    uint64_t word_count;
+    /// State for the first word of each block, i.e., that of `roots[0]`.
+    v2f_entropy_decoder_state_t initial_state;
+
+    /**
+     * Mapped forest cache if the decoder was loaded with v2f_file_map_forest_cache(),
+     * NULL otherwise. The compiled tables of the decoder and of its coder are
+     * then part of this mapping, and `roots` is NULL.
+     */
+    void *forest_cache;
+    /// Size in bytes of `forest_cache`.
+    uint64_t forest_cache_size;
+    /**
+     * Id of the built-in forest whose tables are used by the decoder and its coder
+     * (see v2f_forest_registry_load()), or 0 if the forest is not built-in.
+     */
+    uint32_t forest_id;
 } v2f_entropy_decoder_t;
 
+/**
+ * @struct v2f_entropy_decoder_stream_t
+ *
+ * State of the decompression of a block whose samples are produced in several
+ * calls (see v2f_entropy_decoder_stream_start()).
+ */
+typedef struct {
+    /// State of the decoder for the next word.
+    v2f_entropy_decoder_state_t state;
+    /// Position of the next word in the compressed block.
+    uint8_t const *position;
+    /// Number of words of the compressed block not decoded yet.
+    uint64_t remaining_word_count;
+    /// Number of samples written so far.
+    uint64_t written_sample_count;
+} v2f_entropy_decoder_stream_t;
+
 /// @name Compressor definitions
 
 /**
@@ -411,6 +585,83 @@ typedef enum {
 
 // Functions
 
+/**
+ * @struct v2f_file_options_t
+ *
+ * Optional settings of v2f_file_compress_from_path(), v2f_file_compress_from_file(),
+ * v2f_file_decompress_from_path() and v2f_file_decompress_from_file().
+ *
+ * Instances must be initialized with v2f_file_init_options() before any member is set,
+ * so that members added in later versions keep their defaults.
+ */
+typedef struct {
+    /**
+     * Number of threads used to compress or decompress blocks concurrently.
+     * If 0 or 1, blocks are processed sequentially, unless `pipeline` is true.
+     * Otherwise, another thread reads blocks ahead while they are processed and written.
+     * When decompressing fewer JPEG-LS blocks than threads, the spare threads invert the prediction
+     * of each block as a row wavefront (see v2f_decorrelator_invert_block()).
+     * It must not exceed @ref V2F_C_MAX_THREAD_COUNT. The output does not depend on this value. Default: 0.
+     */
+    uint32_t thread_count;
+    /**
+     * If true and `thread_count` is 0 or 1, blocks are read ahead by one thread and processed
+     * by another one while the calling thread writes them, so that input, coding and output overlap.
+     * Blocks are always pipelined if `thread_count` is greater than 1.
+     * The output does not depend on this value. Default: false.
+     */
+    bool pipeline;
+    /**
+     * If not NULL, path to a forest cache of the header file (see v2f_file_map_forest_cache()).
+     * The forest is mapped from it if it is up to date. Otherwise, the forest is read
+     * from the header file and the cache is rewritten. Default: NULL.
+     */
+    char const *forest_cache_path;
+    /**
+     * Compression only. If true, an index with the position and first sample of each block
+     * is appended to the compressed data, so that decompression of a range of rows
+     * (see `select_rows`) need not read the preceding blocks.
+     * Files with an index can only be decompressed by versions that support it. Default: false.
+     */
+    bool write_block_index;
+    /**
+     * Decompression only. If true, only rows `first_row` to `last_row` (both included) are
+     * reconstructed, and the blocks before them are not decompressed. If the compressed data
+     * have a block index (see `write_block_index`), those blocks are not read either.
+     * Requires a non-zero number of samples per row. Selected rows beyond the end of the data
+     * are ignored. Default: false.
+     */
+    bool select_rows;
+    /// If `select_rows` is true, first reconstructed row. Otherwise, it is ignored. Default: 0.
+    uint32_t first_row;
+    /**
+     * If `select_rows` is true, last reconstructed row, not smaller than `first_row`.
+     * Otherwise, it is ignored. Default: 0.
+     */
+    uint32_t last_row;
+    /**
+     * If true and the input file is a regular file, it is mapped in memory and its samples
+     * or blocks are read in place instead of being copied through stdio buffers.
+     * When decompressing, if the reconstructed file is a regular file too, its final size is
+     * preallocated and the samples are written through a shared mapping of it.
+     * Otherwise, or if the files cannot be mapped, stdio is used.
+     * The output does not depend on this value. Default: false.
+     */
+    bool map_files;
+} v2f_file_options_t;
+
+/**
+ * Set all members of a v2f_file_options_t instance to their defaults.
+ *
+ * @param options options to be initialized
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the options were initialized
+ *  - @ref V2F_E_INVALID_PARAMETER : `options` is NULL
+ */
+V2F_EXPORTED_SYMBOL
+v2f_error_t v2f_file_init_options(v2f_file_options_t *const options);
+
 /**
  * Compress @a raw_file_path into @a utput_file_path using the V2F codec
  * configuration defined in @a output_file_path.
@@ -453,6 +704,8 @@ typedef enum {
  * @param y_shadow_count number of y shadow regions. If y_shadow_count > 1,
  *   then the shadow_y_pairs is expected not to be NULL and to contain exactly
  *   twice as many elements. If shadow_y_paris is NULL, then y_shadow_count must be 0.
+ * @param options if not NULL, optional settings (see v2f_file_options_t). Otherwise, the defaults
+ *   set by v2f_file_init_options() are used. The decompression settings are ignored.
  *
  * @return 0 if and only if compression was successful.
  */
@@ -469,7 +722,8 @@ int v2f_file_compress_from_path(
         v2f_decorrelator_mode_t decorrelator_mode,
         v2f_sample_t samples_per_row,
         uint32_t* shadow_y_pairs,
-        uint32_t y_shadow_count);
+        uint32_t y_shadow_count,
+        v2f_file_options_t const *const options);
 
 /**
  * Compresses an open file into another, using an open header file.
@@ -508,6 +762,8 @@ int v2f_file_compress_from_path(
  * @param y_shadow_count number of y shadow regions. If y_shadow_count > 1,
  *   then the shadow_y_pairs is expected not to be NULL and to contain exactly
  *   twice as many elements. If shadow_y_paris is NULL, then y_shadow_count must be 0.
+ * @param options if not NULL, optional settings (see v2f_file_options_t). Otherwise, the defaults
+ *   set by v2f_file_init_options() are used. The decompression settings are ignored.
  *
  * @return 0 if and only if compression was successful
  */
@@ -524,7 +780,8 @@ int v2f_file_compress_from_file(
         v2f_decorrelator_mode_t decorrelator_mode,
         v2f_sample_t samples_per_row,
         uint32_t* shadow_y_pairs,
-        uint32_t y_shadow_count);
+        uint32_t y_shadow_count,
+        v2f_file_options_t const *const options);
 
 /**
  * Decompress a file @a compressed_file_path produced by @ref v2f_file_compress_from_path,
@@ -557,6 +814,8 @@ int v2f_file_compress_from_file(
  *   this is the decorrelation mode empoyed during decompression.
  *   Otherwise, it is ignored.
  * @param samples_per_row number of samples per row
+ * @param options if not NULL, optional settings (see v2f_file_options_t). Otherwise, the defaults
+ *   set by v2f_file_init_options() are used. The compression settings are ignored.
  *
  * @return 0 if and only if decompression was successful.
  */
@@ -571,7 +830,8 @@ int v2f_file_decompress_from_path(
         v2f_sample_t step_size,
         bool overwrite_decorrelator_mode,
         v2f_decorrelator_mode_t decorrelator_mode,
-        v2f_sample_t samples_per_row);
+        v2f_sample_t samples_per_row,
+        v2f_file_options_t const *const options);
 
 /**
  * Decompresses @a compressed_file into @a reconstructed_file
@@ -600,6 +860,8 @@ int v2f_file_decompress_from_path(
  *   this is the decorrelation mode empoyed during decompression.
  *   Otherwise, it is ignored.
  * @param samples_per_row number of samples per row
+ * @param options if not NULL, optional settings (see v2f_file_options_t). Otherwise, the defaults
+ *   set by v2f_file_init_options() are used. The compression settings are ignored.
  *
  * @return 0 if and only if decompression was successful.
  */
@@ -614,6 +876,285 @@ int v2f_file_decompress_from_file(
         v2f_sample_t step_size,
         bool overwrite_decorrelator_mode,
         v2f_decorrelator_mode_t decorrelator_mode,
+        v2f_sample_t samples_per_row,
+        v2f_file_options_t const *const options);
+
+
+/**
+ * @struct v2f_buffer_forest_t
+ *
+ * Codec definition (V2F forest and default quantizer and decorrelator parameters) loaded
+ * with v2f_buffer_load_forest() or v2f_buffer_load_forest_from_memory(). It is never modified,
+ * and it is shared by all codecs created from it with v2f_buffer_create_codec(), which can be
+ * used concurrently. It is destroyed when it has been released and all its codecs are destroyed.
+ * Its members are not part of the public API.
+ */
+typedef struct v2f_buffer_forest_t v2f_buffer_forest_t;
+
+/**
+ * @struct v2f_buffer_codec_t
+ *
+ * Codec used to compress and decompress caller-provided buffers, with the same format as
+ * v2f_file_compress_from_file() and v2f_file_decompress_from_file().
+ * It references a forest, and only owns its quantizer and decorrelator parameters
+ * and its block buffers. Its members are not part of the public API.
+ *
+ * A codec keeps the block buffers of its last use, so that buffers are not allocated
+ * for each call. It must not be used by two threads at the same time, but codecs
+ * sharing a forest can be used by different threads.
+ */
+typedef struct v2f_buffer_codec_t v2f_buffer_codec_t;
+
+/**
+ * Load a codec definition from a (typically .v2fc) codec file, to be shared
+ * by the codecs created with v2f_buffer_create_codec().
+ *
+ * @param header_file_path path to the file with the codec definition.
+ * @param forest pointer where the loaded forest is stored. It must be released
+ *   with v2f_buffer_release_forest() when no more codecs are to be created from it.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the forest was loaded
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameters, or invalid codec definition
+ *  - @ref V2F_E_IO : the file could not be opened
+ *  - @ref V2F_E_OUT_OF_MEMORY : not enough memory for the forest
+ *  - Any other error produced while reading the codec definition
+ */
+V2F_EXPORTED_SYMBOL
+v2f_error_t v2f_buffer_load_forest(
+        char const *const header_file_path,
+        v2f_buffer_forest_t **const forest);
+
+/**
+ * Load a codec definition from a copy of the contents of a codec file held in memory.
+ * It is otherwise identical in behavior to v2f_buffer_load_forest().
+ *
+ * @param header_data contents of a codec file. They are not needed after this call.
+ * @param header_size number of bytes in `header_data`.
+ * @param forest pointer where the loaded forest is stored. It must be released
+ *   with v2f_buffer_release_forest() when no more codecs are to be created from it.
+ *
+ * @return the same values as v2f_buffer_load_forest().
+ */
+V2F_EXPORTED_SYMBOL
+v2f_error_t v2f_buffer_load_forest_from_memory(
+        uint8_t const *const header_data,
+        uint64_t header_size,
+        v2f_buffer_forest_t **const forest);
+
+/**
+ * Release the reference to a forest returned when loading it. The forest is destroyed
+ * once all codecs created from it are destroyed as well. It can be called from any thread.
+ *
+ * @param forest loaded forest. It must not be used after this call.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the forest was released
+ *  - @ref V2F_E_INVALID_PARAMETER : `forest` is NULL
+ */
+V2F_EXPORTED_SYMBOL
+v2f_error_t v2f_buffer_release_forest(v2f_buffer_forest_t *const forest);
+
+/**
+ * Create a codec that uses a loaded forest, without copying it. It can be called from any thread.
+ *
+ * The created codec uses the quantizer and decorrelator parameters of the codec definition,
+ * and 0 samples per row, until v2f_buffer_configure_codec() is called.
+ *
+ * @param forest loaded forest, not released yet.
+ * @param codec pointer where the created codec is stored. It must be destroyed
+ *   with v2f_buffer_destroy_codec() after use.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the codec was created
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameters
+ *  - @ref V2F_E_OUT_OF_MEMORY : not enough memory for the codec
+ */
+V2F_EXPORTED_SYMBOL
+v2f_error_t v2f_buffer_create_codec(
+        v2f_buffer_forest_t *const forest,
+        v2f_buffer_codec_t **const codec);
+
+/**
+ * Load a codec from a (typically .v2fc) codec file, with a forest used only by this codec.
+ * It is equivalent to v2f_buffer_load_forest(), v2f_buffer_create_codec() and v2f_buffer_release_forest().
+ *
+ * @param header_file_path path to the file with the codec definition.
+ * @param codec pointer where the loaded codec is stored. It must be destroyed
+ *   with v2f_buffer_destroy_codec() after use.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the codec was loaded
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameters, or invalid codec definition
+ *  - @ref V2F_E_IO : the file could not be opened
+ *  - @ref V2F_E_OUT_OF_MEMORY : not enough memory for the codec
+ *  - Any other error produced while reading the codec definition
+ */
+V2F_EXPORTED_SYMBOL
+v2f_error_t v2f_buffer_load_codec(
+        char const *const header_file_path,
+        v2f_buffer_codec_t **const codec);
+
+/**
+ * Load a codec from a copy of the contents of a codec file held in memory.
+ * It is otherwise identical in behavior to v2f_buffer_load_codec().
+ *
+ * @param header_data contents of a codec file. They are not needed after this call.
+ * @param header_size number of bytes in `header_data`.
+ * @param codec pointer where the loaded codec is stored. It must be destroyed
+ *   with v2f_buffer_destroy_codec() after use.
+ *
+ * @return the same values as v2f_buffer_load_codec().
+ */
+V2F_EXPORTED_SYMBOL
+v2f_error_t v2f_buffer_load_codec_from_memory(
+        uint8_t const *const header_data,
+        uint64_t header_size,
+        v2f_buffer_codec_t **const codec);
+
+/**
+ * Overwrite the quantizer and decorrelator parameters of a loaded codec, and set
+ * its number of samples per row. Parameters have the same meaning as those of
+ * v2f_file_compress_from_path() and v2f_file_decompress_from_path(), and apply
+ * to all subsequent calls with this codec.
+ *
+ * @param codec loaded codec.
+ * @param overwrite_quantizer_mode if true, the quantizer mode is overwritten.
+ * @param quantizer_mode new quantizer mode if @a overwrite_quantizer_mode is true.
+ * @param overwrite_qstep if true, the quantizer step size is overwritten.
+ * @param step_size new step size, between 1 and 255, if @a overwrite_qstep is true.
+ * @param overwrite_decorrelator_mode if true, the decorrelator mode is overwritten.
+ * @param decorrelator_mode new decorrelator mode if @a overwrite_decorrelator_mode is true.
+ * @param samples_per_row number of samples per row. It must not be 0 if the resulting
+ *   decorrelator mode needs it.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the codec was configured
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameters. The codec is not modified.
+ */
+V2F_EXPORTED_SYMBOL
+v2f_error_t v2f_buffer_configure_codec(
+        v2f_buffer_codec_t *const codec,
+        bool overwrite_quantizer_mode,
+        v2f_quantizer_mode_t quantizer_mode,
+        bool overwrite_qstep,
+        v2f_sample_t step_size,
+        bool overwrite_decorrelator_mode,
+        v2f_decorrelator_mode_t decorrelator_mode,
         v2f_sample_t samples_per_row);
 
+/**
+ * Free all resources of a codec, and its reference to its forest.
+ *
+ * @param codec codec to be destroyed.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the codec was destroyed
+ *  - @ref V2F_E_INVALID_PARAMETER : `codec` is NULL
+ */
+V2F_EXPORTED_SYMBOL
+v2f_error_t v2f_buffer_destroy_codec(v2f_buffer_codec_t *const codec);
+
+/**
+ * Compute the largest number of bytes that v2f_buffer_compress() can produce
+ * for a raw buffer of a given size with this codec.
+ *
+ * @param codec loaded codec.
+ * @param raw_size number of bytes of the raw buffer.
+ * @param max_compressed_size pointer where the bound is stored.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the bound was computed
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameters, or `raw_size` is not
+ *    a multiple of the number of bytes per sample of the codec
+ */
+V2F_EXPORTED_SYMBOL
+v2f_error_t v2f_buffer_get_max_compressed_size(
+        v2f_buffer_codec_t const *const codec,
+        uint64_t raw_size,
+        uint64_t *const max_compressed_size);
+
+/**
+ * Compute the number of bytes of the samples reconstructed by v2f_buffer_decompress()
+ * from a compressed buffer. Only the block envelopes are read.
+ *
+ * @param codec loaded codec.
+ * @param compressed_data compressed data, as produced by v2f_buffer_compress().
+ * @param compressed_size number of bytes in `compressed_data`.
+ * @param reconstructed_size pointer where the size is stored.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the size was computed
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameters
+ *  - @ref V2F_E_CORRUPTED_DATA : the block envelopes are not valid
+ */
+V2F_EXPORTED_SYMBOL
+v2f_error_t v2f_buffer_get_reconstructed_size(
+        v2f_buffer_codec_t const *const codec,
+        uint8_t const *const compressed_data,
+        uint64_t compressed_size,
+        uint64_t *const reconstructed_size);
+
+/**
+ * Compress a buffer of big-endian samples into a buffer, producing the same bytes as
+ * v2f_file_compress_from_file() without shadow regions and without block index.
+ * No I/O is performed.
+ *
+ * @param codec loaded codec.
+ * @param raw_data big-endian samples with the number of bytes per sample of the codec.
+ * @param raw_size number of bytes in `raw_data`. It must be a multiple of the number
+ *   of bytes per sample, and of the number of samples per row if not 0.
+ * @param compressed_data buffer where the compressed data are stored.
+ * @param compressed_capacity number of bytes available in `compressed_data`.
+ *   Its contents are unspecified if it is smaller than the compressed data.
+ *   A capacity given by v2f_buffer_get_max_compressed_size() is always enough.
+ * @param compressed_size pointer where the number of bytes of the compressed data is stored.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : all samples were compressed
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameters, or `compressed_capacity`
+ *    is too small for the compressed data
+ *  - @ref V2F_E_OUT_OF_MEMORY : not enough memory for the block buffers
+ *  - Any error produced while compressing the blocks
+ */
+V2F_EXPORTED_SYMBOL
+v2f_error_t v2f_buffer_compress(
+        v2f_buffer_codec_t *const codec,
+        uint8_t const *const raw_data,
+        uint64_t raw_size,
+        uint8_t *const compressed_data,
+        uint64_t compressed_capacity,
+        uint64_t *const compressed_size);
+
+/**
+ * Decompress a buffer produced by v2f_buffer_compress() or v2f_file_compress_from_file()
+ * into a buffer of big-endian samples, producing the same bytes as v2f_file_decompress_from_file().
+ * A block index at the end of the compressed data is ignored. No I/O is performed.
+ *
+ * @param codec loaded codec, configured as when the data were compressed.
+ * @param compressed_data compressed data.
+ * @param compressed_size number of bytes in `compressed_data`.
+ * @param reconstructed_data buffer where the reconstructed samples are stored.
+ * @param reconstructed_capacity number of bytes available in `reconstructed_data`.
+ *   Its contents are unspecified if it is smaller than the reconstructed samples.
+ *   A capacity given by v2f_buffer_get_reconstructed_size() is always enough.
+ * @param reconstructed_size pointer where the number of bytes of the reconstructed samples is stored.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : all blocks were decompressed
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameters, or `reconstructed_capacity`
+ *    is too small for the reconstructed samples
+ *  - @ref V2F_E_CORRUPTED_DATA : the compressed data are not valid
+ *  - @ref V2F_E_OUT_OF_MEMORY : not enough memory for the block buffers
+ *  - Any error produced while decompressing the blocks
+ */
+V2F_EXPORTED_SYMBOL
+v2f_error_t v2f_buffer_decompress(
+        v2f_buffer_codec_t *const codec,
+        uint8_t const *const compressed_data,
+        uint64_t compressed_size,
+        uint8_t *const reconstructed_data,
+        uint64_t reconstructed_capacity,
+        uint64_t *const reconstructed_size);
+
 #endif /* V2F_H */
@@ -0,0 +1,627 @@
+/**
+ * @file v2f_buffer.c
+ *
+ * Implementation of the buffer-to-buffer compression API declared in v2f.h.
+ *
+ * Forests hold everything read from a codec definition, and are never modified
+ * once loaded: compression and decompression keep their state in the stack
+ * (see v2f_entropy_coder_stream_t and v2f_entropy_decoder_stream_t). Codecs only add
+ * their own quantizer and decorrelator parameters and block buffers, so any number of them,
+ * used by any number of threads, can share one copy of a forest.
+ *
+ * Compressed buffers contain the same block envelopes as compressed files
+ * (see v2f_file_compress_from_file()): for each block, the size of its bitstream
+ * and its number of samples, as 4-byte unsigned big-endian integers, followed by the bitstream.
+ */
+
+#include "v2f.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "v2f_compressor.h"
+#include "v2f_decompressor.h"
+#include "v2f_entropy_coder.h"
+#include "v2f_file.h"
+
+/// Number of bytes of the header of a block envelope
+#define V2F_BUFFER_ENVELOPE_HEADER_SIZE 8
+
+/**
+ * @struct v2f_buffer_forest_t
+ *
+ * Codec definition shared by all codecs created with it (see v2f.h).
+ */
+struct v2f_buffer_forest_t {
+    /// Compressor read from the codec definition. It is not modified after loading.
+    v2f_compressor_t compressor;
+    /// Decompressor read from the codec definition. It shares its quantizer and decorrelator with `compressor`.
+    v2f_decompressor_t decompressor;
+    /// Number of references: the one returned when loading, until released, plus one per codec.
+    uint32_t reference_count;
+    /// Protects `reference_count`.
+    pthread_mutex_t mutex;
+};
+
+/**
+ * @struct v2f_buffer_codec_t
+ *
+ * Codec for buffer-to-buffer operation (see v2f.h). Only its quantizer, decorrelator
+ * and block buffers belong to it. Its entropy coder and decoder are those of its forest.
+ */
+struct v2f_buffer_codec_t {
+    /// Forest referenced by this codec.
+    v2f_buffer_forest_t *forest;
+    /// Quantizer of this codec, used by `compressor` and `decompressor`.
+    v2f_quantizer_t quantizer;
+    /// Decorrelator of this codec, used by `compressor` and `decompressor`.
+    v2f_decorrelator_t decorrelator;
+    /// Compressor made of this codec's quantizer and decorrelator and of the forest's entropy coder.
+    v2f_compressor_t compressor;
+    /// Decompressor made of this codec's quantizer and decorrelator and of the forest's entropy decoder.
+    v2f_decompressor_t decompressor;
+    /// Number of bytes per raw sample.
+    uint8_t bytes_per_sample;
+    /// Buffer for `sample_capacity` samples when bytes_per_sample > 2, or NULL.
+    v2f_sample_t *samples;
+    /// Buffer for `sample_capacity` samples when bytes_per_sample <= 2, or NULL.
+    v2f_sample16_t *samples_16;
+    /// Number of samples that fit in the sample buffer.
+    uint64_t sample_capacity;
+    /// Buffer for blocks whose bitstream might not fit in the caller's output, or NULL.
+    uint8_t *bitstream;
+    /// Number of bytes that fit in `bitstream`.
+    uint64_t bitstream_capacity;
+};
+
+/**
+ * Read a codec definition and create a forest with it.
+ *
+ * @param header_file file open for reading, positioned at the start of the codec definition
+ * @param forest pointer where the created forest is stored
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the forest was created
+ *  - @ref V2F_E_OUT_OF_MEMORY : not enough memory for the forest
+ *  - Any error returned by v2f_file_read_codec()
+ */
+static v2f_error_t v2f_buffer_read_forest(FILE *header_file, v2f_buffer_forest_t **const forest) {
+    v2f_buffer_forest_t *const new_forest = calloc(1, sizeof(v2f_buffer_forest_t));
+    if (new_forest == NULL) {
+        return V2F_E_OUT_OF_MEMORY; // LCOV_EXCL_LINE
+    }
+    const v2f_error_t status = v2f_file_read_codec(
+            header_file, &(new_forest->compressor), &(new_forest->decompressor));
+    if (status != V2F_E_NONE) {
+        log_error("Error reading the V2F codec definition");
+        free(new_forest);
+        return status;
+    }
+    if (pthread_mutex_init(&(new_forest->mutex), NULL) != 0) {
+        // LCOV_EXCL_START
+        v2f_file_destroy_read_codec(&(new_forest->compressor), &(new_forest->decompressor));
+        free(new_forest);
+        return V2F_E_OUT_OF_MEMORY;
+        // LCOV_EXCL_STOP
+    }
+    new_forest->reference_count = 1;
+
+    *forest = new_forest;
+    return V2F_E_NONE;
+}
+
+/**
+ * Make sure that the sample buffer of a codec can hold a number of samples.
+ * Its previous contents are not kept.
+ *
+ * @param codec codec whose buffer is grown if needed
+ * @param sample_count number of samples, at most @ref V2F_C_MAX_BLOCK_SIZE
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the buffer is large enough
+ *  - @ref V2F_E_OUT_OF_MEMORY : the buffer could not be grown
+ */
+static v2f_error_t v2f_buffer_reserve_samples(v2f_buffer_codec_t *const codec, uint64_t sample_count) {
+    if (sample_count <= codec->sample_capacity) {
+        return V2F_E_NONE;
+    }
+
+    free(codec->samples);
+    free(codec->samples_16);
+    codec->samples = NULL;
+    codec->samples_16 = NULL;
+    codec->sample_capacity = 0;
+    if (codec->bytes_per_sample <= 2) {
+        codec->samples_16 = malloc(sizeof(v2f_sample16_t) * sample_count);
+    } else {
+        codec->samples = malloc(sizeof(v2f_sample_t) * sample_count);
+    }
+    if (codec->samples == NULL && codec->samples_16 == NULL) {
+        return V2F_E_OUT_OF_MEMORY; // LCOV_EXCL_LINE
+    }
+    codec->sample_capacity = sample_count;
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Make sure that the bitstream buffer of a codec can hold a number of bytes.
+ * Its previous contents are not kept.
+ *
+ * @param codec codec whose buffer is grown if needed
+ * @param size number of bytes, at most @ref V2F_C_MAX_COMPRESSED_BLOCK_SIZE
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the buffer is large enough
+ *  - @ref V2F_E_OUT_OF_MEMORY : the buffer could not be grown
+ */
+static v2f_error_t v2f_buffer_reserve_bitstream(v2f_buffer_codec_t *const codec, uint64_t size) {
+    if (size <= codec->bitstream_capacity) {
+        return V2F_E_NONE;
+    }
+
+    free(codec->bitstream);
+    codec->bitstream_capacity = 0;
+    codec->bitstream = malloc(size);
+    if (codec->bitstream == NULL) {
+        return V2F_E_OUT_OF_MEMORY; // LCOV_EXCL_LINE
+    }
+    codec->bitstream_capacity = size;
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Return the number of samples of the blocks in which raw data are split,
+ * as in v2f_file_compress_from_file(). The last block may be shorter.
+ *
+ * @param codec loaded codec
+ *
+ * @return the number of samples per block, a multiple of the number of samples per row if not 0
+ */
+static uint64_t v2f_buffer_block_length(v2f_buffer_codec_t const *const codec) {
+    const uint64_t samples_per_row = codec->compressor.decorrelator->samples_per_row;
+    return samples_per_row > 0 ?
+           V2F_C_MAX_BLOCK_SIZE - V2F_C_MAX_BLOCK_SIZE % samples_per_row :
+           V2F_C_MAX_BLOCK_SIZE;
+}
+
+/**
+ * Read the next block envelope of a compressed buffer.
+ * Envelopes are validated as in v2f_file_decompress_from_file().
+ *
+ * @param codec loaded codec
+ * @param compressed_data compressed data
+ * @param compressed_size number of bytes in `compressed_data`
+ * @param position position of the envelope in `compressed_data`. It is advanced
+ *   to the next envelope.
+ * @param bitstream_size pointer where the size of the bitstream of the block is stored
+ * @param sample_count pointer where the number of samples of the block is stored.
+ *   It is set to 0 at the end of the data, or if a block index starts at `position`.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : an envelope was read, or no more envelopes are available
+ *  - @ref V2F_E_CORRUPTED_DATA : the envelope is not valid or incomplete
+ */
+static v2f_error_t v2f_buffer_read_envelope(
+        v2f_buffer_codec_t const *const codec,
+        uint8_t const *const compressed_data,
+        uint64_t compressed_size,
+        uint64_t *const position,
+        uint64_t *const bitstream_size,
+        uint64_t *const sample_count) {
+    *bitstream_size = 0;
+    *sample_count = 0;
+    if (*position == compressed_size) {
+        return V2F_E_NONE;
+    }
+    if (compressed_size - *position < V2F_BUFFER_ENVELOPE_HEADER_SIZE) {
+        log_error("Incomplete envelope at position %lu", *position);
+        return V2F_E_CORRUPTED_DATA;
+    }
+
+    const v2f_sample_t envelope_bitstream_size =
+            v2f_entropy_coder_buffer_to_sample(compressed_data + *position, 4);
+    const v2f_sample_t envelope_sample_count =
+            v2f_entropy_coder_buffer_to_sample(compressed_data + *position + 4, 4);
+    *position += V2F_BUFFER_ENVELOPE_HEADER_SIZE;
+    if (envelope_bitstream_size == 0 && envelope_sample_count == 0) {
+        // Empty envelope that starts the block index, which is not needed here
+        return V2F_E_NONE;
+    }
+    if (envelope_bitstream_size > V2F_C_MAX_COMPRESSED_BLOCK_SIZE
+        || envelope_bitstream_size % codec->decompressor.entropy_decoder->bytes_per_word != 0
+        || envelope_bitstream_size > compressed_size - *position
+        || envelope_sample_count < V2F_C_MIN_BLOCK_SIZE
+        || envelope_sample_count > V2F_C_MAX_BLOCK_SIZE) {
+        log_error("Corrupted envelope (compressed_bitstream_size=%u, sample_count=%u)",
+                  envelope_bitstream_size, envelope_sample_count);
+        return V2F_E_CORRUPTED_DATA;
+    }
+
+    *bitstream_size = envelope_bitstream_size;
+    *sample_count = envelope_sample_count;
+    *position += envelope_bitstream_size;
+
+    return V2F_E_NONE;
+}
+
+// Declared in v2f.h
+v2f_error_t v2f_buffer_load_forest(
+        char const *const header_file_path,
+        v2f_buffer_forest_t **const forest) {
+    if (header_file_path == NULL || forest == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    FILE *header_file = fopen(header_file_path, "r");
+    if (header_file == NULL) {
+        log_error("Cannot open V2F header file %s for reading.", header_file_path);
+        return V2F_E_IO;
+    }
+    const v2f_error_t status = v2f_buffer_read_forest(header_file, forest);
+    fclose(header_file);
+
+    return status;
+}
+
+// Declared in v2f.h
+v2f_error_t v2f_buffer_load_forest_from_memory(
+        uint8_t const *const header_data,
+        uint64_t header_size,
+        v2f_buffer_forest_t **const forest) {
+    if (header_data == NULL || header_size == 0 || header_size > SIZE_MAX || forest == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    // The codec definition is parsed with the same functions as codec files.
+    // Streams opened with mode "r" never write to their buffer.
+    FILE *header_file = fmemopen((void *) (uintptr_t) header_data, (size_t) header_size, "r");
+    if (header_file == NULL) {
+        return V2F_E_OUT_OF_MEMORY; // LCOV_EXCL_LINE
+    }
+    const v2f_error_t status = v2f_buffer_read_forest(header_file, forest);
+    fclose(header_file);
+
+    return status;
+}
+
+// Declared in v2f.h
+v2f_error_t v2f_buffer_release_forest(v2f_buffer_forest_t *const forest) {
+    if (forest == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    pthread_mutex_lock(&(forest->mutex));
+    assert(forest->reference_count > 0);
+    const uint32_t reference_count = --(forest->reference_count);
+    pthread_mutex_unlock(&(forest->mutex));
+    if (reference_count > 0) {
+        return V2F_E_NONE;
+    }
+
+    const v2f_error_t status = v2f_file_destroy_read_codec(&(forest->compressor), &(forest->decompressor));
+    pthread_mutex_destroy(&(forest->mutex));
+    free(forest);
+
+    return status;
+}
+
+// Declared in v2f.h
+v2f_error_t v2f_buffer_create_codec(
+        v2f_buffer_forest_t *const forest,
+        v2f_buffer_codec_t **const codec) {
+    if (forest == NULL || codec == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    v2f_buffer_codec_t *const new_codec = calloc(1, sizeof(v2f_buffer_codec_t));
+    if (new_codec == NULL) {
+        return V2F_E_OUT_OF_MEMORY; // LCOV_EXCL_LINE
+    }
+    pthread_mutex_lock(&(forest->mutex));
+    const bool is_referenced = forest->reference_count < UINT32_MAX;
+    if (is_referenced) {
+        forest->reference_count++;
+    }
+    pthread_mutex_unlock(&(forest->mutex));
+    if (!is_referenced) {
+        // LCOV_EXCL_START
+        log_error("Too many references to the forest");
+        free(new_codec);
+        return V2F_E_INVALID_PARAMETER;
+        // LCOV_EXCL_STOP
+    }
+
+    // The forest's quantizer and decorrelator hold the parameters of the codec definition
+    new_codec->forest = forest;
+    new_codec->quantizer = *(forest->compressor.quantizer);
+    new_codec->decorrelator = *(forest->compressor.decorrelator);
+    new_codec->decorrelator.samples_per_row = 0;
+    new_codec->compressor.quantizer = &(new_codec->quantizer);
+    new_codec->compressor.decorrelator = &(new_codec->decorrelator);
+    new_codec->compressor.entropy_coder = forest->compressor.entropy_coder;
+    new_codec->decompressor.quantizer = &(new_codec->quantizer);
+    new_codec->decompressor.decorrelator = &(new_codec->decorrelator);
+    new_codec->decompressor.entropy_decoder = forest->decompressor.entropy_decoder;
+    new_codec->bytes_per_sample = forest->decompressor.entropy_decoder->bytes_per_sample;
+
+    *codec = new_codec;
+    return V2F_E_NONE;
+}
+
+// Declared in v2f.h
+v2f_error_t v2f_buffer_load_codec(
+        char const *const header_file_path,
+        v2f_buffer_codec_t **const codec) {
+    if (codec == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    // The codec keeps the only reference to the forest
+    v2f_buffer_forest_t *forest;
+    RETURN_IF_FAIL(v2f_buffer_load_forest(header_file_path, &forest));
+    const v2f_error_t status = v2f_buffer_create_codec(forest, codec);
+    const v2f_error_t release_status = v2f_buffer_release_forest(forest);
+
+    return status != V2F_E_NONE ? status : release_status;
+}
+
+// Declared in v2f.h
+v2f_error_t v2f_buffer_load_codec_from_memory(
+        uint8_t const *const header_data,
+        uint64_t header_size,
+        v2f_buffer_codec_t **const codec) {
+    if (codec == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    v2f_buffer_forest_t *forest;
+    RETURN_IF_FAIL(v2f_buffer_load_forest_from_memory(header_data, header_size, &forest));
+    const v2f_error_t status = v2f_buffer_create_codec(forest, codec);
+    const v2f_error_t release_status = v2f_buffer_release_forest(forest);
+
+    return status != V2F_E_NONE ? status : release_status;
+}
+
+// Declared in v2f.h
+v2f_error_t v2f_buffer_configure_codec(
+        v2f_buffer_codec_t *const codec,
+        bool overwrite_quantizer_mode,
+        v2f_quantizer_mode_t quantizer_mode,
+        bool overwrite_qstep,
+        v2f_sample_t step_size,
+        bool overwrite_decorrelator_mode,
+        v2f_decorrelator_mode_t decorrelator_mode,
+        v2f_sample_t samples_per_row) {
+    if (codec == NULL
+        || (overwrite_quantizer_mode && quantizer_mode >= V2F_C_QUANTIZER_MODE_COUNT)
+        || (overwrite_qstep && (step_size < 1 || step_size > 255))
+        || (overwrite_decorrelator_mode && decorrelator_mode >= V2F_C_DECORRELATOR_MODE_COUNT)
+        || samples_per_row > V2F_C_MAX_BLOCK_SIZE) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    const v2f_decorrelator_mode_t effective_decorrelator_mode =
+            overwrite_decorrelator_mode ? decorrelator_mode : codec->compressor.decorrelator->mode;
+    if ((effective_decorrelator_mode == V2F_C_DECORRELATOR_MODE_JPEG_LS
+         || effective_decorrelator_mode == V2F_C_DECORRELATOR_MODE_FGIJ)
+        && samples_per_row == 0) {
+        log_error("Samples per row was not provided, but the decorrelator mode requires it");
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    // The decompressor uses the same quantizer and decorrelator
+    if (overwrite_quantizer_mode) {
+        codec->compressor.quantizer->mode = quantizer_mode;
+    }
+    if (overwrite_qstep) {
+        codec->compressor.quantizer->step_size = step_size;
+    }
+    if (overwrite_decorrelator_mode) {
+        codec->compressor.decorrelator->mode = decorrelator_mode;
+    }
+    codec->compressor.decorrelator->samples_per_row = samples_per_row;
+
+    return V2F_E_NONE;
+}
+
+// Declared in v2f.h
+v2f_error_t v2f_buffer_destroy_codec(v2f_buffer_codec_t *const codec) {
+    if (codec == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    const v2f_error_t status = v2f_buffer_release_forest(codec->forest);
+    free(codec->samples);
+    free(codec->samples_16);
+    free(codec->bitstream);
+    free(codec);
+
+    return status;
+}
+
+// Declared in v2f.h
+v2f_error_t v2f_buffer_get_max_compressed_size(
+        v2f_buffer_codec_t const *const codec,
+        uint64_t raw_size,
+        uint64_t *const max_compressed_size) {
+    // The size limit prevents overflows below
+    if (codec == NULL || max_compressed_size == NULL
+        || raw_size % codec->bytes_per_sample != 0
+        || raw_size > UINT64_MAX / V2F_C_MAX_BYTES_PER_WORD / 2) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    // Each block produces an envelope header and, at most, one word per sample
+    const uint64_t sample_count = raw_size / codec->bytes_per_sample;
+    const uint64_t block_length = v2f_buffer_block_length(codec);
+    const uint64_t block_count = sample_count / block_length + (sample_count % block_length != 0 ? 1 : 0);
+    *max_compressed_size = sample_count * codec->compressor.entropy_coder->bytes_per_word
+                           + block_count * V2F_BUFFER_ENVELOPE_HEADER_SIZE;
+
+    return V2F_E_NONE;
+}
+
+// Declared in v2f.h
+v2f_error_t v2f_buffer_get_reconstructed_size(
+        v2f_buffer_codec_t const *const codec,
+        uint8_t const *const compressed_data,
+        uint64_t compressed_size,
+        uint64_t *const reconstructed_size) {
+    if (codec == NULL || reconstructed_size == NULL
+        || (compressed_data == NULL && compressed_size > 0)) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    uint64_t position = 0;
+    uint64_t sample_count = 0;
+    while (true) {
+        uint64_t bitstream_size;
+        uint64_t block_sample_count;
+        RETURN_IF_FAIL(v2f_buffer_read_envelope(
+                codec, compressed_data, compressed_size, &position, &bitstream_size, &block_sample_count));
+        if (block_sample_count == 0) {
+            break;
+        }
+        sample_count += block_sample_count;
+    }
+    *reconstructed_size = sample_count * codec->bytes_per_sample;
+
+    return V2F_E_NONE;
+}
+
+// Declared in v2f.h
+v2f_error_t v2f_buffer_compress(
+        v2f_buffer_codec_t *const codec,
+        uint8_t const *const raw_data,
+        uint64_t raw_size,
+        uint8_t *const compressed_data,
+        uint64_t compressed_capacity,
+        uint64_t *const compressed_size) {
+    if (codec == NULL || compressed_size == NULL
+        || (raw_data == NULL && raw_size > 0)
+        || (compressed_data == NULL && compressed_capacity > 0)
+        || raw_size % codec->bytes_per_sample != 0) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    const uint64_t sample_count = raw_size / codec->bytes_per_sample;
+    const uint64_t samples_per_row = codec->compressor.decorrelator->samples_per_row;
+    if (samples_per_row > 0 && sample_count % samples_per_row != 0) {
+        log_error("The image did not have a size multiple of the provided samples per row");
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    // Blocks are split as in v2f_file_compress_from_file(). Bitstreams are produced
+    // directly in the output whenever their worst case fits there.
+    const uint64_t block_length = v2f_buffer_block_length(codec);
+    const uint8_t bytes_per_word = codec->compressor.entropy_coder->bytes_per_word;
+    RETURN_IF_FAIL(v2f_buffer_reserve_samples(codec, sample_count < block_length ? sample_count : block_length));
+    uint64_t position = 0;
+    for (uint64_t first_sample = 0; first_sample < sample_count; first_sample += block_length) {
+        const uint64_t block_sample_count =
+                sample_count - first_sample < block_length ? sample_count - first_sample : block_length;
+        if (compressed_capacity - position < V2F_BUFFER_ENVELOPE_HEADER_SIZE) {
+            log_error("The compressed data do not fit in the output buffer");
+            return V2F_E_INVALID_PARAMETER;
+        }
+        uint8_t *const envelope = compressed_data + position;
+        const uint64_t available_size = compressed_capacity - position - V2F_BUFFER_ENVELOPE_HEADER_SIZE;
+        const bool is_direct = available_size >= block_sample_count * bytes_per_word;
+        if (!is_direct) {
+            RETURN_IF_FAIL(v2f_buffer_reserve_bitstream(codec, block_sample_count * bytes_per_word));
+        }
+        uint8_t *const bitstream = is_direct ? envelope + V2F_BUFFER_ENVELOPE_HEADER_SIZE : codec->bitstream;
+
+        v2f_file_unpack_big_endian(
+                raw_data + first_sample * codec->bytes_per_sample, block_sample_count,
+                codec->bytes_per_sample, codec->samples, codec->samples_16);
+        uint64_t bitstream_size;
+        if (codec->samples_16 != NULL) {
+            RETURN_IF_FAIL(v2f_compressor_compress_block_16(
+                    &(codec->compressor), codec->samples_16, block_sample_count, bitstream, &bitstream_size));
+        } else {
+            RETURN_IF_FAIL(v2f_compressor_compress_block(
+                    &(codec->compressor), codec->samples, block_sample_count, bitstream, &bitstream_size));
+        }
+        if (!is_direct) {
+            if (bitstream_size > available_size) {
+                log_error("The compressed data do not fit in the output buffer");
+                return V2F_E_INVALID_PARAMETER;
+            }
+            memcpy(envelope + V2F_BUFFER_ENVELOPE_HEADER_SIZE, bitstream, bitstream_size);
+        }
+        assert(bitstream_size <= V2F_SAMPLE_T_MAX);
+        v2f_entropy_coder_sample_to_buffer((v2f_sample_t) bitstream_size, envelope, 4);
+        v2f_entropy_coder_sample_to_buffer((v2f_sample_t) block_sample_count, envelope + 4, 4);
+        position += V2F_BUFFER_ENVELOPE_HEADER_SIZE + bitstream_size;
+    }
+    *compressed_size = position;
+
+    return V2F_E_NONE;
+}
+
+// Declared in v2f.h
+v2f_error_t v2f_buffer_decompress(
+        v2f_buffer_codec_t *const codec,
+        uint8_t const *const compressed_data,
+        uint64_t compressed_size,
+        uint8_t *const reconstructed_data,
+        uint64_t reconstructed_capacity,
+        uint64_t *const reconstructed_size) {
+    if (codec == NULL || reconstructed_size == NULL
+        || (compressed_data == NULL && compressed_size > 0)
+        || (reconstructed_data == NULL && reconstructed_capacity > 0)) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    uint64_t position = 0;
+    uint64_t written_size = 0;
+    while (true) {
+        uint64_t bitstream_size;
+        uint64_t block_sample_count;
+        RETURN_IF_FAIL(v2f_buffer_read_envelope(
+                codec, compressed_data, compressed_size, &position, &bitstream_size, &block_sample_count));
+        if (block_sample_count == 0) {
+            break;
+        }
+        const uint64_t block_size = block_sample_count * codec->bytes_per_sample;
+        if (reconstructed_capacity - written_size < block_size) {
+            log_error("The reconstructed samples do not fit in the output buffer");
+            return V2F_E_INVALID_PARAMETER;
+        }
+
+        if (bitstream_size == 0) {
+            // Shadow blocks are reconstructed as zeros
+            memset(reconstructed_data + written_size, 0, block_size);
+        } else {
+            // Bitstreams are decoded in place. They are never written through this pointer.
+            uint8_t *const bitstream = (uint8_t *) (uintptr_t) (compressed_data + position - bitstream_size);
+            uint64_t decoded_sample_count = 0;
+            RETURN_IF_FAIL(v2f_buffer_reserve_samples(codec, block_sample_count));
+            if (codec->samples_16 != NULL) {
+                RETURN_IF_FAIL(v2f_decompressor_decompress_block_16(
+                        &(codec->decompressor), bitstream, bitstream_size, block_sample_count,
+                        codec->samples_16, &decoded_sample_count));
+            } else {
+                RETURN_IF_FAIL(v2f_decompressor_decompress_block(
+                        &(codec->decompressor), bitstream, bitstream_size, block_sample_count,
+                        codec->samples, &decoded_sample_count));
+            }
+            if (decoded_sample_count != block_sample_count) {
+                // The field and the actual number of samples shall match
+                return V2F_E_CORRUPTED_DATA;
+            }
+            v2f_file_pack_big_endian(
+                    codec->samples, codec->samples_16, block_sample_count,
+                    codec->bytes_per_sample, reconstructed_data + written_size);
+        }
+        written_size += block_size;
+    }
+    *reconstructed_size = written_size;
+
+    return V2F_E_NONE;
+}
@@ -316,6 +316,18 @@ v2f_error_t v2f_build_minimal_forest(
         // LCOV_EXCL_STOP
     }
 
+    // Compile the forest into the tables used for coding and decoding
+    status = v2f_entropy_coder_compile(coder);
+    if (status == V2F_E_NONE) {
+        status = v2f_entropy_decoder_compile(decoder);
+    }
+    if (status != V2F_E_NONE) {
+        // LCOV_EXCL_START
+        RETURN_IF_FAIL(v2f_build_destroy_minimal_forest(coder, decoder));
+        return status;
+        // LCOV_EXCL_STOP
+    }
+
     return V2F_E_NONE;
 }
 
@@ -8,6 +8,16 @@
 
 #include "v2f_compressor.h"
 #include "timer.h"
+#include "common.h"
+
+/// Handle of the timer of v2f_compressor_compress_block() and v2f_compressor_compress_block_16()
+TIMER_DEFINE(v2f_compressor_timer, "v2f_compressor_compress_block")
+
+/**
+ * Number of samples of each tile of the fused pipeline of v2f_compressor_compress_block().
+ * The samples of a tile and their decorrelated values fit in the L2 cache of any target.
+ */
+#define V2F_COMPRESSOR_TILE_SIZE 8192
 
 v2f_error_t v2f_compressor_create(
         v2f_compressor_t *compressor,
@@ -32,22 +42,63 @@ v2f_error_t v2f_compressor_compress_block(
         uint64_t sample_count,
         uint8_t *const output_buffer,
         uint64_t *const written_byte_count) {
+    if (compressor == NULL || input_samples == NULL || sample_count == 0 || sample_count == UINT64_MAX) {
+        return V2F_E_INVALID_PARAMETER;
+    }
 
-    timer_start("v2f_compressor_compress_block");
+    timer_start_handle(v2f_compressor_timer());
 
-    RETURN_IF_FAIL(v2f_quantizer_quantize(
-            compressor->quantizer, input_samples, sample_count));
+    // Each tile is quantized in place, then decorrelated into a buffer from which it is coded.
+    // Decorrelation only needs quantized samples of the current and previous tiles.
+    v2f_sample_t decorrelated_samples[V2F_COMPRESSOR_TILE_SIZE];
+    v2f_entropy_coder_stream_t stream;
+    RETURN_IF_FAIL(v2f_entropy_coder_stream_start(compressor->entropy_coder, &stream, output_buffer));
+    for (uint64_t tile_start = 0; tile_start < sample_count; tile_start += V2F_COMPRESSOR_TILE_SIZE) {
+        const uint64_t tile_count = MIN(V2F_COMPRESSOR_TILE_SIZE, sample_count - tile_start);
+        RETURN_IF_FAIL(v2f_quantizer_quantize(
+                compressor->quantizer, input_samples + tile_start, tile_count));
+        RETURN_IF_FAIL(v2f_decorrelator_decorrelate_range(
+                compressor->decorrelator, input_samples, sample_count, tile_start, tile_count,
+                decorrelated_samples));
+        RETURN_IF_FAIL(v2f_entropy_coder_stream_samples(
+                compressor->entropy_coder, &stream, decorrelated_samples, tile_count));
+    }
+    RETURN_IF_FAIL(v2f_entropy_coder_stream_finish(compressor->entropy_coder, &stream, written_byte_count));
 
+    timer_stop_handle(v2f_compressor_timer());
 
-    RETURN_IF_FAIL(v2f_decorrelator_decorrelate_block(
-            compressor->decorrelator, input_samples, sample_count));
+    return V2F_E_NONE;
+}
 
+v2f_error_t v2f_compressor_compress_block_16(
+        v2f_compressor_t *const compressor,
+        v2f_sample16_t *const input_samples,
+        uint64_t sample_count,
+        uint8_t *const output_buffer,
+        uint64_t *const written_byte_count) {
+    if (compressor == NULL || input_samples == NULL || sample_count == 0 || sample_count == UINT64_MAX) {
+        return V2F_E_INVALID_PARAMETER;
+    }
 
-    RETURN_IF_FAIL(v2f_entropy_coder_compress_block(
-            compressor->entropy_coder, input_samples, sample_count,
-            output_buffer, written_byte_count));
+    timer_start_handle(v2f_compressor_timer());
+
+    // As in v2f_compressor_compress_block()
+    v2f_sample16_t decorrelated_samples[V2F_COMPRESSOR_TILE_SIZE];
+    v2f_entropy_coder_stream_t stream;
+    RETURN_IF_FAIL(v2f_entropy_coder_stream_start(compressor->entropy_coder, &stream, output_buffer));
+    for (uint64_t tile_start = 0; tile_start < sample_count; tile_start += V2F_COMPRESSOR_TILE_SIZE) {
+        const uint64_t tile_count = MIN(V2F_COMPRESSOR_TILE_SIZE, sample_count - tile_start);
+        RETURN_IF_FAIL(v2f_quantizer_quantize_16(
+                compressor->quantizer, input_samples + tile_start, tile_count));
+        RETURN_IF_FAIL(v2f_decorrelator_decorrelate_range_16(
+                compressor->decorrelator, input_samples, sample_count, tile_start, tile_count,
+                decorrelated_samples));
+        RETURN_IF_FAIL(v2f_entropy_coder_stream_samples_16(
+                compressor->entropy_coder, &stream, decorrelated_samples, tile_count));
+    }
+    RETURN_IF_FAIL(v2f_entropy_coder_stream_finish(compressor->entropy_coder, &stream, written_byte_count));
 
-    timer_stop("v2f_compressor_compress_block");
+    timer_stop_handle(v2f_compressor_timer());
 
     return V2F_E_NONE;
 }
@@ -37,9 +37,14 @@ v2f_error_t v2f_compressor_create(
  * Compress the samples in `input_samples` and write the result to output_buffer
  * using the full pipeline of `compressor`.
  *
+ * The stages are fused: the block is processed in tiles that are quantized,
+ * decorrelated and coded while they are in cache. The output is identical to that
+ * of applying v2f_quantizer_quantize(), v2f_decorrelator_decorrelate_block() and
+ * v2f_entropy_coder_compress_block() to the whole block.
+ *
  * @param compressor intitialized compressor to be used for compression
  * @param input_samples buffer with at least `input_samples`
- *   v2f_sample_t values.
+ *   v2f_sample_t values. It is quantized in place.
  * @param sample_count number of samples to be coded from the buffer.
  *   Must be < UINT64_MAX.
  * @param output_buffer buffer where the output is produced. It must be large
@@ -60,4 +65,32 @@ v2f_error_t v2f_compressor_compress_block(
         uint64_t *const written_byte_count);
 
 
+/**
+ * Compress a block of samples stored with 16 bits per sample using the full
+ * pipeline of `compressor`. This halves the memory traffic with respect to
+ * v2f_compressor_compress_block(), and produces an identical output.
+ * It can be used when samples have at most 2 bytes.
+ *
+ * @param compressor intitialized compressor to be used for compression
+ * @param input_samples buffer with at least `sample_count` samples.
+ *   It is quantized in place.
+ * @param sample_count number of samples to be coded from the buffer.
+ *   Must be < UINT64_MAX.
+ * @param output_buffer buffer where the output is produced. It must be large
+ *  enough to accommodate the worst case scenario, i.e., one index is emitted
+ *  per input symbol (input_samples*coder->bytes_per_word bytes).
+ * @param written_byte_count pointer to a variable where the number of bytes
+ *   written to output_buffer is stored. If the pointer is NULL, it is ignored.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The block was successfully compressed
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameter provided
+ */
+v2f_error_t v2f_compressor_compress_block_16(
+        v2f_compressor_t *const compressor,
+        v2f_sample16_t *const input_samples,
+        uint64_t sample_count,
+        uint8_t *const output_buffer,
+        uint64_t *const written_byte_count);
+
 #endif /* V2F_COMPRESSOR_H */
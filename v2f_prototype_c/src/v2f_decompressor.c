@@ -9,6 +9,16 @@
 #include "v2f_decompressor.h"
 #include "timer.h"
 #include "log.h"
+#include "common.h"
+
+/// Handle of the timer of v2f_decompressor_decompress_block() and v2f_decompressor_decompress_block_16()
+TIMER_DEFINE(v2f_decompressor_timer, "v2f_decompressor_decompress_block")
+
+/**
+ * Minimum number of samples decoded in each tile of the fused pipeline of v2f_decompressor_decompress_block().
+ * The samples of a tile are inverted and dequantized while they are still in the L2 cache of any target.
+ */
+#define V2F_DECOMPRESSOR_TILE_SIZE 8192
 
 v2f_error_t v2f_decompressor_create(
         v2f_decompressor_t *decompressor,
@@ -27,6 +37,62 @@ v2f_error_t v2f_decompressor_create(
     return V2F_E_NONE;
 }
 
+/**
+ * Determine whether a block must be decompressed in separate stages, i.e., decoding the whole block,
+ * then inverting its decorrelation and then dequantizing it, instead of using the fused pipeline.
+ *
+ * This is the case for the multi-threaded JPEG-LS wavefront of v2f_decorrelator_invert_block(),
+ * which works on complete blocks, and for unknown decorrelator modes.
+ *
+ * @param decorrelator decorrelator of the decompressor
+ *
+ * @return true if and only if the staged decompression must be used
+ */
+static bool v2f_decompressor_is_staged(v2f_decorrelator_t const *const decorrelator) {
+    return decorrelator->mode >= V2F_C_DECORRELATOR_MODE_COUNT
+           || (decorrelator->mode == V2F_C_DECORRELATOR_MODE_JPEG_LS && decorrelator->thread_count > 1);
+}
+
+/**
+ * Number of reconstructed samples that must be kept before the next sample to be inverted,
+ * because they are used for its prediction. Only earlier samples can be dequantized.
+ *
+ * @param decorrelator decorrelator of the decompressor
+ *
+ * @return the number of samples that cannot yet be dequantized
+ */
+static uint64_t v2f_decompressor_dequantization_lag(v2f_decorrelator_t const *const decorrelator) {
+    // Two-dimensional modes use the north-west neighbor, the rest the two samples on the left
+    if (decorrelator->mode == V2F_C_DECORRELATOR_MODE_JPEG_LS || decorrelator->mode == V2F_C_DECORRELATOR_MODE_FGIJ) {
+        return decorrelator->samples_per_row + 1;
+    }
+    return 2;
+}
+
+/**
+ * Verify the number of samples of a decompressed block, as v2f_decorrelator_invert_block() does.
+ *
+ * @param decorrelator decorrelator of the decompressor
+ * @param sample_count number of decoded samples
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The number of samples is valid
+ *  - @ref V2F_E_INVALID_PARAMETER : The block is empty or has an incomplete row
+ */
+static v2f_error_t v2f_decompressor_check_sample_count(
+        v2f_decorrelator_t const *const decorrelator,
+        uint64_t sample_count) {
+    if (sample_count == 0) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    if ((decorrelator->mode == V2F_C_DECORRELATOR_MODE_JPEG_LS || decorrelator->mode == V2F_C_DECORRELATOR_MODE_FGIJ)
+        && sample_count % decorrelator->samples_per_row != 0) {
+        log_error("Invalid number of samples per row (%lu)", decorrelator->samples_per_row);
+        return V2F_E_INVALID_PARAMETER;
+    }
+    return V2F_E_NONE;
+}
+
 v2f_error_t v2f_decompressor_decompress_block(
         v2f_decompressor_t *const decompressor,
         uint8_t *const compressed_data,
@@ -34,31 +100,116 @@ v2f_error_t v2f_decompressor_decompress_block(
         uint64_t max_output_sample_count,
         v2f_sample_t *const reconstructed_samples,
         uint64_t *const written_sample_count) {
+    if (decompressor == NULL || decompressor->decorrelator == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    v2f_decorrelator_t *const decorrelator = decompressor->decorrelator;
 
-    timer_start("v2f_decompressor_decompress_block");
+    timer_start_handle(v2f_decompressor_timer());
 
-    {
-        timer_start("v2f_entropy_decoder_decompress_block");
+    uint64_t sample_count;
+    if (v2f_decompressor_is_staged(decorrelator)) {
         RETURN_IF_FAIL(v2f_entropy_decoder_decompress_block(
                 decompressor->entropy_decoder, compressed_data,
                 buffer_size_bytes,
-                reconstructed_samples, max_output_sample_count, written_sample_count));
-        timer_stop("v2f_entropy_decoder_decompress_block");
+                reconstructed_samples, max_output_sample_count, &sample_count));
+        RETURN_IF_FAIL(v2f_decorrelator_invert_block(decorrelator, reconstructed_samples, sample_count));
+        RETURN_IF_FAIL(v2f_quantizer_dequantize(decompressor->quantizer, reconstructed_samples, sample_count));
+    } else {
+        // Each tile is decoded into the output and inverted in place. Samples are dequantized
+        // once they are no longer needed to predict the following ones.
+        const uint64_t lag = v2f_decompressor_dequantization_lag(decorrelator);
+        uint64_t inverted_count = 0;
+        uint64_t dequantized_count = 0;
+        v2f_entropy_decoder_stream_t stream;
+        RETURN_IF_FAIL(v2f_entropy_decoder_stream_start(
+                decompressor->entropy_decoder, &stream, compressed_data, buffer_size_bytes));
+        while (stream.remaining_word_count > 0 && inverted_count < max_output_sample_count) {
+            RETURN_IF_FAIL(v2f_entropy_decoder_stream_samples(
+                    decompressor->entropy_decoder, &stream, reconstructed_samples, max_output_sample_count,
+                    MIN(max_output_sample_count, inverted_count + V2F_DECOMPRESSOR_TILE_SIZE)));
+            RETURN_IF_FAIL(v2f_decorrelator_invert_range(
+                    decorrelator, reconstructed_samples, inverted_count,
+                    stream.written_sample_count - inverted_count));
+            inverted_count = stream.written_sample_count;
+            if (inverted_count > dequantized_count + lag) {
+                RETURN_IF_FAIL(v2f_quantizer_dequantize(
+                        decompressor->quantizer, reconstructed_samples + dequantized_count,
+                        inverted_count - lag - dequantized_count));
+                dequantized_count = inverted_count - lag;
+            }
+        }
+        RETURN_IF_FAIL(v2f_entropy_decoder_stream_finish(decompressor->entropy_decoder, &stream, &sample_count));
+        RETURN_IF_FAIL(v2f_decompressor_check_sample_count(decorrelator, sample_count));
+        RETURN_IF_FAIL(v2f_quantizer_dequantize(
+                decompressor->quantizer, reconstructed_samples + dequantized_count,
+                sample_count - dequantized_count));
+    }
+    if (written_sample_count != NULL) {
+        *written_sample_count = sample_count;
+    }
 
-        timer_start("v2f_decorrelator_invert_block");
-        RETURN_IF_FAIL(v2f_decorrelator_invert_block(
-                decompressor->decorrelator, reconstructed_samples,
-                *written_sample_count));
-        timer_stop("v2f_decorrelator_invert_block");
+    timer_stop_handle(v2f_decompressor_timer());
 
-        timer_start("v2f_quantizer_dequantize");
-        RETURN_IF_FAIL(v2f_quantizer_dequantize(
-                decompressor->quantizer, reconstructed_samples,
-                *written_sample_count));
-        timer_stop("v2f_quantizer_dequantize");
+    return V2F_E_NONE;
+}
+
+v2f_error_t v2f_decompressor_decompress_block_16(
+        v2f_decompressor_t *const decompressor,
+        uint8_t *const compressed_data,
+        uint64_t buffer_size_bytes,
+        uint64_t max_output_sample_count,
+        v2f_sample16_t *const reconstructed_samples,
+        uint64_t *const written_sample_count) {
+    if (decompressor == NULL || decompressor->decorrelator == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    v2f_decorrelator_t *const decorrelator = decompressor->decorrelator;
+
+    timer_start_handle(v2f_decompressor_timer());
+
+    // As in v2f_decompressor_decompress_block()
+    uint64_t sample_count;
+    if (v2f_decompressor_is_staged(decorrelator)) {
+        RETURN_IF_FAIL(v2f_entropy_decoder_decompress_block_16(
+                decompressor->entropy_decoder, compressed_data,
+                buffer_size_bytes,
+                reconstructed_samples, max_output_sample_count, &sample_count));
+        RETURN_IF_FAIL(v2f_decorrelator_invert_block_16(decorrelator, reconstructed_samples, sample_count));
+        RETURN_IF_FAIL(v2f_quantizer_dequantize_16(decompressor->quantizer, reconstructed_samples, sample_count));
+    } else {
+        const uint64_t lag = v2f_decompressor_dequantization_lag(decorrelator);
+        uint64_t inverted_count = 0;
+        uint64_t dequantized_count = 0;
+        v2f_entropy_decoder_stream_t stream;
+        RETURN_IF_FAIL(v2f_entropy_decoder_stream_start(
+                decompressor->entropy_decoder, &stream, compressed_data, buffer_size_bytes));
+        while (stream.remaining_word_count > 0 && inverted_count < max_output_sample_count) {
+            RETURN_IF_FAIL(v2f_entropy_decoder_stream_samples_16(
+                    decompressor->entropy_decoder, &stream, reconstructed_samples, max_output_sample_count,
+                    MIN(max_output_sample_count, inverted_count + V2F_DECOMPRESSOR_TILE_SIZE)));
+            RETURN_IF_FAIL(v2f_decorrelator_invert_range_16(
+                    decorrelator, reconstructed_samples, inverted_count,
+                    stream.written_sample_count - inverted_count));
+            inverted_count = stream.written_sample_count;
+            if (inverted_count > dequantized_count + lag) {
+                RETURN_IF_FAIL(v2f_quantizer_dequantize_16(
+                        decompressor->quantizer, reconstructed_samples + dequantized_count,
+                        inverted_count - lag - dequantized_count));
+                dequantized_count = inverted_count - lag;
+            }
+        }
+        RETURN_IF_FAIL(v2f_entropy_decoder_stream_finish(decompressor->entropy_decoder, &stream, &sample_count));
+        RETURN_IF_FAIL(v2f_decompressor_check_sample_count(decorrelator, sample_count));
+        RETURN_IF_FAIL(v2f_quantizer_dequantize_16(
+                decompressor->quantizer, reconstructed_samples + dequantized_count,
+                sample_count - dequantized_count));
+    }
+    if (written_sample_count != NULL) {
+        *written_sample_count = sample_count;
     }
 
-    timer_stop("v2f_decompressor_decompress_block");
+    timer_stop_handle(v2f_decompressor_timer());
 
     return V2F_E_NONE;
 }
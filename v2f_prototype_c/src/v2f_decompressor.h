@@ -37,6 +37,11 @@ v2f_error_t v2f_decompressor_create(
  * Decompress the codewords in `compressed_data` and write the
  * result to `reconstructed_samples` using the full decompression pipeline.
  *
+ * The block is decoded in tiles, each of which is inverted and dequantized in place
+ * right after it is decoded, while it is still cached. The result is identical to that of
+ * decoding the whole block, then inverting its decorrelation and then dequantizing it,
+ * which is done instead when the decorrelator uses the multi-threaded JPEG-LS wavefront.
+ *
  * @param decompressor intitialized decompressor to be used for compression.
  * @param compressed_data buffer with the codewords to be decompressed.
  * @param buffer_size_bytes number of bytes in `compressed_data`.
@@ -50,8 +55,8 @@ v2f_error_t v2f_decompressor_create(
  *
  * @return
   *  - @ref V2F_E_NONE : Decompression successfull
-  *  - @ref V2F_E_IO : Input/output error
   *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+  *  - @ref V2F_E_CORRUPTED_DATA : The compressed data are not valid
  */
 v2f_error_t v2f_decompressor_decompress_block(
         v2f_decompressor_t *const decompressor,
@@ -62,4 +67,34 @@ v2f_error_t v2f_decompressor_decompress_block(
         uint64_t *const written_sample_count);
 
 
+/**
+ * Decompress the codewords in `compressed_data` into samples stored with 16 bits
+ * per sample, using the full decompression pipeline. This halves the memory traffic
+ * with respect to v2f_decompressor_decompress_block(), and produces identical samples
+ * with the same tiled pipeline. It can be used when samples have at most 2 bytes.
+ *
+ * @param decompressor intitialized decompressor to be used for compression.
+ * @param compressed_data buffer with the codewords to be decompressed.
+ * @param buffer_size_bytes number of bytes in `compressed_data`.
+ * @param max_output_sample_count maximum number of samples that will
+ *  be written to `reconstructed_samples` (if available).
+ * @param reconstructed_samples buffer where the reconstructed samples
+ *  are to be writen. The caller is responsible to pass a large enough
+ *  buffer.
+ * @param written_sample_count pointer where the number of reconstructed
+ *   samples is to be written.
+ *
+ * @return
+  *  - @ref V2F_E_NONE : Decompression successfull
+  *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+  *  - @ref V2F_E_CORRUPTED_DATA : The compressed data are not valid
+ */
+v2f_error_t v2f_decompressor_decompress_block_16(
+        v2f_decompressor_t *const decompressor,
+        uint8_t *const compressed_data,
+        uint64_t buffer_size_bytes,
+        uint64_t max_output_sample_count,
+        v2f_sample16_t *const reconstructed_samples,
+        uint64_t *const written_sample_count);
+
 #endif /* V2F_DECOMPRESSOR_H */
@@ -9,12 +9,110 @@
 #include "v2f_decorrelator.h"
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "log.h"
 #include "timer.h"
 #include "common.h"
 
+/// Handle of the timer of v2f_decorrelator_decorrelate_block() and v2f_decorrelator_decorrelate_block_16()
+TIMER_DEFINE(v2f_decorrelator_timer, "v2f_decorrelator_decorrelate_block")
+
+/**
+ * Number of samples whose predictions are computed together by the forward prediction kernels.
+ * It is a multiple of the number of samples in the vector registers of any target.
+ */
+#define V2F_DECORRELATOR_CHUNK_SIZE 256
+
+/**
+ * Number of samples of a row reconstructed between two synchronizations of the JPEG-LS wavefront.
+ * The thread that reconstructs a row trails the one of the previous row by at most this many samples.
+ */
+#define V2F_DECORRELATOR_WAVEFRONT_SEGMENT_SIZE 2048
+
+/**
+ * @struct v2f_decorrelator_wavefront_t
+ *
+ * State shared by the threads that invert a JPEG-LS block as a row wavefront.
+ */
+typedef struct {
+    /// Maximum sample value
+    v2f_sample_t max_sample_value;
+    /// Number of samples per row
+    uint64_t samples_per_row;
+    /// Number of rows in the block
+    uint64_t row_count;
+    /// Samples of the block, or NULL if `samples_16` is used
+    v2f_sample_t *samples;
+    /// Samples of the block with 16 bits per sample, or NULL if `samples` is used
+    v2f_sample16_t *samples_16;
+
+    /// Index of the next row to be claimed by a thread
+    uint64_t next_row;
+    /// Number of reconstructed samples of each row
+    uint64_t *reconstructed_counts;
+    /// Mutex that protects `next_row` and `reconstructed_counts`
+    pthread_mutex_t mutex;
+    /// Signaled when a row segment has been reconstructed
+    pthread_cond_t progress;
+} v2f_decorrelator_wavefront_t;
+
+/**
+ * Map a 16-bit sample given its prediction. See v2f_decorrelator_map_predicted_sample().
+ */
+#define V2F_DECORRELATOR_MAP_16(sample, prediction, max_sample_value) \
+    ((v2f_sample16_t) v2f_decorrelator_map_predicted_sample((sample), (prediction), (max_sample_value)))
+
+/**
+ * Unmap a 16-bit coded value given its prediction. See v2f_decorrelator_unmap_sample().
+ */
+#define V2F_DECORRELATOR_UNMAP_16(coded_value, prediction, max_sample_value) \
+    ((v2f_sample16_t) v2f_decorrelator_unmap_sample((coded_value), (prediction), (max_sample_value)))
+
+/**
+ * Compute the JPEG-LS (median edge detector) prediction of a sample
+ * given its left, north and left-north neighbors.
+ *
+ * @param left_neighbor sample to the left
+ * @param north_neighbor sample above
+ * @param left_north_neighbor sample above and to the left
+ *
+ * @return the predicted sample value
+ */
+static inline v2f_sample_t v2f_decorrelator_jpeg_ls_predict(
+        v2f_sample_t left_neighbor,
+        v2f_sample_t north_neighbor,
+        v2f_sample_t left_north_neighbor) {
+    const v2f_sample_t max_neighbor = MAX(left_neighbor, north_neighbor);
+    const v2f_sample_t min_neighbor = MIN(left_neighbor, north_neighbor);
+    return left_north_neighbor >= max_neighbor ? min_neighbor :
+           (left_north_neighbor <= min_neighbor ? max_neighbor :
+            left_neighbor + north_neighbor - left_north_neighbor);
+}
+
+/**
+ * Map a sample given its prediction, as v2f_decorrelator_map_predicted_sample()
+ * but without assertions. Only unsigned 32-bit operations and selections are used,
+ * so that loops calling this function can be vectorized by the compiler.
+ *
+ * @param sample sample to be coded
+ * @param prediction predicted value for this sample
+ * @param max_sample_value maximum possible sample value
+ *
+ * @return the coded prediction error
+ */
+static inline v2f_sample_t v2f_decorrelator_map(
+        v2f_sample_t sample,
+        v2f_sample_t prediction,
+        v2f_sample_t max_sample_value) {
+    const v2f_sample_t theta = MIN(prediction, max_sample_value - prediction);
+    const v2f_sample_t negative = sample < prediction;
+    const v2f_sample_t abs_value = negative ? prediction - sample : sample - prediction;
+    return abs_value <= theta ? (abs_value << 1) - negative : theta + abs_value;
+}
+
 v2f_error_t v2f_decorrelator_create(
         v2f_decorrelator_t *decorrelator,
         v2f_decorrelator_mode_t mode,
@@ -40,6 +138,7 @@ v2f_error_t v2f_decorrelator_create(
     decorrelator->mode = mode;
     decorrelator->max_sample_value = max_sample_value;
     decorrelator->samples_per_row = samples_per_row;
+    decorrelator->thread_count = 1;
 
     return V2F_E_NONE;
 }
@@ -51,23 +150,7 @@ v2f_sample_t v2f_decorrelator_map_predicted_sample(
     assert(sample <= max_sample_value);
     assert(prediction <= max_sample_value);
 
-    v2f_signed_sample_t prediction_difference =
-            (v2f_signed_sample_t) ((int64_t) sample - (int64_t) prediction);
-
-    const v2f_sample_t diff_to_max = max_sample_value - prediction;
-    const v2f_sample_t closer_to_max = diff_to_max < prediction;
-
-    const v2f_sample_t theta =
-            (closer_to_max * diff_to_max)
-            + ((!closer_to_max) * prediction);
-
-    const v2f_sample_t abs_value = (v2f_sample_t) labs(prediction_difference);
-    const v2f_sample_t within_pm_theta = (abs_value <= theta);
-    const v2f_sample_t negative = (prediction_difference < 0);
-
-    const v2f_sample_t coded_value = (v2f_sample_t) (
-            (within_pm_theta * ((abs_value << 1) - negative))
-            + ((!within_pm_theta) * (theta + abs_value)));
+    const v2f_sample_t coded_value = v2f_decorrelator_map(sample, prediction, max_sample_value);
 
     assert(coded_value <= max_sample_value);
 
@@ -112,7 +195,7 @@ v2f_error_t v2f_decorrelator_decorrelate_block(
         v2f_decorrelator_t *decorrelator,
         v2f_sample_t *input_samples,
         uint64_t sample_count) {
-    timer_start("v2f_decorrelator_decorrelate_block");
+    timer_start_handle(v2f_decorrelator_timer());
     if (decorrelator == NULL || input_samples == NULL || sample_count == 0) {
         return V2F_E_INVALID_PARAMETER;
     }
@@ -144,7 +227,7 @@ v2f_error_t v2f_decorrelator_decorrelate_block(
         default:
             abort(); // LCOV_EXCL_LINE
     }
-    timer_stop("v2f_decorrelator_decorrelate_block");
+    timer_stop_handle(v2f_decorrelator_timer());
     return status;
 }
 
@@ -187,6 +270,295 @@ v2f_error_t v2f_decorrelator_invert_block(
     return status;
 }
 
+/**
+ * Compute the forward predictions of the samples `row[x]`, for `x` in `[start, start + count)`,
+ * from the original values of their neighbors.
+ *
+ * The predictions are those of the decorrelator mode for the samples after the first
+ * (left mode), the first two (2-left and FGIJ modes, and FGIJ rows after the first)
+ * or the first one (JPEG-LS) of each row. One-dimensional modes treat the block as a single row.
+ * Each prediction is computed independently, so that the compiler can vectorize the loops.
+ *
+ * @param mode decorrelator mode
+ * @param row samples of the row, not modified yet in `[start - 2, start + count)`
+ * @param north_row samples of the previous row, not modified yet, or NULL for the first row
+ * @param start position of the first sample to be predicted
+ * @param count number of samples to be predicted, at most V2F_DECORRELATOR_CHUNK_SIZE
+ * @param predictions array where the `count` predictions are stored
+ */
+static void v2f_decorrelator_predict_chunk(
+        v2f_decorrelator_mode_t mode,
+        v2f_sample_t const *const row,
+        v2f_sample_t const *const north_row,
+        uint64_t start,
+        uint64_t count,
+        v2f_sample_t *const predictions) {
+    v2f_sample_t const *const left = row + start - 1;
+    switch (mode) {
+        case V2F_C_DECORRELATOR_MODE_LEFT:
+            for (uint64_t k = 0; k < count; k++) {
+                predictions[k] = left[k];
+            }
+            break;
+        case V2F_C_DECORRELATOR_MODE_2_LEFT:
+            for (uint64_t k = 0; k < count; k++) {
+                predictions[k] = (left[k] + left[k - 1] + 1) >> 1;
+            }
+            break;
+        case V2F_C_DECORRELATOR_MODE_JPEG_LS:
+            if (north_row == NULL) {
+                for (uint64_t k = 0; k < count; k++) {
+                    predictions[k] = left[k];
+                }
+            } else {
+                v2f_sample_t const *const north = north_row + start;
+                for (uint64_t k = 0; k < count; k++) {
+                    predictions[k] = v2f_decorrelator_jpeg_ls_predict(left[k], north[k], north[k - 1]);
+                }
+            }
+            break;
+        case V2F_C_DECORRELATOR_MODE_FGIJ:
+            if (north_row == NULL) {
+                for (uint64_t k = 0; k < count; k++) {
+                    predictions[k] = (left[k] + left[k - 1]) >> 1;
+                }
+            } else {
+                v2f_sample_t const *const north = north_row + start;
+                for (uint64_t k = 0; k < count; k++) {
+                    predictions[k] = (left[k] + left[k - 1] + north[k] + north[k - 1]) >> 2;
+                }
+            }
+            break;
+        default:
+            abort(); // LCOV_EXCL_LINE
+    }
+}
+
+/**
+ * Apply the forward prediction of a decorrelator mode to the samples `row[x]`,
+ * for `x` in `[start, end)`, in place.
+ *
+ * Samples are processed in chunks, from last to first, so that the neighbors used
+ * for prediction have not been modified yet and no copy of the block is needed.
+ * The predictions of each chunk are computed first, and then all its samples are mapped.
+ *
+ * @param mode decorrelator mode
+ * @param max_sample_value maximum sample value
+ * @param row samples of the row. The samples before `start` are not modified.
+ * @param north_row samples of the previous row, or NULL for the first row
+ * @param start position of the first sample to be processed (see v2f_decorrelator_predict_chunk())
+ * @param end position after the last sample to be processed
+ */
+static void v2f_decorrelator_apply_row(
+        v2f_decorrelator_mode_t mode,
+        v2f_sample_t max_sample_value,
+        v2f_sample_t *const row,
+        v2f_sample_t const *const north_row,
+        uint64_t start,
+        uint64_t end) {
+    v2f_sample_t predictions[V2F_DECORRELATOR_CHUNK_SIZE];
+    while (end > start) {
+        const uint64_t chunk_start = end - start > V2F_DECORRELATOR_CHUNK_SIZE ?
+                                     end - V2F_DECORRELATOR_CHUNK_SIZE : start;
+        const uint64_t count = end - chunk_start;
+        v2f_decorrelator_predict_chunk(mode, row, north_row, chunk_start, count, predictions);
+        v2f_sample_t *const samples = row + chunk_start;
+        for (uint64_t k = 0; k < count; k++) {
+            samples[k] = v2f_decorrelator_map(samples[k], predictions[k], max_sample_value);
+        }
+        end = chunk_start;
+    }
+}
+
+/**
+ * Apply the forward prediction of a two-dimensional decorrelator mode to a block, in place.
+ * Rows are processed from last to first.
+ *
+ * @param mode V2F_C_DECORRELATOR_MODE_JPEG_LS or V2F_C_DECORRELATOR_MODE_FGIJ
+ * @param max_sample_value maximum sample value
+ * @param samples_per_row number of samples per row, at least 3
+ * @param samples samples to be decorrelated in place
+ * @param sample_count number of samples, a multiple of `samples_per_row`
+ */
+static void v2f_decorrelator_apply_2d_prediction(
+        v2f_decorrelator_mode_t mode,
+        v2f_sample_t max_sample_value,
+        uint64_t samples_per_row,
+        v2f_sample_t *const samples,
+        uint64_t sample_count) {
+    const uint64_t start = mode == V2F_C_DECORRELATOR_MODE_FGIJ ? 2 : 1;
+    for (uint64_t row_index = sample_count / samples_per_row - 1; row_index > 0; row_index--) {
+        v2f_sample_t *const row = samples + row_index * samples_per_row;
+        v2f_sample_t const *const north_row = row - samples_per_row;
+        v2f_decorrelator_apply_row(mode, max_sample_value, row, north_row, start, samples_per_row);
+        if (mode == V2F_C_DECORRELATOR_MODE_FGIJ) {
+            // The third neighbor of the second sample is the last sample of the previous row
+            row[1] = v2f_decorrelator_map_predicted_sample(
+                    row[1], (north_row[1] + north_row[0] + row[-1]) / 3, max_sample_value);
+        }
+        row[0] = v2f_decorrelator_map_predicted_sample(row[0], north_row[0], max_sample_value);
+    }
+
+    // The first row has no north references, and its first sample has no references at all
+    v2f_decorrelator_apply_row(mode, max_sample_value, samples, NULL, start, samples_per_row);
+    if (mode == V2F_C_DECORRELATOR_MODE_FGIJ) {
+        samples[1] = v2f_decorrelator_map_predicted_sample(samples[1], samples[0], max_sample_value);
+    }
+    samples[0] = v2f_decorrelator_map_predicted_sample(samples[0], 0, max_sample_value);
+}
+
+/**
+ * Verify that no sample in a block is larger than the maximum sample value.
+ *
+ * @param max_sample_value maximum sample value
+ * @param samples block of samples
+ * @param sample_count number of samples in the block
+ *
+ * @return
+ *  - @ref V2F_E_NONE : All samples are valid
+ *  - @ref V2F_E_CORRUPTED_DATA : a sample is larger than `max_sample_value`
+ */
+static v2f_error_t v2f_decorrelator_check_samples(
+        v2f_sample_t max_sample_value,
+        v2f_sample_t const *const samples,
+        uint64_t sample_count) {
+    v2f_sample_t block_max = 0;
+    for (uint64_t i = 0; i < sample_count; i++) {
+        block_max = MAX(block_max, samples[i]);
+    }
+    if (block_max > max_sample_value) {
+        for (uint64_t i = 0; i < sample_count; i++) {
+            if (samples[i] > max_sample_value) {
+                log_error("Encountered input sample input_samples[%lu]=%u "
+                          "> max_sample_value=%u",
+                          i, samples[i], max_sample_value);
+                break;
+            }
+        }
+        return V2F_E_CORRUPTED_DATA;
+    }
+    return V2F_E_NONE;
+}
+
+/**
+ * Verify the parameters of v2f_decorrelator_decorrelate_range() and v2f_decorrelator_decorrelate_range_16().
+ *
+ * @param decorrelator decorrelator to be used
+ * @param samples block of samples
+ * @param sample_count number of samples in the block
+ * @param first_sample index of the first sample of the range
+ * @param range_sample_count number of samples in the range
+ * @param decorrelated_samples buffer for the decorrelated samples of the range
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The parameters are valid for the decorrelator's mode
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ */
+static v2f_error_t v2f_decorrelator_check_range(
+        v2f_decorrelator_t const *const decorrelator,
+        void const *const samples,
+        uint64_t sample_count,
+        uint64_t first_sample,
+        uint64_t range_sample_count,
+        void const *const decorrelated_samples) {
+    if (decorrelator == NULL || samples == NULL || decorrelated_samples == NULL
+        || first_sample >= sample_count || range_sample_count > sample_count - first_sample) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    if (decorrelator->mode != V2F_C_DECORRELATOR_MODE_NONE
+        && decorrelator->mode != V2F_C_DECORRELATOR_MODE_LEFT
+        && decorrelator->samples_per_row > 0 && decorrelator->samples_per_row < 3) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    if ((decorrelator->mode == V2F_C_DECORRELATOR_MODE_JPEG_LS
+         || decorrelator->mode == V2F_C_DECORRELATOR_MODE_FGIJ)
+        && (decorrelator->samples_per_row == 0 || sample_count % decorrelator->samples_per_row != 0)) {
+        log_error("Invalid number of samples per row (%lu)", decorrelator->samples_per_row);
+        return V2F_E_INVALID_PARAMETER;
+    }
+    return V2F_E_NONE;
+}
+
+/**
+ * Compute the prediction of one of the first samples of a row, which are not
+ * predicted by v2f_decorrelator_predict_chunk().
+ *
+ * @param mode decorrelator mode
+ * @param row samples of the row
+ * @param north_row samples of the previous row, or NULL for the first row
+ * @param x position of the sample in the row, 0 or 1
+ *
+ * @return the prediction of `row[x]`
+ */
+static inline v2f_sample_t v2f_decorrelator_predict_row_start(
+        v2f_decorrelator_mode_t mode,
+        v2f_sample_t const *const row,
+        v2f_sample_t const *const north_row,
+        uint64_t x) {
+    if (x == 0) {
+        return north_row == NULL ? 0 : north_row[0];
+    }
+    if (mode == V2F_C_DECORRELATOR_MODE_2_LEFT) {
+        return (row[0] + 1) >> 1;
+    }
+    // The third neighbor of the second sample is the last sample of the previous row
+    return north_row == NULL ? row[0] : (north_row[1] + north_row[0] + row[-1]) / 3;
+}
+
+v2f_error_t v2f_decorrelator_decorrelate_range(
+        v2f_decorrelator_t const *const decorrelator,
+        v2f_sample_t const *const samples,
+        uint64_t sample_count,
+        uint64_t first_sample,
+        uint64_t range_sample_count,
+        v2f_sample_t *const decorrelated_samples) {
+    RETURN_IF_FAIL(v2f_decorrelator_check_range(
+            decorrelator, samples, sample_count, first_sample, range_sample_count, decorrelated_samples));
+    const v2f_decorrelator_mode_t mode = decorrelator->mode;
+    const v2f_sample_t max_sample_value = decorrelator->max_sample_value;
+    if (mode == V2F_C_DECORRELATOR_MODE_NONE || mode >= V2F_C_DECORRELATOR_MODE_COUNT) {
+        memcpy(decorrelated_samples, samples + first_sample, sizeof(v2f_sample_t) * range_sample_count);
+        return V2F_E_NONE;
+    }
+    if (mode == V2F_C_DECORRELATOR_MODE_LEFT) {
+        RETURN_IF_FAIL(v2f_decorrelator_check_samples(
+                max_sample_value, samples + first_sample, range_sample_count));
+    }
+
+    // One-dimensional modes treat the block as a single row
+    const uint64_t samples_per_row = mode == V2F_C_DECORRELATOR_MODE_JPEG_LS || mode == V2F_C_DECORRELATOR_MODE_FGIJ ?
+                                     decorrelator->samples_per_row : sample_count;
+    const uint64_t first_predicted =
+            mode == V2F_C_DECORRELATOR_MODE_2_LEFT || mode == V2F_C_DECORRELATOR_MODE_FGIJ ? 2 : 1;
+    const uint64_t end = first_sample + range_sample_count;
+    v2f_sample_t predictions[V2F_DECORRELATOR_CHUNK_SIZE];
+    v2f_sample_t *output = decorrelated_samples;
+    for (uint64_t position = first_sample; position < end;) {
+        const uint64_t row_index = position / samples_per_row;
+        v2f_sample_t const *const row = samples + row_index * samples_per_row;
+        v2f_sample_t const *const north_row = row_index == 0 ? NULL : row - samples_per_row;
+        uint64_t x = position - row_index * samples_per_row;
+        const uint64_t row_end = MIN(samples_per_row, end - row_index * samples_per_row);
+
+        for (; x < MIN(first_predicted, row_end); x++) {
+            *(output++) = v2f_decorrelator_map(
+                    row[x], v2f_decorrelator_predict_row_start(mode, row, north_row, x), max_sample_value);
+        }
+        while (x < row_end) {
+            const uint64_t count = MIN(V2F_DECORRELATOR_CHUNK_SIZE, row_end - x);
+            v2f_decorrelator_predict_chunk(mode, row, north_row, x, count, predictions);
+            for (uint64_t k = 0; k < count; k++) {
+                output[k] = v2f_decorrelator_map(row[x + k], predictions[k], max_sample_value);
+            }
+            output += count;
+            x += count;
+        }
+        position = row_index * samples_per_row + row_end;
+    }
+
+    return V2F_E_NONE;
+}
+
 v2f_error_t v2f_decorrelator_apply_left_prediction(
         v2f_decorrelator_t *decorrelator,
         v2f_sample_t *input_samples,
@@ -199,28 +571,12 @@ v2f_error_t v2f_decorrelator_apply_left_prediction(
         return V2F_E_INVALID_PARAMETER;
     }
     const v2f_sample_t max_sample_value = decorrelator->max_sample_value;
+    RETURN_IF_FAIL(v2f_decorrelator_check_samples(max_sample_value, input_samples, sample_count));
 
     // The first sample is predicted to be exactly zero.
-    v2f_sample_t prediction = 0;
-    for (uint64_t sample_index = 0; sample_index < sample_count; sample_index++) {
-        const v2f_sample_t tmp = input_samples[sample_index];
-
-        if (input_samples[sample_index] > max_sample_value) {
-            log_error("Encountered input sample input_samples[%lu]=%u "
-                      "> max_sample_value=%u",
-                      sample_index,
-                      input_samples[sample_index],
-                      max_sample_value);
-            return V2F_E_CORRUPTED_DATA;
-        }
-
-        input_samples[sample_index] = v2f_decorrelator_map_predicted_sample(
-                input_samples[sample_index],
-                prediction,
-                max_sample_value);
-
-        prediction = tmp;
-    }
+    v2f_decorrelator_apply_row(
+            V2F_C_DECORRELATOR_MODE_LEFT, max_sample_value, input_samples, NULL, 1, sample_count);
+    input_samples[0] = v2f_decorrelator_map_predicted_sample(input_samples[0], 0, max_sample_value);
 
     return V2F_E_NONE;
 }
@@ -266,23 +622,15 @@ v2f_error_t v2f_decorrelator_apply_2_left_prediction(
     }
     const v2f_sample_t max_sample_value = decorrelator->max_sample_value;
 
-    // Prediction starts with zero
-    v2f_sample_t left_left_neighbor = 0;
-    v2f_sample_t left_neighbor = 0;
-    for (uint64_t sample_index = 0; sample_index < sample_count; sample_index++) {
-        const v2f_sample_t tmp = input_samples[sample_index];
-
-        // Prediction is the rounded average of the two left neighbors
-        const v2f_sample_t prediction = ((left_neighbor + left_left_neighbor + 1) >> 1);
-
-        // Decode and verify sample
-        input_samples[sample_index] = v2f_decorrelator_map_predicted_sample(
-                tmp, prediction, max_sample_value);
-
-        // Update stored references to previous values
-        left_left_neighbor = left_neighbor;
-        left_neighbor = tmp;
+    // Prediction is the rounded average of the two left neighbors, which are zero
+    // for the first sample
+    v2f_decorrelator_apply_row(
+            V2F_C_DECORRELATOR_MODE_2_LEFT, max_sample_value, input_samples, NULL, 2, sample_count);
+    if (sample_count > 1) {
+        input_samples[1] = v2f_decorrelator_map_predicted_sample(
+                input_samples[1], (input_samples[0] + 1) >> 1, max_sample_value);
     }
+    input_samples[0] = v2f_decorrelator_map_predicted_sample(input_samples[0], 0, max_sample_value);
 
     return V2F_E_NONE;
 }
@@ -343,65 +691,10 @@ v2f_error_t v2f_decorrelator_apply_fgij_prediction(
         return V2F_E_INVALID_PARAMETER;
     }
 
-    v2f_sample_t *input_copy = malloc(sizeof(v2f_sample_t) * sample_count);
-    if (input_copy == NULL) {
-        return V2F_E_OUT_OF_MEMORY;
-    }
-    memcpy(input_copy, input_samples, sizeof(v2f_sample_t) * sample_count);
-
-    // Process the first two sample (without any reference)
-    input_samples[0] = v2f_decorrelator_map_predicted_sample(
-            input_samples[0],
-            0,
-            decorrelator->max_sample_value);
-    if (decorrelator->samples_per_row > 1) {
-        input_samples[1] = v2f_decorrelator_map_predicted_sample(
-                input_samples[1],
-                input_copy[0],
-                decorrelator->max_sample_value);
-    }
-    // process the remainder of the first row (without north references)
-    for (uint64_t sample_index = 2;
-         sample_index < decorrelator->samples_per_row;
-         sample_index++) {
-        input_samples[sample_index] = v2f_decorrelator_map_predicted_sample(
-                input_samples[sample_index],
-                (input_copy[sample_index - 1] + input_copy[sample_index - 2]) >> 1,
-                decorrelator->max_sample_value);
-    }
-
-    // process the remaining rows
-    const uint64_t row_count = sample_count / decorrelator->samples_per_row;
-    for (uint64_t row_index = 1; row_index < row_count; row_index++) {
-        // Process the first two elements of the row
-        input_samples[row_index * decorrelator->samples_per_row] =
-                v2f_decorrelator_map_predicted_sample(
-                        input_samples[row_index * decorrelator->samples_per_row],
-                        input_copy[(row_index - 1) * decorrelator->samples_per_row],
-                        decorrelator->max_sample_value);
-        if (decorrelator->samples_per_row > 1) {
-            input_samples[row_index * decorrelator->samples_per_row + 1] =
-                    v2f_decorrelator_map_predicted_sample(
-                            input_samples[row_index * decorrelator->samples_per_row + 1],
-                            (input_copy[(row_index - 1) * decorrelator->samples_per_row + 1]
-                             + input_copy[(row_index - 1) * decorrelator->samples_per_row]
-                             + input_copy[row_index * decorrelator->samples_per_row - 1]) / 3,
-                            decorrelator->max_sample_value);
-        }
-        // Process the remaining samples of the row
-        for (uint64_t sample_index = row_index * decorrelator->samples_per_row + 2;
-             sample_index < (row_index + 1) * decorrelator->samples_per_row;
-             sample_index++) {
-            input_samples[sample_index] = v2f_decorrelator_map_predicted_sample(
-                    input_samples[sample_index],
-                    (input_copy[sample_index - 1] + input_copy[sample_index - 2] +
-                     input_copy[sample_index - decorrelator->samples_per_row] +
-                     input_copy[sample_index - decorrelator->samples_per_row - 1]) >> 2,
-                    decorrelator->max_sample_value);
-        }
-    }
+    v2f_decorrelator_apply_2d_prediction(
+            V2F_C_DECORRELATOR_MODE_FGIJ, decorrelator->max_sample_value, decorrelator->samples_per_row,
+            input_samples, sample_count);
 
-    free(input_copy);
     return V2F_E_NONE;
 }
 
@@ -490,61 +783,192 @@ v2f_error_t v2f_decorrelator_apply_jpeg_ls_prediction(
         return V2F_E_INVALID_PARAMETER;
     }
 
-    v2f_sample_t *input_copy = malloc(sizeof(v2f_sample_t) * sample_count);
-    if (input_copy == NULL) {
-        return V2F_E_OUT_OF_MEMORY;
+    v2f_decorrelator_apply_2d_prediction(
+            V2F_C_DECORRELATOR_MODE_JPEG_LS, decorrelator->max_sample_value, decorrelator->samples_per_row,
+            input_samples, sample_count);
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Reconstruct samples `[start, end)` of a row of a JPEG-LS block.
+ *
+ * @param max_sample_value maximum sample value
+ * @param row samples of the row, reconstructed before `start`
+ * @param north_row reconstructed samples of the previous row up to `end`, or NULL for the first row
+ * @param start position of the first sample to be reconstructed
+ * @param end position after the last sample to be reconstructed
+ */
+static void v2f_decorrelator_inverse_jpeg_ls_segment(
+        v2f_sample_t max_sample_value,
+        v2f_sample_t *const row,
+        v2f_sample_t const *const north_row,
+        uint64_t start,
+        uint64_t end) {
+    uint64_t x = start;
+    if (x == 0) {
+        row[0] = v2f_decorrelator_unmap_sample(row[0], north_row == NULL ? 0 : north_row[0], max_sample_value);
+        x = 1;
+    }
+    if (north_row == NULL) {
+        for (; x < end; x++) {
+            row[x] = v2f_decorrelator_unmap_sample(row[x], row[x - 1], max_sample_value);
+        }
+    } else {
+        for (; x < end; x++) {
+            row[x] = v2f_decorrelator_unmap_sample(
+                    row[x],
+                    v2f_decorrelator_jpeg_ls_predict(row[x - 1], north_row[x], north_row[x - 1]),
+                    max_sample_value);
+        }
     }
-    memcpy(input_copy, input_samples, sizeof(v2f_sample_t) * sample_count);
+}
 
-    // Process the first sample (without any reference)
-    input_samples[0] = v2f_decorrelator_map_predicted_sample(
-            input_samples[0],
-            0,
-            decorrelator->max_sample_value);
-    // process the remainder of the first row (without north references)
-    for (uint64_t sample_index = 1;
-         sample_index < decorrelator->samples_per_row;
-         sample_index++) {
-        input_samples[sample_index] = v2f_decorrelator_map_predicted_sample(
-                input_samples[sample_index],
-                input_copy[sample_index - 1],
-                decorrelator->max_sample_value);
+/**
+ * 16-bit version of v2f_decorrelator_inverse_jpeg_ls_segment().
+ *
+ * @param max_sample_value maximum sample value
+ * @param row samples of the row, reconstructed before `start`
+ * @param north_row reconstructed samples of the previous row up to `end`, or NULL for the first row
+ * @param start position of the first sample to be reconstructed
+ * @param end position after the last sample to be reconstructed
+ */
+static void v2f_decorrelator_inverse_jpeg_ls_segment_16(
+        v2f_sample_t max_sample_value,
+        v2f_sample16_t *const row,
+        v2f_sample16_t const *const north_row,
+        uint64_t start,
+        uint64_t end) {
+    uint64_t x = start;
+    if (x == 0) {
+        row[0] = V2F_DECORRELATOR_UNMAP_16(row[0], north_row == NULL ? 0 : north_row[0], max_sample_value);
+        x = 1;
+    }
+    if (north_row == NULL) {
+        for (; x < end; x++) {
+            row[x] = V2F_DECORRELATOR_UNMAP_16(row[x], row[x - 1], max_sample_value);
+        }
+    } else {
+        for (; x < end; x++) {
+            row[x] = V2F_DECORRELATOR_UNMAP_16(
+                    row[x],
+                    v2f_decorrelator_jpeg_ls_predict(row[x - 1], north_row[x], north_row[x - 1]),
+                    max_sample_value);
+        }
     }
+}
 
-    // process the remaining rows
-    const uint64_t row_count = sample_count / decorrelator->samples_per_row;
-    for (uint64_t row_index = 1; row_index < row_count; row_index++) {
-        // Process the first element of the row
-        input_samples[row_index * decorrelator->samples_per_row] =
-                v2f_decorrelator_map_predicted_sample(
-                        input_samples[row_index * decorrelator->samples_per_row],
-                        input_copy[(row_index - 1) * decorrelator->samples_per_row],
-                        decorrelator->max_sample_value);
-        // Process the remaining samples of the row
-        for (uint64_t sample_index = row_index * decorrelator->samples_per_row + 1;
-             sample_index < (row_index + 1) * decorrelator->samples_per_row;
-             sample_index++) {
+/**
+ * Main function of the JPEG-LS wavefront threads: claim the next row of the block
+ * and reconstruct it segment by segment, waiting for the previous row to be
+ * reconstructed up to the end of each segment, until all rows have been claimed.
+ *
+ * @param argument pointer to the v2f_decorrelator_wavefront_t shared by the threads
+ *
+ * @return NULL
+ */
+static void *v2f_decorrelator_wavefront_worker(void *argument) {
+    v2f_decorrelator_wavefront_t *const wavefront = (v2f_decorrelator_wavefront_t *) argument;
+    const uint64_t samples_per_row = wavefront->samples_per_row;
+
+    pthread_mutex_lock(&(wavefront->mutex));
+    while (wavefront->next_row < wavefront->row_count) {
+        const uint64_t row_index = wavefront->next_row;
+        wavefront->next_row++;
+        uint64_t north_count = row_index == 0 ? samples_per_row : wavefront->reconstructed_counts[row_index - 1];
+        pthread_mutex_unlock(&(wavefront->mutex));
+
+        const uint64_t row_offset = row_index * samples_per_row;
+        for (uint64_t start = 0; start < samples_per_row;) {
+            const uint64_t end = MIN(start + V2F_DECORRELATOR_WAVEFRONT_SEGMENT_SIZE, samples_per_row);
+            if (north_count < end) {
+                pthread_mutex_lock(&(wavefront->mutex));
+                while (wavefront->reconstructed_counts[row_index - 1] < end) {
+                    pthread_cond_wait(&(wavefront->progress), &(wavefront->mutex));
+                }
+                north_count = wavefront->reconstructed_counts[row_index - 1];
+                pthread_mutex_unlock(&(wavefront->mutex));
+            }
 
-            const v2f_sample_t left_north_neighbor = input_copy[sample_index -
-                                                                decorrelator->samples_per_row - 1];
-            const v2f_sample_t north_neighbor = input_copy[sample_index -
-                                                           decorrelator->samples_per_row];
-            const v2f_sample_t left_neighbor = input_copy[sample_index - 1];
-            v2f_sample_t prediction;
-            if (left_north_neighbor >= MAX(left_neighbor, north_neighbor)) {
-                prediction = MIN(left_neighbor, north_neighbor);
-            } else if (left_north_neighbor <= MIN(left_neighbor, north_neighbor)) {
-                prediction = MAX(left_neighbor, north_neighbor);
+            if (wavefront->samples != NULL) {
+                v2f_decorrelator_inverse_jpeg_ls_segment(
+                        wavefront->max_sample_value, wavefront->samples + row_offset,
+                        row_index == 0 ? NULL : wavefront->samples + row_offset - samples_per_row, start, end);
             } else {
-                prediction = left_neighbor + north_neighbor - left_north_neighbor;
+                v2f_decorrelator_inverse_jpeg_ls_segment_16(
+                        wavefront->max_sample_value, wavefront->samples_16 + row_offset,
+                        row_index == 0 ? NULL : wavefront->samples_16 + row_offset - samples_per_row, start, end);
             }
 
-            input_samples[sample_index] = v2f_decorrelator_map_predicted_sample(
-                    input_samples[sample_index], prediction, decorrelator->max_sample_value);
+            pthread_mutex_lock(&(wavefront->mutex));
+            wavefront->reconstructed_counts[row_index] = end;
+            pthread_cond_broadcast(&(wavefront->progress));
+            pthread_mutex_unlock(&(wavefront->mutex));
+            start = end;
         }
+
+        pthread_mutex_lock(&(wavefront->mutex));
+    }
+    pthread_mutex_unlock(&(wavefront->mutex));
+
+    return NULL;
+}
+
+/**
+ * Invert the JPEG-LS prediction of a block with several threads, which reconstruct
+ * consecutive rows concurrently. If some threads cannot be started, fewer are used.
+ *
+ * @param decorrelator decorrelator in JPEG-LS mode with more than one thread
+ * @param samples samples to be reconstructed in place, or NULL if `samples_16` is used
+ * @param samples_16 samples to be reconstructed in place, or NULL if `samples` is used
+ * @param sample_count number of samples, a multiple of the decorrelator's `samples_per_row`
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The block was reconstructed
+ *  - @ref V2F_E_OUT_OF_MEMORY : Not enough memory for the wavefront
+ */
+static v2f_error_t v2f_decorrelator_inverse_jpeg_ls_wavefront(
+        v2f_decorrelator_t const *const decorrelator,
+        v2f_sample_t *const samples,
+        v2f_sample16_t *const samples_16,
+        uint64_t sample_count) {
+    v2f_decorrelator_wavefront_t wavefront;
+    wavefront.max_sample_value = decorrelator->max_sample_value;
+    wavefront.samples_per_row = decorrelator->samples_per_row;
+    wavefront.row_count = sample_count / decorrelator->samples_per_row;
+    wavefront.samples = samples;
+    wavefront.samples_16 = samples_16;
+    wavefront.next_row = 0;
+    wavefront.reconstructed_counts = (uint64_t *) calloc(wavefront.row_count, sizeof(uint64_t));
+    if (wavefront.reconstructed_counts == NULL) {
+        log_error("Cannot allocate the wavefront of %lu rows", wavefront.row_count); // LCOV_EXCL_LINE
+        return V2F_E_OUT_OF_MEMORY; // LCOV_EXCL_LINE
+    }
+    pthread_mutex_init(&(wavefront.mutex), NULL);
+    pthread_cond_init(&(wavefront.progress), NULL);
+
+    // The calling thread is one of the workers
+    pthread_t threads[V2F_C_MAX_THREAD_COUNT];
+    const uint64_t helper_count = MIN(decorrelator->thread_count, wavefront.row_count) - 1;
+    uint32_t started_count = 0;
+    while (started_count < helper_count
+           && pthread_create(&(threads[started_count]), NULL,
+                             v2f_decorrelator_wavefront_worker, &wavefront) == 0) {
+        started_count++;
+    }
+    if (started_count < helper_count) {
+        log_warning("Only %u of %lu wavefront threads could be started", // LCOV_EXCL_LINE
+                    started_count, helper_count); // LCOV_EXCL_LINE
+    }
+    v2f_decorrelator_wavefront_worker(&wavefront);
+    for (uint32_t i = 0; i < started_count; i++) {
+        pthread_join(threads[i], NULL);
     }
 
-    free(input_copy);
+    pthread_cond_destroy(&(wavefront.progress));
+    pthread_mutex_destroy(&(wavefront.mutex));
+    free(wavefront.reconstructed_counts);
+
     return V2F_E_NONE;
 }
 
@@ -552,65 +976,709 @@ v2f_error_t v2f_decorrelator_inverse_jpeg_ls_prediction(
         v2f_decorrelator_t *decorrelator,
         v2f_sample_t *input_samples,
         uint64_t sample_count) {
-    {
-        // Verify parameters and define needed constants.
-        if (decorrelator == NULL
-            || input_samples == NULL
-            || sample_count == 0
-            || (decorrelator->samples_per_row > 0
-                && decorrelator->samples_per_row < 3)
-            || decorrelator->mode != V2F_C_DECORRELATOR_MODE_JPEG_LS) {
-            return V2F_E_INVALID_PARAMETER;
-        }
-        if (decorrelator->samples_per_row == 0
-            || sample_count % decorrelator->samples_per_row != 0) {
-            return V2F_E_INVALID_PARAMETER;
-        }
-
-        // Decode the first two samples
-        input_samples[0] = v2f_decorrelator_unmap_sample(
-                input_samples[0], 0, decorrelator->max_sample_value);
-        // Decode the remainder of the first row (no upper references)
-        for (uint64_t sample_index = 1;
-             sample_index < decorrelator->samples_per_row; sample_index++) {
-            input_samples[sample_index] = v2f_decorrelator_unmap_sample(
-                    input_samples[sample_index],
-                    input_samples[sample_index - 1],
-                    decorrelator->max_sample_value);
-        }
-        // Decode the remaining rows
-        const uint64_t row_count = sample_count / decorrelator->samples_per_row;
-        for (uint64_t row_index = 1; row_index < row_count; row_index++) {
-            // Decode the first two samples of the row
-            input_samples[row_index *
-                          decorrelator->samples_per_row] = v2f_decorrelator_unmap_sample(
-                    input_samples[row_index * decorrelator->samples_per_row],
-                    input_samples[(row_index - 1) * decorrelator->samples_per_row],
-                    decorrelator->max_sample_value);
-            // Decode the remainder of the row
-            for (uint64_t sample_index = row_index * decorrelator->samples_per_row + 1;
-                 sample_index < (row_index + 1) * decorrelator->samples_per_row;
-                 sample_index++) {
-                const v2f_sample_t left_north_neighbor = input_samples[sample_index -
-                                                                       decorrelator->samples_per_row -
-                                                                       1];
-                const v2f_sample_t north_neighbor = input_samples[sample_index -
-                                                                  decorrelator->samples_per_row];
-                const v2f_sample_t left_neighbor = input_samples[sample_index - 1];
-                v2f_sample_t prediction;
-                if (left_north_neighbor >= MAX(left_neighbor, north_neighbor)) {
-                    prediction = MIN(left_neighbor, north_neighbor);
-                } else if (left_north_neighbor <= MIN(left_neighbor, north_neighbor)) {
-                    prediction = MAX(left_neighbor, north_neighbor);
-                } else {
-                    prediction = left_neighbor + north_neighbor - left_north_neighbor;
-                }
+    // Verify parameters and define needed constants.
+    if (decorrelator == NULL
+        || input_samples == NULL
+        || sample_count == 0
+        || (decorrelator->samples_per_row > 0
+            && decorrelator->samples_per_row < 3)
+        || decorrelator->mode != V2F_C_DECORRELATOR_MODE_JPEG_LS
+        || decorrelator->thread_count > V2F_C_MAX_THREAD_COUNT) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    if (decorrelator->samples_per_row == 0
+        || sample_count % decorrelator->samples_per_row != 0) {
+        return V2F_E_INVALID_PARAMETER;
+    }
 
-                input_samples[sample_index] = v2f_decorrelator_unmap_sample(
-                        input_samples[sample_index], prediction, decorrelator->max_sample_value);
-            }
-        }
+    const uint64_t row_count = sample_count / decorrelator->samples_per_row;
+    if (decorrelator->thread_count > 1 && row_count > 1) {
+        return v2f_decorrelator_inverse_jpeg_ls_wavefront(decorrelator, input_samples, NULL, sample_count);
+    }
 
-        return V2F_E_NONE;
+    v2f_decorrelator_inverse_jpeg_ls_segment(
+            decorrelator->max_sample_value, input_samples, NULL, 0, decorrelator->samples_per_row);
+    for (uint64_t row_index = 1; row_index < row_count; row_index++) {
+        v2f_sample_t *const row = input_samples + row_index * decorrelator->samples_per_row;
+        v2f_decorrelator_inverse_jpeg_ls_segment(
+                decorrelator->max_sample_value, row, row - decorrelator->samples_per_row,
+                0, decorrelator->samples_per_row);
     }
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Verify the parameters of v2f_decorrelator_invert_range() and v2f_decorrelator_invert_range_16().
+ *
+ * @param decorrelator decorrelator to be used
+ * @param samples block of samples
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The parameters are valid for the decorrelator's mode
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ */
+static v2f_error_t v2f_decorrelator_check_inverse_range(
+        v2f_decorrelator_t const *const decorrelator,
+        void const *const samples) {
+    if (decorrelator == NULL || samples == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    if (decorrelator->mode != V2F_C_DECORRELATOR_MODE_NONE
+        && decorrelator->mode != V2F_C_DECORRELATOR_MODE_LEFT
+        && decorrelator->samples_per_row > 0 && decorrelator->samples_per_row < 3) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    if ((decorrelator->mode == V2F_C_DECORRELATOR_MODE_JPEG_LS
+         || decorrelator->mode == V2F_C_DECORRELATOR_MODE_FGIJ)
+        && decorrelator->samples_per_row == 0) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    return V2F_E_NONE;
+}
+
+/**
+ * Reconstruct the samples `row[x]`, for `x` in `[start, end)`, in place.
+ *
+ * @param mode decorrelator mode other than V2F_C_DECORRELATOR_MODE_NONE
+ * @param max_sample_value maximum sample value
+ * @param row samples of the row, reconstructed before `start`
+ * @param north_row reconstructed samples of the previous row, or NULL for the first row
+ * @param start position of the first sample to be reconstructed
+ * @param end position after the last sample to be reconstructed
+ */
+static void v2f_decorrelator_inverse_segment(
+        v2f_decorrelator_mode_t mode,
+        v2f_sample_t max_sample_value,
+        v2f_sample_t *const row,
+        v2f_sample_t const *const north_row,
+        uint64_t start,
+        uint64_t end) {
+    const uint64_t first_predicted =
+            mode == V2F_C_DECORRELATOR_MODE_2_LEFT || mode == V2F_C_DECORRELATOR_MODE_FGIJ ? 2 : 1;
+    uint64_t x = start;
+    for (; x < MIN(first_predicted, end); x++) {
+        row[x] = v2f_decorrelator_unmap_sample(
+                row[x], v2f_decorrelator_predict_row_start(mode, row, north_row, x), max_sample_value);
+    }
+    switch (mode) {
+        case V2F_C_DECORRELATOR_MODE_LEFT:
+            for (; x < end; x++) {
+                row[x] = v2f_decorrelator_unmap_sample(row[x], row[x - 1], max_sample_value);
+            }
+            break;
+        case V2F_C_DECORRELATOR_MODE_2_LEFT:
+            for (; x < end; x++) {
+                row[x] = v2f_decorrelator_unmap_sample(row[x], (row[x - 1] + row[x - 2] + 1) >> 1, max_sample_value);
+            }
+            break;
+        case V2F_C_DECORRELATOR_MODE_JPEG_LS:
+            v2f_decorrelator_inverse_jpeg_ls_segment(max_sample_value, row, north_row, x, end);
+            break;
+        case V2F_C_DECORRELATOR_MODE_FGIJ:
+            if (north_row == NULL) {
+                for (; x < end; x++) {
+                    row[x] = v2f_decorrelator_unmap_sample(
+                            row[x], (row[x - 1] + row[x - 2]) >> 1, max_sample_value);
+                }
+            } else {
+                for (; x < end; x++) {
+                    row[x] = v2f_decorrelator_unmap_sample(
+                            row[x], (row[x - 1] + row[x - 2] + north_row[x] + north_row[x - 1]) >> 2,
+                            max_sample_value);
+                }
+            }
+            break;
+        default:
+            abort(); // LCOV_EXCL_LINE
+    }
+}
+
+v2f_error_t v2f_decorrelator_invert_range(
+        v2f_decorrelator_t const *const decorrelator,
+        v2f_sample_t *const samples,
+        uint64_t first_sample,
+        uint64_t range_sample_count) {
+    RETURN_IF_FAIL(v2f_decorrelator_check_inverse_range(decorrelator, samples));
+    const v2f_decorrelator_mode_t mode = decorrelator->mode;
+    if (mode == V2F_C_DECORRELATOR_MODE_NONE || mode >= V2F_C_DECORRELATOR_MODE_COUNT) {
+        return V2F_E_NONE;
+    }
+
+    // One-dimensional modes treat the block as a single row
+    const uint64_t samples_per_row = mode == V2F_C_DECORRELATOR_MODE_JPEG_LS || mode == V2F_C_DECORRELATOR_MODE_FGIJ ?
+                                     decorrelator->samples_per_row : UINT64_MAX;
+    const uint64_t end = first_sample + range_sample_count;
+    for (uint64_t position = first_sample; position < end;) {
+        const uint64_t row_index = position / samples_per_row;
+        v2f_sample_t *const row = samples + row_index * samples_per_row;
+        const uint64_t row_end = MIN(samples_per_row, end - row_index * samples_per_row);
+        v2f_decorrelator_inverse_segment(
+                mode, decorrelator->max_sample_value, row, row_index == 0 ? NULL : row - samples_per_row,
+                position - row_index * samples_per_row, row_end);
+        position = row_index * samples_per_row + row_end;
+    }
+
+    return V2F_E_NONE;
+}
+
+/**
+ * 16-bit version of v2f_decorrelator_predict_chunk().
+ *
+ * @param mode decorrelator mode
+ * @param row samples of the row, not modified yet in `[start - 2, start + count)`
+ * @param north_row samples of the previous row, not modified yet, or NULL for the first row
+ * @param start position of the first sample to be predicted
+ * @param count number of samples to be predicted, at most V2F_DECORRELATOR_CHUNK_SIZE
+ * @param predictions array where the `count` predictions are stored
+ */
+static void v2f_decorrelator_predict_chunk_16(
+        v2f_decorrelator_mode_t mode,
+        v2f_sample16_t const *const row,
+        v2f_sample16_t const *const north_row,
+        uint64_t start,
+        uint64_t count,
+        v2f_sample_t *const predictions) {
+    v2f_sample16_t const *const left = row + start - 1;
+    switch (mode) {
+        case V2F_C_DECORRELATOR_MODE_LEFT:
+            for (uint64_t k = 0; k < count; k++) {
+                predictions[k] = left[k];
+            }
+            break;
+        case V2F_C_DECORRELATOR_MODE_2_LEFT:
+            for (uint64_t k = 0; k < count; k++) {
+                predictions[k] = ((v2f_sample_t) left[k] + left[k - 1] + 1) >> 1;
+            }
+            break;
+        case V2F_C_DECORRELATOR_MODE_JPEG_LS:
+            if (north_row == NULL) {
+                for (uint64_t k = 0; k < count; k++) {
+                    predictions[k] = left[k];
+                }
+            } else {
+                v2f_sample16_t const *const north = north_row + start;
+                for (uint64_t k = 0; k < count; k++) {
+                    predictions[k] = v2f_decorrelator_jpeg_ls_predict(left[k], north[k], north[k - 1]);
+                }
+            }
+            break;
+        case V2F_C_DECORRELATOR_MODE_FGIJ:
+            if (north_row == NULL) {
+                for (uint64_t k = 0; k < count; k++) {
+                    predictions[k] = ((v2f_sample_t) left[k] + left[k - 1]) >> 1;
+                }
+            } else {
+                v2f_sample16_t const *const north = north_row + start;
+                for (uint64_t k = 0; k < count; k++) {
+                    predictions[k] = ((v2f_sample_t) left[k] + left[k - 1] + north[k] + north[k - 1]) >> 2;
+                }
+            }
+            break;
+        default:
+            abort(); // LCOV_EXCL_LINE
+    }
+}
+
+/**
+ * 16-bit version of v2f_decorrelator_apply_row().
+ *
+ * @param mode decorrelator mode
+ * @param max_sample_value maximum sample value
+ * @param row samples of the row. The samples before `start` are not modified.
+ * @param north_row samples of the previous row, or NULL for the first row
+ * @param start position of the first sample to be processed
+ * @param end position after the last sample to be processed
+ */
+static void v2f_decorrelator_apply_row_16(
+        v2f_decorrelator_mode_t mode,
+        v2f_sample_t max_sample_value,
+        v2f_sample16_t *const row,
+        v2f_sample16_t const *const north_row,
+        uint64_t start,
+        uint64_t end) {
+    v2f_sample_t predictions[V2F_DECORRELATOR_CHUNK_SIZE];
+    while (end > start) {
+        const uint64_t chunk_start = end - start > V2F_DECORRELATOR_CHUNK_SIZE ?
+                                     end - V2F_DECORRELATOR_CHUNK_SIZE : start;
+        const uint64_t count = end - chunk_start;
+        v2f_decorrelator_predict_chunk_16(mode, row, north_row, chunk_start, count, predictions);
+        v2f_sample16_t *const samples = row + chunk_start;
+        for (uint64_t k = 0; k < count; k++) {
+            samples[k] = (v2f_sample16_t) v2f_decorrelator_map(samples[k], predictions[k], max_sample_value);
+        }
+        end = chunk_start;
+    }
+}
+
+/**
+ * 16-bit version of v2f_decorrelator_apply_2d_prediction(), used for
+ * v2f_decorrelator_apply_jpeg_ls_prediction() and v2f_decorrelator_apply_fgij_prediction().
+ *
+ * @param mode V2F_C_DECORRELATOR_MODE_JPEG_LS or V2F_C_DECORRELATOR_MODE_FGIJ
+ * @param max_sample_value maximum sample value
+ * @param samples_per_row number of samples per row, at least 3
+ * @param samples samples to be decorrelated in place
+ * @param sample_count number of samples, a multiple of `samples_per_row`
+ */
+static void v2f_decorrelator_apply_2d_prediction_16(
+        v2f_decorrelator_mode_t mode,
+        v2f_sample_t max_sample_value,
+        uint64_t samples_per_row,
+        v2f_sample16_t *const samples,
+        uint64_t sample_count) {
+    const uint64_t start = mode == V2F_C_DECORRELATOR_MODE_FGIJ ? 2 : 1;
+    for (uint64_t row_index = sample_count / samples_per_row - 1; row_index > 0; row_index--) {
+        v2f_sample16_t *const row = samples + row_index * samples_per_row;
+        v2f_sample16_t const *const north_row = row - samples_per_row;
+        v2f_decorrelator_apply_row_16(mode, max_sample_value, row, north_row, start, samples_per_row);
+        if (mode == V2F_C_DECORRELATOR_MODE_FGIJ) {
+            // The third neighbor of the second sample is the last sample of the previous row
+            row[1] = V2F_DECORRELATOR_MAP_16(
+                    row[1], ((v2f_sample_t) north_row[1] + north_row[0] + row[-1]) / 3, max_sample_value);
+        }
+        row[0] = V2F_DECORRELATOR_MAP_16(row[0], north_row[0], max_sample_value);
+    }
+
+    v2f_decorrelator_apply_row_16(mode, max_sample_value, samples, NULL, start, samples_per_row);
+    if (mode == V2F_C_DECORRELATOR_MODE_FGIJ) {
+        samples[1] = V2F_DECORRELATOR_MAP_16(samples[1], samples[0], max_sample_value);
+    }
+    samples[0] = V2F_DECORRELATOR_MAP_16(samples[0], 0, max_sample_value);
+}
+
+/**
+ * 16-bit version of v2f_decorrelator_apply_left_prediction().
+ *
+ * @param max_sample_value maximum sample value
+ * @param samples samples to be decorrelated in place
+ * @param sample_count number of samples
+ *
+ * @return
+ *  - @ref V2F_E_NONE : Decorrelation successful
+ *  - @ref V2F_E_CORRUPTED_DATA : a sample is larger than `max_sample_value`
+ */
+static v2f_error_t v2f_decorrelator_apply_left_prediction_16(
+        v2f_sample_t max_sample_value,
+        v2f_sample16_t *const samples,
+        uint64_t sample_count) {
+    v2f_sample16_t block_max = 0;
+    for (uint64_t i = 0; i < sample_count; i++) {
+        block_max = MAX(block_max, samples[i]);
+    }
+    if (block_max > max_sample_value) {
+        for (uint64_t i = 0; i < sample_count; i++) {
+            if (samples[i] > max_sample_value) {
+                log_error("Encountered input sample input_samples[%lu]=%u "
+                          "> max_sample_value=%u",
+                          i, (v2f_sample_t) samples[i], max_sample_value);
+                break;
+            }
+        }
+        return V2F_E_CORRUPTED_DATA;
+    }
+
+    v2f_decorrelator_apply_row_16(V2F_C_DECORRELATOR_MODE_LEFT, max_sample_value, samples, NULL, 1, sample_count);
+    samples[0] = V2F_DECORRELATOR_MAP_16(samples[0], 0, max_sample_value);
+    return V2F_E_NONE;
+}
+
+/**
+ * 16-bit version of v2f_decorrelator_inverse_left_prediction().
+ *
+ * @param max_sample_value maximum sample value
+ * @param samples samples to be reconstructed in place
+ * @param sample_count number of samples
+ */
+static void v2f_decorrelator_inverse_left_prediction_16(
+        v2f_sample_t max_sample_value,
+        v2f_sample16_t *const samples,
+        uint64_t sample_count) {
+    v2f_sample_t prediction = 0;
+    for (uint64_t i = 0; i < sample_count; i++) {
+        samples[i] = V2F_DECORRELATOR_UNMAP_16(samples[i], prediction, max_sample_value);
+        prediction = samples[i];
+    }
+}
+
+/**
+ * 16-bit version of v2f_decorrelator_apply_2_left_prediction().
+ *
+ * @param max_sample_value maximum sample value
+ * @param samples samples to be decorrelated in place
+ * @param sample_count number of samples
+ */
+static void v2f_decorrelator_apply_2_left_prediction_16(
+        v2f_sample_t max_sample_value,
+        v2f_sample16_t *const samples,
+        uint64_t sample_count) {
+    v2f_decorrelator_apply_row_16(V2F_C_DECORRELATOR_MODE_2_LEFT, max_sample_value, samples, NULL, 2, sample_count);
+    if (sample_count > 1) {
+        samples[1] = V2F_DECORRELATOR_MAP_16(samples[1], ((v2f_sample_t) samples[0] + 1) >> 1, max_sample_value);
+    }
+    samples[0] = V2F_DECORRELATOR_MAP_16(samples[0], 0, max_sample_value);
+}
+
+/**
+ * 16-bit version of v2f_decorrelator_inverse_2_left_prediction().
+ *
+ * @param max_sample_value maximum sample value
+ * @param samples samples to be reconstructed in place
+ * @param sample_count number of samples
+ */
+static void v2f_decorrelator_inverse_2_left_prediction_16(
+        v2f_sample_t max_sample_value,
+        v2f_sample16_t *const samples,
+        uint64_t sample_count) {
+    v2f_sample_t left_left_neighbor = 0;
+    v2f_sample_t left_neighbor = 0;
+    for (uint64_t i = 0; i < sample_count; i++) {
+        samples[i] = V2F_DECORRELATOR_UNMAP_16(
+                samples[i], (left_neighbor + left_left_neighbor + 1) >> 1, max_sample_value);
+        left_left_neighbor = left_neighbor;
+        left_neighbor = samples[i];
+    }
+}
+
+/**
+ * 16-bit version of v2f_decorrelator_inverse_jpeg_ls_prediction().
+ *
+ * @param decorrelator decorrelator in JPEG-LS mode
+ * @param samples samples to be reconstructed in place
+ * @param sample_count number of samples, a multiple of the decorrelator's `samples_per_row`
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The block was reconstructed
+ *  - @ref V2F_E_OUT_OF_MEMORY : Not enough memory for the wavefront
+ */
+static v2f_error_t v2f_decorrelator_inverse_jpeg_ls_prediction_16(
+        v2f_decorrelator_t const *const decorrelator,
+        v2f_sample16_t *const samples,
+        uint64_t sample_count) {
+    const uint64_t samples_per_row = decorrelator->samples_per_row;
+    const uint64_t row_count = sample_count / samples_per_row;
+    if (decorrelator->thread_count > 1 && row_count > 1) {
+        return v2f_decorrelator_inverse_jpeg_ls_wavefront(decorrelator, NULL, samples, sample_count);
+    }
+
+    v2f_decorrelator_inverse_jpeg_ls_segment_16(decorrelator->max_sample_value, samples, NULL, 0, samples_per_row);
+    for (uint64_t row_index = 1; row_index < row_count; row_index++) {
+        v2f_sample16_t *const row = samples + row_index * samples_per_row;
+        v2f_decorrelator_inverse_jpeg_ls_segment_16(
+                decorrelator->max_sample_value, row, row - samples_per_row, 0, samples_per_row);
+    }
+    return V2F_E_NONE;
+}
+
+/**
+ * 16-bit version of v2f_decorrelator_inverse_fgij_prediction().
+ *
+ * @param max_sample_value maximum sample value
+ * @param samples_per_row number of samples per row, at least 3
+ * @param samples samples to be reconstructed in place
+ * @param sample_count number of samples, a multiple of `samples_per_row`
+ */
+static void v2f_decorrelator_inverse_fgij_prediction_16(
+        v2f_sample_t max_sample_value,
+        uint64_t samples_per_row,
+        v2f_sample16_t *const samples,
+        uint64_t sample_count) {
+    samples[0] = V2F_DECORRELATOR_UNMAP_16(samples[0], 0, max_sample_value);
+    samples[1] = V2F_DECORRELATOR_UNMAP_16(samples[1], samples[0], max_sample_value);
+    for (uint64_t x = 2; x < samples_per_row; x++) {
+        samples[x] = V2F_DECORRELATOR_UNMAP_16(
+                samples[x], ((v2f_sample_t) samples[x - 1] + samples[x - 2]) >> 1, max_sample_value);
+    }
+    const uint64_t row_count = sample_count / samples_per_row;
+    for (uint64_t row_index = 1; row_index < row_count; row_index++) {
+        v2f_sample16_t *const row = samples + row_index * samples_per_row;
+        v2f_sample16_t const *const north_row = row - samples_per_row;
+        row[0] = V2F_DECORRELATOR_UNMAP_16(row[0], north_row[0], max_sample_value);
+        row[1] = V2F_DECORRELATOR_UNMAP_16(
+                row[1],
+                ((v2f_sample_t) north_row[1] + north_row[0] + row[-1]) / 3,
+                max_sample_value);
+        for (uint64_t x = 2; x < samples_per_row; x++) {
+            row[x] = V2F_DECORRELATOR_UNMAP_16(
+                    row[x],
+                    ((v2f_sample_t) row[x - 1] + row[x - 2] + north_row[x] + north_row[x - 1]) >> 2,
+                    max_sample_value);
+        }
+    }
+}
+
+/**
+ * Verify the parameters of the 16-bit decorrelation functions.
+ *
+ * @param decorrelator decorrelator to be used
+ * @param samples block of samples
+ * @param sample_count number of samples in the block
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The parameters are valid for the decorrelator's mode
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ */
+static v2f_error_t v2f_decorrelator_check_block_16(
+        v2f_decorrelator_t const *const decorrelator,
+        v2f_sample16_t const *const samples,
+        uint64_t sample_count) {
+    if (decorrelator == NULL || samples == NULL || sample_count == 0
+        || decorrelator->max_sample_value > V2F_SAMPLE16_T_MAX
+        || decorrelator->thread_count > V2F_C_MAX_THREAD_COUNT) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    if (decorrelator->mode != V2F_C_DECORRELATOR_MODE_NONE
+        && decorrelator->mode != V2F_C_DECORRELATOR_MODE_LEFT
+        && decorrelator->samples_per_row > 0 && decorrelator->samples_per_row < 3) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    if ((decorrelator->mode == V2F_C_DECORRELATOR_MODE_JPEG_LS
+         || decorrelator->mode == V2F_C_DECORRELATOR_MODE_FGIJ)
+        && (decorrelator->samples_per_row == 0 || sample_count % decorrelator->samples_per_row != 0)) {
+        log_error("Invalid number of samples per row (%lu)", decorrelator->samples_per_row);
+        return V2F_E_INVALID_PARAMETER;
+    }
+    return V2F_E_NONE;
+}
+
+v2f_error_t v2f_decorrelator_decorrelate_block_16(
+        v2f_decorrelator_t *decorrelator,
+        v2f_sample16_t *input_samples,
+        uint64_t sample_count) {
+    RETURN_IF_FAIL(v2f_decorrelator_check_block_16(decorrelator, input_samples, sample_count));
+
+    timer_start_handle(v2f_decorrelator_timer());
+    v2f_error_t status = V2F_E_NONE;
+    switch (decorrelator->mode) {
+        case V2F_C_DECORRELATOR_MODE_NONE:
+            break;
+        case V2F_C_DECORRELATOR_MODE_LEFT:
+            status = v2f_decorrelator_apply_left_prediction_16(
+                    decorrelator->max_sample_value, input_samples, sample_count);
+            break;
+        case V2F_C_DECORRELATOR_MODE_2_LEFT:
+            v2f_decorrelator_apply_2_left_prediction_16(
+                    decorrelator->max_sample_value, input_samples, sample_count);
+            break;
+        case V2F_C_DECORRELATOR_MODE_JPEG_LS:
+            v2f_decorrelator_apply_2d_prediction_16(
+                    decorrelator->mode, decorrelator->max_sample_value, decorrelator->samples_per_row,
+                    input_samples, sample_count);
+            break;
+        case V2F_C_DECORRELATOR_MODE_FGIJ:
+            v2f_decorrelator_apply_2d_prediction_16(
+                    decorrelator->mode, decorrelator->max_sample_value, decorrelator->samples_per_row,
+                    input_samples, sample_count);
+            break;
+        default:
+            break;
+    }
+    timer_stop_handle(v2f_decorrelator_timer());
+    return status;
+}
+
+v2f_error_t v2f_decorrelator_invert_block_16(
+        v2f_decorrelator_t *decorrelator,
+        v2f_sample16_t *input_samples,
+        uint64_t sample_count) {
+    RETURN_IF_FAIL(v2f_decorrelator_check_block_16(decorrelator, input_samples, sample_count));
+
+    switch (decorrelator->mode) {
+        case V2F_C_DECORRELATOR_MODE_NONE:
+            break;
+        case V2F_C_DECORRELATOR_MODE_LEFT:
+            v2f_decorrelator_inverse_left_prediction_16(
+                    decorrelator->max_sample_value, input_samples, sample_count);
+            break;
+        case V2F_C_DECORRELATOR_MODE_2_LEFT:
+            v2f_decorrelator_inverse_2_left_prediction_16(
+                    decorrelator->max_sample_value, input_samples, sample_count);
+            break;
+        case V2F_C_DECORRELATOR_MODE_JPEG_LS:
+            RETURN_IF_FAIL(v2f_decorrelator_inverse_jpeg_ls_prediction_16(decorrelator, input_samples, sample_count));
+            break;
+        case V2F_C_DECORRELATOR_MODE_FGIJ:
+            v2f_decorrelator_inverse_fgij_prediction_16(
+                    decorrelator->max_sample_value, decorrelator->samples_per_row,
+                    input_samples, sample_count);
+            break;
+        default:
+            return V2F_E_INVALID_PARAMETER;
+    }
+
+    return V2F_E_NONE;
+}
+
+/**
+ * 16-bit version of v2f_decorrelator_predict_row_start().
+ *
+ * @param mode decorrelator mode
+ * @param row samples of the row
+ * @param north_row samples of the previous row, or NULL for the first row
+ * @param x position of the sample in the row, 0 or 1
+ *
+ * @return the prediction of `row[x]`
+ */
+static inline v2f_sample_t v2f_decorrelator_predict_row_start_16(
+        v2f_decorrelator_mode_t mode,
+        v2f_sample16_t const *const row,
+        v2f_sample16_t const *const north_row,
+        uint64_t x) {
+    if (x == 0) {
+        return north_row == NULL ? 0 : north_row[0];
+    }
+    if (mode == V2F_C_DECORRELATOR_MODE_2_LEFT) {
+        return ((v2f_sample_t) row[0] + 1) >> 1;
+    }
+    return north_row == NULL ? row[0] : ((v2f_sample_t) north_row[1] + north_row[0] + row[-1]) / 3;
+}
+
+v2f_error_t v2f_decorrelator_decorrelate_range_16(
+        v2f_decorrelator_t const *const decorrelator,
+        v2f_sample16_t const *const samples,
+        uint64_t sample_count,
+        uint64_t first_sample,
+        uint64_t range_sample_count,
+        v2f_sample16_t *const decorrelated_samples) {
+    RETURN_IF_FAIL(v2f_decorrelator_check_range(
+            decorrelator, samples, sample_count, first_sample, range_sample_count, decorrelated_samples));
+    if (decorrelator->max_sample_value > V2F_SAMPLE16_T_MAX) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    const v2f_decorrelator_mode_t mode = decorrelator->mode;
+    const v2f_sample_t max_sample_value = decorrelator->max_sample_value;
+    if (mode == V2F_C_DECORRELATOR_MODE_NONE || mode >= V2F_C_DECORRELATOR_MODE_COUNT) {
+        memcpy(decorrelated_samples, samples + first_sample, sizeof(v2f_sample16_t) * range_sample_count);
+        return V2F_E_NONE;
+    }
+    if (mode == V2F_C_DECORRELATOR_MODE_LEFT) {
+        v2f_sample16_t range_max = 0;
+        for (uint64_t i = first_sample; i < first_sample + range_sample_count; i++) {
+            range_max = MAX(range_max, samples[i]);
+        }
+        if (range_max > max_sample_value) {
+            log_error("Encountered input sample > max_sample_value=%u", max_sample_value);
+            return V2F_E_CORRUPTED_DATA;
+        }
+    }
+
+    const uint64_t samples_per_row = mode == V2F_C_DECORRELATOR_MODE_JPEG_LS || mode == V2F_C_DECORRELATOR_MODE_FGIJ ?
+                                     decorrelator->samples_per_row : sample_count;
+    const uint64_t first_predicted =
+            mode == V2F_C_DECORRELATOR_MODE_2_LEFT || mode == V2F_C_DECORRELATOR_MODE_FGIJ ? 2 : 1;
+    const uint64_t end = first_sample + range_sample_count;
+    v2f_sample_t predictions[V2F_DECORRELATOR_CHUNK_SIZE];
+    v2f_sample16_t *output = decorrelated_samples;
+    for (uint64_t position = first_sample; position < end;) {
+        const uint64_t row_index = position / samples_per_row;
+        v2f_sample16_t const *const row = samples + row_index * samples_per_row;
+        v2f_sample16_t const *const north_row = row_index == 0 ? NULL : row - samples_per_row;
+        uint64_t x = position - row_index * samples_per_row;
+        const uint64_t row_end = MIN(samples_per_row, end - row_index * samples_per_row);
+
+        for (; x < MIN(first_predicted, row_end); x++) {
+            *(output++) = (v2f_sample16_t) v2f_decorrelator_map(
+                    row[x], v2f_decorrelator_predict_row_start_16(mode, row, north_row, x), max_sample_value);
+        }
+        while (x < row_end) {
+            const uint64_t count = MIN(V2F_DECORRELATOR_CHUNK_SIZE, row_end - x);
+            v2f_decorrelator_predict_chunk_16(mode, row, north_row, x, count, predictions);
+            for (uint64_t k = 0; k < count; k++) {
+                output[k] = (v2f_sample16_t) v2f_decorrelator_map(row[x + k], predictions[k], max_sample_value);
+            }
+            output += count;
+            x += count;
+        }
+        position = row_index * samples_per_row + row_end;
+    }
+
+    return V2F_E_NONE;
+}
+
+/**
+ * 16-bit version of v2f_decorrelator_inverse_segment().
+ *
+ * @param mode decorrelator mode other than V2F_C_DECORRELATOR_MODE_NONE
+ * @param max_sample_value maximum sample value
+ * @param row samples of the row, reconstructed before `start`
+ * @param north_row reconstructed samples of the previous row, or NULL for the first row
+ * @param start position of the first sample to be reconstructed
+ * @param end position after the last sample to be reconstructed
+ */
+static void v2f_decorrelator_inverse_segment_16(
+        v2f_decorrelator_mode_t mode,
+        v2f_sample_t max_sample_value,
+        v2f_sample16_t *const row,
+        v2f_sample16_t const *const north_row,
+        uint64_t start,
+        uint64_t end) {
+    const uint64_t first_predicted =
+            mode == V2F_C_DECORRELATOR_MODE_2_LEFT || mode == V2F_C_DECORRELATOR_MODE_FGIJ ? 2 : 1;
+    uint64_t x = start;
+    for (; x < MIN(first_predicted, end); x++) {
+        row[x] = V2F_DECORRELATOR_UNMAP_16(
+                row[x], v2f_decorrelator_predict_row_start_16(mode, row, north_row, x), max_sample_value);
+    }
+    switch (mode) {
+        case V2F_C_DECORRELATOR_MODE_LEFT:
+            for (; x < end; x++) {
+                row[x] = V2F_DECORRELATOR_UNMAP_16(row[x], row[x - 1], max_sample_value);
+            }
+            break;
+        case V2F_C_DECORRELATOR_MODE_2_LEFT:
+            for (; x < end; x++) {
+                row[x] = V2F_DECORRELATOR_UNMAP_16(
+                        row[x], ((v2f_sample_t) row[x - 1] + row[x - 2] + 1) >> 1, max_sample_value);
+            }
+            break;
+        case V2F_C_DECORRELATOR_MODE_JPEG_LS:
+            v2f_decorrelator_inverse_jpeg_ls_segment_16(max_sample_value, row, north_row, x, end);
+            break;
+        case V2F_C_DECORRELATOR_MODE_FGIJ:
+            if (north_row == NULL) {
+                for (; x < end; x++) {
+                    row[x] = V2F_DECORRELATOR_UNMAP_16(
+                            row[x], ((v2f_sample_t) row[x - 1] + row[x - 2]) >> 1, max_sample_value);
+                }
+            } else {
+                for (; x < end; x++) {
+                    row[x] = V2F_DECORRELATOR_UNMAP_16(
+                            row[x], ((v2f_sample_t) row[x - 1] + row[x - 2] + north_row[x] + north_row[x - 1]) >> 2,
+                            max_sample_value);
+                }
+            }
+            break;
+        default:
+            abort(); // LCOV_EXCL_LINE
+    }
+}
+
+v2f_error_t v2f_decorrelator_invert_range_16(
+        v2f_decorrelator_t const *const decorrelator,
+        v2f_sample16_t *const samples,
+        uint64_t first_sample,
+        uint64_t range_sample_count) {
+    RETURN_IF_FAIL(v2f_decorrelator_check_inverse_range(decorrelator, samples));
+    if (decorrelator->max_sample_value > V2F_SAMPLE16_T_MAX) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    const v2f_decorrelator_mode_t mode = decorrelator->mode;
+    if (mode == V2F_C_DECORRELATOR_MODE_NONE || mode >= V2F_C_DECORRELATOR_MODE_COUNT) {
+        return V2F_E_NONE;
+    }
+
+    const uint64_t samples_per_row = mode == V2F_C_DECORRELATOR_MODE_JPEG_LS || mode == V2F_C_DECORRELATOR_MODE_FGIJ ?
+                                     decorrelator->samples_per_row : UINT64_MAX;
+    const uint64_t end = first_sample + range_sample_count;
+    for (uint64_t position = first_sample; position < end;) {
+        const uint64_t row_index = position / samples_per_row;
+        v2f_sample16_t *const row = samples + row_index * samples_per_row;
+        const uint64_t row_end = MIN(samples_per_row, end - row_index * samples_per_row);
+        v2f_decorrelator_inverse_segment_16(
+                mode, decorrelator->max_sample_value, row, row_index == 0 ? NULL : row - samples_per_row,
+                position - row_index * samples_per_row, row_end);
+        position = row_index * samples_per_row + row_end;
+    }
+
+    return V2F_E_NONE;
 }
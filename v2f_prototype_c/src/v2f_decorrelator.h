@@ -97,6 +97,134 @@ v2f_error_t v2f_decorrelator_invert_block(
         v2f_sample_t *input_samples,
         uint64_t sample_count);
 
+/**
+ * Apply decorrelation to a block of samples stored with 16 bits per sample.
+ *
+ * The result is identical to that of v2f_decorrelator_decorrelate_block()
+ * for the same samples. The decorrelator's max_sample_value must fit in 16 bits.
+ *
+ * @param decorrelator initialized decorrelator
+ * @param input_samples buffer of samples to decorrelate
+ * @param sample_count number of samples in the buffer
+ * @return
+ *  - @ref V2F_E_NONE : Decorrelation successfull
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ *  - @ref V2F_E_CORRUPTED_DATA : A sample exceeds the maximum sample value
+ */
+v2f_error_t v2f_decorrelator_decorrelate_block_16(
+        v2f_decorrelator_t *decorrelator,
+        v2f_sample16_t *input_samples,
+        uint64_t sample_count);
+
+/**
+ * Apply inverse decorrelation to a block of samples stored with 16 bits per sample.
+ *
+ * The result is identical to that of v2f_decorrelator_invert_block()
+ * for the same samples. The decorrelator's max_sample_value must fit in 16 bits.
+ *
+ * @param decorrelator initialized decorrelator
+ * @param input_samples buffer of samples to decorrelate
+ * @param sample_count number of samples in the buffer
+ * @return
+ *  - @ref V2F_E_NONE : Inverse decorrelation successfull
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ */
+v2f_error_t v2f_decorrelator_invert_block_16(
+        v2f_decorrelator_t *decorrelator,
+        v2f_sample16_t *input_samples,
+        uint64_t sample_count);
+
+/**
+ * Compute the decorrelated values of a range of consecutive samples of a block,
+ * without modifying the block.
+ *
+ * The decorrelated values are identical to those of the same samples after
+ * v2f_decorrelator_decorrelate_block(), so a block can be decorrelated
+ * by ranges, e.g., to keep the decorrelated samples in cache until they are coded.
+ *
+ * @param decorrelator initialized decorrelator
+ * @param samples samples of the whole block
+ * @param sample_count number of samples in the block
+ * @param first_sample index of the first sample of the range
+ * @param range_sample_count number of samples in the range
+ * @param decorrelated_samples buffer where the `range_sample_count` decorrelated samples are stored
+ * @return
+ *  - @ref V2F_E_NONE : Decorrelation successfull
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ *  - @ref V2F_E_CORRUPTED_DATA : A sample exceeds the maximum sample value
+ */
+v2f_error_t v2f_decorrelator_decorrelate_range(
+        v2f_decorrelator_t const *const decorrelator,
+        v2f_sample_t const *const samples,
+        uint64_t sample_count,
+        uint64_t first_sample,
+        uint64_t range_sample_count,
+        v2f_sample_t *const decorrelated_samples);
+
+/**
+ * 16-bit version of v2f_decorrelator_decorrelate_range().
+ * The decorrelator's max_sample_value must fit in 16 bits.
+ *
+ * @param decorrelator initialized decorrelator
+ * @param samples samples of the whole block
+ * @param sample_count number of samples in the block
+ * @param first_sample index of the first sample of the range
+ * @param range_sample_count number of samples in the range
+ * @param decorrelated_samples buffer where the `range_sample_count` decorrelated samples are stored
+ * @return
+ *  - @ref V2F_E_NONE : Decorrelation successfull
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ *  - @ref V2F_E_CORRUPTED_DATA : A sample exceeds the maximum sample value
+ */
+v2f_error_t v2f_decorrelator_decorrelate_range_16(
+        v2f_decorrelator_t const *const decorrelator,
+        v2f_sample16_t const *const samples,
+        uint64_t sample_count,
+        uint64_t first_sample,
+        uint64_t range_sample_count,
+        v2f_sample16_t *const decorrelated_samples);
+
+/**
+ * Apply inverse decorrelation to a range of consecutive samples of a block, in place.
+ *
+ * All samples of the block before the range must have been reconstructed already,
+ * so that a block can be reconstructed by consecutive ranges, e.g., while it is decoded.
+ * The result is identical to that of v2f_decorrelator_invert_block() for the whole block,
+ * which must consist of complete rows in two-dimensional modes.
+ * Ranges are always reconstructed by the calling thread.
+ *
+ * @param decorrelator initialized decorrelator
+ * @param samples samples of the whole block
+ * @param first_sample index of the first sample of the range
+ * @param range_sample_count number of samples in the range
+ * @return
+ *  - @ref V2F_E_NONE : Inverse decorrelation successfull
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ */
+v2f_error_t v2f_decorrelator_invert_range(
+        v2f_decorrelator_t const *const decorrelator,
+        v2f_sample_t *const samples,
+        uint64_t first_sample,
+        uint64_t range_sample_count);
+
+/**
+ * 16-bit version of v2f_decorrelator_invert_range().
+ * The decorrelator's max_sample_value must fit in 16 bits.
+ *
+ * @param decorrelator initialized decorrelator
+ * @param samples samples of the whole block
+ * @param first_sample index of the first sample of the range
+ * @param range_sample_count number of samples in the range
+ * @return
+ *  - @ref V2F_E_NONE : Inverse decorrelation successfull
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ */
+v2f_error_t v2f_decorrelator_invert_range_16(
+        v2f_decorrelator_t const *const decorrelator,
+        v2f_sample16_t *const samples,
+        uint64_t first_sample,
+        uint64_t range_sample_count);
+
 /**
  * Apply DPCM decorrelation using the immediately previous sample
  * (prediction is 0 for the first sample of the block),
@@ -11,12 +11,154 @@
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "v2f.h"
 #include "log.h"
 #include "timer.h"
 
+/// Handle of the timer of v2f_entropy_coder_compress_block() and v2f_entropy_coder_compress_block_16()
+TIMER_DEFINE(v2f_entropy_coder_timer, "v2f_entropy_coder_compress_block")
+
+/**
+ * List of the distinct nodes of a forest being compiled, with an open-addressing
+ * hash map to find the position (state index) of each node in the list.
+ */
+typedef struct {
+    /// Nodes in the order they have been discovered.
+    v2f_entropy_coder_entry_t const **nodes;
+    /// Number of valid elements in `nodes`.
+    uint64_t node_count;
+    /// Number of allocated elements in `nodes`.
+    uint64_t node_capacity;
+    /// Hash map from node address to position in `nodes` (UINT32_MAX for empty slots).
+    uint32_t *slots;
+    /// Number of slots in the hash map (always a power of 2).
+    uint64_t slot_count;
+} v2f_entropy_coder_node_list_t;
+
+/**
+ * Get the first hash map slot to be probed for a node.
+ *
+ * @param node node address
+ * @param slot_count number of slots in the map (a power of 2)
+ *
+ * @return the slot index
+ */
+static inline uint64_t v2f_entropy_coder_node_slot(
+        v2f_entropy_coder_entry_t const *const node, uint64_t slot_count) {
+    uint64_t hash = (uint64_t) (uintptr_t) node;
+    hash ^= hash >> 33;
+    hash *= UINT64_C(0xff51afd7ed558ccd);
+    hash ^= hash >> 33;
+    return hash & (slot_count - 1);
+}
+
+/**
+ * Find the position of a node in the list, if present.
+ *
+ * @param list list of discovered nodes
+ * @param node node to be found
+ *
+ * @return the position of node in list->nodes, or UINT32_MAX if not present
+ */
+static uint32_t v2f_entropy_coder_node_find(
+        v2f_entropy_coder_node_list_t const *const list,
+        v2f_entropy_coder_entry_t const *const node) {
+    uint64_t slot = v2f_entropy_coder_node_slot(node, list->slot_count);
+    while (list->slots[slot] != UINT32_MAX) {
+        if (list->nodes[list->slots[slot]] == node) {
+            return list->slots[slot];
+        }
+        slot = (slot + 1) & (list->slot_count - 1);
+    }
+    return UINT32_MAX;
+}
+
+/**
+ * Add a node to the list unless it is already present, growing
+ * the list and its hash map as needed.
+ *
+ * @param list list of discovered nodes
+ * @param node node to be added
+ * @param node_index pointer where the position of node in list->nodes is stored
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The node was found or successfully added
+ *  - @ref V2F_E_CORRUPTED_DATA : Too many nodes in the forest
+ *  - @ref V2F_E_OUT_OF_MEMORY : Not enough memory to grow the list
+ */
+static v2f_error_t v2f_entropy_coder_node_add(
+        v2f_entropy_coder_node_list_t *const list,
+        v2f_entropy_coder_entry_t const *const node,
+        uint32_t *const node_index) {
+    *node_index = v2f_entropy_coder_node_find(list, node);
+    if (*node_index != UINT32_MAX) {
+        return V2F_E_NONE;
+    }
+    if (list->node_count >= V2F_C_MAX_ENTRY_COUNT) {
+        return V2F_E_CORRUPTED_DATA;
+    }
+
+    if (list->node_count == list->node_capacity) {
+        const uint64_t new_capacity = 2 * list->node_capacity;
+        v2f_entropy_coder_entry_t const **const new_nodes = realloc(
+                (void *) list->nodes, sizeof(v2f_entropy_coder_entry_t *) * new_capacity);
+        if (new_nodes == NULL) {
+            return V2F_E_OUT_OF_MEMORY; // LCOV_EXCL_LINE
+        }
+        list->nodes = new_nodes;
+        list->node_capacity = new_capacity;
+    }
+    if (2 * (list->node_count + 1) > list->slot_count) {
+        const uint64_t new_slot_count = 2 * list->slot_count;
+        uint32_t *const new_slots = malloc(sizeof(uint32_t) * new_slot_count);
+        if (new_slots == NULL) {
+            return V2F_E_OUT_OF_MEMORY; // LCOV_EXCL_LINE
+        }
+        memset(new_slots, 0xff, sizeof(uint32_t) * new_slot_count);
+        for (uint64_t i = 0; i < list->node_count; i++) {
+            uint64_t slot = v2f_entropy_coder_node_slot(list->nodes[i], new_slot_count);
+            while (new_slots[slot] != UINT32_MAX) {
+                slot = (slot + 1) & (new_slot_count - 1);
+            }
+            new_slots[slot] = (uint32_t) i;
+        }
+        free(list->slots);
+        list->slots = new_slots;
+        list->slot_count = new_slot_count;
+    }
+
+    uint64_t slot = v2f_entropy_coder_node_slot(node, list->slot_count);
+    while (list->slots[slot] != UINT32_MAX) {
+        slot = (slot + 1) & (list->slot_count - 1);
+    }
+    *node_index = (uint32_t) list->node_count;
+    list->slots[slot] = *node_index;
+    list->nodes[list->node_count] = node;
+    list->node_count++;
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Free the compiled transition table of a coder, if any.
+ *
+ * @param coder coder whose table is to be freed
+ */
+static void v2f_entropy_coder_free_table(v2f_entropy_coder_t *const coder) {
+    free(coder->states);
+    free(coder->transitions);
+    free(coder->root_transition_offsets);
+    coder->states = NULL;
+    coder->state_count = 0;
+    coder->transitions = NULL;
+    coder->transition_count = 0;
+    coder->root_transition_offsets = NULL;
+}
+
 v2f_error_t v2f_entropy_coder_create(
         v2f_entropy_coder_t *const coder,
         v2f_sample_t max_expected_value,
@@ -35,122 +177,343 @@ v2f_error_t v2f_entropy_coder_create(
     }
     coder->roots = roots;
     coder->root_count = root_count;
-    coder->current_entry = roots[0];
     coder->bytes_per_word = bytes_per_word;
     coder->max_expected_value = max_expected_value;
+    coder->states = NULL;
+    coder->state_count = 0;
+    coder->transitions = NULL;
+    coder->transition_count = 0;
+    coder->root_transition_offsets = NULL;
 
     return V2F_E_NONE;
 }
 
+v2f_error_t v2f_entropy_coder_compile(v2f_entropy_coder_t *const coder) {
+    if (coder == NULL || coder->roots == NULL
+        || coder->root_count < V2F_C_MIN_ROOT_COUNT
+        || coder->max_expected_value < 1
+        || coder->max_expected_value > V2F_C_MAX_SAMPLE_VALUE) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    const uint64_t symbol_count = (uint64_t) coder->max_expected_value + 1;
+    if (coder->roots[0] == NULL || coder->roots[0]->children_count != symbol_count) {
+        log_error("The first root must have one child per symbol");
+        return V2F_E_CORRUPTED_DATA;
+    }
+    v2f_entropy_coder_free_table(coder);
+
+    v2f_error_t status = V2F_E_NONE;
+    v2f_entropy_coder_node_list_t list = {
+            .nodes = malloc(sizeof(v2f_entropy_coder_entry_t *) * 64),
+            .node_count = 0,
+            .node_capacity = 64,
+            .slots = malloc(sizeof(uint32_t) * 128),
+            .slot_count = 128};
+    if (list.nodes == NULL || list.slots == NULL) {
+        status = V2F_E_OUT_OF_MEMORY; // LCOV_EXCL_LINE
+        goto cleanup; // LCOV_EXCL_LINE
+    }
+    memset(list.slots, 0xff, sizeof(uint32_t) * list.slot_count);
+
+    // Roots are added first, so that the i-th distinct root is state i
+    // and state 0 is the first root.
+    uint32_t node_index;
+    for (uint32_t r = 0; r < coder->root_count; r++) {
+        if (coder->roots[r] == NULL
+            || coder->roots[r]->children_count < 1
+            || coder->roots[r]->children_count > symbol_count) {
+            status = V2F_E_CORRUPTED_DATA;
+            goto cleanup;
+        }
+        status = v2f_entropy_coder_node_add(&list, coder->roots[r], &node_index);
+        if (status != V2F_E_NONE) {
+            goto cleanup; // LCOV_EXCL_LINE
+        }
+    }
+    const uint64_t distinct_root_count = list.node_count;
+
+    // Discover all nodes reachable from the roots. Roots with fewer children than
+    // symbols only define children for the last symbols.
+    uint64_t transition_count = distinct_root_count * symbol_count;
+    for (uint64_t i = 0; i < list.node_count; i++) {
+        v2f_entropy_coder_entry_t const *const node = list.nodes[i];
+        if (node->children_count > symbol_count
+            || (node->children_count > 0 && node->children_entries == NULL)) {
+            status = V2F_E_CORRUPTED_DATA;
+            goto cleanup;
+        }
+        const uint64_t first_child = i < distinct_root_count ? symbol_count - node->children_count : 0;
+        const uint64_t last_child = i < distinct_root_count ? symbol_count : node->children_count;
+        if (i >= distinct_root_count) {
+            transition_count += node->children_count;
+        }
+        for (uint64_t c = first_child; c < last_child; c++) {
+            if (node->children_entries[c] == NULL) {
+                status = V2F_E_CORRUPTED_DATA;
+                goto cleanup;
+            }
+            status = v2f_entropy_coder_node_add(&list, node->children_entries[c], &node_index);
+            if (status != V2F_E_NONE) {
+                goto cleanup;
+            }
+        }
+    }
+
+    coder->states = malloc(sizeof(v2f_entropy_coder_state_t) * list.node_count);
+    coder->transitions = malloc(sizeof(uint32_t) * transition_count);
+    coder->root_transition_offsets = malloc(sizeof(uint64_t) * (symbol_count + 1));
+    if (coder->states == NULL || coder->transitions == NULL || coder->root_transition_offsets == NULL) {
+        status = V2F_E_OUT_OF_MEMORY; // LCOV_EXCL_LINE
+        goto cleanup; // LCOV_EXCL_LINE
+    }
+    coder->state_count = (uint32_t) list.node_count;
+    coder->transition_count = transition_count;
+
+    // Fill the states and their transitions
+    uint64_t next_transition = 0;
+    for (uint64_t i = 0; i < list.node_count; i++) {
+        v2f_entropy_coder_entry_t const *const node = list.nodes[i];
+        v2f_entropy_coder_state_t *const state = &(coder->states[i]);
+        memset(state->word_bytes, 0, sizeof(state->word_bytes));
+        state->first_transition = next_transition;
+
+        if (i < distinct_root_count) {
+            // Roots are never left by emitting a word. Transitions for missing symbols
+            // are never used, and are pointed to the first root.
+            state->children_count = (uint32_t) symbol_count;
+            const uint64_t first_child = symbol_count - node->children_count;
+            for (uint64_t s = 0; s < symbol_count; s++) {
+                coder->transitions[next_transition + s] = s < first_child ?
+                        0 : v2f_entropy_coder_node_find(&list, node->children_entries[s]);
+            }
+            next_transition += symbol_count;
+        } else {
+            state->children_count = node->children_count;
+            for (uint64_t c = 0; c < node->children_count; c++) {
+                coder->transitions[next_transition + c] =
+                        v2f_entropy_coder_node_find(&list, node->children_entries[c]);
+            }
+            next_transition += node->children_count;
+            if (node->children_count < symbol_count && node->word_bytes != NULL) {
+                memcpy(state->word_bytes, node->word_bytes, coder->bytes_per_word);
+            }
+        }
+    }
+    assert(next_transition == transition_count);
+
+    // Emitting a word with c children continues at root c. Roots beyond root_count
+    // are not defined, and the last one is used instead. Full nodes never emit,
+    // but an offset is needed for them to allow branchless coding.
+    for (uint64_t c = 0; c < symbol_count; c++) {
+        const uint64_t r = c < coder->root_count ? c : coder->root_count - 1;
+        coder->root_transition_offsets[c] =
+                coder->states[v2f_entropy_coder_node_find(&list, coder->roots[r])].first_transition;
+    }
+    coder->root_transition_offsets[symbol_count] = 0;
+
+    log_debug("Compiled coder: %u states, %lu transitions", coder->state_count, coder->transition_count);
+
+    cleanup:
+    free((void *) list.nodes);
+    free(list.slots);
+    if (status != V2F_E_NONE) {
+        v2f_entropy_coder_free_table(coder);
+    }
+
+    return status;
+}
+
 v2f_error_t v2f_entropy_coder_destroy(v2f_entropy_coder_t *const coder) {
     if (coder == NULL
         || coder->bytes_per_word < V2F_C_MIN_BYTES_PER_WORD
         || coder->bytes_per_word > V2F_C_MAX_BYTES_PER_WORD) {
         return V2F_E_INVALID_PARAMETER;
     }
+    v2f_entropy_coder_free_table(coder);
 
     return V2F_E_NONE;
 }
 
+/**
+ * Code samples stored either as v2f_sample_t or as v2f_sample16_t values,
+ * continuing from the current state of a stream. The last word is not emitted.
+ * See v2f_entropy_coder_compress_block() for details.
+ *
+ * @param coder compiled coder
+ * @param stream stream whose state and position are updated
+ * @param input_samples v2f_sample_t samples, or NULL if `input_samples_16` is used
+ * @param input_samples_16 v2f_sample16_t samples, or NULL if `input_samples` is used
+ * @param sample_count number of samples to be coded
+ */
+static inline void v2f_entropy_coder_code_samples(
+        v2f_entropy_coder_t const *const coder,
+        v2f_entropy_coder_stream_t *const stream,
+        v2f_sample_t const *const input_samples,
+        v2f_sample16_t const *const input_samples_16,
+        uint64_t sample_count) {
+    v2f_entropy_coder_state_t const *const states = coder->states;
+    uint32_t const *const transitions = coder->transitions;
+    uint64_t const *const root_transition_offsets = coder->root_transition_offsets;
+    const uint8_t last_word_byte = (uint8_t) (coder->bytes_per_word - 1);
+
+    uint32_t state_index = stream->state_index;
+    uint8_t *buffer = stream->position;
+    for (uint64_t sample_index = 0;
+         sample_index < sample_count;
+         sample_index++) {
+        // Note: this loop is heavily optimized to avoid conditional branching.
+        // The sample width is fixed for the whole block, so this test is always predicted correctly.
+        const v2f_sample_t sample = input_samples_16 != NULL ?
+                                    input_samples_16[sample_index] : input_samples[sample_index];
+        v2f_entropy_coder_state_t const *const state = &(states[state_index]);
+        const uint64_t emit = (uint64_t) (state->children_count <= sample);
+
+        log_debug("sample_index = %lu", sample_index);
+        log_debug("state_index = %u", state_index);
+        log_debug("sample = %u", sample);
+        log_debug("emit = %d", (int) emit);
+
+        // The word is always written, but the output only advances when it is emitted.
+        // The first root is full and never emits, so at most
+        // sample_count*bytes_per_word bytes are ever written.
+        buffer[0] = state->word_bytes[0];
+        buffer[last_word_byte] = state->word_bytes[last_word_byte];
+        buffer += emit * coder->bytes_per_word;
+
+        // If the word is emitted, the next root is selected based on the number
+        // of children of the emitted word. Otherwise, a child of the current state is used.
+        const uint64_t next_transition = emit ?
+                                         root_transition_offsets[state->children_count] :
+                                         state->first_transition;
+        state_index = transitions[next_transition + sample];
+    }
+    stream->state_index = state_index;
+    stream->position = buffer;
+}
+
+/**
+ * Emit the last word of a stream.
+ *
+ * @param coder compiled coder
+ * @param stream stream whose last word is emitted
+ * @param written_byte_count if not NULL, the number of bytes written for the block is stored here
+ */
+static inline void v2f_entropy_coder_finish_samples(
+        v2f_entropy_coder_t const *const coder,
+        v2f_entropy_coder_stream_t *const stream,
+        uint64_t *const written_byte_count) {
+    v2f_entropy_coder_state_t const *const states = coder->states;
+    uint32_t state_index = stream->state_index;
+
+    // Emit the last element if included. If not included, another codeword is emited instead.
+    // The first child is recursively explored until an included node is found.
+    // The decoder knows the total number of samples in the block, so this is not problematic.
+    while (states[state_index].children_count == coder->max_expected_value + 1) {
+        state_index = coder->transitions[states[state_index].first_transition];
+    }
+    memcpy(stream->position, states[state_index].word_bytes, coder->bytes_per_word);
+    stream->position += coder->bytes_per_word;
+
+    if (written_byte_count != NULL) {
+        *written_byte_count = (uint64_t) (stream->position - stream->output_buffer);
+    }
+}
+
 v2f_error_t v2f_entropy_coder_compress_block(
-        v2f_entropy_coder_t *const coder,
+        v2f_entropy_coder_t const *const coder,
         v2f_sample_t const *const input_samples,
         uint64_t sample_count,
         uint8_t *const output_buffer,
         uint64_t *const written_byte_count) {
-    timer_start("v2f_entropy_coder_compress_block");
-
-    if (coder == NULL || input_samples == NULL || sample_count == UINT64_MAX) {
+    if (coder == NULL || input_samples == NULL || sample_count == UINT64_MAX
+        || coder->states == NULL) {
         return V2F_E_INVALID_PARAMETER;
     }
 
-    // Blocks are independently coded, hence the first root is always the starting point
-    coder->current_entry = coder->roots[0];
+    timer_start_handle(v2f_entropy_coder_timer());
+    v2f_entropy_coder_stream_t stream;
+    RETURN_IF_FAIL(v2f_entropy_coder_stream_start(coder, &stream, output_buffer));
+    v2f_entropy_coder_code_samples(coder, &stream, input_samples, NULL, sample_count);
+    v2f_entropy_coder_finish_samples(coder, &stream, written_byte_count);
+    timer_stop_handle(v2f_entropy_coder_timer());
 
-    uint8_t *buffer = output_buffer;
+    return V2F_E_NONE;
+}
 
-    uint64_t write_count = 0;
-    write_count = 0;
-    for (uint64_t sample_index = 0;
-         sample_index < sample_count;
-         sample_index++) {
-        // Note: this loop is heavily optimized and uses some potentially unsafe operations
-        // to avoid conditional branching. Therefore, static and/or dynamic
-        // code checkers will
+v2f_error_t v2f_entropy_coder_compress_block_16(
+        v2f_entropy_coder_t const *const coder,
+        v2f_sample16_t const *const input_samples,
+        uint64_t sample_count,
+        uint8_t *const output_buffer,
+        uint64_t *const written_byte_count) {
+    if (coder == NULL || input_samples == NULL || sample_count == UINT64_MAX
+        || coder->states == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
 
-        const v2f_sample_t sample = input_samples[sample_index];
-        const uint32_t current_children_count = coder->current_entry->children_count;
+    timer_start_handle(v2f_entropy_coder_timer());
+    v2f_entropy_coder_stream_t stream;
+    RETURN_IF_FAIL(v2f_entropy_coder_stream_start(coder, &stream, output_buffer));
+    v2f_entropy_coder_code_samples(coder, &stream, NULL, input_samples, sample_count);
+    v2f_entropy_coder_finish_samples(coder, &stream, written_byte_count);
+    timer_stop_handle(v2f_entropy_coder_timer());
 
-        uint64_t emit = (uint64_t) (current_children_count <= sample);
-        const uint64_t bytes_emit = emit * (uint64_t) coder->bytes_per_word;
+    return V2F_E_NONE;
+}
 
-        log_debug("sample_index = %lu", sample_index);
-        log_debug("sample_count = %lu", sample_count);
-        log_debug("coder->current_entry = %p",
-                  (void *) (coder->current_entry));
-        log_debug("current_children_count = %u", current_children_count);
-        log_debug("sample = %u", sample);
-        log_debug("emit = %d", (int) emit);
-        if (_LOG_LEVEL >= LOG_DEBUG_LEVEL) {
-            if (emit > 0) {
-                uint64_t word_value = 0;
-                log_debug("Emitted word:");
-                for (uint32_t i = 0; i < coder->bytes_per_word; i++) {
-                    log_no_newline(LOG_DEBUG_LEVEL, " %x", (int) coder->current_entry->word_bytes[i]);
-                    word_value += (uint64_t) (
-                            coder->current_entry->word_bytes[i]
-                                    << ((coder->bytes_per_word - i - 1) * 8));
-                }
-                log_no_newline(LOG_DEBUG_LEVEL, " :: %lu \n", word_value);
-            }
-            log_no_newline(LOG_DEBUG_LEVEL, "\n\n");
-        }
+v2f_error_t v2f_entropy_coder_stream_start(
+        v2f_entropy_coder_t const *const coder,
+        v2f_entropy_coder_stream_t *const stream,
+        uint8_t *const output_buffer) {
+    if (coder == NULL || stream == NULL || output_buffer == NULL || coder->states == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
 
+    // Blocks are independently coded, hence the first root is always the starting point
+    stream->state_index = 0;
+    stream->output_buffer = output_buffer;
+    stream->position = output_buffer;
 
-        // NOTE: this triggers "Conditional jump or move depends on uninitialised value(s)"
-        // errors in valgrind. This is ok, because bytes_emit will be zero
-        // whenever an invalid/uninitialzied address is passed.
-        // This potentially unsafe operation is included to allow branchless
-        // compression.
-        memcpy(buffer,
-               coder->current_entry->word_bytes + (1 - emit),
-               bytes_emit);
-        buffer += bytes_emit;
-        write_count += bytes_emit;
-        uint64_t new_address = ((uint64_t) coder->current_entry);
+    return V2F_E_NONE;
+}
 
+v2f_error_t v2f_entropy_coder_stream_samples(
+        v2f_entropy_coder_t const *const coder,
+        v2f_entropy_coder_stream_t *const stream,
+        v2f_sample_t const *const input_samples,
+        uint64_t sample_count) {
+    if (coder == NULL || stream == NULL || input_samples == NULL || coder->states == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
 
-        // If word is emitted, the next root is selected based on the number
-        // of children of the emitted word.
-        new_address += emit *
-                       (((uint64_t) (coder->roots[current_children_count *
-                                                  emit]->children_entries[sample]))
-                        - ((uint64_t) (coder->current_entry)));
+    v2f_entropy_coder_code_samples(coder, stream, input_samples, NULL, sample_count);
 
-        // If it is not emitted, a child of the current entry is used instead
-        new_address += (1 - emit) *
-                       (((uint64_t) (coder->current_entry->children_entries[
-                               sample * (1 - emit)]))
-                        - ((uint64_t) (coder->current_entry)));
+    return V2F_E_NONE;
+}
 
-        coder->current_entry = (v2f_entropy_coder_entry_t *) new_address;
+v2f_error_t v2f_entropy_coder_stream_samples_16(
+        v2f_entropy_coder_t const *const coder,
+        v2f_entropy_coder_stream_t *const stream,
+        v2f_sample16_t const *const input_samples,
+        uint64_t sample_count) {
+    if (coder == NULL || stream == NULL || input_samples == NULL || coder->states == NULL) {
+        return V2F_E_INVALID_PARAMETER;
     }
 
-    // Emit the last element if included. If not included, another codeword is emited instead.
-    // The first child is recursively explored until an included node is found.
-    // The decoder knows the total number of samples in the block, so this is not problematic.
-    while (coder->current_entry->children_count ==
-           coder->max_expected_value + 1) {
-        coder->current_entry = coder->current_entry->children_entries[0];
-    }
-    memcpy(buffer, coder->current_entry->word_bytes, coder->bytes_per_word);
-    write_count += coder->bytes_per_word;
+    v2f_entropy_coder_code_samples(coder, stream, NULL, input_samples, sample_count);
 
-    if (written_byte_count != NULL) {
-        *written_byte_count = write_count;
+    return V2F_E_NONE;
+}
+
+v2f_error_t v2f_entropy_coder_stream_finish(
+        v2f_entropy_coder_t const *const coder,
+        v2f_entropy_coder_stream_t *const stream,
+        uint64_t *const written_byte_count) {
+    if (coder == NULL || stream == NULL || coder->states == NULL) {
+        return V2F_E_INVALID_PARAMETER;
     }
 
-    timer_stop("v2f_entropy_coder_compress_block");
+    v2f_entropy_coder_finish_samples(coder, stream, written_byte_count);
 
     return V2F_E_NONE;
 }
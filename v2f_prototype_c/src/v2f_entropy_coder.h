@@ -33,8 +33,28 @@ v2f_error_t v2f_entropy_coder_create(
         v2f_entropy_coder_entry_t **roots,
         uint32_t root_count);
 
+/**
+ * Compile the forest of an initialized coder into a contiguous transition table
+ * indexed by (state, sample), which is then used by
+ * v2f_entropy_coder_compress_block() instead of the pointer structure.
+ *
+ * This function must be called once the forest pointed to by the coder's roots
+ * is complete, and again if it is later modified. Any previously compiled table
+ * is replaced.
+ *
+ * @param coder initialized coder whose forest is to be compiled
+ *
+ * @return
+ *  - @ref V2F_E_NONE : Compilation was successful
+ *  - @ref V2F_E_INVALID_PARAMETER : coder is NULL or does not seem initialized
+ *  - @ref V2F_E_CORRUPTED_DATA : the forest structure is not valid
+ *  - @ref V2F_E_OUT_OF_MEMORY : not enough memory to store the table
+ */
+v2f_error_t v2f_entropy_coder_compile(v2f_entropy_coder_t *const coder);
+
 /**
  * This function does NOT free any variables passed to the initialization.
+ * The transition table created by v2f_entropy_coder_compile(), if any, is freed.
  *
  * @param coder coder to be destroyed
  *
@@ -49,7 +69,11 @@ v2f_error_t v2f_entropy_coder_destroy(v2f_entropy_coder_t *const coder);
  * Compress the samples in `input_samples` and write the result to output_buffer
  * using `coder`.
  *
- * @param coder intitialized entropy coder to be used for compression
+ * The coder is not modified, so the same coder can be used to compress
+ * several blocks concurrently.
+ *
+ * @param coder intitialized entropy coder to be used for compression.
+ *   Its forest must have been compiled with v2f_entropy_coder_compile().
  * @param input_samples buffer with at least `input_samples`
  *   v2f_sample_t values.
  * @param sample_count number of samples to be coded from the buffer.
@@ -62,15 +86,121 @@ v2f_error_t v2f_entropy_coder_destroy(v2f_entropy_coder_t *const coder);
  *
  * @return
  *  - @ref V2F_E_NONE : The block was successfully compressed
- *  - @ref V2F_E_INVALID_PARAMETER : invalid parameter provided
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameter provided, or the coder
+ *    has not been compiled
  */
 v2f_error_t v2f_entropy_coder_compress_block(
-        v2f_entropy_coder_t *const coder,
+        v2f_entropy_coder_t const *const coder,
         v2f_sample_t const *const input_samples,
         uint64_t sample_count,
         uint8_t *const output_buffer,
         uint64_t *const written_byte_count);
 
+/**
+ * Compress a block of samples stored with 16 bits per sample.
+ *
+ * The output is identical to that of v2f_entropy_coder_compress_block()
+ * for the same samples. See that function for details.
+ *
+ * @param coder intitialized entropy coder to be used for compression.
+ *   Its forest must have been compiled with v2f_entropy_coder_compile().
+ * @param input_samples buffer with at least `sample_count` samples.
+ * @param sample_count number of samples to be coded from the buffer.
+ *   Must be < UINT64_MAX.
+ * @param output_buffer buffer where the output is produced, large enough for the worst case.
+ * @param written_byte_count pointer to a variable where the number of bytes
+ *   written to output_buffer is stored. If the pointer is NULL, it is ignored.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The block was successfully compressed
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameter provided, or the coder
+ *    has not been compiled
+ */
+v2f_error_t v2f_entropy_coder_compress_block_16(
+        v2f_entropy_coder_t const *const coder,
+        v2f_sample16_t const *const input_samples,
+        uint64_t sample_count,
+        uint8_t *const output_buffer,
+        uint64_t *const written_byte_count);
+
+/**
+ * Start the compression of a block whose samples are provided in several calls
+ * to v2f_entropy_coder_stream_samples() or v2f_entropy_coder_stream_samples_16(),
+ * and which is completed by v2f_entropy_coder_stream_finish().
+ *
+ * The output is identical to that of v2f_entropy_coder_compress_block() for
+ * all the samples of the block.
+ *
+ * @param coder intitialized entropy coder to be used for compression.
+ *   Its forest must have been compiled with v2f_entropy_coder_compile().
+ * @param stream stream to be initialized
+ * @param output_buffer buffer where the output is produced, large enough for the
+ *   worst case of the whole block.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The stream was started
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameter provided, or the coder
+ *    has not been compiled
+ */
+v2f_error_t v2f_entropy_coder_stream_start(
+        v2f_entropy_coder_t const *const coder,
+        v2f_entropy_coder_stream_t *const stream,
+        uint8_t *const output_buffer);
+
+/**
+ * Code the next samples of a block started with v2f_entropy_coder_stream_start().
+ *
+ * @param coder coder used to start the stream
+ * @param stream started stream
+ * @param input_samples buffer with at least `sample_count` samples
+ * @param sample_count number of samples to be coded
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The samples were coded
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameter provided
+ */
+v2f_error_t v2f_entropy_coder_stream_samples(
+        v2f_entropy_coder_t const *const coder,
+        v2f_entropy_coder_stream_t *const stream,
+        v2f_sample_t const *const input_samples,
+        uint64_t sample_count);
+
+/**
+ * Code the next samples of a block, stored with 16 bits per sample.
+ * See v2f_entropy_coder_stream_samples().
+ *
+ * @param coder coder used to start the stream
+ * @param stream started stream
+ * @param input_samples buffer with at least `sample_count` samples
+ * @param sample_count number of samples to be coded
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The samples were coded
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameter provided
+ */
+v2f_error_t v2f_entropy_coder_stream_samples_16(
+        v2f_entropy_coder_t const *const coder,
+        v2f_entropy_coder_stream_t *const stream,
+        v2f_sample16_t const *const input_samples,
+        uint64_t sample_count);
+
+/**
+ * Complete the compression of a block started with v2f_entropy_coder_stream_start().
+ *
+ * @param coder coder used to start the stream
+ * @param stream started stream
+ * @param written_byte_count pointer to a variable where the number of bytes
+ *   written for the block is stored. If the pointer is NULL, it is ignored.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The block was completed
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameter provided
+ */
+v2f_error_t v2f_entropy_coder_stream_finish(
+        v2f_entropy_coder_t const *const coder,
+        v2f_entropy_coder_stream_t *const stream,
+        uint64_t *const written_byte_count);
+
 /**
  * Fill the index bytes of `entry` given its index.
  *
@@ -79,8 +79,153 @@ v2f_error_t v2f_entropy_decoder_create(
     decoder->bytes_per_sample = bytes_per_sample;
     decoder->roots = roots;
     decoder->root_count = root_count;
-    decoder->current_root = roots[0];
     decoder->null_entry = NULL;
+    decoder->forest_arena = NULL;
+    decoder->sample_pool = NULL;
+    decoder->sample_pool_16 = NULL;
+    decoder->sample_pool_size = 0;
+    decoder->words = NULL;
+    decoder->word_count = 0;
+    decoder->initial_state.first_word = 0;
+    decoder->initial_state.included_count = 0;
+    decoder->forest_cache = NULL;
+    decoder->forest_cache_size = 0;
+    decoder->forest_id = 0;
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Free the compiled word table of a decoder, if any.
+ *
+ * @param decoder decoder whose table is to be freed
+ */
+static void v2f_entropy_decoder_free_table(v2f_entropy_decoder_t *const decoder) {
+    free(decoder->sample_pool);
+    free(decoder->sample_pool_16);
+    free(decoder->words);
+    decoder->sample_pool = NULL;
+    decoder->sample_pool_16 = NULL;
+    decoder->sample_pool_size = 0;
+    decoder->words = NULL;
+    decoder->word_count = 0;
+    decoder->initial_state.first_word = 0;
+    decoder->initial_state.included_count = 0;
+}
+
+v2f_error_t v2f_entropy_decoder_compile(v2f_entropy_decoder_t *const decoder) {
+    if (decoder == NULL || decoder->roots == NULL
+        || decoder->root_count < V2F_C_MIN_ROOT_COUNT) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    v2f_entropy_decoder_free_table(decoder);
+
+    // Count words and samples, and place the words of each root in the table,
+    // so that words can point to the root that follows them. Aliased roots share their words.
+    // Invariants are verified here so that decoding needs no further checks.
+    uint64_t word_count = 1;
+    uint64_t sample_pool_size = 0;
+    v2f_entropy_decoder_root_t const *last_root = NULL;
+    for (uint32_t r = 0; r < decoder->root_count; r++) {
+        v2f_entropy_decoder_root_t *const root = decoder->roots[r];
+        // Checked before the alias test, since last_root starts as NULL
+        if (root == NULL || root->entries_by_word == NULL) {
+            return V2F_E_CORRUPTED_DATA;
+        }
+        if (root == last_root) {
+            continue;
+        }
+        root->first_word = word_count;
+        for (uint32_t w = 0; w < root->root_included_count; w++) {
+            if (root->entries_by_word[w] == NULL
+                || (root->entries_by_word[w]->sample_count > 0
+                    && root->entries_by_word[w]->samples == NULL)) {
+                log_error("Invalid entry for word %u", w);
+                return V2F_E_CORRUPTED_DATA;
+            }
+            if (root->entries_by_word[w]->children_count >= decoder->root_count
+                || decoder->roots[root->entries_by_word[w]->children_count] == NULL) {
+                // The decoder does not have enough roots to go after this word.
+                log_error("Word %u has no next root (children_count = %u)",
+                          w, root->entries_by_word[w]->children_count);
+                return V2F_E_CORRUPTED_DATA;
+            }
+            sample_pool_size += root->entries_by_word[w]->sample_count;
+        }
+        word_count += (uint64_t) root->root_included_count + 1;
+        last_root = root;
+    }
+
+    decoder->words = malloc(sizeof(v2f_entropy_decoder_word_t) * word_count);
+    decoder->sample_pool = malloc(sizeof(v2f_sample_t) * (sample_pool_size > 0 ? sample_pool_size : 1));
+    if (decoder->words == NULL || decoder->sample_pool == NULL) {
+        // LCOV_EXCL_START
+        v2f_entropy_decoder_free_table(decoder);
+        return V2F_E_OUT_OF_MEMORY;
+        // LCOV_EXCL_STOP
+    }
+    decoder->word_count = word_count;
+    decoder->sample_pool_size = sample_pool_size;
+
+    // Invalid words produce no samples and lead to the error root, which is never left.
+    // The first word is that of the error root, which has no valid words.
+    const v2f_entropy_decoder_word_t invalid_word = {
+            .sample_offset = 0,
+            .next_first_word = 0,
+            .sample_count = 0,
+            .next_included_count = 0};
+    decoder->words[0] = invalid_word;
+
+    // Copy the samples of all words consecutively in the pool
+    uint64_t next_word = 1;
+    uint64_t next_sample = 0;
+    last_root = NULL;
+    for (uint32_t r = 0; r < decoder->root_count; r++) {
+        v2f_entropy_decoder_root_t *const root = decoder->roots[r];
+        if (root == last_root) {
+            continue;
+        }
+        for (uint32_t w = 0; w < root->root_included_count; w++) {
+            v2f_entropy_decoder_entry_t const *const entry = root->entries_by_word[w];
+            decoder->words[next_word].sample_offset = next_sample;
+            decoder->words[next_word].sample_count = entry->sample_count;
+            decoder->words[next_word].next_first_word = decoder->roots[entry->children_count]->first_word;
+            decoder->words[next_word].next_included_count =
+                    decoder->roots[entry->children_count]->root_included_count;
+            memcpy(decoder->sample_pool + next_sample, entry->samples,
+                   sizeof(v2f_sample_t) * entry->sample_count);
+            next_sample += entry->sample_count;
+            next_word++;
+        }
+        decoder->words[next_word] = invalid_word;
+        next_word++;
+        last_root = root;
+    }
+    assert(next_word == word_count);
+    assert(next_sample == sample_pool_size);
+
+    decoder->initial_state.first_word = decoder->roots[0]->first_word;
+    decoder->initial_state.included_count = decoder->roots[0]->root_included_count;
+
+    // Keep a 16-bit copy of the pool when possible, for v2f_entropy_decoder_decompress_block_16()
+    bool fits_16_bits = true;
+    for (uint64_t i = 0; i < sample_pool_size; i++) {
+        fits_16_bits = fits_16_bits && decoder->sample_pool[i] <= V2F_SAMPLE16_T_MAX;
+    }
+    if (fits_16_bits) {
+        decoder->sample_pool_16 = malloc(sizeof(v2f_sample16_t) * (sample_pool_size > 0 ? sample_pool_size : 1));
+        if (decoder->sample_pool_16 == NULL) {
+            // LCOV_EXCL_START
+            v2f_entropy_decoder_free_table(decoder);
+            return V2F_E_OUT_OF_MEMORY;
+            // LCOV_EXCL_STOP
+        }
+        for (uint64_t i = 0; i < sample_pool_size; i++) {
+            decoder->sample_pool_16[i] = (v2f_sample16_t) decoder->sample_pool[i];
+        }
+    }
+
+    log_debug("Compiled decoder: %lu words, %lu samples", word_count, sample_pool_size);
 
     return V2F_E_NONE;
 }
@@ -94,6 +239,7 @@ v2f_error_t v2f_entropy_decoder_destroy(v2f_entropy_decoder_t *const decoder) {
         free(decoder->null_entry);
         decoder->null_entry = NULL;
     }
+    v2f_entropy_decoder_free_table(decoder);
     for (uint64_t i = 0; i < decoder->root_count; i++) {
         if (decoder->roots[i]->entries_by_index == NULL) {
             return V2F_E_INVALID_PARAMETER;
@@ -103,15 +249,107 @@ v2f_error_t v2f_entropy_decoder_destroy(v2f_entropy_decoder_t *const decoder) {
     return V2F_E_NONE;
 }
 
+/**
+ * Decode words of a stream into samples stored either as v2f_sample_t or as v2f_sample16_t values,
+ * until at least `min_sample_count` samples have been written or all words have been decoded.
+ * See v2f_entropy_decoder_decompress_block() for details.
+ *
+ * @param decoder compiled decoder
+ * @param stream stream whose state, position and counts are updated
+ * @param reconstructed_samples output buffer of the whole block, viewed as bytes
+ * @param sample_pool pool of samples of the same type as `reconstructed_samples`, viewed as bytes
+ * @param sample_size size in bytes of each sample in `reconstructed_samples` and `sample_pool`
+ * @param max_output_sample_count maximum number of samples to be written for the whole block
+ * @param min_sample_count number of written samples after which decoding stops
+ */
+static inline void v2f_entropy_decoder_decode_words(
+        v2f_entropy_decoder_t const *const decoder,
+        v2f_entropy_decoder_stream_t *const stream,
+        uint8_t *const reconstructed_samples,
+        uint8_t const *const sample_pool,
+        size_t sample_size,
+        uint64_t max_output_sample_count,
+        uint64_t min_sample_count) {
+    v2f_entropy_decoder_word_t const *const words = decoder->words;
+    const uint8_t bytes_per_word = decoder->bytes_per_word;
+
+    uint64_t first_word = stream->state.first_word;
+    uint32_t included_count = stream->state.included_count;
+    uint64_t write_count = stream->written_sample_count;
+    uint64_t remaining_word_count = stream->remaining_word_count;
+    uint8_t const *input_buffer = stream->position;
+    for (; remaining_word_count > 0 && write_count < min_sample_count; remaining_word_count--) {
+        v2f_sample_t word = 0;
+        for (uint8_t b = 0; b < bytes_per_word; b++) {
+            word = (word << 8) | input_buffer[b];
+        }
+        input_buffer += bytes_per_word;
+
+        // Words not valid for this root are mapped to the invalid word that follows
+        // the root's valid words. Once an invalid word is found, only the error
+        // root is used, and no more samples are produced.
+        word = word < included_count ? word : included_count;
+        v2f_entropy_decoder_word_t const *const entry = &(words[first_word + word]);
+        log_debug("word = %u, sample_count = %u", word, entry->sample_count);
+
+        // The last word might code more samples than needed
+        const uint64_t remaining_count = max_output_sample_count - write_count;
+        const uint64_t copy_count = entry->sample_count < remaining_count ?
+                                    entry->sample_count : remaining_count;
+        memcpy(reconstructed_samples + sample_size * write_count,
+               sample_pool + sample_size * entry->sample_offset,
+               sample_size * copy_count);
+        write_count += copy_count;
+
+        first_word = entry->next_first_word;
+        included_count = entry->next_included_count;
+    }
+
+    stream->state.first_word = first_word;
+    stream->state.included_count = included_count;
+    stream->written_sample_count = write_count;
+    stream->remaining_word_count = remaining_word_count;
+    stream->position = input_buffer;
+}
+
 v2f_error_t v2f_entropy_decoder_decompress_block(
-        v2f_entropy_decoder_t *const decoder,
+        v2f_entropy_decoder_t const *const decoder,
         uint8_t const *const compressed_block,
         uint64_t compressed_size,
         v2f_sample_t *const reconstructed_samples,
         uint64_t max_output_sample_count,
         uint64_t *const written_sample_count) {
-    if (decoder == NULL || compressed_block == NULL
-        || compressed_size == 0 || reconstructed_samples == NULL) {
+    log_debug("compressed_block = %p", compressed_block);
+    log_debug("compressed_size = %lu", compressed_size);
+
+    v2f_entropy_decoder_stream_t stream;
+    RETURN_IF_FAIL(v2f_entropy_decoder_stream_start(decoder, &stream, compressed_block, compressed_size));
+    RETURN_IF_FAIL(v2f_entropy_decoder_stream_samples(
+            decoder, &stream, reconstructed_samples, max_output_sample_count, UINT64_MAX));
+    return v2f_entropy_decoder_stream_finish(decoder, &stream, written_sample_count);
+}
+
+v2f_error_t v2f_entropy_decoder_decompress_block_16(
+        v2f_entropy_decoder_t const *const decoder,
+        uint8_t const *const compressed_block,
+        uint64_t compressed_size,
+        v2f_sample16_t *const reconstructed_samples,
+        uint64_t max_output_sample_count,
+        uint64_t *const written_sample_count) {
+    v2f_entropy_decoder_stream_t stream;
+    RETURN_IF_FAIL(v2f_entropy_decoder_stream_start(decoder, &stream, compressed_block, compressed_size));
+    RETURN_IF_FAIL(v2f_entropy_decoder_stream_samples_16(
+            decoder, &stream, reconstructed_samples, max_output_sample_count, UINT64_MAX));
+    return v2f_entropy_decoder_stream_finish(decoder, &stream, written_sample_count);
+}
+
+v2f_error_t v2f_entropy_decoder_stream_start(
+        v2f_entropy_decoder_t const *const decoder,
+        v2f_entropy_decoder_stream_t *const stream,
+        uint8_t const *const compressed_block,
+        uint64_t compressed_size) {
+    if (decoder == NULL || stream == NULL || compressed_block == NULL
+        || compressed_size == 0 || decoder->words == NULL) {
         return V2F_E_INVALID_PARAMETER;
     }
     if (compressed_size % decoder->bytes_per_word != 0) {
@@ -119,100 +357,111 @@ v2f_error_t v2f_entropy_decoder_decompress_block(
     }
 
     // Blocks are independently coded, hence the first root is always the starting point
-    decoder->current_root = decoder->roots[0];
+    stream->state = decoder->initial_state;
+    stream->position = compressed_block;
+    stream->remaining_word_count = compressed_size / decoder->bytes_per_word;
+    stream->written_sample_count = 0;
 
-    uint64_t write_count = 0;
+    return V2F_E_NONE;
+}
 
-    uint8_t const *input_buffer = compressed_block;
-    log_debug("compressed_block = %p", compressed_block);
-    log_debug("compressed_block + compressed_size = %p",
-              compressed_block + compressed_size);
-    log_debug("compressed_size = %lu", compressed_size);
-    uint64_t consumed_bytes = 0;
-    for (uint64_t word_index = 0;
-         word_index < compressed_size / decoder->bytes_per_word;
-         word_index++) {
-        log_debug("word_index = %lu", word_index);
-
-        uint32_t samples_written;
-        v2f_sample_t decoded_samples[V2F_C_MAX_SAMPLE_COUNT];
-        RETURN_IF_FAIL(v2f_entropy_decoder_decode_next_index(
-                decoder, input_buffer, decoded_samples, &samples_written));
-        log_debug("samples_written = %u", samples_written);
-        
-        for (uint32_t i = 0;
-             i < samples_written && write_count < max_output_sample_count;
-             i++) {
-            log_debug("i = %u", i);
-            log_debug("decoded_samples[i] = %u", decoded_samples[i]);
-            reconstructed_samples[write_count] = decoded_samples[i];
-            write_count++;
-        }
-        input_buffer += decoder->bytes_per_word;
-        consumed_bytes += decoder->bytes_per_word;
+v2f_error_t v2f_entropy_decoder_stream_samples(
+        v2f_entropy_decoder_t const *const decoder,
+        v2f_entropy_decoder_stream_t *const stream,
+        v2f_sample_t *const reconstructed_samples,
+        uint64_t max_output_sample_count,
+        uint64_t min_sample_count) {
+    if (decoder == NULL || stream == NULL || reconstructed_samples == NULL || decoder->words == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    v2f_entropy_decoder_decode_words(
+            decoder, stream, (uint8_t *) reconstructed_samples, (uint8_t const *) decoder->sample_pool,
+            sizeof(v2f_sample_t), max_output_sample_count, min_sample_count);
+
+    return V2F_E_NONE;
+}
+
+v2f_error_t v2f_entropy_decoder_stream_samples_16(
+        v2f_entropy_decoder_t const *const decoder,
+        v2f_entropy_decoder_stream_t *const stream,
+        v2f_sample16_t *const reconstructed_samples,
+        uint64_t max_output_sample_count,
+        uint64_t min_sample_count) {
+    if (decoder == NULL || stream == NULL || reconstructed_samples == NULL
+        || decoder->words == NULL || decoder->sample_pool_16 == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    v2f_entropy_decoder_decode_words(
+            decoder, stream, (uint8_t *) reconstructed_samples, (uint8_t const *) decoder->sample_pool_16,
+            sizeof(v2f_sample16_t), max_output_sample_count, min_sample_count);
 
-        log_debug("input_buffer = %p", input_buffer);
-        assert(input_buffer < input_buffer + compressed_size);
+    return V2F_E_NONE;
+}
 
-        log_debug("consumed_bytes = %lu / compressed_size = %lu",
-                  consumed_bytes, compressed_size);
+v2f_error_t v2f_entropy_decoder_stream_finish(
+        v2f_entropy_decoder_t const *const decoder,
+        v2f_entropy_decoder_stream_t *const stream,
+        uint64_t *const written_sample_count) {
+    if (decoder == NULL || stream == NULL || decoder->words == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    // The remaining words produce no samples, but an invalid one must still be detected
+    for (; stream->remaining_word_count > 0; stream->remaining_word_count--) {
+        v2f_sample_t word = 0;
+        for (uint8_t b = 0; b < decoder->bytes_per_word; b++) {
+            word = (word << 8) | stream->position[b];
+        }
+        stream->position += decoder->bytes_per_word;
+        word = word < stream->state.included_count ? word : stream->state.included_count;
+        v2f_entropy_decoder_word_t const *const entry = &(decoder->words[stream->state.first_word + word]);
+        stream->state.first_word = entry->next_first_word;
+        stream->state.included_count = entry->next_included_count;
+    }
+
+    if (stream->state.first_word == 0) {
+        return V2F_E_CORRUPTED_DATA;
     }
 
     if (written_sample_count != NULL) {
-        *written_sample_count = write_count;
+        *written_sample_count = stream->written_sample_count;
     }
 
     return V2F_E_NONE;
 }
 
 v2f_error_t v2f_entropy_decoder_decode_next_index(
-        v2f_entropy_decoder_t *const decoder,
+        v2f_entropy_decoder_t const *const decoder,
         uint8_t const *const compressed_block,
         v2f_sample_t *const output_samples,
-        uint32_t *const samples_written) {
-
-    log_debug("DECODING NEXT SAMPLE\n\n\n");
+        uint32_t *const samples_written,
+        v2f_entropy_decoder_state_t *const state) {
+    if (decoder == NULL || compressed_block == NULL || output_samples == NULL
+        || state == NULL || decoder->words == NULL
+        || state->first_word + state->included_count >= decoder->word_count) {
+        return V2F_E_INVALID_PARAMETER;
+    }
 
     v2f_sample_t word = v2f_entropy_coder_buffer_to_sample(compressed_block,
                                                            decoder->bytes_per_word);
     log_debug("word = %u", word);
-    log_debug("decoder->current_root = %p", (void *) (decoder->current_root));
-    log_debug("decoder->bytes_per_word = %u", decoder->bytes_per_word);
-    log_debug("decoder->current_root->root_entry_count = %u",
-              decoder->current_root->root_entry_count);
-    log_debug(
-            "decoder->current_root->entries_by_index[word].children_count = %u",
-            decoder->current_root->entries_by_index[word].children_count);
-
-    if (word >= decoder->current_root->root_included_count) {
-        return V2F_E_CORRUPTED_DATA;
-    }
 
-    if (decoder->current_root->entries_by_word[word]->children_count
-        >= decoder->root_count) {
-        // The decoder does not have enough roots to go after this sample.
+    word = word < state->included_count ? word : state->included_count;
+    v2f_entropy_decoder_word_t const *const entry = &(decoder->words[state->first_word + word]);
+    if (entry->next_first_word == 0) {
         return V2F_E_CORRUPTED_DATA;
     }
 
-    uint32_t sample_write_count = 0;
-    log_debug("decoder->current_root->entries_by_word[word]->sample_count = %u",
-              decoder->current_root->entries_by_word[word]->sample_count);
-    for (uint32_t s = 0;
-         s < decoder->current_root->entries_by_word[word]->sample_count; s++) {
-        output_samples[s] = decoder->current_root->entries_by_word[word]->samples[s];
-        sample_write_count++;
-        log_debug(
-                "decoder->current_root->entries_by_index[%u].samples[%u] = %u",
-                word, s,
-                decoder->current_root->entries_by_word[word]->samples[s]);
-    }
-
-    decoder->current_root = decoder->roots[
-            decoder->current_root->entries_by_word[word]->children_count];
+    memcpy(output_samples, decoder->sample_pool + entry->sample_offset,
+           sizeof(v2f_sample_t) * entry->sample_count);
+    state->first_word = entry->next_first_word;
+    state->included_count = entry->next_included_count;
 
     if (samples_written != NULL) {
-        assert(sample_write_count <= V2F_C_MAX_SAMPLE_COUNT);
-        *samples_written = sample_write_count;
+        assert(entry->sample_count <= V2F_C_MAX_SAMPLE_COUNT);
+        *samples_written = entry->sample_count;
     }
 
     return V2F_E_NONE;
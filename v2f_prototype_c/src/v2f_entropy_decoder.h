@@ -33,7 +33,28 @@ v2f_error_t v2f_entropy_decoder_create(
         uint8_t bytes_per_sample);
 
 /**
- * Destroy a decoder, releasing any resources allocated during initialization.
+ * Compile the roots of an initialized decoder into a contiguous word table,
+ * with the samples of all words stored consecutively in a single sample pool.
+ * This table is used by v2f_entropy_decoder_decompress_block() and
+ * v2f_entropy_decoder_decode_next_index() instead of the entry structures.
+ *
+ * This function must be called once all roots and their entries are complete.
+ * Any previously compiled table is replaced.
+ *
+ * @param decoder initialized decoder whose roots are to be compiled
+ *
+ * @return
+ *   - @ref V2F_E_NONE : Compilation was successful
+ *   - @ref V2F_E_INVALID_PARAMETER : decoder is NULL or does not seem initialized
+ *   - @ref V2F_E_CORRUPTED_DATA : some included word has no valid entry
+ *     or no valid next root
+ *   - @ref V2F_E_OUT_OF_MEMORY : not enough memory to store the table
+ */
+v2f_error_t v2f_entropy_decoder_compile(v2f_entropy_decoder_t *const decoder);
+
+/**
+ * Destroy a decoder, releasing any resources allocated during initialization
+ * and the table created by v2f_entropy_decoder_compile(), if any.
  *
  * @param decoder pointer to the decoder to be destroyed.
  *
@@ -52,7 +73,9 @@ v2f_error_t v2f_entropy_decoder_destroy(v2f_entropy_decoder_t *const decoder);
  * reconstructed block and to avoid buffer overflows,
  * see the `max_output_sample_count` argument.
  *
- * @param decoder decoder to be used for decompression
+ * @param decoder decoder to be used for decompression. It must have been
+ *   compiled with v2f_entropy_decoder_compile(). It is not modified, so the
+ *   same decoder can be used to decompress several blocks concurrently.
  * @param compressed_block buffer of compressed data
  * @param compressed_size number of bytes to be decompressed from
  *   `compressed_block`.
@@ -66,15 +89,134 @@ v2f_error_t v2f_entropy_decoder_destroy(v2f_entropy_decoder_t *const decoder);
  * @return
  *  - @ref V2F_E_NONE : The block was successfully decompressed
  *  - @ref V2F_E_INVALID_PARAMETER : invalid parameter provided
+ *  - @ref V2F_E_CORRUPTED_DATA : compressed data contained an invalid word.
+ *    In this case, the contents of `reconstructed_samples` are undefined.
  */
 v2f_error_t v2f_entropy_decoder_decompress_block(
-        v2f_entropy_decoder_t *const decoder,
+        v2f_entropy_decoder_t const *const decoder,
         uint8_t const*const compressed_block,
         uint64_t compressed_size,
         v2f_sample_t *const reconstructed_samples,
         uint64_t max_output_sample_count,
         uint64_t *const written_sample_count);
 
+/**
+ * Decompress a block into samples stored with 16 bits per sample.
+ *
+ * The output is identical to that of v2f_entropy_decoder_decompress_block()
+ * for the same block. See that function for details.
+ *
+ * @param decoder decoder to be used for decompression. It must have been
+ *   compiled with v2f_entropy_decoder_compile(), and all its samples must fit in 16 bits.
+ * @param compressed_block block of words to be decompressed.
+ * @param compressed_size number of bytes in `compressed_block`.
+ * @param reconstructed_samples buffer where at most `max_output_sample_count`
+ *   samples are written.
+ * @param max_output_sample_count maximum number of samples to be written.
+ * @param written_sample_count pointer where the number of written samples is stored.
+ *   If the pointer is NULL, it is ignored.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The block was successfully decompressed
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter, or
+ *    the decoder has samples that do not fit in 16 bits
+ *  - @ref V2F_E_CORRUPTED_DATA : compressed data contained an invalid word.
+ *    In this case, the contents of `reconstructed_samples` are undefined.
+ */
+v2f_error_t v2f_entropy_decoder_decompress_block_16(
+        v2f_entropy_decoder_t const *const decoder,
+        uint8_t const *const compressed_block,
+        uint64_t compressed_size,
+        v2f_sample16_t *const reconstructed_samples,
+        uint64_t max_output_sample_count,
+        uint64_t *const written_sample_count);
+
+/**
+ * Start the decompression of a block whose samples are produced in several calls
+ * to v2f_entropy_decoder_stream_samples() or v2f_entropy_decoder_stream_samples_16(),
+ * and which is completed by v2f_entropy_decoder_stream_finish().
+ *
+ * The samples are identical to those of v2f_entropy_decoder_decompress_block().
+ *
+ * @param decoder compiled decoder to be used for decompression
+ * @param stream stream to be initialized
+ * @param compressed_block block of words to be decompressed
+ * @param compressed_size number of bytes in `compressed_block`
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The stream was started
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ */
+v2f_error_t v2f_entropy_decoder_stream_start(
+        v2f_entropy_decoder_t const *const decoder,
+        v2f_entropy_decoder_stream_t *const stream,
+        uint8_t const *const compressed_block,
+        uint64_t compressed_size);
+
+/**
+ * Decode the next words of a block started with v2f_entropy_decoder_stream_start(),
+ * until the stream's written_sample_count reaches at least `min_sample_count`
+ * or all words are decoded. The last decoded word may produce more samples.
+ *
+ * @param decoder decoder used to start the stream
+ * @param stream started stream
+ * @param reconstructed_samples buffer of the whole block. Samples are written
+ *   after the stream's written_sample_count previous ones.
+ * @param max_output_sample_count maximum number of samples to be written for the whole block
+ * @param min_sample_count number of written samples after which decoding stops
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The words were decoded
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ */
+v2f_error_t v2f_entropy_decoder_stream_samples(
+        v2f_entropy_decoder_t const *const decoder,
+        v2f_entropy_decoder_stream_t *const stream,
+        v2f_sample_t *const reconstructed_samples,
+        uint64_t max_output_sample_count,
+        uint64_t min_sample_count);
+
+/**
+ * Decode the next words of a block into samples stored with 16 bits per sample.
+ * See v2f_entropy_decoder_stream_samples().
+ *
+ * @param decoder decoder used to start the stream. All its samples must fit in 16 bits.
+ * @param stream started stream
+ * @param reconstructed_samples buffer of the whole block
+ * @param max_output_sample_count maximum number of samples to be written for the whole block
+ * @param min_sample_count number of written samples after which decoding stops
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The words were decoded
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter, or
+ *    the decoder has samples that do not fit in 16 bits
+ */
+v2f_error_t v2f_entropy_decoder_stream_samples_16(
+        v2f_entropy_decoder_t const *const decoder,
+        v2f_entropy_decoder_stream_t *const stream,
+        v2f_sample16_t *const reconstructed_samples,
+        uint64_t max_output_sample_count,
+        uint64_t min_sample_count);
+
+/**
+ * Complete the decompression of a block started with v2f_entropy_decoder_stream_start().
+ * Words not decoded yet produce no samples, but are verified.
+ *
+ * @param decoder decoder used to start the stream
+ * @param stream started stream
+ * @param written_sample_count pointer where the number of samples written
+ *   for the block is stored. If the pointer is NULL, it is ignored.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The block was successfully decompressed
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ *  - @ref V2F_E_CORRUPTED_DATA : compressed data contained an invalid word
+ */
+v2f_error_t v2f_entropy_decoder_stream_finish(
+        v2f_entropy_decoder_t const *const decoder,
+        v2f_entropy_decoder_stream_t *const stream,
+        uint64_t *const written_sample_count);
+
 /**
  * Decode the samples corresponding to the first encoded word in
  * compressed_block.
@@ -83,24 +225,29 @@ v2f_error_t v2f_entropy_decoder_decompress_block(
  * produced by @ref v2f_entropy_coder_fill_entry, i.e., using big-endian ordering
  * when applicable.
  *
- * @param decoder initialized entropy decoder to be used for decompression
+ * @param decoder initialized entropy decoder to be used for decompression.
+ *   It must have been compiled with v2f_entropy_decoder_compile().
  * @param compressed_block pointer to the next index position
  * @param output_samples buffer of samples with enough capacity to accommodate
  *   the largest sequence of samples encoded by any word of the encoder
  * @param samples_written pointer to a variable where the number
  *   of decoded samples represented by the index is to be stored.
  *   Ignored if NULL.
+ * @param state pointer to the state with which the index is decoded.
+ *   It must be decoder->initial_state for the first index of a block, and it is
+ *   updated to the state with which the next index is to be decoded.
  *
  * @return
  *  - @ref V2F_E_NONE : The index was successfully decoded
  *  - @ref V2F_E_INVALID_PARAMETER : invalid parameter provided
  *  - @ref V2F_E_CORRUPTED_DATA : compressed data contained an invalid index,
- *   i.e., an index >= decoder->total_entry_count.
+ *   i.e., an index >= state->included_count.
  */
 v2f_error_t v2f_entropy_decoder_decode_next_index(
-        v2f_entropy_decoder_t *const decoder,
+        v2f_entropy_decoder_t const *const decoder,
         uint8_t const* const compressed_block,
         v2f_sample_t *const output_samples,
-        uint32_t *const samples_written);
+        uint32_t *const samples_written,
+        v2f_entropy_decoder_state_t *const state);
 
 #endif /* V2F_ENTROPY_DECODER_H */
@@ -11,11 +11,51 @@
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "v2f_entropy_coder.h"
 #include "v2f_entropy_decoder.h"
+#include "v2f_forest_registry.h"
 #include "log.h"
 #include "timer.h"
+#include "common.h"
+
+/// Handle of the timer of v2f_file_read_codec()
+TIMER_DEFINE(v2f_file_read_codec_timer, "v2f_file_read_codec")
+
+/**
+ * Number of samples serialized before each fwrite call in v2f_file_write_big_endian(),
+ * and read with each fread call in v2f_file_read_big_endian()
+ */
+#define V2F_FILE_IO_CHUNK_SAMPLE_COUNT 4096
+
+/**
+ * Number of blocks in flight per worker thread in v2f_file_compress_from_file() and v2f_file_decompress_from_file(),
+ * besides the blocks being read and written
+ */
+#define V2F_FILE_BLOCKS_PER_THREAD 2
+
+/// Last 8 bytes of compressed files with a block index (see v2f_file_write_block_index())
+#define V2F_FILE_BLOCK_INDEX_MAGIC "V2FINDX1"
+/// Size in bytes of each block index entry
+#define V2F_FILE_BLOCK_INDEX_ENTRY_SIZE 20
+/// Size in bytes of the trailer at the end of the block index
+#define V2F_FILE_BLOCK_INDEX_TRAILER_SIZE 20
+
+/// Options set by v2f_file_init_options(), and used when no options are given
+static const v2f_file_options_t v2f_file_default_options = {
+        .thread_count = 0,
+        .pipeline = false,
+        .forest_cache_path = NULL,
+        .write_block_index = false,
+        .select_rows = false,
+        .first_row = 0,
+        .last_row = 0,
+        .map_files = false};
 
 v2f_error_t v2f_file_write_codec(
         FILE *output_file,
@@ -62,8 +102,11 @@ v2f_error_t v2f_file_write_codec(
     RETURN_IF_FAIL(v2f_file_write_big_endian(output_file, &value, 1, 4));
 
     // Write forest id (0: included explicitly)
-    value = 0;
+    value = decompressor->entropy_decoder->forest_id;
     RETURN_IF_FAIL(v2f_file_write_big_endian(output_file, &value, 1, 4));
+    if (value != 0) {
+        return V2F_E_NONE;
+    }
 
     // Write forest
     RETURN_IF_FAIL(v2f_file_write_forest(
@@ -75,11 +118,71 @@ v2f_error_t v2f_file_write_codec(
     return V2F_E_NONE;
 }
 
+/**
+ * Rewrite the forest cache at `path` with the tables of a coder/decoder pair.
+ * The cache is written to a temporary file that then replaces `path`, so that
+ * concurrent processes never map a partially written cache. Only the owner can
+ * read or write it, since v2f_file_map_forest_cache() refuses any other cache.
+ * Errors are only logged, since the cache is not needed to use the pair.
+ *
+ * @param path path to the cache file
+ * @param coder compiled coder
+ * @param decoder compiled decoder
+ * @param content_hash hash of the codec file that defines the forest
+ */
+static void v2f_file_update_forest_cache(
+        char const *const path,
+        v2f_entropy_coder_t const *const coder,
+        v2f_entropy_decoder_t const *const decoder,
+        uint64_t content_hash) {
+    const size_t path_length = strlen(path);
+    char *const temporary_path = malloc(path_length + sizeof(".XXXXXX"));
+    if (temporary_path == NULL) {
+        log_warning("Cannot update forest cache %s", path); // LCOV_EXCL_LINE
+        return; // LCOV_EXCL_LINE
+    }
+    memcpy(temporary_path, path, path_length);
+    memcpy(temporary_path + path_length, ".XXXXXX", sizeof(".XXXXXX"));
+
+    const int fd = mkstemp(temporary_path);
+    FILE *const output = fd >= 0 && fchmod(fd, S_IRUSR | S_IWUSR) == 0 ? fdopen(fd, "w") : NULL;
+    if (output == NULL) {
+        log_warning("Cannot create temporary forest cache %s", temporary_path);
+        if (fd >= 0) {
+            close(fd); // LCOV_EXCL_LINE
+            unlink(temporary_path); // LCOV_EXCL_LINE
+        }
+        free(temporary_path);
+        return;
+    }
+
+    const v2f_error_t status = v2f_file_write_forest_cache(output, coder, decoder, content_hash);
+    if (fclose(output) != 0 || status != V2F_E_NONE || rename(temporary_path, path) != 0) {
+        log_warning("Cannot update forest cache %s", path);
+        unlink(temporary_path);
+    }
+    free(temporary_path);
+}
+
 v2f_error_t v2f_file_read_codec(
         FILE *input_file,
         v2f_compressor_t *const compressor,
         v2f_decompressor_t *const decompressor) {
-    timer_start("v2f_file_read_codec");
+    return v2f_file_read_codec_cached(input_file, NULL, compressor, decompressor);
+}
+
+v2f_error_t v2f_file_read_codec_cached(
+        FILE *input_file,
+        char const *const forest_cache_path,
+        v2f_compressor_t *const compressor,
+        v2f_decompressor_t *const decompressor) {
+    timer_start_handle(v2f_file_read_codec_timer());
+
+    // The cache is only valid for the current contents of the codec file
+    uint64_t content_hash = 0;
+    if (forest_cache_path != NULL) {
+        RETURN_IF_FAIL(v2f_file_hash_contents(input_file, &content_hash));
+    }
 
     // Read quantizer and decorrelator parameters
     log_debug("ftello(input_file) before = %ld", ftello(input_file));
@@ -163,7 +266,7 @@ v2f_error_t v2f_file_read_codec(
     v2f_sample_t forest_index;
     RETURN_IF_FAIL(
             v2f_file_read_big_endian(input_file, &forest_index, 1, 4, NULL));
-    if (forest_index != 0) {
+    if (forest_index > v2f_forest_registry_count()) {
         log_error("Unsupported value forest_index = %u", forest_index);
         for (uint32_t i = 0; i < sizeof(pointers) / sizeof(void *); i++) {
             if (pointers[i] == NULL) {
@@ -175,13 +278,27 @@ v2f_error_t v2f_file_read_codec(
         return V2F_E_FEATURE_NOT_IMPLEMENTED;
     }
 
-    // Read forest
+    // Use the built-in forest if selected. Otherwise, map the forest
+    // from its cache if up to date, or read it
     log_debug("Reading forest...");
     v2f_entropy_coder_t *entropy_coder = malloc(sizeof(v2f_entropy_coder_t));
     v2f_entropy_decoder_t *entropy_decoder = malloc(
             sizeof(v2f_entropy_decoder_t));
-    v2f_error_t forest_status = v2f_file_read_forest(
-            input_file, entropy_coder, entropy_decoder);
+    v2f_error_t forest_status;
+    if (forest_index != 0) {
+        forest_status = v2f_forest_registry_load(forest_index, entropy_coder, entropy_decoder);
+    } else {
+        forest_status = forest_cache_path != NULL ?
+                        v2f_file_map_forest_cache(forest_cache_path, content_hash, entropy_coder, entropy_decoder) :
+                        V2F_E_IO;
+    }
+    if (forest_status != V2F_E_NONE && forest_index == 0) {
+        forest_status = v2f_file_read_forest(
+                input_file, entropy_coder, entropy_decoder);
+        if (forest_status == V2F_E_NONE && forest_cache_path != NULL) {
+            v2f_file_update_forest_cache(forest_cache_path, entropy_coder, entropy_decoder, content_hash);
+        }
+    }
     if (forest_status != V2F_E_NONE) {
         for (uint32_t i = 0; i < sizeof(pointers) / sizeof(void *); i++) {
             if (pointers[i] == NULL) {
@@ -190,6 +307,8 @@ v2f_error_t v2f_file_read_codec(
         }
         free(quantizer);
         free(decorrelator);
+        free(entropy_coder);
+        free(entropy_decoder);
         RETURN_IF_FAIL(forest_status);
     }
 
@@ -212,7 +331,7 @@ v2f_error_t v2f_file_read_codec(
         RETURN_IF_FAIL(decompressor_status);
     }
 
-    timer_stop("v2f_file_read_codec");
+    timer_stop_handle(v2f_file_read_codec_timer());
 
     return V2F_E_NONE;
 }
@@ -240,7 +359,7 @@ v2f_error_t v2f_file_write_forest(FILE *output,
                                   v2f_entropy_coder_t const *const coder,
                                   v2f_entropy_decoder_t const *const decoder,
                                   uint32_t different_roots) {
-    if (output == NULL || coder == NULL) {
+    if (output == NULL || coder == NULL || decoder == NULL || decoder->roots == NULL) {
         return V2F_E_INVALID_PARAMETER;
     }
 
@@ -436,7 +555,86 @@ v2f_error_t v2f_file_write_forest(FILE *output,
     return V2F_E_NONE;
 }
 
-// TODO: cleanup memory allocation in a more elegant way
+/**
+ * Round a size up to a multiple of 8 bytes, so that all structures
+ * taken consecutively from a forest arena are properly aligned.
+ */
+#define V2F_FILE_ARENA_ALIGN(size) ((((size_t) (size)) + 7) & ~((size_t) 7))
+
+/**
+ * @struct v2f_file_forest_arena_t
+ *
+ * Memory of a forest read by v2f_file_read_forest(). All coder and decoder
+ * structures are taken from a single block, sized from the counts in the forest
+ * header, which starts with this structure. Since the total number of samples
+ * is not known in advance, the samples of all decoder entries are stored
+ * consecutively in a second block.
+ */
+typedef struct {
+    /// Samples of all decoder entries.
+    v2f_sample_t *samples;
+    /// Number of elements allocated in `samples`.
+    uint64_t sample_capacity;
+    /// Number of elements used in `samples`.
+    uint64_t sample_count;
+    /// Next unused byte of the block.
+    uint8_t *next_free;
+} v2f_file_forest_arena_t;
+
+/**
+ * Take memory for `count` elements of `size` bytes from a forest arena.
+ * The arena is sized in advance, so this never fails.
+ *
+ * @param arena arena from which memory is taken
+ * @param count number of elements
+ * @param size size of each element
+ *
+ * @return a pointer to the first element, which is zero-initialized
+ */
+static void *v2f_file_arena_take(v2f_file_forest_arena_t *const arena, uint64_t count, size_t size) {
+    void *const taken = arena->next_free;
+    arena->next_free += V2F_FILE_ARENA_ALIGN(count * size);
+    return taken;
+}
+
+/**
+ * Reserve room for `count` more samples in the sample block of a forest arena.
+ *
+ * @param arena arena where samples are stored
+ * @param count number of samples to be stored next
+ *
+ * @return
+ *  - @ref V2F_E_NONE : there is room for `count` more samples
+ *  - @ref V2F_E_OUT_OF_MEMORY : the sample block could not be enlarged
+ */
+static v2f_error_t v2f_file_arena_reserve_samples(v2f_file_forest_arena_t *const arena, uint64_t count) {
+    if (arena->sample_count + count <= arena->sample_capacity) {
+        return V2F_E_NONE;
+    }
+    uint64_t capacity = arena->sample_capacity > 0 ? 2 * arena->sample_capacity : 4096;
+    while (capacity < arena->sample_count + count) {
+        capacity *= 2;
+    }
+    v2f_sample_t *const samples = realloc(arena->samples, sizeof(v2f_sample_t) * capacity);
+    if (samples == NULL) {
+        return V2F_E_OUT_OF_MEMORY; // LCOV_EXCL_LINE
+    }
+    arena->samples = samples;
+    arena->sample_capacity = capacity;
+    return V2F_E_NONE;
+}
+
+/**
+ * Free a forest arena and its sample block.
+ *
+ * @param arena arena to be freed. Nothing is done if NULL.
+ */
+static void v2f_file_arena_free(v2f_file_forest_arena_t *const arena) {
+    if (arena != NULL) {
+        free(arena->samples);
+        free(arena);
+    }
+}
 
 v2f_error_t v2f_file_read_forest(
         FILE *input,
@@ -499,50 +697,76 @@ v2f_error_t v2f_file_read_forest(
     }
     log_debug("included_root_count = %u", included_root_count);
 
-    // Allocate roots
-    v2f_entropy_coder_entry_t **coder_root_pointers =
-            malloc(sizeof(v2f_entropy_coder_entry_t *) *
-                   (max_expected_value + 1));
-    v2f_entropy_decoder_root_t **decoder_root_pointers =
-            malloc(sizeof(v2f_entropy_decoder_root_t *) *
-                   (max_expected_value + 1));
-
-    void *root_pointers[] = {coder_root_pointers, decoder_root_pointers};
-    if (coder_root_pointers == NULL || decoder_root_pointers == NULL) {
-        log_error("coder_root_pointers = %p", (void *) coder_root_pointers);
-        log_error("decoder_root_pointers = %p",
-                  (void *) decoder_root_pointers);
+    // Allocate a single block for all coder and decoder structures.
+    // Every entry is the child of at most one other entry, so there are at most
+    // total_entry_count children pointers (and included entries) in a valid forest.
+    const uint64_t root_count = (uint64_t) max_expected_value + 1;
+    const size_t arena_size =
+            V2F_FILE_ARENA_ALIGN(sizeof(v2f_file_forest_arena_t))
+            + V2F_FILE_ARENA_ALIGN(root_count * sizeof(v2f_entropy_coder_entry_t *))
+            + V2F_FILE_ARENA_ALIGN(root_count * sizeof(v2f_entropy_decoder_root_t *))
+            + V2F_FILE_ARENA_ALIGN(sizeof(v2f_entropy_coder_entry_t *))
+            + V2F_FILE_ARENA_ALIGN(sizeof(v2f_entropy_coder_entry_t))
+            + V2F_FILE_ARENA_ALIGN(sizeof(v2f_entropy_coder_entry_t *))
+            + included_root_count * (
+                    V2F_FILE_ARENA_ALIGN(sizeof(v2f_entropy_coder_entry_t))
+                    + V2F_FILE_ARENA_ALIGN(sizeof(v2f_entropy_decoder_root_t))
+                    + V2F_FILE_ARENA_ALIGN(root_count * sizeof(v2f_entropy_coder_entry_t *)))
+            + V2F_FILE_ARENA_ALIGN((uint64_t) total_entry_count * sizeof(v2f_entropy_decoder_entry_t))
+            + V2F_FILE_ARENA_ALIGN((uint64_t) total_entry_count * sizeof(v2f_entropy_coder_entry_t))
+            + V2F_FILE_ARENA_ALIGN((uint64_t) total_entry_count * bytes_per_word)
+            + V2F_FILE_ARENA_ALIGN((uint64_t) total_entry_count * sizeof(v2f_entropy_coder_entry_t *))
+            + V2F_FILE_ARENA_ALIGN((uint64_t) total_entry_count * sizeof(v2f_entropy_decoder_entry_t *));
+    uint8_t *const block = calloc(1, arena_size);
+    if (block == NULL) {
+        log_error("Cannot allocate %lu bytes for the forest", arena_size);
         return V2F_E_OUT_OF_MEMORY;
     }
+    v2f_file_forest_arena_t *const arena = (v2f_file_forest_arena_t *) block;
+    arena->next_free = block + V2F_FILE_ARENA_ALIGN(sizeof(v2f_file_forest_arena_t));
 
-    v2f_entropy_coder_entry_t **null_children_entries = malloc(
-            sizeof(v2f_entropy_coder_entry_t *));
-    null_children_entries[0] = malloc(sizeof(v2f_entropy_coder_entry_t));
+    v2f_entropy_coder_entry_t **const coder_root_pointers =
+            v2f_file_arena_take(arena, root_count, sizeof(v2f_entropy_coder_entry_t *));
+    v2f_entropy_decoder_root_t **const decoder_root_pointers =
+            v2f_file_arena_take(arena, root_count, sizeof(v2f_entropy_decoder_root_t *));
+
+    // Entries without children share an empty list with a single null entry
+    v2f_entropy_coder_entry_t **const null_children_entries =
+            v2f_file_arena_take(arena, 1, sizeof(v2f_entropy_coder_entry_t *));
+    null_children_entries[0] = v2f_file_arena_take(arena, 1, sizeof(v2f_entropy_coder_entry_t));
     null_children_entries[0]->children_count = 0;
     null_children_entries[0]->word_bytes = NULL;
-    null_children_entries[0]->children_entries = malloc(
-            sizeof(v2f_entropy_coder_entry_t *));
+    null_children_entries[0]->children_entries =
+            v2f_file_arena_take(arena, 1, sizeof(v2f_entropy_coder_entry_t *));
     null_children_entries[0]->children_entries[0] = NULL;
     log_debug("null_children_entries = %p", (void *) null_children_entries);
     log_debug("null_children_entries[0] = %p",
               (void *) (null_children_entries[0]));
 
+    // Entries of all roots are stored consecutively
+    v2f_entropy_decoder_entry_t *const decoder_entries =
+            v2f_file_arena_take(arena, total_entry_count, sizeof(v2f_entropy_decoder_entry_t));
+    v2f_entropy_coder_entry_t *const coder_entries =
+            v2f_file_arena_take(arena, total_entry_count, sizeof(v2f_entropy_coder_entry_t));
+    uint8_t *const word_bytes = v2f_file_arena_take(arena, total_entry_count, bytes_per_word);
+    v2f_entropy_coder_entry_t **const children_pointers =
+            v2f_file_arena_take(arena, total_entry_count, sizeof(v2f_entropy_coder_entry_t *));
+    v2f_entropy_decoder_entry_t **const word_pointers =
+            v2f_file_arena_take(arena, total_entry_count, sizeof(v2f_entropy_decoder_entry_t *));
+    uint64_t first_entry = 0;
+    uint64_t used_children_count = 0;
+    uint64_t used_word_count = 0;
+
     // Read the roots
-    v2f_error_t status;
+    v2f_error_t status = V2F_E_NONE;
     for (uint32_t root_index = 0;
          root_index < included_root_count; root_index++) {
         log_debug("Reading root index %u (max index %u)", root_index,
                   (uint32_t) included_root_count - 1);
 
-        // Allocate root entry
-        coder_root_pointers[root_index] = malloc(
-                sizeof(v2f_entropy_coder_entry_t));
-        decoder_root_pointers[root_index] = malloc(
-                sizeof(v2f_entropy_decoder_root_t));
-        if (coder_root_pointers[root_index] == NULL ||
-            decoder_root_pointers == NULL) {
-            return V2F_E_OUT_OF_MEMORY;
-        }
+        coder_root_pointers[root_index] = v2f_file_arena_take(arena, 1, sizeof(v2f_entropy_coder_entry_t));
+        decoder_root_pointers[root_index] = v2f_file_arena_take(arena, 1, sizeof(v2f_entropy_decoder_root_t));
+        v2f_entropy_decoder_root_t *const decoder_root = decoder_root_pointers[root_index];
 
         // Total entry count (with or without assigned codeword)
         v2f_sample_t root_total_entry_count;
@@ -552,9 +776,10 @@ v2f_error_t v2f_file_read_forest(
             || root_total_entry_count < V2F_C_MIN_ENTRY_COUNT
             || root_total_entry_count > V2F_C_MAX_ENTRY_COUNT
             || root_total_entry_count > remaining_entry_count) {
-            return status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
+            status = status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
+            goto cleanup;
         }
-        decoder_root_pointers[root_index]->root_entry_count = root_total_entry_count;
+        decoder_root->root_entry_count = root_total_entry_count;
         log_debug("root_total_entry_count = %u", root_total_entry_count);
 
         // Total included entry count (with assigned codeword)
@@ -566,46 +791,29 @@ v2f_error_t v2f_file_read_forest(
             || root_included_count > V2F_C_MAX_ENTRY_COUNT
             || root_included_count > remaining_entry_count
             || root_included_count > root_total_entry_count) {
-            return status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
+            status = status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
+            goto cleanup;
         }
-        decoder_root_pointers[root_index]->root_included_count = root_included_count;
+        decoder_root->root_included_count = root_included_count;
         log_debug("root_included_count = %u", root_included_count);
 
-        // Allocate decoder entries
-        decoder_root_pointers[root_index]->entries_by_index =
-                malloc(sizeof(v2f_entropy_decoder_entry_t) *
-                       root_total_entry_count);
-        if (decoder_root_pointers[root_index]->entries_by_index == NULL) {
-            for (uint32_t i = 0;
-                 i < sizeof(root_pointers) / sizeof(void *); i++) {
-                if (root_pointers[i] != NULL) {
-                    free(root_pointers[i]);
-                }
-            }
-            return V2F_E_OUT_OF_MEMORY;
+        // Take this root's entries from the arena
+        decoder_root->entries_by_index = decoder_entries + first_entry;
+        for (uint32_t i = 0; i < root_total_entry_count; i++) {
+            decoder_root->entries_by_index[i].coder_entry = coder_entries + first_entry + i;
+            decoder_root->entries_by_index[i].coder_entry->word_bytes =
+                    word_bytes + (first_entry + i) * bytes_per_word;
         }
+        first_entry += root_total_entry_count;
 
         log_debug("root#%u coder_root_pointers[%u] = %p",
                   root_index, root_index,
                   (void *) (coder_root_pointers[root_index]));
 
-        // Read and allocate root entries
-        uint32_t next_index;
-        for (next_index = 0;
+        // Read root entries
+        for (uint32_t next_index = 0;
              next_index < root_total_entry_count;
              next_index++) {
-            // Allocate
-            decoder_root_pointers[root_index]->entries_by_index[next_index].coder_entry =
-                    malloc(sizeof(v2f_entropy_coder_entry_t));
-            decoder_root_pointers[root_index]->entries_by_index[next_index].coder_entry->word_bytes =
-                    malloc(sizeof(uint8_t) * bytes_per_word);
-            if (decoder_root_pointers[root_index]->entries_by_index[
-                        next_index].coder_entry == NULL
-                || decoder_root_pointers[root_index]->entries_by_index[
-                           next_index].coder_entry->word_bytes == NULL) {
-                return V2F_E_OUT_OF_MEMORY;
-            }
-
             // Index
             v2f_sample_t entry_index;
             status = v2f_file_read_big_endian(
@@ -613,58 +821,44 @@ v2f_error_t v2f_file_read_forest(
             if (status != V2F_E_NONE
                 || entry_index >= V2F_C_MAX_ENTRY_COUNT
                 || entry_index >= root_total_entry_count) {
-                return status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
+                status = status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
+                goto cleanup;
             }
             if (entry_index != next_index) {
                 log_error(
                         "This implementation expects entry_index == next_index, but they differ "
                         "(%u != %u)\n", entry_index, next_index);
-                return V2F_E_CORRUPTED_DATA;
+                status = V2F_E_CORRUPTED_DATA;
+                goto cleanup;
             }
+            v2f_entropy_decoder_entry_t *const decoder_entry = &(decoder_root->entries_by_index[entry_index]);
+            v2f_entropy_coder_entry_t *const coder_entry = decoder_entry->coder_entry;
             log_debug("Read index %u of root %u (%p)",
-                      entry_index, root_index,
-                      (void *) (decoder_root_pointers[root_index]->entries_by_index[
-                              entry_index].coder_entry));
+                      entry_index, root_index, (void *) coder_entry);
 
             // Number of children
             status = v2f_file_read_big_endian(input, &value, 1, 4, NULL);
             const v2f_sample_t entry_children_count = value;
             if (status != V2F_E_NONE ||
-                entry_children_count > V2F_C_MAX_CHILD_COUNT) {
+                entry_children_count > V2F_C_MAX_CHILD_COUNT ||
+                entry_children_count > total_entry_count - used_children_count) {
                 log_error("entry_children_count = %u", entry_children_count);
                 log_error("status = %d", (int) status);
-
-                return status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
+                status = status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
+                goto cleanup;
             }
-            decoder_root_pointers[root_index]->entries_by_index[
-                    entry_index].coder_entry->children_count = entry_children_count;
             if (_LOG_LEVEL >= LOG_DEBUG_LEVEL + 1) {
                 log_debug("entry_children_count = %u", entry_children_count);
             }
 
-            // Allocate children pointers
+            // Take children pointers from the arena
+            decoder_entry->children_count = entry_children_count;
+            coder_entry->children_count = entry_children_count;
             if (entry_children_count == 0) {
-                decoder_root_pointers[root_index]->entries_by_index[
-                        entry_index].children_count = 0;
-                decoder_root_pointers[root_index]->entries_by_index[
-                        entry_index].coder_entry->children_count = 0;
-                decoder_root_pointers[root_index]->entries_by_index[
-                        entry_index].coder_entry->children_entries = null_children_entries;
+                coder_entry->children_entries = null_children_entries;
             } else {
-                decoder_root_pointers[root_index]->entries_by_index[
-                        entry_index].children_count = entry_children_count;
-                decoder_root_pointers[root_index]->entries_by_index[
-                        entry_index].coder_entry->children_count = entry_children_count;
-                decoder_root_pointers[root_index]->entries_by_index[
-                        entry_index].coder_entry->children_entries =
-                        malloc(sizeof(v2f_entropy_coder_entry_t *) *
-                               entry_children_count);
-                if (decoder_root_pointers[root_index]->entries_by_index[
-                            entry_index].coder_entry->children_entries ==
-                    NULL) {
-                    return status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA
-                                                : status;
-                }
+                coder_entry->children_entries = children_pointers + used_children_count;
+                used_children_count += entry_children_count;
             }
 
             // Assign children indices
@@ -678,25 +872,21 @@ v2f_error_t v2f_file_read_forest(
                     log_error("Error assigning children entries: status = %u "
                               "[root %u, child_index = %u]",
                               status, root_index, child_index);
-                    return status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA
-                                                : status;
+                    status = status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
+                    goto cleanup;
                 }
 
                 // Pointers might not have been initialized yet. In this first
                 // pass, the root's global index is stored and then the pointers
-                // are assigned once all memory has been allocated.
-                decoder_root_pointers[root_index]->entries_by_index[
-                        entry_index].coder_entry->children_entries[c] =
-                        (v2f_entropy_coder_entry_t *) ((uint64_t) child_index);
+                // are assigned once all entries have been read.
+                coder_entry->children_entries[c] = (v2f_entropy_coder_entry_t *) ((uint64_t) child_index);
                 if (_LOG_LEVEL >= LOG_DEBUG_LEVEL + 1) {
                     log_debug("Child index %u for (root %u, index %u) %p, ",
                               child_index, root_index, entry_index,
-                              (void *) (decoder_root_pointers[root_index]->entries_by_index[
-                                      entry_index].coder_entry->children_entries[c]));
+                              (void *) (coder_entry->children_entries[c]));
                 }
             }
 
-
             if (entry_children_count < max_expected_value + 1) {
                 // Read sample count
                 status = v2f_file_read_big_endian(input, &value, 1, 2, NULL);
@@ -705,67 +895,52 @@ v2f_error_t v2f_file_read_forest(
                     || sample_count < V2F_C_MIN_SAMPLE_COUNT
                     || sample_count > V2F_C_MAX_SAMPLE_COUNT) {
                     log_error("sample_count = %u", sample_count);
-                    return status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA
-                                                : status;
-                }
-                decoder_root_pointers[root_index]->entries_by_index[entry_index].sample_count = sample_count;
-                decoder_root_pointers[root_index]->entries_by_index[entry_index].samples =
-                        malloc(sizeof(v2f_sample_t) * sample_count);
-                if (decoder_root_pointers[root_index]->entries_by_index[entry_index].samples ==
-                    NULL) {
-                    log_error(
-                            "(void*) (decoder_root_pointers[root_index]->entries_by_index[entry_index].samples) = %p",
-                            (void *) (decoder_root_pointers[root_index]->entries_by_index[entry_index].samples));
-
-                    return status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA
-                                                : status;
+                    status = status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
+                    goto cleanup;
                 }
+                decoder_entry->sample_count = sample_count;
                 if (_LOG_LEVEL >= LOG_DEBUG_LEVEL + 1) {
                     log_debug("%u samples for (root %u, index %u)",
-                              decoder_root_pointers[root_index]->entries_by_index[entry_index].sample_count,
-                              root_index, entry_index);
+                              sample_count, root_index, entry_index);
                 }
 
-                // Read samples
-                for (uint32_t s = 0;
-                     s <
-                     decoder_root_pointers[root_index]->entries_by_index[entry_index].sample_count;
-                     s++) {
-                    status = v2f_file_read_big_endian(input, &value, 1,
-                                                      bytes_per_sample, NULL);
-                    const v2f_sample_t sample_value = value;
-                    if (status != V2F_E_NONE ||
-                        sample_value > max_expected_value ||
-                        sample_value > V2F_C_MAX_SAMPLE_VALUE) {
-                        log_error("sample_value = %u", sample_value);
-                        return status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA
-                                                    : status;
+                // Read samples onto the sample block. Since it may be moved when
+                // enlarged, the entry stores the position of its samples until
+                // all samples have been read.
+                status = v2f_file_arena_reserve_samples(arena, sample_count);
+                if (status != V2F_E_NONE) {
+                    goto cleanup; // LCOV_EXCL_LINE
+                }
+                v2f_sample_t *const samples = arena->samples + arena->sample_count;
+                status = v2f_file_read_big_endian(input, samples, sample_count, bytes_per_sample, NULL);
+                if (status != V2F_E_NONE) {
+                    goto cleanup;
+                }
+                for (uint32_t s = 0; s < sample_count; s++) {
+                    if (samples[s] > max_expected_value) {
+                        log_error("sample_value = %u", samples[s]);
+                        status = V2F_E_CORRUPTED_DATA;
+                        goto cleanup;
                     }
-                    decoder_root_pointers[root_index]->entries_by_index[entry_index].samples[s] = sample_value;
                     log_no_newline(LOG_DEBUG_LEVEL, "%s%u, ",
-                                   (s == 0 ? "Samples: " : ""), sample_value);
+                                   (s == 0 ? "Samples: " : ""), samples[s]);
                 }
-                log_no_newline(LOG_DEBUG_LEVEL,
-                               (decoder_root_pointers[root_index]->entries_by_index[entry_index].sample_count >
-                                0 ? "\n" : ""));
+                log_no_newline(LOG_DEBUG_LEVEL, (sample_count > 0 ? "\n" : ""));
+                decoder_entry->samples = (v2f_sample_t *) arena->sample_count;
+                arena->sample_count += sample_count;
 
                 // Read word bytes
                 status = v2f_file_read_big_endian(
                         input, &value, 1, bytes_per_word, NULL);
-                if (value >=
-                    decoder_root_pointers[root_index]->root_included_count) {
+                if (value >= decoder_root->root_included_count) {
                     log_error("Invalid word value %u", value);
-                    return V2F_E_CORRUPTED_DATA;
+                    status = V2F_E_CORRUPTED_DATA;
+                    goto cleanup;
                 }
-                v2f_entropy_coder_sample_to_buffer(
-                        value,
-                        decoder_root_pointers[root_index]->entries_by_index[entry_index].coder_entry->word_bytes,
-                        bytes_per_word);
+                v2f_entropy_coder_sample_to_buffer(value, coder_entry->word_bytes, bytes_per_word);
                 log_no_newline(LOG_DEBUG_LEVEL, "Words: ");
                 for (uint32_t w = 0; w < bytes_per_word; w++) {
-                    log_no_newline(LOG_DEBUG_LEVEL, "%d",
-                                   (int) decoder_root_pointers[root_index]->entries_by_index[
-                                           entry_index].coder_entry->word_bytes[w]);
+                    log_no_newline(LOG_DEBUG_LEVEL, "%d", (int) coder_entry->word_bytes[w]);
                 }
                 log_no_newline(LOG_DEBUG_LEVEL, "\n");
             }
@@ -788,21 +963,14 @@ v2f_error_t v2f_file_read_forest(
             || root_children_count > V2F_C_MAX_CHILD_COUNT
             || (non_full_tree && (!missing_r))) {
             log_error("root_children_count = %u", root_children_count);
-            return status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
+            status = status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
+            goto cleanup;
         }
         coder_root_pointers[root_index]->children_count = root_children_count;
         log_debug("root_children_count = %u", root_children_count);
 
         coder_root_pointers[root_index]->children_entries =
-                malloc(sizeof(v2f_entropy_coder_entry_t *) *
-                       (max_expected_value + 1));
-        if (coder_root_pointers[root_index]->children_entries == NULL) {
-            log_error(
-                    "(void*) (coder_root_pointers[root_index]->children_entries) = %p",
-                    (void *) (coder_root_pointers[root_index]->children_entries));
-
-            return V2F_E_OUT_OF_MEMORY;
-        }
+                v2f_file_arena_take(arena, root_count, sizeof(v2f_entropy_coder_entry_t *));
 
         for (uint32_t c = 0; c < root_children_count; c++) {
             // Read root child index
@@ -813,7 +981,7 @@ v2f_error_t v2f_file_read_forest(
                 log_debug("child_index = %u", child_index);
             }
 
-            v2f_sample_t symbol_value;
+            v2f_sample_t symbol_value = 0;
             bool valid_symbol_value = false;
             if (status == V2F_E_NONE) {
                 // Read root child index input symbol value
@@ -827,96 +995,68 @@ v2f_error_t v2f_file_read_forest(
                          symbol_value == c + root_index));
             }
 
-            if (status != V2F_E_NONE || child_index >= total_entry_count ||
+            if (status != V2F_E_NONE || child_index >= root_total_entry_count ||
                 !valid_symbol_value) {
                 log_error("child_index = %u", child_index);
                 log_error("symbol_value = %u", symbol_value);
                 log_error("valid_symbol_value = %d", (int) valid_symbol_value);
-
-                return status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
-            }
-            if (!non_full_tree) {
-                coder_root_pointers[root_index]->children_entries[c] =
-                        decoder_root_pointers[root_index]->entries_by_index[child_index].coder_entry;
-            } else {
-                assert(missing_r);
-                coder_root_pointers[root_index]->children_entries[c +
-                                                                  root_index] =
-                        decoder_root_pointers[root_index]->entries_by_index[child_index].coder_entry;
+                status = status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
+                goto cleanup;
             }
+            coder_root_pointers[root_index]->children_entries[non_full_tree ? c + root_index : c] =
+                    decoder_root->entries_by_index[child_index].coder_entry;
         }
 
-        // Allocate word to index table
         // Create word to included node structure
-        decoder_root_pointers[root_index]->entries_by_word =
-                malloc(sizeof(v2f_entropy_decoder_entry_t *) *
-                       decoder_root_pointers[root_index]->root_included_count);
-        if (decoder_root_pointers[root_index]->entries_by_word == NULL) {
-            log_error("error allocating entries by word for root_index = %u",
-                      root_index);
-
-            return V2F_E_OUT_OF_MEMORY;
-        }
-        memset(decoder_root_pointers[root_index]->entries_by_word,
-               0, sizeof(v2f_entropy_decoder_entry_t *)
-                  * decoder_root_pointers[root_index]->root_included_count);
+        decoder_root->entries_by_word = word_pointers + used_word_count;
+        used_word_count += decoder_root->root_included_count;
 
         for (uint32_t i = 0; i < root_total_entry_count; i++) {
             // Assign pending child pointers
-            for (uint32_t c = 0;
-                 c <
-                 decoder_root_pointers[root_index]->entries_by_index[i].coder_entry->children_count;
-                 c++) {
-
-                uint64_t pointer_index = (uint64_t) (decoder_root_pointers[
-                        root_index]->entries_by_index[
-                        i].coder_entry->children_entries[
-                        c]);
-
-                if (pointer_index >
-                    decoder_root_pointers[root_index]->root_entry_count) {
+            v2f_entropy_coder_entry_t *const coder_entry = decoder_root->entries_by_index[i].coder_entry;
+            for (uint32_t c = 0; c < coder_entry->children_count; c++) {
+                const uint64_t pointer_index = (uint64_t) (coder_entry->children_entries[c]);
+                if (pointer_index >= decoder_root->root_entry_count) {
                     log_error("pointer_index: %lu; entry count: %u",
-                              pointer_index,
-                              decoder_root_pointers[root_index]->root_entry_count);
-                    return V2F_E_CORRUPTED_DATA;
+                              pointer_index, decoder_root->root_entry_count);
+                    status = V2F_E_CORRUPTED_DATA;
+                    goto cleanup;
                 }
-
-                decoder_root_pointers[root_index]->entries_by_index[i].coder_entry->children_entries[c] =
-                        decoder_root_pointers[
-                                root_index]->entries_by_index[pointer_index].coder_entry;
+                coder_entry->children_entries[c] = decoder_root->entries_by_index[pointer_index].coder_entry;
             }
         }
 
         // Assign word to entry table
-        for (uint32_t index = 0;
-             index <
-             decoder_root_pointers[root_index]->root_entry_count; index++) {
-            if (decoder_root_pointers[root_index]->entries_by_index[index].children_count <
-                (max_expected_value + 1)) {
+        for (uint32_t index = 0; index < decoder_root->root_entry_count; index++) {
+            if (decoder_root->entries_by_index[index].children_count < (max_expected_value + 1)) {
                 v2f_sample_t word = v2f_entropy_coder_buffer_to_sample(
-                        decoder_root_pointers[root_index]->entries_by_index[
-                                index].coder_entry->word_bytes,
+                        decoder_root->entries_by_index[index].coder_entry->word_bytes,
                         bytes_per_word);
-                decoder_root_pointers[root_index]->entries_by_word[word] =
-                        &(decoder_root_pointers[root_index]->entries_by_index[index]);
+                decoder_root->entries_by_word[word] = &(decoder_root->entries_by_index[index]);
             }
         }
 
-        for (uint32_t w = 0;
-             w < decoder_root_pointers[root_index]->root_included_count; w++) {
-            if (decoder_root_pointers[root_index]->entries_by_word[w] ==
-                NULL) {
+        for (uint32_t w = 0; w < decoder_root->root_included_count; w++) {
+            if (decoder_root->entries_by_word[w] == NULL) {
                 log_debug("NULL pointer for w = %u", w);
-                return V2F_E_CORRUPTED_DATA;
+                status = V2F_E_CORRUPTED_DATA;
+                goto cleanup;
             }
         }
-
     }
 
     if (remaining_entry_count != 0) {
         log_error("remaining_entry_count = %u should be zero.",
                   remaining_entry_count);
-        return V2F_E_CORRUPTED_DATA;
+        status = V2F_E_CORRUPTED_DATA;
+        goto cleanup;
+    }
+
+    // The sample block is no longer moved: replace sample positions with pointers
+    for (uint64_t i = 0; i < total_entry_count; i++) {
+        if (decoder_entries[i].children_count < max_expected_value + 1) {
+            decoder_entries[i].samples = arena->samples + (uint64_t) decoder_entries[i].samples;
+        }
     }
 
     // Not all roots need to be defined
@@ -935,83 +1075,474 @@ v2f_error_t v2f_file_read_forest(
                                        max_expected_value + 1,
                                        bytes_per_word, bytes_per_sample);
     if (coder_status != V2F_E_NONE || decoder_status != V2F_E_NONE) {
-        for (uint32_t root_index = 0;
-             root_index < included_root_count; root_index++) {
-            for (uint32_t d = 0;
-                 d <
-                 decoder_root_pointers[root_index]->root_included_count; d++) {
-                if (decoder_root_pointers[root_index]->entries_by_index[d].coder_entry->children_count >
-                    0) {
-                    free(decoder_root_pointers[root_index]->entries_by_index[d].coder_entry->children_entries);
-                }
-                if (decoder_root_pointers[root_index]->entries_by_index[d].coder_entry->children_count !=
-                    (max_expected_value + 1)) {
-                    free(decoder_root_pointers[root_index]->entries_by_index[d].coder_entry->word_bytes);
-                }
-                free(decoder_root_pointers[root_index]->entries_by_index[d].coder_entry);
-            }
-        }
-        for (uint32_t i = 0;
-             i < sizeof(root_pointers) / sizeof(void *); i++) {
-            if (root_pointers[i] != NULL) {
-                free(root_pointers[i]);
-            }
-        }
-        free(null_children_entries[0]->children_entries);
-        free(null_children_entries[0]);
-
         log_error("coder_status = %d", (int) coder_status);
         log_error("decoder_status = %d", (int) decoder_status);
-
-        return status == V2F_E_NONE ? V2F_E_CORRUPTED_DATA : status;
+        status = V2F_E_CORRUPTED_DATA;
+        goto cleanup;
     }
+    decoder->forest_arena = arena;
 
+    // Compile the forest into the tables used for coding and decoding
+    status = v2f_entropy_coder_compile(coder);
+    if (status == V2F_E_NONE) {
+        status = v2f_entropy_decoder_compile(decoder);
+    }
+    if (status != V2F_E_NONE) {
+        log_error("Cannot compile the forest: status = %d", (int) status);
+        RETURN_IF_FAIL(v2f_file_destroy_read_forest(coder, decoder));
+        return status;
+    }
 
     return v2f_verify_forest(coder, decoder);
+
+    cleanup:
+    v2f_file_arena_free(arena);
+    return status;
 }
 
 v2f_error_t v2f_file_destroy_read_forest(v2f_entropy_coder_t *coder,
                                          v2f_entropy_decoder_t *decoder) {
     if (coder == NULL || decoder == NULL ||
-        coder->root_count != decoder->root_count) {
+        coder->root_count != decoder->root_count ||
+        (decoder->forest_arena == NULL && decoder->forest_cache == NULL && decoder->forest_id == 0)) {
         return V2F_E_INVALID_PARAMETER;
     }
 
-    v2f_entropy_decoder_root_t *last_root = NULL;
-    bool null_children_deleted = false;
-    for (uint32_t r = 0; r < decoder->root_count; r++) {
-        if (decoder->roots[r] == last_root) {
-            break;
+    // Built-in forests are not owned by the pair
+    if (decoder->forest_id != 0) {
+        decoder->forest_id = 0;
+        coder->states = NULL;
+        coder->transitions = NULL;
+        coder->root_transition_offsets = NULL;
+        decoder->words = NULL;
+        decoder->sample_pool = NULL;
+        decoder->sample_pool_16 = NULL;
+        return V2F_E_NONE;
+    }
+
+    // The tables of mapped forests are part of the mapping
+    if (decoder->forest_cache != NULL) {
+        munmap(decoder->forest_cache, decoder->forest_cache_size);
+        decoder->forest_cache = NULL;
+        decoder->forest_cache_size = 0;
+        coder->states = NULL;
+        coder->transitions = NULL;
+        coder->root_transition_offsets = NULL;
+        decoder->words = NULL;
+        decoder->sample_pool = NULL;
+        decoder->sample_pool_16 = NULL;
+        return V2F_E_NONE;
+    }
+    RETURN_IF_FAIL(v2f_entropy_coder_destroy(coder));
+    RETURN_IF_FAIL(v2f_entropy_decoder_destroy(decoder));
+
+    // All roots, entries and samples of the forest are in its arena
+    v2f_file_arena_free(decoder->forest_arena);
+    decoder->forest_arena = NULL;
+    coder->roots = NULL;
+    decoder->roots = NULL;
+
+    return V2F_E_NONE;
+}
+
+/// Identifies forest cache files. It is changed whenever their layout changes.
+#define V2F_FILE_FOREST_CACHE_MAGIC "V2FCACH1"
+
+/// Stored natively in forest caches, so that caches with a different byte order are rejected
+#define V2F_FILE_FOREST_CACHE_BYTE_ORDER UINT32_C(0x01020304)
+
+/// Alignment in bytes of each table within a forest cache
+#define V2F_FILE_FOREST_CACHE_ALIGNMENT 64
+
+/**
+ * @struct v2f_file_forest_cache_header_t
+ *
+ * Start of a forest cache file. All tables follow it in the order of
+ * their offsets, each aligned to @ref V2F_FILE_FOREST_CACHE_ALIGNMENT bytes.
+ */
+typedef struct {
+    /// @ref V2F_FILE_FOREST_CACHE_MAGIC, without the terminating null character.
+    char magic[8];
+    /// @ref V2F_FILE_FOREST_CACHE_BYTE_ORDER, as stored by the machine that wrote the cache.
+    uint32_t byte_order;
+    /// Size of v2f_entropy_coder_state_t when the cache was written.
+    uint32_t state_size;
+    /// Size of v2f_entropy_decoder_word_t when the cache was written.
+    uint32_t word_size;
+    /// Maximum expected sample value of the coder.
+    uint32_t max_expected_value;
+    /// Hash of the codec file that defines the forest (see v2f_file_hash_contents()).
+    uint64_t content_hash;
+    /// Total size of the cache file in bytes.
+    uint64_t file_size;
+    /// Number of bytes per word of the coder and decoder.
+    uint32_t bytes_per_word;
+    /// Number of bytes per sample of the decoder.
+    uint32_t bytes_per_sample;
+    /// Number of states of the coder.
+    uint64_t state_count;
+    /// Number of transitions of the coder.
+    uint64_t transition_count;
+    /// Number of words of the decoder.
+    uint64_t word_count;
+    /// Number of samples in the sample pool of the decoder.
+    uint64_t sample_pool_size;
+    /// Position in the word table of the word 0 of the decoder's first root.
+    uint64_t first_word;
+    /// Number of valid words of the decoder's first root.
+    uint64_t first_included_count;
+    /// Position in the file of the coder's states.
+    uint64_t states_offset;
+    /// Position in the file of the coder's transitions.
+    uint64_t transitions_offset;
+    /// Position in the file of the coder's root transition offsets.
+    uint64_t root_transition_offsets_offset;
+    /// Position in the file of the decoder's words.
+    uint64_t words_offset;
+    /// Position in the file of the decoder's sample pool.
+    uint64_t sample_pool_offset;
+    /// Position in the file of the decoder's 16-bit sample pool, or 0 if not present.
+    uint64_t sample_pool_16_offset;
+} v2f_file_forest_cache_header_t;
+
+/**
+ * Round a position in a forest cache up to the alignment of its tables.
+ *
+ * @param position position in bytes
+ *
+ * @return the aligned position
+ */
+static inline uint64_t v2f_file_forest_cache_align(uint64_t position) {
+    return (position + V2F_FILE_FOREST_CACHE_ALIGNMENT - 1) & ~((uint64_t) V2F_FILE_FOREST_CACHE_ALIGNMENT - 1);
+}
+
+/**
+ * Write one table of a forest cache, preceded by the padding needed to align it.
+ *
+ * @param output file open for writing
+ * @param table table contents
+ * @param size size of the table in bytes
+ * @param position current position in the file, updated after the write
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The table was written
+ *  - @ref V2F_E_IO : Error writing to the file
+ */
+static v2f_error_t v2f_file_write_forest_cache_table(
+        FILE *output, void const *const table, uint64_t size, uint64_t *const position) {
+    static const uint8_t padding[V2F_FILE_FOREST_CACHE_ALIGNMENT] = {0};
+    const uint64_t padding_size = v2f_file_forest_cache_align(*position) - *position;
+    if (fwrite(padding, 1, padding_size, output) != padding_size
+        || fwrite(table, 1, size, output) != size) {
+        return V2F_E_IO;
+    }
+    *position += padding_size + size;
+    return V2F_E_NONE;
+}
+
+v2f_error_t v2f_file_write_forest_cache(
+        FILE *output,
+        v2f_entropy_coder_t const *const coder,
+        v2f_entropy_decoder_t const *const decoder,
+        uint64_t content_hash) {
+    if (output == NULL || coder == NULL || decoder == NULL
+        || coder->states == NULL || decoder->words == NULL
+        || coder->bytes_per_word != decoder->bytes_per_word) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    const uint64_t symbol_count = (uint64_t) coder->max_expected_value + 1;
+
+    // Place the tables
+    v2f_file_forest_cache_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, V2F_FILE_FOREST_CACHE_MAGIC, sizeof(header.magic));
+    header.byte_order = V2F_FILE_FOREST_CACHE_BYTE_ORDER;
+    header.state_size = sizeof(v2f_entropy_coder_state_t);
+    header.word_size = sizeof(v2f_entropy_decoder_word_t);
+    header.max_expected_value = coder->max_expected_value;
+    header.content_hash = content_hash;
+    header.bytes_per_word = decoder->bytes_per_word;
+    header.bytes_per_sample = decoder->bytes_per_sample;
+    header.state_count = coder->state_count;
+    header.transition_count = coder->transition_count;
+    header.word_count = decoder->word_count;
+    header.sample_pool_size = decoder->sample_pool_size;
+    header.first_word = decoder->initial_state.first_word;
+    header.first_included_count = decoder->initial_state.included_count;
+
+    uint64_t position = sizeof(header);
+    header.states_offset = v2f_file_forest_cache_align(position);
+    position = header.states_offset + sizeof(v2f_entropy_coder_state_t) * coder->state_count;
+    header.transitions_offset = v2f_file_forest_cache_align(position);
+    position = header.transitions_offset + sizeof(uint32_t) * coder->transition_count;
+    header.root_transition_offsets_offset = v2f_file_forest_cache_align(position);
+    position = header.root_transition_offsets_offset + sizeof(uint64_t) * (symbol_count + 1);
+    header.words_offset = v2f_file_forest_cache_align(position);
+    position = header.words_offset + sizeof(v2f_entropy_decoder_word_t) * decoder->word_count;
+    header.sample_pool_offset = v2f_file_forest_cache_align(position);
+    position = header.sample_pool_offset + sizeof(v2f_sample_t) * decoder->sample_pool_size;
+    if (decoder->sample_pool_16 != NULL) {
+        header.sample_pool_16_offset = v2f_file_forest_cache_align(position);
+        position = header.sample_pool_16_offset + sizeof(v2f_sample16_t) * decoder->sample_pool_size;
+    }
+    header.file_size = position;
+
+    // Write them
+    position = 0;
+    RETURN_IF_FAIL(v2f_file_write_forest_cache_table(output, &header, sizeof(header), &position));
+    RETURN_IF_FAIL(v2f_file_write_forest_cache_table(
+            output, coder->states, sizeof(v2f_entropy_coder_state_t) * coder->state_count, &position));
+    RETURN_IF_FAIL(v2f_file_write_forest_cache_table(
+            output, coder->transitions, sizeof(uint32_t) * coder->transition_count, &position));
+    RETURN_IF_FAIL(v2f_file_write_forest_cache_table(
+            output, coder->root_transition_offsets, sizeof(uint64_t) * (symbol_count + 1), &position));
+    RETURN_IF_FAIL(v2f_file_write_forest_cache_table(
+            output, decoder->words, sizeof(v2f_entropy_decoder_word_t) * decoder->word_count, &position));
+    RETURN_IF_FAIL(v2f_file_write_forest_cache_table(
+            output, decoder->sample_pool, sizeof(v2f_sample_t) * decoder->sample_pool_size, &position));
+    if (decoder->sample_pool_16 != NULL) {
+        RETURN_IF_FAIL(v2f_file_write_forest_cache_table(
+                output, decoder->sample_pool_16, sizeof(v2f_sample16_t) * decoder->sample_pool_size, &position));
+    }
+    assert(position == header.file_size);
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Check that a table of a forest cache lies within the file.
+ *
+ * @param header header of the cache
+ * @param offset position of the table in the file
+ * @param count number of elements of the table
+ * @param size size in bytes of each element
+ *
+ * @return true if and only if the table is aligned and within the file
+ */
+static bool v2f_file_forest_cache_table_fits(
+        v2f_file_forest_cache_header_t const *const header, uint64_t offset, uint64_t count, uint64_t size) {
+    return offset >= sizeof(v2f_file_forest_cache_header_t)
+           && offset % V2F_FILE_FOREST_CACHE_ALIGNMENT == 0
+           && offset <= header->file_size
+           && count <= (header->file_size - offset) / size;
+}
+
+/**
+ * Verify that the tables of a mapped forest cache are consistent, so that compressing
+ * and decompressing with them never accesses memory outside the tables.
+ *
+ * @param header header of the cache, whose tables are within the mapping
+ * @param cache mapped cache
+ *
+ * @return true if and only if the tables are consistent
+ */
+static bool v2f_file_forest_cache_tables_valid(
+        v2f_file_forest_cache_header_t const *const header, uint8_t const *const cache) {
+    const uint64_t symbol_count = (uint64_t) header->max_expected_value + 1;
+    v2f_entropy_coder_state_t const *const states =
+            (v2f_entropy_coder_state_t const *) (cache + header->states_offset);
+    uint32_t const *const transitions = (uint32_t const *) (cache + header->transitions_offset);
+    uint64_t const *const root_transition_offsets =
+            (uint64_t const *) (cache + header->root_transition_offsets_offset);
+    v2f_entropy_decoder_word_t const *const words =
+            (v2f_entropy_decoder_word_t const *) (cache + header->words_offset);
+    v2f_sample_t const *const sample_pool = (v2f_sample_t const *) (cache + header->sample_pool_offset);
+
+    // Coder: samples that do not emit a word lead to a child, and those that do lead to a root.
+    // Following the first child of full states must always end in a non-full state.
+    for (uint64_t c = 0; c <= symbol_count; c++) {
+        if (root_transition_offsets[c] > header->transition_count - symbol_count) {
+            return false;
         }
-        for (uint32_t i = 0; i < decoder->roots[r]->root_entry_count; i++) {
-            if (decoder->roots[r]->entries_by_index[i].coder_entry->children_count
-                != (coder->max_expected_value + 1)) {
-                free(decoder->roots[r]->entries_by_index[i].samples);
+    }
+    for (uint64_t t = 0; t < header->transition_count; t++) {
+        if (transitions[t] >= header->state_count) {
+            return false;
+        }
+    }
+    for (uint64_t s = 0; s < header->state_count; s++) {
+        if (states[s].children_count > symbol_count
+            || states[s].first_transition > header->transition_count - states[s].children_count) {
+            return false;
+        }
+        if (states[s].children_count == symbol_count) {
+            const uint32_t first_child = transitions[states[s].first_transition];
+            if (first_child <= s && (first_child != 0 || s == 0)) {
+                return false;
             }
+        }
+    }
 
-            free(decoder->roots[r]->entries_by_index[i].coder_entry->word_bytes);
-            if (decoder->roots[r]->entries_by_index[i].coder_entry->children_count >
-                0) {
-                free(decoder->roots[r]->entries_by_index[i].coder_entry->children_entries);
-            } else if (!null_children_deleted) {
-                free(decoder->roots[r]->entries_by_index[i].coder_entry->children_entries[0]->children_entries);
-                free(decoder->roots[r]->entries_by_index[i].coder_entry->children_entries[0]);
-                free(decoder->roots[r]->entries_by_index[i].coder_entry->children_entries);
-                null_children_deleted = true;
+    // Decoder: words produce samples from the pool and lead to existing words
+    // Sums are compared as differences so that huge values cannot wrap around.
+    if (header->word_count < 1 || words[0].next_first_word != 0 || words[0].next_included_count != 0
+        || header->first_word == 0 || header->first_word >= header->word_count
+        || header->first_included_count > UINT32_MAX
+        || header->first_included_count >= header->word_count - header->first_word) {
+        return false;
+    }
+    for (uint64_t w = 0; w < header->word_count; w++) {
+        if (words[w].sample_offset > header->sample_pool_size
+            || words[w].sample_count > header->sample_pool_size - words[w].sample_offset
+            || words[w].next_first_word >= header->word_count
+            || words[w].next_included_count >= header->word_count - words[w].next_first_word) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < header->sample_pool_size; i++) {
+        if (sample_pool[i] > header->max_expected_value) {
+            return false;
+        }
+    }
+    if (header->sample_pool_16_offset != 0) {
+        v2f_sample16_t const *const sample_pool_16 =
+                (v2f_sample16_t const *) (cache + header->sample_pool_16_offset);
+        for (uint64_t i = 0; i < header->sample_pool_size; i++) {
+            if (sample_pool_16[i] != sample_pool[i]) {
+                return false;
             }
-            free(decoder->roots[r]->entries_by_index[i].coder_entry);
         }
-        assert(coder->roots[r]->children_count > 0);
-        free(coder->roots[r]->children_entries);
-        free(decoder->roots[r]->entries_by_index);
-        free(decoder->roots[r]->entries_by_word);
-        free(decoder->roots[r]);
-        free(coder->roots[r]);
-        last_root = decoder->roots[r];
     }
-    free(coder->roots);
-    free(decoder->roots);
 
+    return true;
+}
+
+v2f_error_t v2f_file_map_forest_cache(
+        char const *const path,
+        uint64_t content_hash,
+        v2f_entropy_coder_t *const coder,
+        v2f_entropy_decoder_t *const decoder) {
+    if (path == NULL || coder == NULL || decoder == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        log_info("Cannot open forest cache %s", path);
+        return V2F_E_IO;
+    }
+    struct stat file_status;
+    if (fstat(fd, &file_status) != 0
+        || file_status.st_size < (off_t) sizeof(v2f_file_forest_cache_header_t)) {
+        log_warning("Invalid forest cache %s", path);
+        close(fd);
+        return V2F_E_CORRUPTED_DATA;
+    }
+    // The tables are validated once and then used in place, so nobody else may be able to modify them
+    if (!S_ISREG(file_status.st_mode) || file_status.st_uid != geteuid()
+        || (file_status.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+        log_warning("Forest cache %s is not private to this user", path);
+        close(fd);
+        return V2F_E_CORRUPTED_DATA;
+    }
+    const uint64_t cache_size = (uint64_t) file_status.st_size;
+    void *const cache = mmap(NULL, cache_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (cache == MAP_FAILED) {
+        log_warning("Cannot map forest cache %s", path);
+        return V2F_E_IO;
+    }
+
+    v2f_error_t status = V2F_E_CORRUPTED_DATA;
+    v2f_file_forest_cache_header_t const *const header = cache;
+    if (memcmp(header->magic, V2F_FILE_FOREST_CACHE_MAGIC, sizeof(header->magic)) != 0
+        || header->byte_order != V2F_FILE_FOREST_CACHE_BYTE_ORDER
+        || header->state_size != sizeof(v2f_entropy_coder_state_t)
+        || header->word_size != sizeof(v2f_entropy_decoder_word_t)
+        || header->file_size != cache_size) {
+        log_warning("Forest cache %s was not written by this version", path);
+        goto cleanup;
+    }
+    if (header->content_hash != content_hash) {
+        log_info("Forest cache %s is stale", path);
+        goto cleanup;
+    }
+    const uint64_t symbol_count = (uint64_t) header->max_expected_value + 1;
+    if (header->max_expected_value < 1 || header->max_expected_value > V2F_C_MAX_SAMPLE_VALUE
+        || header->bytes_per_word < V2F_C_MIN_BYTES_PER_WORD
+        || header->bytes_per_word > V2F_C_MAX_BYTES_PER_WORD
+        || header->bytes_per_sample < V2F_C_MIN_BYTES_PER_SAMPLE
+        || header->bytes_per_sample > V2F_C_MAX_BYTES_PER_SAMPLE
+        || header->state_count < 1 || header->state_count > V2F_C_MAX_ENTRY_COUNT
+        || header->transition_count < symbol_count
+        || !v2f_file_forest_cache_table_fits(
+                header, header->states_offset, header->state_count, sizeof(v2f_entropy_coder_state_t))
+        || !v2f_file_forest_cache_table_fits(
+                header, header->transitions_offset, header->transition_count, sizeof(uint32_t))
+        || !v2f_file_forest_cache_table_fits(
+                header, header->root_transition_offsets_offset, symbol_count + 1, sizeof(uint64_t))
+        || !v2f_file_forest_cache_table_fits(
+                header, header->words_offset, header->word_count, sizeof(v2f_entropy_decoder_word_t))
+        || !v2f_file_forest_cache_table_fits(
+                header, header->sample_pool_offset, header->sample_pool_size, sizeof(v2f_sample_t))
+        || (header->sample_pool_16_offset != 0 && !v2f_file_forest_cache_table_fits(
+                header, header->sample_pool_16_offset, header->sample_pool_size, sizeof(v2f_sample16_t)))
+        || !v2f_file_forest_cache_tables_valid(header, cache)) {
+        log_warning("Corrupted forest cache %s", path);
+        goto cleanup;
+    }
+
+    // The tables are used where they are mapped. The forest structure is not available.
+    uint8_t *const tables = cache;
+    coder->bytes_per_word = (uint8_t) header->bytes_per_word;
+    coder->max_expected_value = header->max_expected_value;
+    coder->roots = NULL;
+    coder->root_count = (uint32_t) symbol_count;
+    coder->states = (v2f_entropy_coder_state_t *) (tables + header->states_offset);
+    coder->state_count = (uint32_t) header->state_count;
+    coder->transitions = (uint32_t *) (tables + header->transitions_offset);
+    coder->transition_count = header->transition_count;
+    coder->root_transition_offsets = (uint64_t *) (tables + header->root_transition_offsets_offset);
+
+    decoder->bytes_per_word = (uint8_t) header->bytes_per_word;
+    decoder->bytes_per_sample = (uint8_t) header->bytes_per_sample;
+    decoder->roots = NULL;
+    decoder->root_count = (uint32_t) symbol_count;
+    decoder->null_entry = NULL;
+    decoder->forest_arena = NULL;
+    decoder->sample_pool = (v2f_sample_t *) (tables + header->sample_pool_offset);
+    decoder->sample_pool_16 = header->sample_pool_16_offset != 0 ?
+                              (v2f_sample16_t *) (tables + header->sample_pool_16_offset) : NULL;
+    decoder->sample_pool_size = header->sample_pool_size;
+    decoder->words = (v2f_entropy_decoder_word_t *) (tables + header->words_offset);
+    decoder->word_count = header->word_count;
+    decoder->initial_state.first_word = header->first_word;
+    decoder->initial_state.included_count = (uint32_t) header->first_included_count;
+    decoder->forest_cache = cache;
+    decoder->forest_cache_size = cache_size;
+    decoder->forest_id = 0;
+
+    log_debug("Mapped forest cache %s (%lu bytes)", path, cache_size);
+    return V2F_E_NONE;
+
+    cleanup:
+    munmap(cache, cache_size);
+    return status;
+}
+
+v2f_error_t v2f_file_hash_contents(FILE *input, uint64_t *const content_hash) {
+    if (input == NULL || content_hash == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    const off_t initial_position = ftello(input);
+    if (initial_position < 0 || fseeko(input, 0, SEEK_SET) != 0) {
+        return V2F_E_IO;
+    }
+
+    // 64-bit FNV-1a
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    uint8_t buffer[4096];
+    size_t read_size;
+    while ((read_size = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+        for (size_t i = 0; i < read_size; i++) {
+            hash = (hash ^ buffer[i]) * UINT64_C(0x100000001b3);
+        }
+    }
+    if (ferror(input) || fseeko(input, initial_position, SEEK_SET) != 0) {
+        return V2F_E_IO;
+    }
+
+    *content_hash = hash;
     return V2F_E_NONE;
 }
 
@@ -1047,59 +1578,147 @@ v2f_error_t v2f_verify_forest(
     return V2F_E_NONE;
 }
 
-v2f_error_t v2f_file_read_big_endian(
-        FILE *input_file,
-        v2f_sample_t *sample_buffer,
-        uint64_t max_sample_count,
+void v2f_file_unpack_big_endian(
+        uint8_t const *const bytes,
+        uint64_t sample_count,
         uint8_t bytes_per_sample,
-        uint64_t *read_sample_count) {
-    // Parameter sanitization
-    if (sample_buffer == NULL
-        || max_sample_count == 0
-        || bytes_per_sample < 1
-        || bytes_per_sample > 4
-        || max_sample_count > V2F_C_MAX_BLOCK_SIZE) {
-        return V2F_E_INVALID_PARAMETER;
+        v2f_sample_t *const sample_buffer,
+        v2f_sample16_t *const sample_buffer_16) {
+    // The 1 and 2 byte cases are written as plain loops so that they can be vectorized.
+    if (sample_buffer_16 != NULL) {
+        if (bytes_per_sample == 1) {
+            for (uint64_t i = 0; i < sample_count; i++) {
+                sample_buffer_16[i] = bytes[i];
+            }
+        } else {
+            for (uint64_t i = 0; i < sample_count; i++) {
+                sample_buffer_16[i] = (v2f_sample16_t) ((bytes[2 * i] << 8) | bytes[2 * i + 1]);
+            }
+        }
+        return;
     }
 
-    // Keep track of the number of read samples, whether the user
-    // requests its value back or not
-    uint64_t _read_sample_count;
-    if (read_sample_count == NULL) {
-        read_sample_count = &_read_sample_count;
+    switch (bytes_per_sample) {
+        case 1:
+            for (uint64_t i = 0; i < sample_count; i++) {
+                sample_buffer[i] = bytes[i];
+            }
+            break;
+        case 2:
+            for (uint64_t i = 0; i < sample_count; i++) {
+                sample_buffer[i] = ((v2f_sample_t) bytes[2 * i] << 8) | bytes[2 * i + 1];
+            }
+            break;
+        default:
+            for (uint64_t i = 0; i < sample_count; i++) {
+                sample_buffer[i] = v2f_entropy_coder_buffer_to_sample(
+                        bytes + bytes_per_sample * i, bytes_per_sample);
+            }
+            break;
     }
-    *read_sample_count = 0;
+}
 
-    // Read bytes onto the data buffer
-    uint8_t *const data_buffer = (uint8_t *) sample_buffer;
-    size_t read_bytes = fread(
-            data_buffer,
-            1,
-            bytes_per_sample * max_sample_count,
-            input_file);
-    if (ferror(input_file) && !feof(input_file)) {
-        return V2F_E_IO;
-    }
-    if (read_bytes % bytes_per_sample != 0) {
-        return V2F_E_IO;
+void v2f_file_pack_big_endian(
+        v2f_sample_t const *const sample_buffer,
+        v2f_sample16_t const *const sample_buffer_16,
+        uint64_t sample_count,
+        uint8_t bytes_per_sample,
+        uint8_t *const bytes) {
+    // The 1 and 2 byte cases are written as plain loops so that they can be vectorized.
+    if (sample_buffer_16 != NULL) {
+        if (bytes_per_sample == 1) {
+            for (uint64_t i = 0; i < sample_count; i++) {
+                bytes[i] = (uint8_t) sample_buffer_16[i];
+            }
+        } else {
+            for (uint64_t i = 0; i < sample_count; i++) {
+                bytes[2 * i] = (uint8_t) (sample_buffer_16[i] >> 8);
+                bytes[2 * i + 1] = (uint8_t) sample_buffer_16[i];
+            }
+        }
+        return;
     }
 
-    // Transform the read bytes into v2f_sample_t values assuming big endian.
-    *read_sample_count = read_bytes / bytes_per_sample;
-    for (uint64_t i = 0; i < *read_sample_count; i++) {
-
-
-        v2f_sample_t *const next_sample =
-                &(sample_buffer[*read_sample_count - i - 1]);
-        uint8_t const *const next_data_buffer =
-                &(data_buffer[(*read_sample_count - i - 1) *
-                              bytes_per_sample]);
-        *next_sample = v2f_entropy_coder_buffer_to_sample(
-                next_data_buffer, bytes_per_sample);
-
-        if (_LOG_LEVEL >= LOG_DEBUG_LEVEL + 1) {
-            log_debug("*READ next_sample = %u", *next_sample);
-        }
+    switch (bytes_per_sample) {
+        case 1:
+            for (uint64_t i = 0; i < sample_count; i++) {
+                bytes[i] = (uint8_t) sample_buffer[i];
+            }
+            break;
+        case 2:
+            for (uint64_t i = 0; i < sample_count; i++) {
+                bytes[2 * i] = (uint8_t) (sample_buffer[i] >> 8);
+                bytes[2 * i + 1] = (uint8_t) sample_buffer[i];
+            }
+            break;
+        default:
+            for (uint64_t i = 0; i < sample_count; i++) {
+                v2f_entropy_coder_sample_to_buffer(
+                        sample_buffer[i], bytes + bytes_per_sample * i, bytes_per_sample);
+            }
+            break;
+    }
+}
+
+/**
+ * Read big-endian samples either as v2f_sample_t or as v2f_sample16_t values.
+ * See v2f_file_read_big_endian() for details.
+ *
+ * @param input_file file to read from
+ * @param sample_buffer v2f_sample_t output buffer, or NULL if `sample_buffer_16` is used
+ * @param sample_buffer_16 v2f_sample16_t output buffer, or NULL if `sample_buffer` is used.
+ *   In that case, bytes_per_sample must be at most 2.
+ * @param max_sample_count maximum number of samples to read
+ * @param bytes_per_sample number of bytes per sample
+ * @param read_sample_count the number of read samples is stored here
+ *
+ * @return
+ *  - @ref V2F_E_NONE : max_sample_count samples were read
+ *  - @ref V2F_E_UNEXPECTED_END_OF_FILE : fewer samples were available
+ *  - @ref V2F_E_IO : read error, or EOF not aligned with bytes_per_sample
+ */
+static v2f_error_t v2f_file_read_big_endian_samples(
+        FILE *input_file,
+        v2f_sample_t *sample_buffer,
+        v2f_sample16_t *sample_buffer_16,
+        uint64_t max_sample_count,
+        uint8_t bytes_per_sample,
+        uint64_t *read_sample_count) {
+    *read_sample_count = 0;
+
+    // Read bytes in chunks onto a byte buffer, and widen them into samples
+    // assuming big endian.
+    uint8_t data_buffer[V2F_FILE_IO_CHUNK_SAMPLE_COUNT * 4];
+    uint64_t read_bytes = 0;
+    while (*read_sample_count < max_sample_count) {
+        const uint64_t remaining_count = max_sample_count - *read_sample_count;
+        const size_t chunk_count = (size_t) (remaining_count < V2F_FILE_IO_CHUNK_SAMPLE_COUNT ?
+                                             remaining_count : V2F_FILE_IO_CHUNK_SAMPLE_COUNT);
+        const size_t chunk_bytes = fread(data_buffer, 1, bytes_per_sample * chunk_count, input_file);
+        if (ferror(input_file) && !feof(input_file)) {
+            return V2F_E_IO;
+        }
+        read_bytes += chunk_bytes;
+        if (read_bytes % bytes_per_sample != 0) {
+            return V2F_E_IO;
+        }
+
+        const size_t chunk_sample_count = chunk_bytes / bytes_per_sample;
+        v2f_file_unpack_big_endian(
+                data_buffer, chunk_sample_count, bytes_per_sample,
+                sample_buffer == NULL ? NULL : sample_buffer + *read_sample_count,
+                sample_buffer_16 == NULL ? NULL : sample_buffer_16 + *read_sample_count);
+        if (_LOG_LEVEL >= LOG_DEBUG_LEVEL + 1) {
+            for (size_t i = 0; i < chunk_sample_count; i++) {
+                log_debug("*READ next_sample = %u", v2f_entropy_coder_buffer_to_sample(
+                        data_buffer + bytes_per_sample * i, bytes_per_sample));
+            }
+        }
+
+        *read_sample_count += chunk_sample_count;
+        if (chunk_sample_count < chunk_count) {
+            break;
+        }
     }
 
     // Since max_sample_count must be greater than zero, an empty count
@@ -1108,30 +1727,1361 @@ v2f_error_t v2f_file_read_big_endian(
            V2F_E_NONE : V2F_E_UNEXPECTED_END_OF_FILE;
 }
 
-v2f_error_t v2f_file_write_big_endian(
-        FILE *output_file,
-        v2f_sample_t *const sample_buffer,
-        uint64_t sample_count,
-        uint8_t bytes_per_sample) {
+v2f_error_t v2f_file_read_big_endian(
+        FILE *input_file,
+        v2f_sample_t *sample_buffer,
+        uint64_t max_sample_count,
+        uint8_t bytes_per_sample,
+        uint64_t *read_sample_count) {
+    // Parameter sanitization
+    if (sample_buffer == NULL
+        || max_sample_count == 0
+        || bytes_per_sample < 1
+        || bytes_per_sample > 4
+        || max_sample_count > V2F_C_MAX_BLOCK_SIZE) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    // Keep track of the number of read samples, whether the user
+    // requests its value back or not
+    uint64_t _read_sample_count;
+    if (read_sample_count == NULL) {
+        read_sample_count = &_read_sample_count;
+    }
+
+    return v2f_file_read_big_endian_samples(
+            input_file, sample_buffer, NULL, max_sample_count, bytes_per_sample, read_sample_count);
+}
+
+v2f_error_t v2f_file_read_big_endian_16(
+        FILE *input_file,
+        v2f_sample16_t *sample_buffer,
+        uint64_t max_sample_count,
+        uint8_t bytes_per_sample,
+        uint64_t *read_sample_count) {
+    if (sample_buffer == NULL
+        || max_sample_count == 0
+        || bytes_per_sample < 1
+        || bytes_per_sample > 2
+        || max_sample_count > V2F_C_MAX_BLOCK_SIZE) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    uint64_t _read_sample_count;
+    if (read_sample_count == NULL) {
+        read_sample_count = &_read_sample_count;
+    }
+
+    return v2f_file_read_big_endian_samples(
+            input_file, NULL, sample_buffer, max_sample_count, bytes_per_sample, read_sample_count);
+}
+
+/**
+ * Write big-endian samples stored either as v2f_sample_t or as v2f_sample16_t values.
+ * See v2f_file_write_big_endian() for details.
+ *
+ * @param output_file file to write to
+ * @param sample_buffer v2f_sample_t samples, or NULL if `sample_buffer_16` is used
+ * @param sample_buffer_16 v2f_sample16_t samples, or NULL if `sample_buffer` is used.
+ *   In that case, bytes_per_sample must be at most 2.
+ * @param sample_count number of samples to write
+ * @param bytes_per_sample number of bytes per output sample
+ *
+ * @return
+ *  - @ref V2F_E_NONE : all samples were written
+ *  - @ref V2F_E_IO : write error
+ */
+static v2f_error_t v2f_file_write_big_endian_samples(
+        FILE *output_file,
+        v2f_sample_t const *const sample_buffer,
+        v2f_sample16_t const *const sample_buffer_16,
+        uint64_t sample_count,
+        uint8_t bytes_per_sample) {
+    // Samples are serialized in chunks, and each chunk is output with a single fwrite call.
+    uint8_t output_buffer[V2F_FILE_IO_CHUNK_SAMPLE_COUNT * 4];
+    for (uint64_t chunk_start = 0; chunk_start < sample_count;
+         chunk_start += V2F_FILE_IO_CHUNK_SAMPLE_COUNT) {
+        const uint64_t remaining_count = sample_count - chunk_start;
+        const size_t chunk_count = (size_t) (remaining_count < V2F_FILE_IO_CHUNK_SAMPLE_COUNT ?
+                                             remaining_count : V2F_FILE_IO_CHUNK_SAMPLE_COUNT);
+
+        v2f_file_pack_big_endian(
+                sample_buffer == NULL ? NULL : sample_buffer + chunk_start,
+                sample_buffer_16 == NULL ? NULL : sample_buffer_16 + chunk_start,
+                chunk_count, bytes_per_sample, output_buffer);
+
+        if (fwrite(output_buffer, bytes_per_sample, chunk_count, output_file) != chunk_count) {
+            log_error(
+                    "v2f_file_write_big_endian: [i=%lu] fwrite error %d (feof %d)",
+                    chunk_start,
+                    ferror(output_file),
+                    feof(output_file));
+            return V2F_E_IO;
+        }
+    }
+    return V2F_E_NONE;
+}
+
+v2f_error_t v2f_file_write_big_endian(
+        FILE *output_file,
+        v2f_sample_t *const sample_buffer,
+        uint64_t sample_count,
+        uint8_t bytes_per_sample) {
+    if (output_file == NULL
+        || (sample_buffer == NULL && sample_count > 0)
+        || bytes_per_sample < 1
+        || bytes_per_sample > 4) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    return v2f_file_write_big_endian_samples(
+            output_file, sample_buffer, NULL, sample_count, bytes_per_sample);
+}
+
+v2f_error_t v2f_file_write_big_endian_16(
+        FILE *output_file,
+        v2f_sample16_t const *const sample_buffer,
+        uint64_t sample_count,
+        uint8_t bytes_per_sample) {
+    if (output_file == NULL
+        || (sample_buffer == NULL && sample_count > 0)
+        || bytes_per_sample < 1
+        || bytes_per_sample > 2) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    return v2f_file_write_big_endian_samples(
+            output_file, NULL, sample_buffer, sample_count, bytes_per_sample);
+}
+
+/**
+ * @struct v2f_file_mapping_t
+ *
+ * File mapped in memory by v2f_file_map_input() or v2f_file_map_output().
+ */
+typedef struct {
+    /// First byte of the file.
+    uint8_t *data;
+    /// Number of mapped bytes, from the beginning of the file.
+    uint64_t size;
+    /// Position of the next byte to be read or written.
+    uint64_t position;
+} v2f_file_mapping_t;
+
+/**
+ * Map the contents of a regular file open for reading, so that they can be
+ * read in place from its current position.
+ *
+ * @param file file to be mapped
+ * @param mapping mapping to be initialized
+ *
+ * @return true if the file was mapped, or false if it cannot be mapped
+ *   (e.g., it is not a regular file or it is empty)
+ */
+static bool v2f_file_map_input(FILE *file, v2f_file_mapping_t *const mapping) {
+    const int fd = fileno(file);
+    struct stat file_status;
+    const off_t position = ftello(file);
+    if (fd < 0 || position < 0 || fstat(fd, &file_status) != 0 || !S_ISREG(file_status.st_mode)
+        || file_status.st_size <= position) {
+        return false;
+    }
+    mapping->size = (uint64_t) file_status.st_size;
+    mapping->position = (uint64_t) position;
+    void *const data = mmap(NULL, mapping->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        return false; // LCOV_EXCL_LINE
+    }
+    mapping->data = (uint8_t *) data;
+    // The advice is only a hint, and the file is read correctly regardless of it
+    (void) posix_madvise(data, mapping->size, POSIX_MADV_SEQUENTIAL);
+
+    return true;
+}
+
+/**
+ * Preallocate `size` bytes of a regular file open for writing after its current position,
+ * and map them so that they can be written in place.
+ *
+ * @param file file to be mapped
+ * @param size number of bytes to be written, greater than zero
+ * @param mapping mapping to be initialized
+ *
+ * @return true if the file was mapped, or false if it cannot be preallocated or mapped
+ */
+static bool v2f_file_map_output(FILE *file, uint64_t size, v2f_file_mapping_t *const mapping) {
+    const int fd = fileno(file);
+    struct stat file_status;
+    if (fflush(file) != 0 || fd < 0 || fstat(fd, &file_status) != 0 || !S_ISREG(file_status.st_mode)) {
+        return false;
+    }
+    const off_t position = ftello(file);
+    if (position < 0 || posix_fallocate(fd, position, (off_t) size) != 0) {
+        return false;
+    }
+    mapping->size = (uint64_t) position + size;
+    mapping->position = (uint64_t) position;
+    void *const data = mmap(NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        // LCOV_EXCL_START
+        if (ftruncate(fd, position) != 0) {
+            log_warning("Cannot remove the preallocated space");
+        }
+        return false;
+        // LCOV_EXCL_STOP
+    }
+    mapping->data = (uint8_t *) data;
+
+    return true;
+}
+
+/**
+ * Unmap a file mapped with v2f_file_map_input() or v2f_file_map_output(),
+ * and move the file position after the last byte read or written.
+ *
+ * @param file mapped file
+ * @param mapping mapping of `file`
+ * @param is_output if true, the file was mapped with v2f_file_map_output(), and it is truncated
+ *   after the last written byte (so that no preallocated space remains if not all of it was written)
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the file was unmapped
+ *  - @ref V2F_E_IO : the file could not be truncated or repositioned
+ */
+static v2f_error_t v2f_file_unmap(FILE *file, v2f_file_mapping_t const *const mapping, bool is_output) {
+    munmap(mapping->data, mapping->size);
+    if (is_output && mapping->position < mapping->size
+        && ftruncate(fileno(file), (off_t) mapping->position) != 0) {
+        log_error("Cannot truncate the output file"); // LCOV_EXCL_LINE
+        return V2F_E_IO; // LCOV_EXCL_LINE
+    }
+    if (fseeko(file, (off_t) mapping->position, SEEK_SET) != 0) {
+        log_error("Cannot reposition the mapped file"); // LCOV_EXCL_LINE
+        return V2F_E_IO; // LCOV_EXCL_LINE
+    }
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Read big-endian samples in place from a mapped file, with the same results
+ * as v2f_file_read_big_endian() and v2f_file_read_big_endian_16().
+ *
+ * @param mapping mapping from whose position samples are read, which is advanced past them
+ * @param sample_buffer buffer for up to `max_sample_count` samples, or NULL if `sample_buffer_16` is used
+ * @param sample_buffer_16 buffer for up to `max_sample_count` samples, or NULL if `sample_buffer` is used
+ * @param max_sample_count maximum number of samples to be read, greater than zero
+ * @param bytes_per_sample number of bytes per sample
+ * @param read_sample_count number of samples actually read
+ *
+ * @return
+ *  - @ref V2F_E_NONE : `max_sample_count` samples were read
+ *  - @ref V2F_E_UNEXPECTED_END_OF_FILE : fewer samples were available
+ *  - @ref V2F_E_IO : the file ends in the middle of a sample
+ */
+static v2f_error_t v2f_file_read_mapped_big_endian(
+        v2f_file_mapping_t *const mapping,
+        v2f_sample_t *sample_buffer,
+        v2f_sample16_t *sample_buffer_16,
+        uint64_t max_sample_count,
+        uint8_t bytes_per_sample,
+        uint64_t *const read_sample_count) {
+    const uint64_t available_bytes = mapping->size - mapping->position;
+    *read_sample_count = available_bytes / bytes_per_sample < max_sample_count ?
+                         available_bytes / bytes_per_sample : max_sample_count;
+    if (*read_sample_count < max_sample_count && available_bytes % bytes_per_sample != 0) {
+        return V2F_E_IO;
+    }
+    v2f_file_unpack_big_endian(
+            mapping->data + mapping->position, *read_sample_count, bytes_per_sample,
+            sample_buffer, sample_buffer_16);
+    mapping->position += *read_sample_count * bytes_per_sample;
+
+    return *read_sample_count == max_sample_count ?
+           V2F_E_NONE : V2F_E_UNEXPECTED_END_OF_FILE;
+}
+
+/**
+ * @struct v2f_file_block_slot_t
+ *
+ * One block in flight in v2f_file_compress_from_file() or
+ * v2f_file_decompress_from_file(). Slots are reused cyclically:
+ * block number i is always held in slot i % slot_count.
+ */
+typedef struct {
+    /**
+     * Buffer for up to V2F_C_MAX_BLOCK_SIZE samples: the raw samples (modified in place)
+     * when compressing, or the reconstructed samples when decompressing.
+     * NULL if `samples_16` is used instead.
+     */
+    v2f_sample_t *samples;
+    /// Buffer used instead of `samples` when samples have at most 2 bytes, or NULL otherwise.
+    v2f_sample16_t *samples_16;
+    /// Buffer for the compressed bitstream in the worst case (one word per sample).
+    uint8_t *bitstream;
+    /**
+     * If not NULL, compressed bitstream of the block in place in a mapped compressed file,
+     * decompressed instead of `bitstream`.
+     */
+    uint8_t const *mapped_bitstream;
+    /// Number of samples in the block.
+    uint64_t sample_count;
+    /// Position of the first sample of the block among all samples of the file (only set when decompressing).
+    uint64_t first_sample;
+    /// Number of bytes in the compressed bitstream.
+    uint64_t bitstream_size;
+    /// Shadow blocks are not compressed, have an empty bitstream and are reconstructed as zeros.
+    bool is_shadow;
+    /// Set once the block has been processed.
+    bool is_done;
+    /// Result of processing the block.
+    v2f_error_t status;
+} v2f_file_block_slot_t;
+
+/**
+ * Function that reads the next block into a slot.
+ *
+ * @param source state of the reader, as passed to v2f_file_block_pool_create()
+ * @param slot free slot where the block is stored
+ * @param has_block set to true if a block was read into `slot`, or to false if no blocks remain
+ *
+ * @return
+ *  - @ref V2F_E_NONE : a block was read, or no blocks remain
+ *  - Any error produced while reading the block
+ */
+typedef v2f_error_t (*v2f_file_block_read_function_t)(
+        void *source, v2f_file_block_slot_t *const slot, bool *const has_block);
+
+/**
+ * Function that processes (compresses or decompresses) the block in a slot
+ * and stores the result in it.
+ *
+ * @param codec compressor or decompressor to be used
+ * @param slot slot with the block to be processed
+ */
+typedef void (*v2f_file_block_function_t)(void *codec, v2f_file_block_slot_t *const slot);
+
+/**
+ * @struct v2f_file_block_pool_t
+ *
+ * Pipeline that reads, compresses or decompresses, and writes blocks in
+ * v2f_file_compress_from_file() and v2f_file_decompress_from_file().
+ *
+ * When pipelined, a reader thread fills free slots in input order, worker threads
+ * process them, and the caller writes them in input order and releases them
+ * (see v2f_file_block_pool_next() and v2f_file_block_pool_release()),
+ * so that reading, coding and writing overlap. Slots move through three bounded
+ * single-producer/single-consumer stages of the same ring:
+ * free (written by the caller, consumed by the reader), submitted (consumed by the workers)
+ * and processed (consumed by the caller). The codec is shared (read-only) by all workers.
+ *
+ * Otherwise, each block is read and processed by the caller when requested.
+ */
+typedef struct {
+    /// Function that reads each block.
+    v2f_file_block_read_function_t read_block;
+    /// State passed to `read_block`. Only used by the reader thread while it runs.
+    void *source;
+    /// Function applied to each submitted block.
+    v2f_file_block_function_t process_block;
+    /// Compressor or decompressor shared by all workers.
+    void *codec;
+    /// Ring of `slot_count` block slots.
+    v2f_file_block_slot_t *slots;
+    /// Number of slots in the ring.
+    uint32_t slot_count;
+    /// Number of running worker threads. If 0, blocks are read and processed by the caller.
+    uint32_t thread_count;
+    /// Worker thread identifiers.
+    pthread_t *threads;
+    /// Reader thread identifier, only valid if `thread_count` is not 0.
+    pthread_t reader_thread;
+    /// If not NULL, the buffers of the only slot are borrowed from this workspace and not freed with the pool.
+    v2f_file_workspace_t *workspace;
+
+    /// Number of blocks submitted so far.
+    uint64_t submitted_count;
+    /// Number of submitted blocks already claimed by a worker.
+    uint64_t claimed_count;
+    /// Number of blocks released by the caller, whose slots can be read into again.
+    uint64_t released_count;
+    /// Set once no more blocks are to be submitted, either because no blocks remain or because reading failed.
+    bool input_done;
+    /// Result of the last call to `read_block`.
+    v2f_error_t read_status;
+    /// Set when the reader must stop reading.
+    bool abort_reading;
+    /// Set when the workers must stop once all submitted blocks are processed.
+    bool shutdown;
+
+    /// Protects all members above and the `is_done` field of the slots.
+    pthread_mutex_t mutex;
+    /// Signaled when a block is submitted or when shutdown is requested.
+    pthread_cond_t block_submitted;
+    /// Signaled when a block has been processed, or when input is done.
+    pthread_cond_t block_done;
+    /// Signaled when a slot is released, or when the reader must stop.
+    pthread_cond_t slot_released;
+} v2f_file_block_pool_t;
+
+/**
+ * @struct v2f_file_block_index_entry_t
+ *
+ * Entry of the block index of a compressed file (see v2f_file_write_block_index()).
+ */
+typedef struct {
+    /// Position of the envelope of the block, relative to the first envelope of the file.
+    uint64_t offset;
+    /// Position of the first sample of the block among all samples of the file.
+    uint64_t first_sample;
+    /// Number of samples in the block.
+    uint32_t sample_count;
+} v2f_file_block_index_entry_t;
+
+/**
+ * Compress the block held in `slot`, unless it is a shadow block,
+ * and store the result in it.
+ *
+ * @param codec compressor to be used
+ * @param slot slot with the block to be compressed
+ */
+static void v2f_file_compress_slot(void *codec, v2f_file_block_slot_t *const slot) {
+    v2f_compressor_t *const compressor = (v2f_compressor_t *) codec;
+    slot->bitstream_size = 0;
+    slot->status = V2F_E_NONE;
+    if (!slot->is_shadow) {
+        if (slot->samples_16 != NULL) {
+            slot->status = v2f_compressor_compress_block_16(
+                    compressor, slot->samples_16, slot->sample_count,
+                    slot->bitstream, &(slot->bitstream_size));
+        } else {
+            slot->status = v2f_compressor_compress_block(
+                    compressor, slot->samples, slot->sample_count,
+                    slot->bitstream, &(slot->bitstream_size));
+        }
+    }
+}
+
+/**
+ * Decompress the block held in `slot`, or fill it with zeros if it is a shadow block.
+ *
+ * @param codec decompressor to be used
+ * @param slot slot with the block to be decompressed
+ */
+static void v2f_file_decompress_slot(void *codec, v2f_file_block_slot_t *const slot) {
+    v2f_decompressor_t *const decompressor = (v2f_decompressor_t *) codec;
+    slot->status = V2F_E_NONE;
+    if (slot->is_shadow) {
+        if (slot->samples_16 != NULL) {
+            memset(slot->samples_16, 0, sizeof(v2f_sample16_t) * slot->sample_count);
+        } else {
+            memset(slot->samples, 0, sizeof(v2f_sample_t) * slot->sample_count);
+        }
+        return;
+    }
+
+    // The decompressor does not modify the bitstream, which can be mapped read-only
+    uint8_t *const bitstream = slot->mapped_bitstream != NULL ?
+                               (uint8_t *) (uintptr_t) slot->mapped_bitstream : slot->bitstream;
+    uint64_t decoded_sample_count = 0;
+    if (slot->samples_16 != NULL) {
+        slot->status = v2f_decompressor_decompress_block_16(
+                decompressor, bitstream, slot->bitstream_size, slot->sample_count,
+                slot->samples_16, &decoded_sample_count);
+    } else {
+        slot->status = v2f_decompressor_decompress_block(
+                decompressor, bitstream, slot->bitstream_size, slot->sample_count,
+                slot->samples, &decoded_sample_count);
+    }
+    if (slot->status == V2F_E_NONE && decoded_sample_count != slot->sample_count) {
+        // The field and the actual number of samples shall match
+        slot->status = V2F_E_CORRUPTED_DATA;
+    }
+}
+
+/**
+ * Main function of the worker threads: process submitted blocks
+ * until shutdown is requested and no submitted block remains.
+ *
+ * @param argument pointer to the v2f_file_block_pool_t instance
+ *
+ * @return NULL
+ */
+static void *v2f_file_block_worker(void *argument) {
+    v2f_file_block_pool_t *const pool = (v2f_file_block_pool_t *) argument;
+
+    pthread_mutex_lock(&(pool->mutex));
+    while (true) {
+        while (!pool->shutdown && pool->claimed_count == pool->submitted_count) {
+            pthread_cond_wait(&(pool->block_submitted), &(pool->mutex));
+        }
+        if (pool->claimed_count == pool->submitted_count) {
+            break;
+        }
+        v2f_file_block_slot_t *const slot =
+                &(pool->slots[pool->claimed_count % pool->slot_count]);
+        pool->claimed_count++;
+        pthread_mutex_unlock(&(pool->mutex));
+
+        pool->process_block(pool->codec, slot);
+
+        pthread_mutex_lock(&(pool->mutex));
+        slot->is_done = true;
+        pthread_cond_broadcast(&(pool->block_done));
+    }
+    pthread_mutex_unlock(&(pool->mutex));
+
+    return NULL;
+}
+
+/**
+ * Main function of the reader thread: read blocks into free slots and submit them
+ * until no blocks remain, reading fails or the reader is asked to stop.
+ *
+ * @param argument pointer to the v2f_file_block_pool_t instance
+ *
+ * @return NULL
+ */
+static void *v2f_file_block_reader(void *argument) {
+    v2f_file_block_pool_t *const pool = (v2f_file_block_pool_t *) argument;
+
+    pthread_mutex_lock(&(pool->mutex));
+    while (true) {
+        while (!pool->abort_reading && pool->submitted_count - pool->released_count == pool->slot_count) {
+            pthread_cond_wait(&(pool->slot_released), &(pool->mutex));
+        }
+        if (pool->abort_reading) {
+            break;
+        }
+        v2f_file_block_slot_t *const slot =
+                &(pool->slots[pool->submitted_count % pool->slot_count]);
+        pthread_mutex_unlock(&(pool->mutex));
+
+        bool has_block = false;
+        const v2f_error_t status = pool->read_block(pool->source, slot, &has_block);
+
+        pthread_mutex_lock(&(pool->mutex));
+        if (status != V2F_E_NONE || !has_block) {
+            pool->read_status = status;
+            break;
+        }
+        slot->is_done = false;
+        pool->submitted_count++;
+        pthread_cond_signal(&(pool->block_submitted));
+    }
+    pool->input_done = true;
+    pthread_cond_broadcast(&(pool->block_done));
+    pthread_mutex_unlock(&(pool->mutex));
+
+    return NULL;
+}
+
+/**
+ * Stop the worker threads of a pool once all submitted blocks are processed.
+ *
+ * @param pool pool whose workers are stopped
+ */
+static void v2f_file_block_pool_stop_workers(v2f_file_block_pool_t *const pool) {
+    pthread_mutex_lock(&(pool->mutex));
+    pool->shutdown = true;
+    pthread_cond_broadcast(&(pool->block_submitted));
+    pthread_mutex_unlock(&(pool->mutex));
+    for (uint32_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pool->thread_count = 0;
+}
+
+/**
+ * Allocate the slots of a block pool and start its reader and worker threads.
+ *
+ * If the reader or all workers cannot be started, blocks are read and processed
+ * by the caller instead. If only some workers cannot be started, the pool runs with fewer workers.
+ *
+ * @param read_block function that reads each block
+ * @param source state passed to `read_block`
+ * @param process_block function applied to each read block
+ * @param codec compressor or decompressor passed to `process_block`
+ * @param use_16_bit if true, blocks are stored in the `samples_16` buffer of the slots
+ *   and processed with the 16-bit pipeline. Otherwise, the `samples` buffer is used.
+ * @param thread_count number of worker threads. If 0, no threads are started.
+ *   Otherwise, a reader thread is started too.
+ * @param workspace if not NULL, the pool has a single slot and no threads,
+ *   and the slot buffers are those of the workspace (allocated now if needed).
+ *   Otherwise, the slot buffers are allocated for the pool.
+ * @param pool pool to be initialized
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the pool was successfully initialized
+ *  - @ref V2F_E_OUT_OF_MEMORY : not enough memory for the block buffers
+ */
+static v2f_error_t v2f_file_block_pool_create(
+        v2f_file_block_read_function_t read_block,
+        void *source,
+        v2f_file_block_function_t process_block,
+        void *codec,
+        bool use_16_bit,
+        uint32_t thread_count,
+        v2f_file_workspace_t *const workspace,
+        v2f_file_block_pool_t *const pool) {
+    if (workspace != NULL) {
+        thread_count = 0;
+    }
+    pool->read_block = read_block;
+    pool->source = source;
+    pool->process_block = process_block;
+    pool->codec = codec;
+    // Besides the blocks in flight in the workers, one slot is being read and another one written
+    pool->slot_count = thread_count > 0 ? V2F_FILE_BLOCKS_PER_THREAD * thread_count + 2 : 1;
+    pool->thread_count = 0;
+    pool->submitted_count = 0;
+    pool->claimed_count = 0;
+    pool->released_count = 0;
+    pool->input_done = false;
+    pool->read_status = V2F_E_NONE;
+    pool->abort_reading = false;
+    pool->shutdown = false;
+    pool->threads = NULL;
+    pool->workspace = workspace;
+
+    pool->slots = (v2f_file_block_slot_t *) calloc(pool->slot_count, sizeof(v2f_file_block_slot_t));
+    if (pool->slots == NULL) {
+        return V2F_E_OUT_OF_MEMORY; // LCOV_EXCL_LINE
+    }
+    if (workspace != NULL) {
+        // The bitstream buffer is sized for any codec, so that the workspace can be shared among codecs
+        if (use_16_bit && workspace->samples_16 == NULL) {
+            workspace->samples_16 = (v2f_sample16_t *) malloc(sizeof(v2f_sample16_t) * V2F_C_MAX_BLOCK_SIZE);
+        }
+        if (!use_16_bit && workspace->samples == NULL) {
+            workspace->samples = (v2f_sample_t *) malloc(sizeof(v2f_sample_t) * V2F_C_MAX_BLOCK_SIZE);
+        }
+        if (workspace->bitstream == NULL) {
+            workspace->bitstream = (uint8_t *) malloc(V2F_C_MAX_COMPRESSED_BLOCK_SIZE);
+        }
+        pool->slots[0].samples_16 = use_16_bit ? workspace->samples_16 : NULL;
+        pool->slots[0].samples = use_16_bit ? NULL : workspace->samples;
+        pool->slots[0].bitstream = workspace->bitstream;
+        if ((pool->slots[0].samples == NULL && pool->slots[0].samples_16 == NULL)
+            || pool->slots[0].bitstream == NULL) {
+            // LCOV_EXCL_START
+            log_error("Error allocating the workspace buffers");
+            free(pool->slots);
+            return V2F_E_OUT_OF_MEMORY;
+            // LCOV_EXCL_STOP
+        }
+    }
+    for (uint32_t i = 0; i < pool->slot_count && workspace == NULL; i++) {
+        if (use_16_bit) {
+            pool->slots[i].samples_16 = (v2f_sample16_t *) malloc(
+                    sizeof(v2f_sample16_t) * V2F_C_MAX_BLOCK_SIZE);
+        } else {
+            pool->slots[i].samples = (v2f_sample_t *) malloc(
+                    sizeof(v2f_sample_t) * V2F_C_MAX_BLOCK_SIZE);
+        }
+        // Sized for the largest envelope accepted by v2f_file_read_envelope(), not only for valid ones
+        pool->slots[i].bitstream = (uint8_t *) malloc(V2F_C_MAX_COMPRESSED_BLOCK_SIZE);
+        if ((pool->slots[i].samples == NULL && pool->slots[i].samples_16 == NULL)
+            || pool->slots[i].bitstream == NULL) {
+            // LCOV_EXCL_START
+            log_error("Error allocating input or output buffers with limits %ld and %d.\n",
+                      sizeof(v2f_sample_t) * V2F_C_MAX_BLOCK_SIZE,
+                      V2F_C_MAX_COMPRESSED_BLOCK_SIZE);
+            for (uint32_t j = 0; j <= i; j++) {
+                free(pool->slots[j].samples);
+                free(pool->slots[j].samples_16);
+                free(pool->slots[j].bitstream);
+            }
+            free(pool->slots);
+            return V2F_E_OUT_OF_MEMORY;
+            // LCOV_EXCL_STOP
+        }
+    }
+
+    pthread_mutex_init(&(pool->mutex), NULL);
+    pthread_cond_init(&(pool->block_submitted), NULL);
+    pthread_cond_init(&(pool->block_done), NULL);
+    pthread_cond_init(&(pool->slot_released), NULL);
+    if (thread_count > 0) {
+        pool->threads = (pthread_t *) malloc(sizeof(pthread_t) * thread_count);
+        if (pool->threads != NULL) {
+            while (pool->thread_count < thread_count
+                   && pthread_create(&(pool->threads[pool->thread_count]), NULL,
+                                     v2f_file_block_worker, pool) == 0) {
+                pool->thread_count++;
+            }
+        }
+        if (pool->thread_count > 0
+            && pthread_create(&(pool->reader_thread), NULL, v2f_file_block_reader, pool) != 0) {
+            // LCOV_EXCL_START
+            v2f_file_block_pool_stop_workers(pool);
+            // LCOV_EXCL_STOP
+        }
+        if (pool->thread_count < thread_count) {
+            log_warning("Could only start %u out of %u worker threads",
+                        pool->thread_count, thread_count);
+        }
+    }
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Get the next block of the pool in input order, once it has been read and processed.
+ *
+ * The block must be released with v2f_file_block_pool_release() before requesting the next one.
+ *
+ * @param pool pool from which the block is obtained
+ * @param slot set to the slot of the next block, or to NULL if no more blocks remain
+ *   or reading failed
+ *
+ * @return
+ *  - @ref V2F_E_NONE : `slot` was set to the next block, or no blocks remain
+ *  - Any error produced while reading the blocks (`slot` is set to NULL)
+ */
+static v2f_error_t v2f_file_block_pool_next(
+        v2f_file_block_pool_t *const pool,
+        v2f_file_block_slot_t **const slot) {
+    *slot = NULL;
+    if (pool->thread_count == 0) {
+        if (pool->input_done) {
+            return pool->read_status;
+        }
+        v2f_file_block_slot_t *const next_slot = &(pool->slots[pool->submitted_count % pool->slot_count]);
+        bool has_block = false;
+        pool->read_status = pool->read_block(pool->source, next_slot, &has_block);
+        if (pool->read_status != V2F_E_NONE || !has_block) {
+            pool->input_done = true;
+            return pool->read_status;
+        }
+        pool->process_block(pool->codec, next_slot);
+        next_slot->is_done = true;
+        pool->submitted_count++;
+        *slot = next_slot;
+        return V2F_E_NONE;
+    }
+
+    v2f_file_block_slot_t *const next_slot = &(pool->slots[pool->released_count % pool->slot_count]);
+    pthread_mutex_lock(&(pool->mutex));
+    while (!(pool->released_count < pool->submitted_count && next_slot->is_done)
+           && !(pool->input_done && pool->released_count == pool->submitted_count)) {
+        pthread_cond_wait(&(pool->block_done), &(pool->mutex));
+    }
+    const v2f_error_t status = pool->released_count < pool->submitted_count ? V2F_E_NONE : pool->read_status;
+    if (pool->released_count < pool->submitted_count) {
+        *slot = next_slot;
+    }
+    pthread_mutex_unlock(&(pool->mutex));
+
+    return status;
+}
+
+/**
+ * Release the block obtained with the last call to v2f_file_block_pool_next(),
+ * so that its slot can be read into again.
+ *
+ * @param pool pool from which the block was obtained
+ */
+static void v2f_file_block_pool_release(v2f_file_block_pool_t *const pool) {
+    if (pool->thread_count == 0) {
+        pool->released_count++;
+        return;
+    }
+
+    pthread_mutex_lock(&(pool->mutex));
+    pool->released_count++;
+    pthread_cond_signal(&(pool->slot_released));
+    pthread_mutex_unlock(&(pool->mutex));
+}
+
+/**
+ * Stop the reader thread of a pool, then its worker threads once all submitted blocks are processed,
+ * and free its resources.
+ *
+ * @param pool pool to be destroyed
+ */
+static void v2f_file_block_pool_destroy(v2f_file_block_pool_t *const pool) {
+    if (pool->thread_count > 0) {
+        pthread_mutex_lock(&(pool->mutex));
+        pool->abort_reading = true;
+        pthread_cond_broadcast(&(pool->slot_released));
+        pthread_mutex_unlock(&(pool->mutex));
+        pthread_join(pool->reader_thread, NULL);
+        v2f_file_block_pool_stop_workers(pool);
+    }
+    free(pool->threads);
+    pthread_mutex_destroy(&(pool->mutex));
+    pthread_cond_destroy(&(pool->block_submitted));
+    pthread_cond_destroy(&(pool->block_done));
+    pthread_cond_destroy(&(pool->slot_released));
+    for (uint32_t i = 0; i < pool->slot_count && pool->workspace == NULL; i++) {
+        free(pool->slots[i].samples);
+        free(pool->slots[i].samples_16);
+        free(pool->slots[i].bitstream);
+    }
+    free(pool->slots);
+}
+
+/**
+ * Write the envelope of a compressed (or shadow) block:
+ *
+ * 1. `compressed_bitstream_size`: 4 bytes, unsigned big-endian integer (zero for shadow blocks).
+ * 2. `sample_count`: 4 bytes, unsigned big-endian integer.
+ * 3. `compressed_bitstream`: `compressed_bitstream_size` bytes.
+ *
+ * @param slot slot with the compressed block
+ * @param output_file file where the envelope is written
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the envelope was successfully written
+ *  - @ref V2F_E_IO : the envelope could not be written
+ */
+static v2f_error_t v2f_file_write_envelope(
+        v2f_file_block_slot_t const *const slot,
+        FILE *output_file) {
+    assert(slot->bitstream_size <= V2F_SAMPLE_T_MAX);
+    assert(slot->sample_count <= V2F_SAMPLE_T_MAX);
+    v2f_sample_t header[2] = {(v2f_sample_t) slot->bitstream_size, (v2f_sample_t) slot->sample_count};
+    RETURN_IF_FAIL(v2f_file_write_big_endian(output_file, header, 2, 4));
+    if (fwrite(slot->bitstream, 1, slot->bitstream_size, output_file)
+        != slot->bitstream_size) {
+        log_error("Error writing the compressed block");
+        return V2F_E_IO;
+    }
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Read the next block envelope (see v2f_file_write_envelope()) into `slot`.
+ *
+ * @param compressed_file file from which the envelope is read
+ * @param mapping if not NULL, mapping of `compressed_file` from which the envelope is read instead.
+ *   The bitstream is not copied, and `mapped_bitstream` of `slot` points to it.
+ * @param bytes_per_word number of bytes per word of the codec
+ * @param slot slot where the envelope is stored. Its sample_count is set to 0
+ *   if the end of file is found exactly before the envelope, or if the block index
+ *   starts there, which is how the end of the compressed data is signaled.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : an envelope was read, or no more envelopes are available
+ *  - @ref V2F_E_CORRUPTED_DATA : the envelope is not valid
+ *  - @ref V2F_E_UNEXPECTED_END_OF_FILE : the envelope is incomplete
+ *  - @ref V2F_E_IO : the envelope could not be read
+ */
+static v2f_error_t v2f_file_read_envelope(
+        FILE *compressed_file,
+        v2f_file_mapping_t *const mapping,
+        uint8_t bytes_per_word,
+        v2f_file_block_slot_t *const slot) {
+    slot->sample_count = 0;
+    slot->mapped_bitstream = NULL;
+
+    // 1 - `compressed_bitstream_size`: 4 bytes, unsigned big-endian integer.
+    v2f_sample_t compressed_bitstream_size;
+    uint64_t read_count;
+    v2f_error_t status = mapping != NULL ?
+                         v2f_file_read_mapped_big_endian(mapping, &compressed_bitstream_size, NULL, 1, 4, &read_count) :
+                         v2f_file_read_big_endian(compressed_file, &compressed_bitstream_size, 1, 4, &read_count);
+    if (status == V2F_E_UNEXPECTED_END_OF_FILE && read_count == 0) {
+        // EOFs are expected to be aligned with envelopes.
+        return V2F_E_NONE;
+    }
+    RETURN_IF_FAIL(status);
+    if (compressed_bitstream_size > V2F_C_MAX_COMPRESSED_BLOCK_SIZE
+        || compressed_bitstream_size % bytes_per_word != 0) {
+        log_error("Corrupted envelope (compressed_bitstream_size=%u)",
+                  compressed_bitstream_size);
+        return V2F_E_CORRUPTED_DATA;
+    }
+
+    // 2 - `sample_count`: 4 bytes, unsigned big-endian integer.
+    v2f_sample_t sample_count;
+    RETURN_IF_FAIL(mapping != NULL ?
+                   v2f_file_read_mapped_big_endian(mapping, &sample_count, NULL, 1, 4, &read_count) :
+                   v2f_file_read_big_endian(compressed_file, &sample_count, 1, 4, NULL));
+    if (compressed_bitstream_size == 0 && sample_count == 0) {
+        // Empty envelope that starts the block index (see v2f_file_write_block_index())
+        return V2F_E_NONE;
+    }
+    if (sample_count < V2F_C_MIN_BLOCK_SIZE
+        || sample_count > V2F_C_MAX_BLOCK_SIZE) {
+        log_error("Corrupted envelope (sample_count=%u)", sample_count);
+        return V2F_E_CORRUPTED_DATA;
+    }
+
+    // 3 - `compressed_bitstream`: `compressed_bitstream_size` `bytes`.
+    if (mapping != NULL) {
+        if (mapping->size - mapping->position < compressed_bitstream_size) {
+            log_error("Corrupted envelope?");
+            return V2F_E_CORRUPTED_DATA;
+        }
+        slot->mapped_bitstream = mapping->data + mapping->position;
+        mapping->position += compressed_bitstream_size;
+    } else if (fread(slot->bitstream, 1, compressed_bitstream_size, compressed_file)
+               != compressed_bitstream_size) {
+        log_error("Corrupted envelope?");
+        return V2F_E_CORRUPTED_DATA;
+    }
+
+    slot->bitstream_size = compressed_bitstream_size;
+    slot->sample_count = sample_count;
+    slot->is_shadow = (compressed_bitstream_size == 0);
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Write a 64-bit unsigned integer as 8 big-endian bytes.
+ *
+ * @param output_file file where the value is written
+ * @param value value to be written
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the value was written
+ *  - @ref V2F_E_IO : the value could not be written
+ */
+static v2f_error_t v2f_file_write_uint64(FILE *output_file, uint64_t value) {
+    v2f_sample_t halves[2] = {(v2f_sample_t) (value >> 32), (v2f_sample_t) (value & UINT32_MAX)};
+    return v2f_file_write_big_endian(output_file, halves, 2, 4);
+}
+
+/**
+ * Read a 64-bit unsigned integer written by v2f_file_write_uint64().
+ *
+ * @param input_file file from which the value is read
+ * @param value pointer where the value is stored
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the value was read
+ *  - @ref V2F_E_UNEXPECTED_END_OF_FILE : the value is incomplete
+ *  - @ref V2F_E_IO : the value could not be read
+ */
+static v2f_error_t v2f_file_read_uint64(FILE *input_file, uint64_t *const value) {
+    v2f_sample_t halves[2];
+    RETURN_IF_FAIL(v2f_file_read_big_endian(input_file, halves, 2, 4, NULL));
+    *value = (((uint64_t) halves[0]) << 32) | halves[1];
+    return V2F_E_NONE;
+}
+
+/**
+ * Write the block index after the last envelope of a compressed file:
+ *
+ * 1. An empty envelope (`compressed_bitstream_size` and `sample_count` both 0),
+ *    which marks the end of the compressed data for sequential readers.
+ * 2. One entry per envelope, in file order:
+ *    - `offset`: 8 bytes, unsigned big-endian position of the envelope relative to the first one.
+ *    - `first_sample`: 8 bytes, unsigned big-endian position of the first sample of the block.
+ *    - `sample_count`: 4 bytes, unsigned big-endian integer.
+ * 3. A trailer of @ref V2F_FILE_BLOCK_INDEX_TRAILER_SIZE bytes:
+ *    - `data_size`: 8 bytes, unsigned big-endian size of all envelopes (the position of the empty envelope).
+ *    - `entry_count`: 4 bytes, unsigned big-endian integer.
+ *    - magic: the 8 bytes of @ref V2F_FILE_BLOCK_INDEX_MAGIC.
+ *
+ * @param output_file file where the index is written
+ * @param entries entries of all envelopes
+ * @param entry_count number of entries
+ * @param data_size total size of the envelopes
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the index was written
+ *  - @ref V2F_E_IO : the index could not be written
+ */
+static v2f_error_t v2f_file_write_block_index(
+        FILE *output_file,
+        v2f_file_block_index_entry_t const *const entries,
+        uint32_t entry_count,
+        uint64_t data_size) {
+    v2f_sample_t empty_envelope[2] = {0, 0};
+    RETURN_IF_FAIL(v2f_file_write_big_endian(output_file, empty_envelope, 2, 4));
+    for (uint32_t i = 0; i < entry_count; i++) {
+        v2f_sample_t sample_count = entries[i].sample_count;
+        RETURN_IF_FAIL(v2f_file_write_uint64(output_file, entries[i].offset));
+        RETURN_IF_FAIL(v2f_file_write_uint64(output_file, entries[i].first_sample));
+        RETURN_IF_FAIL(v2f_file_write_big_endian(output_file, &sample_count, 1, 4));
+    }
+    RETURN_IF_FAIL(v2f_file_write_uint64(output_file, data_size));
+    RETURN_IF_FAIL(v2f_file_write_big_endian(output_file, &entry_count, 1, 4));
+    if (fwrite(V2F_FILE_BLOCK_INDEX_MAGIC, 1, 8, output_file) != 8) {
+        log_error("Error writing the block index");
+        return V2F_E_IO;
+    }
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Use the block index of a compressed file, if it has one, to move the file position
+ * to the envelope of the block that contains `first_sample`, so that the envelopes
+ * of all previous blocks need not be read.
+ *
+ * The index is ignored (and the file position is not modified) if the file cannot be
+ * repositioned (e.g., a pipe), if it has no index, or if the index is not consistent
+ * with the current position being that of the first envelope.
+ *
+ * @param compressed_file file positioned at its first envelope
+ * @param first_sample position of the first sample to be decompressed
+ * @param block_first_sample pointer where the position of the first sample of the block
+ *   at the new file position is stored. It is not modified if the index is not used.
+ *   If `first_sample` lies beyond the last block, the file is positioned at the
+ *   end of the compressed data, and the total number of samples is stored.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the index was used, or ignored
+ *  - @ref V2F_E_IO : the file position could not be restored after trying to read the index
+ */
+static v2f_error_t v2f_file_seek_block_index(
+        FILE *compressed_file,
+        uint64_t first_sample,
+        uint64_t *const block_first_sample) {
+    const off_t data_position = ftello(compressed_file);
+    if (data_position < 0 || fseeko(compressed_file, 0, SEEK_END) != 0) {
+        log_info("The compressed file cannot be repositioned. Its block index is not used");
+        return V2F_E_NONE;
+    }
+    const off_t end_position = ftello(compressed_file);
+
+    // Trailer and empty envelope
+    uint64_t data_size = 0;
+    v2f_sample_t entry_count = 0;
+    char magic[8];
+    bool is_valid = end_position - data_position >= V2F_FILE_BLOCK_INDEX_TRAILER_SIZE + 8
+                    && fseeko(compressed_file, end_position - V2F_FILE_BLOCK_INDEX_TRAILER_SIZE, SEEK_SET) == 0
+                    && v2f_file_read_uint64(compressed_file, &data_size) == V2F_E_NONE
+                    && v2f_file_read_big_endian(compressed_file, &entry_count, 1, 4, NULL) == V2F_E_NONE
+                    && fread(magic, 1, 8, compressed_file) == 8
+                    && memcmp(magic, V2F_FILE_BLOCK_INDEX_MAGIC, 8) == 0;
+    const uint64_t index_size = 8 + (uint64_t) entry_count * V2F_FILE_BLOCK_INDEX_ENTRY_SIZE
+                                + V2F_FILE_BLOCK_INDEX_TRAILER_SIZE;
+    v2f_sample_t empty_envelope[2] = {1, 1};
+    is_valid = is_valid
+               && (uint64_t) (end_position - data_position) >= index_size
+               && data_size == (uint64_t) (end_position - data_position) - index_size
+               && fseeko(compressed_file, data_position + (off_t) data_size, SEEK_SET) == 0
+               && v2f_file_read_big_endian(compressed_file, empty_envelope, 2, 4, NULL) == V2F_E_NONE
+               && empty_envelope[0] == 0 && empty_envelope[1] == 0;
+    if (!is_valid) {
+        log_info("No valid block index was found");
+        if (fseeko(compressed_file, data_position, SEEK_SET) != 0) {
+            log_error("Cannot reposition the compressed file"); // LCOV_EXCL_LINE
+            return V2F_E_IO; // LCOV_EXCL_LINE
+        }
+        return V2F_E_NONE;
+    }
+
+    // Entries are read until that of the block with first_sample,
+    // checking that blocks are contiguous
+    uint64_t next_first_sample = 0;
+    uint64_t next_offset = 0;
+    for (uint32_t i = 0; i < entry_count; i++) {
+        uint64_t offset;
+        uint64_t entry_first_sample;
+        v2f_sample_t sample_count;
+        if (v2f_file_read_uint64(compressed_file, &offset) != V2F_E_NONE
+            || v2f_file_read_uint64(compressed_file, &entry_first_sample) != V2F_E_NONE
+            || v2f_file_read_big_endian(compressed_file, &sample_count, 1, 4, NULL) != V2F_E_NONE
+            || offset < next_offset || offset + 8 > data_size || entry_first_sample != next_first_sample
+            || sample_count < V2F_C_MIN_BLOCK_SIZE || sample_count > V2F_C_MAX_BLOCK_SIZE) {
+            log_warning("Corrupted block index entry %u. The index is not used", i);
+            if (fseeko(compressed_file, data_position, SEEK_SET) != 0) {
+                log_error("Cannot reposition the compressed file"); // LCOV_EXCL_LINE
+                return V2F_E_IO; // LCOV_EXCL_LINE
+            }
+            return V2F_E_NONE;
+        }
+        if (first_sample < entry_first_sample + sample_count) {
+            log_info("Block index: skipping %u blocks", i);
+            if (fseeko(compressed_file, data_position + (off_t) offset, SEEK_SET) != 0) {
+                log_error("Cannot reposition the compressed file"); // LCOV_EXCL_LINE
+                return V2F_E_IO; // LCOV_EXCL_LINE
+            }
+            *block_first_sample = entry_first_sample;
+            return V2F_E_NONE;
+        }
+        next_first_sample = entry_first_sample + sample_count;
+        next_offset = offset + 8;
+    }
+
+    // All blocks lie before first_sample
+    if (fseeko(compressed_file, data_position + (off_t) data_size, SEEK_SET) != 0) {
+        log_error("Cannot reposition the compressed file"); // LCOV_EXCL_LINE
+        return V2F_E_IO; // LCOV_EXCL_LINE
+    }
+    *block_first_sample = next_first_sample;
+
+    return V2F_E_NONE;
+}
+
+/**
+ * @struct v2f_file_raw_source_t
+ *
+ * State of the reader of raw blocks in v2f_file_compress_blocks().
+ */
+typedef struct {
+    /// File with the samples to be compressed.
+    FILE *raw_file;
+    /// If not NULL, mapping of `raw_file` from which samples are read instead.
+    v2f_file_mapping_t *mapping;
+    /// Number of bytes per sample in `raw_file`.
+    uint8_t bytes_per_sample;
+    /// Number of samples per row, or 0 if rows are not considered.
+    uint64_t samples_per_row;
+    /// Shadow regions, as described in v2f_file_compress_from_path().
+    uint32_t const *shadow_y_pairs;
+    /// Number of shadow regions.
+    uint32_t y_shadow_count;
+    /// Total number of samples read so far.
+    uint64_t processed_sample_count;
+    /// Total number of shadow regions read so far.
+    uint32_t processed_shadow_count;
+    /// Cleared once the end of `raw_file` is found.
+    bool continue_reading;
+} v2f_file_raw_source_t;
 
-    for (uint64_t i = 0; i < sample_count; i++) {
-        uint8_t output_buffer[bytes_per_sample];
-        v2f_entropy_coder_sample_to_buffer(
-                sample_buffer[i],
-                output_buffer,
-                bytes_per_sample);
-        if (fwrite(output_buffer, bytes_per_sample, 1, output_file) != 1) {
-            log_error(
-                    "v2f_file_write_big_endian: [i=%lu] fwrite error %d (feof %d)",
-                    i,
-                    ferror(output_file),
-                    feof(output_file));
-            return V2F_E_IO;
+/**
+ * Read the next raw block (see v2f_file_block_read_function_t).
+ *
+ * Samples are read in blocks of at most V2F_C_MAX_BLOCK_SIZE elements.
+ * If the number of samples per row is provided and not zero, then
+ * blocks are also guaranteed to have length a multiple of that number.
+ * Block size may be smaller in case shadow regions are defined.
+ * When an EOF is found, reading is stopped.
+ *
+ * @param source pointer to the v2f_file_raw_source_t instance
+ * @param slot free slot where the block is stored
+ * @param has_block set to true if a block was read into `slot`, or to false if no samples remain
+ *
+ * @return
+ *  - @ref V2F_E_NONE : a block was read, or no samples remain
+ *  - @ref V2F_E_CORRUPTED_DATA : the number of samples is not a multiple of the number of samples per row
+ *  - Any error produced while reading the samples, other than an unexpected end of file
+ */
+static v2f_error_t v2f_file_read_raw_block(
+        void *source, v2f_file_block_slot_t *const slot, bool *const has_block) {
+    v2f_file_raw_source_t *const raw_source = (v2f_file_raw_source_t *) source;
+    const uint64_t samples_per_row = raw_source->samples_per_row;
+    *has_block = false;
+    if (!raw_source->continue_reading) {
+        return V2F_E_NONE;
+    }
+
+    // Determine the length of the next block to be read
+    uint64_t next_block_length = V2F_C_MAX_BLOCK_SIZE;
+    if (samples_per_row > 0) {
+        next_block_length -= V2F_C_MAX_BLOCK_SIZE % samples_per_row;
+    }
+    slot->is_shadow = false;
+    if (raw_source->processed_shadow_count < raw_source->y_shadow_count) {
+        uint32_t const *const shadow_pair = raw_source->shadow_y_pairs + 2 * raw_source->processed_shadow_count;
+        const uint64_t next_shadow_sample_index = shadow_pair[0] * samples_per_row;
+        if (raw_source->processed_sample_count == next_shadow_sample_index) {
+            slot->is_shadow = true;
+            next_block_length = samples_per_row * (shadow_pair[1] - shadow_pair[0] + 1);
+        } else if (raw_source->processed_sample_count + next_block_length > next_shadow_sample_index) {
+            next_block_length = next_shadow_sample_index - raw_source->processed_sample_count;
         }
     }
+
+    // Read a raw block
+    v2f_error_t status;
+    if (raw_source->mapping != NULL) {
+        status = v2f_file_read_mapped_big_endian(
+                raw_source->mapping, slot->samples, slot->samples_16, next_block_length,
+                raw_source->bytes_per_sample, &(slot->sample_count));
+    } else if (slot->samples_16 != NULL) {
+        status = v2f_file_read_big_endian_16(
+                raw_source->raw_file, slot->samples_16, next_block_length,
+                raw_source->bytes_per_sample, &(slot->sample_count));
+    } else {
+        status = v2f_file_read_big_endian(
+                raw_source->raw_file, slot->samples, next_block_length,
+                raw_source->bytes_per_sample, &(slot->sample_count));
+    }
+    if (status != V2F_E_NONE && status != V2F_E_UNEXPECTED_END_OF_FILE) {
+        log_error("Error reading input samples (different from EOF)");
+        return status;
+    }
+    raw_source->continue_reading = (status == V2F_E_NONE);
+    if (slot->sample_count == 0) {
+        log_info("No more samples available");
+        assert(!raw_source->continue_reading);
+        return V2F_E_NONE;
+    }
+    if (samples_per_row > 0 && slot->sample_count % samples_per_row != 0) {
+        log_error("The image did not have a size multiple of the provided samples per row");
+        return V2F_E_CORRUPTED_DATA;
+    }
+    assert(slot->sample_count <= V2F_SAMPLE_T_MAX);
+
+    log_info("Enveloping block of %lu samples (shadow=%d)...",
+             slot->sample_count, (int) slot->is_shadow);
+    raw_source->processed_sample_count += slot->sample_count;
+    if (slot->is_shadow) {
+        raw_source->processed_shadow_count++;
+    }
+    *has_block = true;
+
     return V2F_E_NONE;
 }
 
+/**
+ * Compress all samples of `raw_file` and write the envelopes of the compressed
+ * blocks (see v2f_file_write_envelope()) into `output_file`.
+ *
+ * @param raw_file file open for reading with the samples to be compressed
+ * @param output_file file open for writing where the envelopes are written
+ * @param compressor compressor used for all blocks. If the number of samples per row
+ *   of its decorrelator is not 0, block sizes are multiples of it.
+ * @param bytes_per_sample number of bytes per sample in `raw_file`
+ * @param shadow_y_pairs shadow regions, as described in v2f_file_compress_from_path()
+ * @param y_shadow_count number of shadow regions
+ * @param write_block_index if true, the block index (see v2f_file_write_block_index()) is written
+ *   after the last envelope
+ * @param thread_count number of threads used to compress blocks concurrently.
+ *   If not 0, blocks are read and compressed in a pipeline (see v2f_file_block_pool_t).
+ * @param workspace if not NULL, blocks are compressed sequentially with the buffers of this workspace,
+ *   and `thread_count` is ignored
+ * @param map_files if true and `raw_file` is a regular file, it is mapped (see v2f_file_map_input())
+ *   and samples are read in place instead of through stdio
+ *
+ * @return
+ *  - @ref V2F_E_NONE : all samples were compressed
+ *  - @ref V2F_E_OUT_OF_MEMORY : not enough memory for the block buffers
+ *  - @ref V2F_E_CORRUPTED_DATA : the number of samples is not a multiple of the number of samples per row
+ *  - Any error produced while reading, compressing or writing the blocks
+ */
+static v2f_error_t v2f_file_compress_blocks(
+        FILE *raw_file,
+        FILE *output_file,
+        v2f_compressor_t *const compressor,
+        uint8_t bytes_per_sample,
+        uint32_t const *const shadow_y_pairs,
+        uint32_t y_shadow_count,
+        bool write_block_index,
+        uint32_t thread_count,
+        v2f_file_workspace_t *const workspace,
+        bool map_files) {
+    v2f_file_mapping_t raw_mapping = {0};
+    const bool is_mapped = map_files && v2f_file_map_input(raw_file, &raw_mapping);
+    if (map_files && !is_mapped) {
+        log_info("The raw file cannot be mapped, and is read with stdio");
+    }
+
+    // Prepare one block slot per block in flight, with buffers for the worst case
+    // (full block with 1 word per input sample).
+    // Samples of at most 2 bytes are processed with the 16-bit pipeline.
+    v2f_file_raw_source_t source = {
+            raw_file, is_mapped ? &raw_mapping : NULL, bytes_per_sample, compressor->decorrelator->samples_per_row,
+            shadow_y_pairs, y_shadow_count, 0, 0, true};
+    v2f_file_block_pool_t pool;
+    v2f_error_t status = v2f_file_block_pool_create(
+            v2f_file_read_raw_block, &source, v2f_file_compress_slot, compressor,
+            bytes_per_sample <= 2, thread_count, workspace, &pool);
+    if (status != V2F_E_NONE) {
+        // LCOV_EXCL_START
+        if (is_mapped) {
+            munmap(raw_mapping.data, raw_mapping.size);
+        }
+        return status;
+        // LCOV_EXCL_STOP
+    }
+
+    // Compress the blocks and output the block envelopes in input order.
+    // When pipelined, blocks are read ahead and compressed by the pool
+    // threads while envelopes are written here.
+    // Total number of envelopes written so far
+    uint64_t written_block_count = 0;
+    // Index entries of the envelopes written so far, and their total size and number of samples
+    v2f_file_block_index_entry_t *index_entries = NULL;
+    uint64_t index_capacity = 0;
+    uint64_t written_size = 0;
+    uint64_t written_sample_count = 0;
+    while (status == V2F_E_NONE) {
+        v2f_file_block_slot_t *slot;
+        status = v2f_file_block_pool_next(&pool, &slot);
+        if (slot == NULL) {
+            break;
+        }
+
+        // Generate the envelope of the oldest block only if its compression is successful.
+        status = slot->status;
+        if (status == V2F_E_NONE && write_block_index && written_block_count == index_capacity) {
+            // The entry count is stored in 4 bytes
+            index_capacity = index_capacity == 0 ? 64 : 2 * index_capacity;
+            v2f_file_block_index_entry_t *const new_entries = written_block_count >= UINT32_MAX ? NULL :
+                    (v2f_file_block_index_entry_t *) realloc(
+                            index_entries, sizeof(v2f_file_block_index_entry_t) * index_capacity);
+            if (new_entries == NULL) {
+                log_error("Cannot grow the block index"); // LCOV_EXCL_LINE
+                status = V2F_E_OUT_OF_MEMORY; // LCOV_EXCL_LINE
+            } else {
+                index_entries = new_entries;
+            }
+        }
+        if (status == V2F_E_NONE) {
+            log_debug("\tsending envelope...");
+            status = v2f_file_write_envelope(slot, output_file);
+        }
+        if (status == V2F_E_NONE) {
+            log_info("... successfully enveloped %lu samples into a %lu byte bitstream.",
+                     slot->sample_count, slot->bitstream_size);
+            if (write_block_index) {
+                index_entries[written_block_count].offset = written_size;
+                index_entries[written_block_count].first_sample = written_sample_count;
+                index_entries[written_block_count].sample_count = (uint32_t) slot->sample_count;
+            }
+            written_size += 8 + slot->bitstream_size;
+            written_sample_count += slot->sample_count;
+        }
+        written_block_count++;
+        v2f_file_block_pool_release(&pool);
+    }
+    if (status == V2F_E_NONE && write_block_index) {
+        status = v2f_file_write_block_index(
+                output_file, index_entries, (uint32_t) written_block_count, written_size);
+    }
+    free(index_entries);
+
+    // The reader is stopped before its state is inspected
+    v2f_file_block_pool_destroy(&pool);
+    if (is_mapped) {
+        const v2f_error_t unmap_status = v2f_file_unmap(raw_file, &raw_mapping, false);
+        status = status != V2F_E_NONE ? status : unmap_status;
+    }
+    log_info("Processed %lu samples in total", source.processed_sample_count);
+    if (source.processed_shadow_count < y_shadow_count) {
+        log_warning("Processed only %u out of %u shadow regions. "
+                    "The remaining regions lie beyond the encountered EOF "
+                    "and are ignored.\n",
+                    source.processed_shadow_count, y_shadow_count);
+    }
+
+    return status;
+}
+
+/**
+ * Get the number of worker threads of the block pool (see v2f_file_block_pool_create()) for some options.
+ *
+ * @param options options of the compression or decompression
+ *
+ * @return the number of worker threads, or 0 if blocks are to be processed sequentially
+ */
+static uint32_t v2f_file_get_worker_count(v2f_file_options_t const *const options) {
+    if (options->thread_count > 1) {
+        return options->thread_count;
+    }
+    return options->pipeline ? 1 : 0;
+}
+
+// Declared in v2f.h
+v2f_error_t v2f_file_init_options(v2f_file_options_t *const options) {
+    if (options == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    *options = v2f_file_default_options;
+
+    return V2F_E_NONE;
+}
 
 // Declared in v2f.h
 int v2f_file_compress_from_path(
@@ -1146,7 +3096,8 @@ int v2f_file_compress_from_path(
         v2f_decorrelator_mode_t decorrelator_mode,
         v2f_sample_t samples_per_row,
         uint32_t *shadow_y_pairs,
-        uint32_t y_shadow_count) {
+        uint32_t y_shadow_count,
+        v2f_file_options_t const *options) {
 
     // Basic parameter verification
     if (raw_file_path == NULL || header_file_path == NULL ||
@@ -1205,7 +3156,7 @@ int v2f_file_compress_from_path(
             overwrite_quantizer_mode, quantizer_mode,
             overwrite_qstep, step_size,
             overwrite_decorrelator_mode, decorrelator_mode, samples_per_row,
-            shadow_y_pairs, y_shadow_count);
+            shadow_y_pairs, y_shadow_count, options);
 
     // Cleanup
     fclose(raw_file);
@@ -1228,7 +3179,8 @@ int v2f_file_compress_from_file(
         v2f_decorrelator_mode_t decorrelator_mode,
         v2f_sample_t samples_per_row,
         uint32_t *shadow_y_pairs,
-        uint32_t y_shadow_count) {
+        uint32_t y_shadow_count,
+        v2f_file_options_t const *options) {
     if (raw_file == NULL || header_file == NULL || output_file == NULL) {
         log_error("Invalid parameters");
         return 1;
@@ -1239,12 +3191,19 @@ int v2f_file_compress_from_file(
         log_error("Invalid shadow description");
         return 1;
     }
+    if (options == NULL) {
+        options = &v2f_file_default_options;
+    }
+    if (options->thread_count > V2F_C_MAX_THREAD_COUNT) {
+        log_error("Invalid thread count %u", options->thread_count);
+        return 1;
+    }
 
     // Read the entropy coder/decoder pair in the header file
     // (both are simultaneously defined)
     v2f_compressor_t compressor;
     v2f_decompressor_t decompressor;
-    if (v2f_file_read_codec(header_file, &compressor, &decompressor)
+    if (v2f_file_read_codec_cached(header_file, options->forest_cache_path, &compressor, &decompressor)
         != V2F_E_NONE) {
         log_error("Error reading the V2F codec file");
         return 1;
@@ -1262,189 +3221,355 @@ int v2f_file_compress_from_file(
     }
     compressor.decorrelator->samples_per_row = samples_per_row;
 
-    // Prepare buffers for the worst case
-    // (full block with 1 word per input sample)
-    v2f_sample_t *input_sample_buffer = (v2f_sample_t *) malloc(
-            sizeof(v2f_sample_t) * V2F_C_MAX_BLOCK_SIZE);
-    uint8_t *compressed_block_buffer = (uint8_t *) malloc(
-            compressor.entropy_coder->bytes_per_word *
-            (size_t) V2F_C_MAX_BLOCK_SIZE);
-    if (input_sample_buffer == NULL || compressed_block_buffer == NULL) {
-        log_error(
-                "Error allocating input or output buffers with limits %ld and %d.\n",
-                sizeof(v2f_sample_t) * V2F_C_MAX_BLOCK_SIZE,
-                V2F_C_MAX_COMPRESSED_BLOCK_SIZE);
-        if (input_sample_buffer != NULL) {
-            free(input_sample_buffer);
+    v2f_error_t status = v2f_file_compress_blocks(
+            raw_file, output_file, &compressor, decompressor.entropy_decoder->bytes_per_sample,
+            shadow_y_pairs, y_shadow_count, options->write_block_index, v2f_file_get_worker_count(options), NULL,
+            options->map_files);
+
+    // Cleanup and report status
+    v2f_file_destroy_read_codec(&compressor, &decompressor);
+
+    // V2F_E_NONE is defined to be 0. It is compatible with this method's signature.
+    return (int) status;
+}
+
+/**
+ * @struct v2f_file_envelope_source_t
+ *
+ * State of the reader of block envelopes in v2f_file_decompress_blocks().
+ */
+typedef struct {
+    /// File with the envelopes.
+    FILE *compressed_file;
+    /// If not NULL, mapping of `compressed_file` from which envelopes are read instead.
+    v2f_file_mapping_t *mapping;
+    /// Number of bytes per word of the decompressor.
+    uint8_t bytes_per_word;
+    /// First sample to be written.
+    uint64_t first_sample;
+    /// Sample after the last one to be written.
+    uint64_t end_sample;
+    /// Position of the first sample of the next envelope to be read.
+    uint64_t next_first_sample;
+    /// Cleared once no more envelopes are needed.
+    bool continue_reading;
+} v2f_file_envelope_source_t;
+
+/**
+ * Read the next envelope with selected samples (see v2f_file_block_read_function_t).
+ *
+ * @param source pointer to the v2f_file_envelope_source_t instance
+ * @param slot free slot where the envelope is stored
+ * @param has_block set to true if an envelope was read into `slot`, or to false if no more envelopes are needed
+ *
+ * @return
+ *  - @ref V2F_E_NONE : an envelope was read, or no more envelopes are needed
+ *  - Any error produced while reading the envelope
+ */
+static v2f_error_t v2f_file_read_envelope_block(
+        void *source, v2f_file_block_slot_t *const slot, bool *const has_block) {
+    v2f_file_envelope_source_t *const envelope_source = (v2f_file_envelope_source_t *) source;
+    *has_block = false;
+    while (envelope_source->continue_reading) {
+        RETURN_IF_FAIL(v2f_file_read_envelope(
+                envelope_source->compressed_file, envelope_source->mapping, envelope_source->bytes_per_word, slot));
+        // The way it is signaled when no more block envelopes are present
+        // is by finding an and of file while reading the first element of the
+        // envelope (and having read exactly 0 bytes in that read),
+        // or by finding the empty envelope of the block index
+        if (slot->sample_count == 0) {
+            envelope_source->continue_reading = false;
+            break;
         }
-        if (compressed_block_buffer != NULL) {
-            free(compressed_block_buffer);
+        slot->first_sample = envelope_source->next_first_sample;
+        envelope_source->next_first_sample += slot->sample_count;
+        if (envelope_source->next_first_sample <= envelope_source->first_sample) {
+            // The block precedes the selected rows, and its slot is reused
+            continue;
         }
-        v2f_file_destroy_read_codec(&compressor, &decompressor);
-        return 1;
+        // No more envelopes are needed after the one with the last selected sample
+        envelope_source->continue_reading = envelope_source->next_first_sample < envelope_source->end_sample;
+        *has_block = true;
+        break;
     }
 
-    // Compress the blocks and output the block envelopes.
-    // Samples are read in blocks of at most V2F_C_MAX_BLOCK_SIZE elements
-    // If the number of samples per row is provided and not zero, then
-    // blocks are also guaranteed to have length a multiple of that number.
-    // Block size may be smaller in case shadow regions are defined.
-    // When an EOF is found, reading is stoped.
-    v2f_error_t status = V2F_E_NONE;
-    bool continue_reading = true;
-    // Total number of samples coded so far
-    uint64_t processed_sample_count = 0;
-    // Total number of shadow regions processed so far
-    uint32_t processed_shadow_count = 0;
-    while (continue_reading && status == V2F_E_NONE) {
-        // Determine the length of the next block to be read
-        uint64_t next_block_length = V2F_C_MAX_BLOCK_SIZE;
-        if (samples_per_row > 0) {
-            next_block_length -= V2F_C_MAX_BLOCK_SIZE % samples_per_row;
-        }
-        bool is_shadow_block = false;
-        if (processed_shadow_count < y_shadow_count) {
-            const uint64_t next_shadow_sample_index =
-                    shadow_y_pairs[2 * processed_shadow_count] * samples_per_row;
-            if (processed_sample_count == next_shadow_sample_index) {
-                is_shadow_block = true;
-                next_block_length = samples_per_row *
-                                    (shadow_y_pairs[2 * processed_shadow_count + 1]
-                                     - shadow_y_pairs[2 * processed_shadow_count]
-                                     + 1);
-            } else if (processed_sample_count + next_block_length > next_shadow_sample_index) {
-                next_block_length = next_shadow_sample_index - processed_sample_count;
-            }
-        }
+    return V2F_E_NONE;
+}
 
-        // Read a raw block
-        uint64_t read_sample_count;
-        status = v2f_file_read_big_endian(
-                raw_file, input_sample_buffer, next_block_length,
-                decompressor.entropy_decoder->bytes_per_sample,
-                &read_sample_count);
-        if (status != V2F_E_NONE && status != V2F_E_UNEXPECTED_END_OF_FILE) {
-            log_error("Error reading input samples (different from EOF)");
+/**
+ * Count the samples that v2f_file_decompress_blocks() writes from a mapped compressed file,
+ * by walking its envelopes without decompressing them.
+ *
+ * Counting stops at the first invalid envelope, which is reported when the envelopes are decompressed.
+ *
+ * @param source state of the reader of envelopes, which is not modified
+ *
+ * @return the number of samples written if all envelopes up to that point are valid
+ */
+static uint64_t v2f_file_count_mapped_samples(v2f_file_envelope_source_t const *const source) {
+    v2f_file_mapping_t mapping = *(source->mapping);
+    v2f_file_envelope_source_t counting_source = *source;
+    counting_source.mapping = &mapping;
+    v2f_file_block_slot_t slot;
+    memset(&slot, 0, sizeof(slot));
+    uint64_t sample_count = 0;
+    bool has_block;
+    while (v2f_file_read_envelope_block(&counting_source, &slot, &has_block) == V2F_E_NONE && has_block) {
+        const uint64_t begin = slot.first_sample > source->first_sample ? slot.first_sample : source->first_sample;
+        const uint64_t end = slot.first_sample + slot.sample_count < source->end_sample ?
+                             slot.first_sample + slot.sample_count : source->end_sample;
+        sample_count += end - begin;
+    }
+
+    return sample_count;
+}
+
+/**
+ * Count the blocks that v2f_file_decompress_blocks() decompresses, up to a limit,
+ * by walking their envelopes without decompressing them or reading their bitstreams.
+ *
+ * Counting stops at the first invalid envelope, which is reported when the envelopes are decompressed.
+ *
+ * @param source state of the reader of envelopes. Its file position is restored afterwards,
+ *   and the rest of its state is not modified.
+ * @param max_block_count counting stops once this many blocks are found
+ * @param block_count pointer where the number of blocks is stored, not larger than `max_block_count`.
+ *   If the envelopes are read with stdio from a file that cannot be repositioned,
+ *   `max_block_count` is stored.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the blocks were counted
+ *  - @ref V2F_E_IO : the file position could not be restored
+ */
+static v2f_error_t v2f_file_count_blocks(
+        v2f_file_envelope_source_t const *const source, uint64_t max_block_count, uint64_t *const block_count) {
+    *block_count = 0;
+    v2f_file_mapping_t mapping;
+    memset(&mapping, 0, sizeof(mapping));
+    if (source->mapping != NULL) {
+        mapping = *(source->mapping);
+    }
+    const off_t start_position = source->mapping != NULL ? 0 : ftello(source->compressed_file);
+    if (start_position < 0) {
+        *block_count = max_block_count;
+        return V2F_E_NONE;
+    }
+
+    uint64_t next_first_sample = source->next_first_sample;
+    bool continue_reading = source->continue_reading;
+    while (*block_count < max_block_count && continue_reading) {
+        // 1 - `compressed_bitstream_size` and 2 - `sample_count`, as read by v2f_file_read_envelope()
+        v2f_sample_t envelope_header[2];
+        uint64_t read_count;
+        const v2f_error_t status = source->mapping != NULL ?
+                v2f_file_read_mapped_big_endian(&mapping, envelope_header, NULL, 2, 4, &read_count) :
+                v2f_file_read_big_endian(source->compressed_file, envelope_header, 2, 4, &read_count);
+        if (status != V2F_E_NONE || envelope_header[1] == 0) {
             break;
         }
-        continue_reading = (status == V2F_E_NONE);
-        if (read_sample_count == 0) {
-            log_info("No more samples available");
-            assert(status == V2F_E_UNEXPECTED_END_OF_FILE);
-            status = V2F_E_NONE;
+        // 3 - `compressed_bitstream` is skipped
+        if (source->mapping != NULL) {
+            if (mapping.size - mapping.position < envelope_header[0]) {
+                break;
+            }
+            mapping.position += envelope_header[0];
+        } else if (fseeko(source->compressed_file, (off_t) envelope_header[0], SEEK_CUR) != 0) {
             break;
         }
-        if (samples_per_row > 0 && read_sample_count % samples_per_row != 0) {
-            log_error("The image did not have a size multiple of the provided samples per row");
-            status = V2F_E_CORRUPTED_DATA;
-            break;
+        // Blocks before the selected rows are not decompressed, nor those after them
+        next_first_sample += envelope_header[1];
+        if (next_first_sample > source->first_sample) {
+            (*block_count)++;
+            continue_reading = next_first_sample < source->end_sample;
         }
+    }
 
-        log_info("Enveloping block of %lu samples (shadow=%d)...",
-                 read_sample_count, (int) is_shadow_block);
-
-        // Compress the read block whenever a complete or partial block is read
-        if (status == V2F_E_NONE
-            || (status == V2F_E_UNEXPECTED_END_OF_FILE && read_sample_count > 0)) {
-            assert(read_sample_count <= V2F_SAMPLE_T_MAX);
-
-            if (! is_shadow_block) {
-                // Compress the block
-                log_debug("\tcompressing block...");
-                uint64_t written_byte_count;
-                status = v2f_compressor_compress_block(
-                        &compressor, input_sample_buffer, read_sample_count,
-                        compressed_block_buffer, &written_byte_count);
-                if (status != V2F_E_NONE) {
-                    break;
-                }
-
-                log_debug("\tsending envelope...");
-                // Generate the envelope only if compression is successful.
-
-                // 1 - `compressed_bitstream_size`: 4 bytes, unsigned big-endian integer.
-                {
-                    assert(written_byte_count <= V2F_SAMPLE_T_MAX);
-                    v2f_sample_t compressed_bitstream_size =
-                            (v2f_sample_t) written_byte_count;
-                    status = v2f_file_write_big_endian(
-                            output_file, &compressed_bitstream_size, 1, 4);
-                    if (status != V2F_E_NONE) {
-                        break;
-                    }
-                }
-
-                // 2 - `sample_count`: 4 bytes, unsigned big-endian integer.
-                {
-                    v2f_sample_t casted_sample_count = (v2f_sample_t) read_sample_count;
-                    status = v2f_file_write_big_endian(
-                            output_file, &casted_sample_count, 1, 4);
-                    read_sample_count = casted_sample_count;
-                    if (status != V2F_E_NONE) {
-                        break;
-                    }
-                }
-
-                // 3 - `compressed_bitstream`: `compressed_bitstream_size` `bytes`.
-                if (fwrite(compressed_block_buffer, 1, written_byte_count, output_file)
-                    != written_byte_count) {
-                    log_error("Error writing the compressed block");
-                    status = V2F_E_IO;
-                }
+    if (source->mapping == NULL && fseeko(source->compressed_file, start_position, SEEK_SET) != 0) {
+        log_error("Cannot restore the position of the compressed file");
+        return V2F_E_IO;
+    }
+    return V2F_E_NONE;
+}
 
-                log_info("... successfully enveloped %lu samples into a %lu byte bitstream.",
-                         read_sample_count, written_byte_count);
-            } else {
-                // It is a shadow block
-                // 1 - `compressed_bitstream_size`: 4 bytes, unsigned big-endian integer (zero)
-                {
-                    v2f_sample_t sample_zero = 0;
-                    status = v2f_file_write_big_endian(
-                            output_file, &sample_zero, 1, 4);
-                    if (status != V2F_E_NONE) {
-                        break;
-                    }
-                }
+/**
+ * Decompress all block envelopes (see v2f_file_write_envelope()) of `compressed_file`
+ * and write the reconstructed samples into `reconstructed_file`.
+ *
+ * If only some rows are selected, the blocks before them are not decompressed. If the file has
+ * a block index (see v2f_file_write_block_index()), their envelopes are not read either.
+ * Selected rows beyond the end of the file are ignored.
+ *
+ * @param compressed_file file open for reading with the envelopes
+ * @param reconstructed_file file open for writing where the samples are written
+ * @param decompressor decompressor used for all blocks. If `select_rows` is true,
+ *   the number of samples per row of its decorrelator must not be 0.
+ * @param select_rows if true, only rows `first_row` to `last_row` (both included) are written.
+ *   Otherwise, all samples are written.
+ * @param first_row first row written if `select_rows` is true
+ * @param last_row last row written if `select_rows` is true, not smaller than `first_row`
+ * @param thread_count number of threads used to decompress blocks concurrently.
+ *   If not 0, blocks are read and decompressed in a pipeline (see v2f_file_block_pool_t).
+ *   If there are fewer blocks than threads, each block is decompressed by a single worker,
+ *   and the spare threads invert its JPEG-LS prediction (see v2f_decorrelator_invert_block()).
+ * @param workspace if not NULL, blocks are decompressed sequentially with the buffers of this workspace,
+ *   and `thread_count` is ignored
+ * @param map_files if true and `compressed_file` is a regular file, it is mapped (see v2f_file_map_input())
+ *   and envelopes are decompressed in place. If, furthermore, `reconstructed_file` is a regular file,
+ *   the reconstructed samples are written through a mapping of its preallocated space
+ *   (see v2f_file_map_output()). Otherwise, stdio is used.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : all envelopes were decompressed
+ *  - @ref V2F_E_OUT_OF_MEMORY : not enough memory for the block buffers
+ *  - Any error produced while reading, decompressing or writing the blocks
+ */
+static v2f_error_t v2f_file_decompress_blocks(
+        FILE *compressed_file,
+        FILE *reconstructed_file,
+        v2f_decompressor_t *const decompressor,
+        bool select_rows,
+        uint32_t first_row,
+        uint32_t last_row,
+        uint32_t thread_count,
+        v2f_file_workspace_t *const workspace,
+        bool map_files) {
+    // Samples from first_sample (included) to end_sample (excluded) are written
+    const uint64_t samples_per_row = decompressor->decorrelator->samples_per_row;
+    assert(!select_rows || (samples_per_row > 0 && first_row <= last_row));
+    const uint64_t first_sample = select_rows ? first_row * samples_per_row : 0;
+    const uint64_t end_sample = select_rows ? (last_row + UINT64_C(1)) * samples_per_row : UINT64_MAX;
+    // Position of the first sample of the next envelope to be read
+    uint64_t next_first_sample = 0;
+    if (first_sample > 0) {
+        RETURN_IF_FAIL(v2f_file_seek_block_index(compressed_file, first_sample, &next_first_sample));
+    }
+
+    // Prepare one block slot per block in flight, with buffers for the worst case
+    // (full block with 1 word per input sample).
+    // Samples of at most 2 bytes are reconstructed with the 16-bit pipeline.
+    const uint8_t bytes_per_sample = decompressor->entropy_decoder->bytes_per_sample;
+    v2f_file_mapping_t compressed_mapping = {0};
+    const bool is_mapped = map_files && v2f_file_map_input(compressed_file, &compressed_mapping);
+    v2f_file_envelope_source_t source = {
+            compressed_file, is_mapped ? &compressed_mapping : NULL, decompressor->entropy_decoder->bytes_per_word,
+            first_sample, end_sample, next_first_sample, true};
+
+    // The reconstructed size is known once the envelopes are mapped, and the output is preallocated
+    v2f_file_mapping_t reconstructed_mapping = {0};
+    const uint64_t reconstructed_size = is_mapped ? bytes_per_sample * v2f_file_count_mapped_samples(&source) : 0;
+    const bool is_output_mapped = reconstructed_size > 0 && v2f_file_map_output(
+            reconstructed_file, reconstructed_size, &reconstructed_mapping);
+    if (map_files && !is_mapped) {
+        log_info("The compressed file cannot be mapped, and is read with stdio");
+    } else if (map_files && !is_output_mapped) {
+        log_info("The reconstructed file cannot be mapped, and is written with stdio");
+    }
+
+    // With fewer JPEG-LS blocks than threads, the spare threads of each block run its inverse
+    // prediction as a row wavefront. The decorrelator is restored when done.
+    v2f_decorrelator_t *const decorrelator = decompressor->decorrelator;
+    const uint32_t decorrelator_thread_count = decorrelator->thread_count;
+    v2f_error_t status = V2F_E_NONE;
+    if (workspace == NULL && thread_count > 1 && decorrelator->mode == V2F_C_DECORRELATOR_MODE_JPEG_LS) {
+        uint64_t block_count;
+        status = v2f_file_count_blocks(&source, thread_count, &block_count);
+        if (status == V2F_E_NONE && block_count > 0 && block_count < thread_count) {
+            const uint64_t block_thread_count = thread_count / block_count;
+            decorrelator->thread_count = (uint32_t) MIN(block_thread_count, V2F_C_MAX_THREAD_COUNT);
+            thread_count = (uint32_t) block_count;
+        }
+    }
 
-                // 2 - `sample_count`: 4 bytes, unsigned big-endian integer.
-                {
-                    v2f_sample_t casted_sample_count = (v2f_sample_t) read_sample_count;
-                    status = v2f_file_write_big_endian(
-                            output_file, &casted_sample_count, 1, 4);
-                    read_sample_count = casted_sample_count;
-                    if (status != V2F_E_NONE) {
-                        break;
-                    }
-                }
+    v2f_file_block_pool_t pool;
+    if (status == V2F_E_NONE) {
+        status = v2f_file_block_pool_create(
+                v2f_file_read_envelope_block, &source, v2f_file_decompress_slot, decompressor,
+                bytes_per_sample <= 2 && decompressor->entropy_decoder->sample_pool_16 != NULL,
+                thread_count, workspace, &pool);
+    }
+    if (status != V2F_E_NONE) {
+        decorrelator->thread_count = decorrelator_thread_count;
+        // LCOV_EXCL_START
+        if (is_output_mapped) {
+            (void) v2f_file_unmap(reconstructed_file, &reconstructed_mapping, true);
+        }
+        if (is_mapped) {
+            munmap(compressed_mapping.data, compressed_mapping.size);
+        }
+        return status;
+        // LCOV_EXCL_STOP
+    }
 
-                // 3 - `compressed_bitstream`: empty because it is a shadow region
+    // Envelopes are read and decoded, ahead of time and by the pool threads when pipelined,
+    // while the reconstructed samples are written here in order.
+    while (status == V2F_E_NONE) {
+        v2f_file_block_slot_t *slot;
+        status = v2f_file_block_pool_next(&pool, &slot);
+        if (slot == NULL) {
+            break;
+        }
+        status = slot->status;
+        if (status != V2F_E_NONE) {
+            log_error("Error decoding the envelope.");
+            break;
+        }
+        if (slot->is_shadow) {
+            log_info("Received a shadow envelop with %lu samples.", slot->sample_count);
+        } else {
+            log_info("Decoded an envelop with %lu samples.", slot->sample_count);
+        }
 
-                log_info("... successfully enveloped %lu shadow samples into a 0 byte bitstream.",
-                         read_sample_count);
+        // Finally output the selected samples to the output file
+        const uint64_t skipped_count = slot->first_sample < first_sample ? first_sample - slot->first_sample : 0;
+        uint64_t output_count = slot->sample_count - skipped_count;
+        if (slot->first_sample + slot->sample_count > end_sample) {
+            output_count -= slot->first_sample + slot->sample_count - end_sample;
+        }
+        if (is_output_mapped) {
+            if (reconstructed_mapping.size - reconstructed_mapping.position < bytes_per_sample * output_count) {
+                // LCOV_EXCL_START
+                log_error("The compressed file changed while being decompressed");
+                status = V2F_E_IO;
+                break;
+                // LCOV_EXCL_STOP
             }
-
-            processed_sample_count += read_sample_count;
+            v2f_file_pack_big_endian(
+                    slot->samples_16 != NULL ? NULL : slot->samples + skipped_count,
+                    slot->samples_16 != NULL ? slot->samples_16 + skipped_count : NULL,
+                    output_count, bytes_per_sample, reconstructed_mapping.data + reconstructed_mapping.position);
+            reconstructed_mapping.position += bytes_per_sample * output_count;
+        } else if (slot->samples_16 != NULL) {
+            status = v2f_file_write_big_endian_16(
+                    reconstructed_file, slot->samples_16 + skipped_count, output_count, bytes_per_sample);
+        } else {
+            status = v2f_file_write_big_endian(
+                    reconstructed_file, slot->samples + skipped_count, output_count, bytes_per_sample);
         }
-
-        if (is_shadow_block) {
-            processed_shadow_count++;
+        if (status != V2F_E_NONE) {
+            log_error("Error writing samples to output buffer.");
+            break;
         }
-    }
-    log_info("Processed %lu samples in total", processed_sample_count);
-    if (processed_shadow_count < y_shadow_count) {
-        log_warning("Processed only %u out of %u shadow regions. "
-                    "The remaining regions lie beyond the encountered EOF "
-                    "and are ignored.\n",
-                    processed_shadow_count, y_shadow_count);
+        v2f_file_block_pool_release(&pool);
     }
 
-    // Cleanup and report status
-    v2f_file_destroy_read_codec(&compressor, &decompressor);
-    free(input_sample_buffer);
-    free(compressed_block_buffer);
+    // The reader is stopped before its state is inspected
+    v2f_file_block_pool_destroy(&pool);
+    decorrelator->thread_count = decorrelator_thread_count;
+    if (is_output_mapped) {
+        const v2f_error_t unmap_status = v2f_file_unmap(reconstructed_file, &reconstructed_mapping, true);
+        status = status != V2F_E_NONE ? status : unmap_status;
+    }
+    if (is_mapped) {
+        const v2f_error_t unmap_status = v2f_file_unmap(compressed_file, &compressed_mapping, false);
+        status = status != V2F_E_NONE ? status : unmap_status;
+    }
+    if (status == V2F_E_NONE && source.next_first_sample < end_sample && select_rows) {
+        log_warning("Rows %lu to %u lie beyond the end of the compressed data and are ignored",
+                    (source.next_first_sample > first_sample ? source.next_first_sample : first_sample)
+                    / samples_per_row, last_row);
+    }
 
-    // V2F_E_NONE is defined to be 0. It is compatible with this method's signature.
-    return (int) status;
+    return status;
 }
 
 // Declared in v2f.h
@@ -1458,7 +3583,8 @@ int v2f_file_decompress_from_path(
         v2f_sample_t step_size,
         bool overwrite_decorrelator_mode,
         v2f_decorrelator_mode_t decorrelator_mode,
-        v2f_sample_t samples_per_row) {
+        v2f_sample_t samples_per_row,
+        v2f_file_options_t const *options) {
 
     // Basic parameter verification
     if (compressed_file_path == NULL || header_file_path == NULL ||
@@ -1481,6 +3607,12 @@ int v2f_file_decompress_from_path(
         return 1;
     }
 
+    if (options != NULL && options->select_rows
+        && (samples_per_row == 0 || options->first_row > options->last_row)) {
+        log_error("Invalid row selection");
+        return 1;
+    }
+
     FILE *compressed_file = fopen(compressed_file_path, "r");
     if (compressed_file == NULL) {
         log_error("Cannot open input file %s for reading",
@@ -1509,7 +3641,7 @@ int v2f_file_decompress_from_path(
             compressed_file, header_file, reconstructed_file,
             overwrite_quantizer_mode, quantizer_mode,
             overwrite_qstep, step_size,
-            overwrite_decorrelator_mode, decorrelator_mode, samples_per_row);
+            overwrite_decorrelator_mode, decorrelator_mode, samples_per_row, options);
 
     // Cleanup
     fclose(compressed_file);
@@ -1530,18 +3662,30 @@ int v2f_file_decompress_from_file(
         v2f_sample_t step_size,
         bool overwrite_decorrelator_mode,
         v2f_decorrelator_mode_t decorrelator_mode,
-        v2f_sample_t samples_per_row) {
+        v2f_sample_t samples_per_row,
+        v2f_file_options_t const *options) {
     if (compressed_file == NULL
         || header_file == NULL
         || reconstructed_file == NULL) {
         log_error("Invalid parameters");
         return 1;
     }
+    if (options == NULL) {
+        options = &v2f_file_default_options;
+    }
+    if (options->thread_count > V2F_C_MAX_THREAD_COUNT) {
+        log_error("Invalid thread count %u", options->thread_count);
+        return 1;
+    }
+    if (options->select_rows && (samples_per_row == 0 || options->first_row > options->last_row)) {
+        log_error("Invalid row selection");
+        return 1;
+    }
 
     // Read the entropy coder/decoder pair in the header file
     v2f_compressor_t compressor;
     v2f_decompressor_t decompressor;
-    if (v2f_file_read_codec(header_file, &compressor, &decompressor)
+    if (v2f_file_read_codec_cached(header_file, options->forest_cache_path, &compressor, &decompressor)
         != V2F_E_NONE) {
         log_error("Error reading the V2F codec file");
         return 1;
@@ -1559,134 +3703,80 @@ int v2f_file_decompress_from_file(
     }
     compressor.decorrelator->samples_per_row = samples_per_row;
 
-    // Prepare buffers for the worst case
-    // (full block with 1 word per input sample)
-    uint8_t *compressed_block_buffer = (uint8_t *) malloc(
-            compressor.entropy_coder->bytes_per_word *
-            (size_t) V2F_C_MAX_BLOCK_SIZE);
-    v2f_sample_t *output_sample_buffer = (v2f_sample_t *) malloc(
-            sizeof(v2f_sample_t) * V2F_C_MAX_BLOCK_SIZE);
-    if (output_sample_buffer == NULL || compressed_block_buffer == NULL) {
-        log_error(
-                "Error allocating input or output buffers of %ld and %d bytes.\n",
-                sizeof(v2f_sample_t) * V2F_C_MAX_BLOCK_SIZE,
-                V2F_C_MAX_COMPRESSED_BLOCK_SIZE);
-        if (output_sample_buffer != NULL) {
-            free(output_sample_buffer);
-        }
-        if (compressed_block_buffer != NULL) {
-            free(compressed_block_buffer);
-        }
-        v2f_file_destroy_read_codec(&compressor, &decompressor);
-        return 1;
-    }
+    v2f_error_t status = v2f_file_decompress_blocks(
+            compressed_file, reconstructed_file, &decompressor, options->select_rows, options->first_row,
+            options->last_row, v2f_file_get_worker_count(options), NULL, options->map_files);
 
-    v2f_error_t status = V2F_E_NONE;
-    bool found_eof_at_first_element = false;
-    while (status == V2F_E_NONE) {
-        // Read the compressed envelope
-        // 1 - `compressed_bitstream_size`: 4 bytes, unsigned big-endian integer.
-        v2f_sample_t compressed_bitstream_size;
-        {
-            uint64_t read_count;
-            status = v2f_file_read_big_endian(
-                    compressed_file, &compressed_bitstream_size,
-                    1, 4, &read_count);
-            if (status != V2F_E_NONE) {
-                if (status == V2F_E_UNEXPECTED_END_OF_FILE &&
-                    read_count == 0) {
-                    // EOFs are expected to be aligned with envelopes.
-                    found_eof_at_first_element = true;
-                }
-                break;
-            }
-        }
-        const bool is_shadow_block = (compressed_bitstream_size == 0);
+    v2f_file_destroy_read_codec(&compressor, &decompressor);
 
-        if (compressed_bitstream_size > V2F_C_MAX_COMPRESSED_BLOCK_SIZE
-            || (compressed_bitstream_size %
-                compressor.entropy_coder->bytes_per_word
-                != 0)) {
-            status = V2F_E_CORRUPTED_DATA;
-            log_error("Corrupted envelope (compressed_bitstream_size=%u)",
-                      compressed_bitstream_size);
-            break;
-        }
+    // V2F_E_NONE is defined to be 0. It is compatible with this method's signature.
+    return (int) status;
+}
 
-        // 2 - `sample_count`: 4 bytes, unsigned big-endian integer.
-        v2f_sample_t sample_count;
-        {
-            status = v2f_file_read_big_endian(
-                    compressed_file, &sample_count, 1, 4, NULL);
-            if (status != V2F_E_NONE) {
-                break;
-            }
-            if (sample_count < V2F_C_MIN_BLOCK_SIZE
-                || sample_count > V2F_C_MAX_BLOCK_SIZE) {
-                status = V2F_E_CORRUPTED_DATA;
-                log_error("Corrupted envelope (sample_count=%u)", sample_count);
-                break;
-            }
-        }
+v2f_error_t v2f_file_create_workspace(v2f_file_workspace_t *const workspace) {
+    if (workspace == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    workspace->samples = NULL;
+    workspace->samples_16 = NULL;
+    workspace->bitstream = NULL;
 
-        if (!is_shadow_block) {
-            // 3 - `compressed_bitstream`: `compressed_bitstream_size` `bytes`.
-            if (fread(compressed_block_buffer, 1,
-                      compressed_bitstream_size, compressed_file)
-                != compressed_bitstream_size) {
-                status = V2F_E_CORRUPTED_DATA;
-                log_error("Corrupted envelope?");
-                break;
-            }
+    return V2F_E_NONE;
+}
 
-            // At this point, data have been successfully read.
-            // Now decode the envelope.
-            {
-                uint64_t decoded_sample_count;
-                status = v2f_decompressor_decompress_block(
-                        &decompressor, compressed_block_buffer,
-                        compressed_bitstream_size, sample_count,
-                        output_sample_buffer, &decoded_sample_count);
-                if (decoded_sample_count != sample_count) {
-                    // The field and the actual number of samples shall match
-                    status = V2F_E_CORRUPTED_DATA;
-                }
-            }
-            if (status != V2F_E_NONE) {
-                log_error("Error decoding the envelope.");
-                break;
-            }
+v2f_error_t v2f_file_destroy_workspace(v2f_file_workspace_t *const workspace) {
+    if (workspace == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    free(workspace->samples);
+    free(workspace->samples_16);
+    free(workspace->bitstream);
 
-            log_info("Decoded an envelop with %u samples.", sample_count);
-        } else {
-            memset(output_sample_buffer, 0, sizeof(v2f_sample_t) * sample_count);
-            log_info("Received a shadow envelop with %u samples.", sample_count);
-        }
+    return v2f_file_create_workspace(workspace);
+}
 
-        // Finally output the samples to the output file
-        status = v2f_file_write_big_endian(
-                reconstructed_file,
-                output_sample_buffer,
-                sample_count,
-                decompressor.entropy_decoder->bytes_per_sample);
-        if (status != V2F_E_NONE) {
-            log_error("Error writing samples to output buffer.");
-            break;
-        }
+v2f_error_t v2f_file_compress_with_codec(
+        FILE *raw_file,
+        FILE *output_file,
+        v2f_compressor_t *const compressor,
+        uint8_t bytes_per_sample,
+        uint32_t const *const shadow_y_pairs,
+        uint32_t y_shadow_count,
+        bool write_block_index,
+        v2f_file_workspace_t *const workspace) {
+    if (raw_file == NULL || output_file == NULL || compressor == NULL
+        || bytes_per_sample < 1 || bytes_per_sample > 4) {
+        log_error("Invalid parameters");
+        return V2F_E_INVALID_PARAMETER;
     }
-
-    // The way it is signaled when no more block envelopes are present
-    // is by finding an and of file while reading the first element of the
-    // envelope (and having read exactly 0 bytes in that read)
-    if (status == V2F_E_UNEXPECTED_END_OF_FILE && found_eof_at_first_element) {
-        status = V2F_E_NONE;
+    if ((shadow_y_pairs == NULL) != (y_shadow_count == 0)
+        || (y_shadow_count != 0 && compressor->decorrelator->samples_per_row == 0)) {
+        log_error("Invalid shadow description");
+        return V2F_E_INVALID_PARAMETER;
     }
 
-    v2f_file_destroy_read_codec(&compressor, &decompressor);
+    return v2f_file_compress_blocks(
+            raw_file, output_file, compressor, bytes_per_sample, shadow_y_pairs, y_shadow_count, write_block_index,
+            0, workspace, false);
+}
 
-    free(output_sample_buffer);
-    free(compressed_block_buffer);
+v2f_error_t v2f_file_decompress_with_codec(
+        FILE *compressed_file,
+        FILE *reconstructed_file,
+        v2f_decompressor_t *const decompressor,
+        bool select_rows,
+        uint32_t first_row,
+        uint32_t last_row,
+        v2f_file_workspace_t *const workspace) {
+    if (compressed_file == NULL || reconstructed_file == NULL || decompressor == NULL) {
+        log_error("Invalid parameters");
+        return V2F_E_INVALID_PARAMETER;
+    }
+    if (select_rows && (decompressor->decorrelator->samples_per_row == 0 || first_row > last_row)) {
+        log_error("Invalid row selection");
+        return V2F_E_INVALID_PARAMETER;
+    }
 
-    // V2F_E_NONE is defined to be 0. It is compatible with this method's signature.
-    return (int) status;
+    return v2f_file_decompress_blocks(
+            compressed_file, reconstructed_file, decompressor, select_rows, first_row, last_row, 0, workspace, false);
 }
@@ -11,6 +11,23 @@
 #include "v2f_compressor.h"
 #include "v2f_decompressor.h"
 
+/**
+ * @struct v2f_file_workspace_t
+ *
+ * Block buffers reused by v2f_file_compress_with_codec() and v2f_file_decompress_with_codec()
+ * across files, so that long-running processes do not allocate them for each file.
+ * Buffers are allocated the first time they are needed, with room for any codec.
+ * A workspace must not be used by two threads at the same time.
+ */
+typedef struct {
+    /// Buffer for @ref V2F_C_MAX_BLOCK_SIZE samples, or NULL if not used yet.
+    v2f_sample_t *samples;
+    /// Buffer for @ref V2F_C_MAX_BLOCK_SIZE 16-bit samples, or NULL if not used yet.
+    v2f_sample16_t *samples_16;
+    /// Buffer for @ref V2F_C_MAX_COMPRESSED_BLOCK_SIZE bytes, or NULL if not used yet.
+    uint8_t *bitstream;
+} v2f_file_workspace_t;
+
 /**
  * Write a compressor/decompressor pair to @a output_file with
  * the following format:
@@ -28,9 +45,11 @@
  * - forest_id: 4 bytes, unsigned bit endian.
  *   If this field is set to 0, it indicates that a explicit
  *   definition of the V2F forest is included afterwards.
- *   If set to a larger value v, the (v-1)-th prebuilt forest is used.
+ *   If set to a larger value v, the built-in forest with id v is used
+ *   (see v2f_forest_registry.h). It is written for pairs loaded with
+ *   v2f_forest_registry_load().
  *
- * - V2F forest: If forest_id != 0, an entropy coder/decoder pair definition,
+ * - V2F forest: If forest_id == 0, an entropy coder/decoder pair definition,
  *   as output by @ref v2f_file_write_forest (variable length).
  *
  *
@@ -56,12 +75,36 @@ v2f_error_t v2f_file_write_codec(
  * @return
  *  - @ref V2F_E_NONE : Read successfull
  *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ *  - @ref V2F_E_FEATURE_NOT_IMPLEMENTED : The forest_id is not that of a built-in forest
  */
 v2f_error_t v2f_file_read_codec(
         FILE* input_file,
         v2f_compressor_t *const compressor,
         v2f_decompressor_t *const decompressor);
 
+/**
+ * Read a compressor/decompressor pair from @a input_file, mapping its forest
+ * from the cache at @a forest_cache_path when possible.
+ *
+ * The cache is used if it was written for the current contents of @a input_file.
+ * Otherwise, the forest is read from @a input_file as in v2f_file_read_codec(),
+ * and the cache is rewritten. Failing to rewrite the cache is not an error.
+ *
+ * @param input_file file open for reading, positioned at the start of the codec definition
+ * @param forest_cache_path path to the forest cache. If NULL, no cache is used.
+ * @param compressor compressor to be initialized
+ * @param decompressor decompressor to be initialized
+ * @return
+ *  - @ref V2F_E_NONE : Read successfull
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ *  - @ref V2F_E_FEATURE_NOT_IMPLEMENTED : The forest_id is not that of a built-in forest
+ */
+v2f_error_t v2f_file_read_codec_cached(
+        FILE* input_file,
+        char const *const forest_cache_path,
+        v2f_compressor_t *const compressor,
+        v2f_decompressor_t *const decompressor);
+
 
 /**
  * Free all resources allocated when reading the compressor/decompressor
@@ -201,7 +244,9 @@ v2f_error_t v2f_file_read_forest(
         v2f_entropy_decoder_t *const decoder);
 
 /**
- * Free all memory allocated by @ref v2f_file_read_forest.
+ * Free all memory allocated by @ref v2f_file_read_forest, or unmap a forest
+ * mapped by @ref v2f_file_map_forest_cache. Pairs of built-in forests
+ * (see v2f_forest_registry_load()) are only detached from their tables.
  * Freeing other coders/decoders may cause a crash.
  *
  * @param coder coder to be destroyed.
@@ -213,6 +258,75 @@ v2f_error_t v2f_file_read_forest(
  */
 v2f_error_t v2f_file_destroy_read_forest(v2f_entropy_coder_t *coder, v2f_entropy_decoder_t *decoder);
 
+/**
+ * Write the compiled tables of a coder/decoder pair to a forest cache file,
+ * which can be mapped back to memory with v2f_file_map_forest_cache().
+ *
+ * The cache holds the tables in the native format of the machine, with all
+ * references between elements stored as positions within the tables.
+ * It is not meant to be exchanged between machines, but to avoid reading
+ * the forest of a codec file each time it is used.
+ *
+ * @param output file open for writing
+ * @param coder compiled coder (see v2f_entropy_coder_compile())
+ * @param decoder compiled decoder of the same forest (see v2f_entropy_decoder_compile())
+ * @param content_hash hash of the codec file that defines the forest,
+ *   checked by v2f_file_map_forest_cache() to detect stale caches
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The cache was successfully written
+ *  - @ref V2F_E_INVALID_PARAMETER : The coder or the decoder are not compiled
+ *  - @ref V2F_E_IO : Error writing to the file
+ */
+v2f_error_t v2f_file_write_forest_cache(
+        FILE *output,
+        v2f_entropy_coder_t const *const coder,
+        v2f_entropy_decoder_t const *const decoder,
+        uint64_t content_hash);
+
+/**
+ * Map a forest cache written by v2f_file_write_forest_cache() and initialize
+ * a coder/decoder pair that uses its tables directly.
+ *
+ * The tables are validated, so that corrupted caches cannot cause
+ * invalid memory accesses, but no memory is allocated and no pointers are restored.
+ * The resulting coder and decoder can only be used for compression and decompression
+ * (they have no forest structure), and must be released with v2f_file_destroy_read_forest().
+ * Caches that are not regular files owned by the effective user, or that others can write,
+ * are rejected, since their tables could change after being validated.
+ *
+ * @param path path to the cache file
+ * @param content_hash expected hash of the codec file that defines the forest
+ * @param coder coder to be initialized
+ * @param decoder decoder to be initialized
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The cache was successfully mapped
+ *  - @ref V2F_E_INVALID_PARAMETER : Invalid parameters
+ *  - @ref V2F_E_IO : The cache cannot be opened or mapped
+ *  - @ref V2F_E_CORRUPTED_DATA : The cache is not valid, it is not private to the user,
+ *    or it was written for different codec file contents
+ */
+v2f_error_t v2f_file_map_forest_cache(
+        char const *const path,
+        uint64_t content_hash,
+        v2f_entropy_coder_t *const coder,
+        v2f_entropy_decoder_t *const decoder);
+
+/**
+ * Compute the hash of the contents of a file that identifies its forest caches.
+ * The file position is not modified.
+ *
+ * @param input file open for reading
+ * @param content_hash pointer where the hash is stored
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The hash was computed
+ *  - @ref V2F_E_INVALID_PARAMETER : Invalid parameters
+ *  - @ref V2F_E_IO : Error reading the file
+ */
+v2f_error_t v2f_file_hash_contents(FILE *input, uint64_t *const content_hash);
+
 /**
  * Verify the validity of a coder/decoder pair. Useful when the pair
  * is loaded from a file.
@@ -271,13 +385,41 @@ v2f_error_t v2f_file_read_big_endian(
         uint8_t bytes_per_sample,
         uint64_t* read_sample_count);
 
+/**
+ * Read up to @a max_sample_count samples in big endian format from
+ * @a input_file, and store them into a buffer of 16-bit samples.
+ *
+ * This function behaves as v2f_file_read_big_endian(), but only
+ * 1 or 2 bytes per sample are supported.
+ *
+ * @param input_file file open for reading.
+ * @param sample_buffer buffer with space for at least `max_sample_count` elements.
+ * @param max_sample_count maximum number of samples to be read.
+ *   Cannot be larger than @ref V2F_C_MAX_BLOCK_SIZE.
+ * @param bytes_per_sample number of bytes per sample used for reading, 1 or 2.
+ * @param read_sample_count if not NULL, the total number of samples
+ *   stored in @a sample_buffer is stored there. Otherwise, it is
+ *   ignored.
+ *
+ * @return the same values as v2f_file_read_big_endian().
+ */
+v2f_error_t v2f_file_read_big_endian_16(
+        FILE *input_file,
+        v2f_sample16_t *sample_buffer,
+        uint64_t max_sample_count,
+        uint8_t bytes_per_sample,
+        uint64_t *read_sample_count);
+
 /**
  * Write samples to a file, storing them in big endian order.
  *
+ * Samples are serialized in chunks of a few thousand samples,
+ * which are output with a single fwrite call each.
+ *
  * @param output_file file open for writing.
  * @param sample_buffer buffer of samples to be writen.
  * @param sample_count number of samples in the buffer.
- * @param bytes_per_sample number of bytes per output
+ * @param bytes_per_sample number of bytes per output sample, between 1 and 4.
  *
  * @return
  *  - @ref V2F_E_NONE : Samples successfully writen
@@ -290,4 +432,153 @@ v2f_error_t v2f_file_write_big_endian(
         uint64_t sample_count,
         uint8_t bytes_per_sample);
 
+/**
+ * Write 16-bit samples to a file, storing them in big endian order.
+ *
+ * This function behaves as v2f_file_write_big_endian(), but only
+ * 1 or 2 bytes per sample are supported.
+ *
+ * @param output_file file open for writing.
+ * @param sample_buffer buffer of samples to be writen.
+ * @param sample_count number of samples in the buffer.
+ * @param bytes_per_sample number of bytes per output sample, 1 or 2.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : Samples successfully writen
+ *  - @ref V2F_E_INVALID_PARAMETER : Invalid input parameters
+ *  - @ref V2F_E_IO : Could not write the block
+ */
+v2f_error_t v2f_file_write_big_endian_16(
+        FILE *output_file,
+        v2f_sample16_t const *const sample_buffer,
+        uint64_t sample_count,
+        uint8_t bytes_per_sample);
+
+/**
+ * Convert big-endian samples stored in a byte buffer into samples,
+ * as done by v2f_file_read_big_endian() and v2f_file_read_big_endian_16().
+ *
+ * @param bytes buffer with `sample_count * bytes_per_sample` bytes
+ * @param sample_count number of samples to be converted
+ * @param bytes_per_sample number of bytes per sample in `bytes`, between 1 and 4
+ * @param sample_buffer buffer for at least `sample_count` samples, or NULL if `sample_buffer_16` is used
+ * @param sample_buffer_16 buffer for at least `sample_count` 16-bit samples, or NULL if `sample_buffer` is used.
+ *   In that case, `bytes_per_sample` must be at most 2.
+ */
+void v2f_file_unpack_big_endian(
+        uint8_t const *const bytes,
+        uint64_t sample_count,
+        uint8_t bytes_per_sample,
+        v2f_sample_t *const sample_buffer,
+        v2f_sample16_t *const sample_buffer_16);
+
+/**
+ * Convert samples into big-endian samples stored in a byte buffer,
+ * as done by v2f_file_write_big_endian() and v2f_file_write_big_endian_16().
+ *
+ * @param sample_buffer buffer with `sample_count` samples, or NULL if `sample_buffer_16` is used
+ * @param sample_buffer_16 buffer with `sample_count` 16-bit samples, or NULL if `sample_buffer` is used.
+ *   In that case, `bytes_per_sample` must be at most 2.
+ * @param sample_count number of samples to be converted
+ * @param bytes_per_sample number of bytes per sample in `bytes`, between 1 and 4
+ * @param bytes buffer for at least `sample_count * bytes_per_sample` bytes
+ */
+void v2f_file_pack_big_endian(
+        v2f_sample_t const *const sample_buffer,
+        v2f_sample16_t const *const sample_buffer_16,
+        uint64_t sample_count,
+        uint8_t bytes_per_sample,
+        uint8_t *const bytes);
+
+/**
+ * Initialize an empty workspace. No memory is allocated until it is used.
+ *
+ * @param workspace workspace to be initialized
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the workspace was initialized
+ *  - @ref V2F_E_INVALID_PARAMETER : `workspace` is NULL
+ */
+v2f_error_t v2f_file_create_workspace(v2f_file_workspace_t *const workspace);
+
+/**
+ * Free the buffers of a workspace initialized with v2f_file_create_workspace().
+ *
+ * @param workspace workspace to be destroyed
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the workspace was destroyed
+ *  - @ref V2F_E_INVALID_PARAMETER : `workspace` is NULL
+ */
+v2f_error_t v2f_file_destroy_workspace(v2f_file_workspace_t *const workspace);
+
+/**
+ * Compress all samples of an open file with an already loaded compressor,
+ * writing the same output as v2f_file_compress_from_file().
+ *
+ * Blocks are compressed sequentially in the calling thread with the buffers of `workspace`,
+ * and `compressor` is not modified, so several threads can use the same compressor
+ * concurrently, each with its own workspace.
+ *
+ * @param raw_file file open for reading with the samples to be compressed.
+ *   All remaining data are consumed.
+ * @param output_file file open for writing where the compressed data are stored.
+ * @param compressor compressor to be used. Its decorrelator's number of samples per row
+ *   is used as in v2f_file_compress_from_file().
+ * @param bytes_per_sample number of bytes per sample in `raw_file`, between 1 and 4.
+ * @param shadow_y_pairs shadow regions, as described in v2f_file_compress_from_path(), or NULL.
+ * @param y_shadow_count number of shadow regions.
+ * @param write_block_index if true, the block index described in v2f_file_compress_from_path() is written.
+ * @param workspace workspace whose buffers are used, or NULL to allocate them for this call only.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : all samples were compressed
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameters
+ *  - @ref V2F_E_OUT_OF_MEMORY : not enough memory for the block buffers
+ *  - @ref V2F_E_CORRUPTED_DATA : the number of samples is not a multiple of the number of samples per row
+ *  - Any error produced while reading, compressing or writing the blocks
+ */
+v2f_error_t v2f_file_compress_with_codec(
+        FILE *raw_file,
+        FILE *output_file,
+        v2f_compressor_t *const compressor,
+        uint8_t bytes_per_sample,
+        uint32_t const *const shadow_y_pairs,
+        uint32_t y_shadow_count,
+        bool write_block_index,
+        v2f_file_workspace_t *const workspace);
+
+/**
+ * Decompress an open file with an already loaded decompressor,
+ * writing the same output as v2f_file_decompress_from_file().
+ *
+ * Blocks are decompressed sequentially in the calling thread with the buffers of `workspace`,
+ * and `decompressor` is not modified, so several threads can use the same decompressor
+ * concurrently, each with its own workspace.
+ *
+ * @param compressed_file file open for reading with the compressed data.
+ * @param reconstructed_file file open for writing where the reconstructed samples are stored.
+ * @param decompressor decompressor to be used.
+ * @param select_rows if true, only rows `first_row` to `last_row` are reconstructed,
+ *   as described in v2f_file_decompress_from_path(). The number of samples per row
+ *   of the decorrelator of `decompressor` must not be 0.
+ * @param first_row first reconstructed row if `select_rows` is true.
+ * @param last_row last reconstructed row if `select_rows` is true, not smaller than `first_row`.
+ * @param workspace workspace whose buffers are used, or NULL to allocate them for this call only.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the selected blocks were decompressed
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameters
+ *  - @ref V2F_E_OUT_OF_MEMORY : not enough memory for the block buffers
+ *  - Any error produced while reading, decompressing or writing the blocks
+ */
+v2f_error_t v2f_file_decompress_with_codec(
+        FILE *compressed_file,
+        FILE *reconstructed_file,
+        v2f_decompressor_t *const decompressor,
+        bool select_rows,
+        uint32_t first_row,
+        uint32_t last_row,
+        v2f_file_workspace_t *const workspace);
+
 #endif /* V2F_FILE_H */
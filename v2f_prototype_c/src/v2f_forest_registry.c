@@ -0,0 +1,256 @@
+/**
+ * @file v2f_forest_registry.c
+ *
+ * Compiled tables of the forests built into the library.
+ */
+
+#include "v2f_forest_registry.h"
+
+#include <stdint.h>
+
+#include "log.h"
+#include "errors.h"
+
+/**
+ * @struct v2f_forest_registry_entry_t
+ *
+ * Compiled tables of a built-in forest, laid out as in v2f_entropy_coder_compile()
+ * and v2f_entropy_decoder_compile().
+ */
+typedef struct {
+    /// Number of bytes per word of the forest.
+    uint8_t bytes_per_word;
+    /// Number of bytes per sample of the forest.
+    uint8_t bytes_per_sample;
+    /// Maximum sample value supported by the forest.
+    v2f_sample_t max_expected_value;
+
+    /// Coder states.
+    v2f_entropy_coder_state_t const *states;
+    /// Number of elements in `states`.
+    uint32_t state_count;
+    /// Coder transitions.
+    uint32_t const *transitions;
+    /// Number of elements in `transitions`.
+    uint64_t transition_count;
+    /// Coder root transition offsets (`max_expected_value` + 2 elements).
+    uint64_t const *root_transition_offsets;
+
+    /// Decoder words.
+    v2f_entropy_decoder_word_t const *words;
+    /// Number of elements in `words`.
+    uint64_t word_count;
+    /// Decoder sample pool.
+    v2f_sample_t const *sample_pool;
+    /// Decoder sample pool with 16 bits per sample, or NULL.
+    v2f_sample16_t const *sample_pool_16;
+    /// Number of elements in `sample_pool`.
+    uint64_t sample_pool_size;
+    /// Decoder state for the first word of each block.
+    v2f_entropy_decoder_state_t initial_state;
+} v2f_forest_registry_entry_t;
+
+/// Expand `m(16 * h)` to `m(16 * h + 15)`, each followed by a comma.
+#define V2F_FOREST_REGISTRY_REPEAT_16(m, h) \
+    m(16 * (h) + 0), m(16 * (h) + 1), m(16 * (h) + 2), m(16 * (h) + 3), \
+    m(16 * (h) + 4), m(16 * (h) + 5), m(16 * (h) + 6), m(16 * (h) + 7), \
+    m(16 * (h) + 8), m(16 * (h) + 9), m(16 * (h) + 10), m(16 * (h) + 11), \
+    m(16 * (h) + 12), m(16 * (h) + 13), m(16 * (h) + 14), m(16 * (h) + 15),
+
+/// Expand `m(256 * g)` to `m(256 * g + 255)`, each followed by a comma.
+#define V2F_FOREST_REGISTRY_REPEAT_256_AT(m, g) \
+    V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 0) V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 1) \
+    V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 2) V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 3) \
+    V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 4) V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 5) \
+    V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 6) V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 7) \
+    V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 8) V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 9) \
+    V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 10) V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 11) \
+    V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 12) V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 13) \
+    V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 14) V2F_FOREST_REGISTRY_REPEAT_16(m, 16 * (g) + 15)
+
+/// Expand `m(0)` to `m(255)`, each followed by a comma.
+#define V2F_FOREST_REGISTRY_REPEAT_256(m) V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 0)
+
+/// Expand `m(4096 * f)` to `m(4096 * f + 4095)`, each followed by a comma.
+#define V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, f) \
+    V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 0) V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 1) \
+    V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 2) V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 3) \
+    V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 4) V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 5) \
+    V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 6) V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 7) \
+    V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 8) V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 9) \
+    V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 10) V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 11) \
+    V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 12) V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 13) \
+    V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 14) V2F_FOREST_REGISTRY_REPEAT_256_AT(m, 16 * (f) + 15)
+
+/// Expand `m(0)` to `m(65535)`, each followed by a comma.
+#define V2F_FOREST_REGISTRY_REPEAT_65536(m) \
+    V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 0) V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 1) \
+    V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 2) V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 3) \
+    V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 4) V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 5) \
+    V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 6) V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 7) \
+    V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 8) V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 9) \
+    V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 10) V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 11) \
+    V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 12) V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 13) \
+    V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 14) V2F_FOREST_REGISTRY_REPEAT_4096_AT(m, 15)
+
+/// @name Forest 1: minimal forest for 1 byte per word
+
+/// Leaf of word `i`. Leaves emit their word for any sample.
+#define V2F_FOREST_REGISTRY_MINIMAL8_STATE(i) {256, 0, {(uint8_t) (i), 0}}
+/// Sample `i` leads from the root to the leaf of word `i`.
+#define V2F_FOREST_REGISTRY_MINIMAL8_TRANSITION(i) ((i) + 1)
+/// Word `i` is sample `i`, after which the root is used again.
+#define V2F_FOREST_REGISTRY_MINIMAL8_WORD(i) {(i), 1, 1, 256}
+/// Sample `i` of the pool.
+#define V2F_FOREST_REGISTRY_IDENTITY(i) (i)
+
+/// States of forest 1: the root, followed by its leaves.
+static const v2f_entropy_coder_state_t v2f_forest_registry_minimal8_states[1 + 256] = {
+        {0, 256, {0, 0}},
+        V2F_FOREST_REGISTRY_REPEAT_256(V2F_FOREST_REGISTRY_MINIMAL8_STATE)
+};
+
+/// Transitions of forest 1 (only the root has children).
+static const uint32_t v2f_forest_registry_minimal8_transitions[256] = {
+        V2F_FOREST_REGISTRY_REPEAT_256(V2F_FOREST_REGISTRY_MINIMAL8_TRANSITION)
+};
+
+/// Root transition offsets of forest 1. All roots are aliases of the root in state 0.
+static const uint64_t v2f_forest_registry_minimal8_root_transition_offsets[256 + 1] = {0};
+
+/// Words of forest 1, between the invalid word of the error root and that of the root.
+static const v2f_entropy_decoder_word_t v2f_forest_registry_minimal8_words[1 + 256 + 1] = {
+        {0, 0, 0, 0},
+        V2F_FOREST_REGISTRY_REPEAT_256(V2F_FOREST_REGISTRY_MINIMAL8_WORD)
+        {0, 0, 0, 0}
+};
+
+/// Sample pool of forest 1.
+static const v2f_sample_t v2f_forest_registry_minimal8_sample_pool[256] = {
+        V2F_FOREST_REGISTRY_REPEAT_256(V2F_FOREST_REGISTRY_IDENTITY)
+};
+
+/// Sample pool of forest 1 with 16 bits per sample.
+static const v2f_sample16_t v2f_forest_registry_minimal8_sample_pool_16[256] = {
+        V2F_FOREST_REGISTRY_REPEAT_256(V2F_FOREST_REGISTRY_IDENTITY)
+};
+
+/// @name Forest 2: minimal forest for 2 bytes per word
+
+/// Leaf of word `i`, whose bytes are stored in big-endian order.
+#define V2F_FOREST_REGISTRY_MINIMAL16_STATE(i) {65536, 0, {(uint8_t) ((i) >> 8), (uint8_t) ((i) & 0xff)}}
+/// Sample `i` leads from the root to the leaf of word `i`.
+#define V2F_FOREST_REGISTRY_MINIMAL16_TRANSITION(i) ((i) + 1)
+/// Word `i` is sample `i`, after which the root is used again.
+#define V2F_FOREST_REGISTRY_MINIMAL16_WORD(i) {(i), 1, 1, 65536}
+
+/// States of forest 2: the root, followed by its leaves.
+static const v2f_entropy_coder_state_t v2f_forest_registry_minimal16_states[1 + 65536] = {
+        {0, 65536, {0, 0}},
+        V2F_FOREST_REGISTRY_REPEAT_65536(V2F_FOREST_REGISTRY_MINIMAL16_STATE)
+};
+
+/// Transitions of forest 2 (only the root has children).
+static const uint32_t v2f_forest_registry_minimal16_transitions[65536] = {
+        V2F_FOREST_REGISTRY_REPEAT_65536(V2F_FOREST_REGISTRY_MINIMAL16_TRANSITION)
+};
+
+/// Root transition offsets of forest 2. All roots are aliases of the root in state 0.
+static const uint64_t v2f_forest_registry_minimal16_root_transition_offsets[65536 + 1] = {0};
+
+/// Words of forest 2, between the invalid word of the error root and that of the root.
+static const v2f_entropy_decoder_word_t v2f_forest_registry_minimal16_words[1 + 65536 + 1] = {
+        {0, 0, 0, 0},
+        V2F_FOREST_REGISTRY_REPEAT_65536(V2F_FOREST_REGISTRY_MINIMAL16_WORD)
+        {0, 0, 0, 0}
+};
+
+/// Sample pool of forest 2.
+static const v2f_sample_t v2f_forest_registry_minimal16_sample_pool[65536] = {
+        V2F_FOREST_REGISTRY_REPEAT_65536(V2F_FOREST_REGISTRY_IDENTITY)
+};
+
+/// Sample pool of forest 2 with 16 bits per sample.
+static const v2f_sample16_t v2f_forest_registry_minimal16_sample_pool_16[65536] = {
+        V2F_FOREST_REGISTRY_REPEAT_65536(V2F_FOREST_REGISTRY_IDENTITY)
+};
+
+/// Built-in forests. Forest id `i` is element `i - 1`.
+static const v2f_forest_registry_entry_t v2f_forest_registry_entries[] = {
+        {
+                1, 1, 255,
+                v2f_forest_registry_minimal8_states, 1 + 256,
+                v2f_forest_registry_minimal8_transitions, 256,
+                v2f_forest_registry_minimal8_root_transition_offsets,
+                v2f_forest_registry_minimal8_words, 1 + 256 + 1,
+                v2f_forest_registry_minimal8_sample_pool,
+                v2f_forest_registry_minimal8_sample_pool_16,
+                256,
+                {1, 256}
+        },
+        {
+                2, 2, 65535,
+                v2f_forest_registry_minimal16_states, 1 + 65536,
+                v2f_forest_registry_minimal16_transitions, 65536,
+                v2f_forest_registry_minimal16_root_transition_offsets,
+                v2f_forest_registry_minimal16_words, 1 + 65536 + 1,
+                v2f_forest_registry_minimal16_sample_pool,
+                v2f_forest_registry_minimal16_sample_pool_16,
+                65536,
+                {1, 65536}
+        },
+};
+
+/**
+ * Return a pointer to a built-in table as the type of the coder and decoder members.
+ * The tables are never written through these members.
+ *
+ * @param table constant table
+ * @return `table` without the const qualifier
+ */
+static void *v2f_forest_registry_table(void const *const table) {
+    return (void *) (uintptr_t) table;
+}
+
+uint32_t v2f_forest_registry_count(void) {
+    return (uint32_t) (sizeof(v2f_forest_registry_entries) / sizeof(v2f_forest_registry_entry_t));
+}
+
+v2f_error_t v2f_forest_registry_load(
+        uint32_t forest_id,
+        v2f_entropy_coder_t *const coder,
+        v2f_entropy_decoder_t *const decoder) {
+    if (coder == NULL || decoder == NULL || forest_id < 1 || forest_id > v2f_forest_registry_count()) {
+        log_error("forest_id = %u", forest_id);
+        return V2F_E_INVALID_PARAMETER;
+    }
+    v2f_forest_registry_entry_t const *const entry = &(v2f_forest_registry_entries[forest_id - 1]);
+
+    coder->bytes_per_word = entry->bytes_per_word;
+    coder->max_expected_value = entry->max_expected_value;
+    coder->roots = NULL;
+    coder->root_count = entry->max_expected_value + 1;
+    coder->states = v2f_forest_registry_table(entry->states);
+    coder->state_count = entry->state_count;
+    coder->transitions = v2f_forest_registry_table(entry->transitions);
+    coder->transition_count = entry->transition_count;
+    coder->root_transition_offsets = v2f_forest_registry_table(entry->root_transition_offsets);
+
+    decoder->bytes_per_word = entry->bytes_per_word;
+    decoder->bytes_per_sample = entry->bytes_per_sample;
+    decoder->roots = NULL;
+    decoder->root_count = entry->max_expected_value + 1;
+    decoder->null_entry = NULL;
+    decoder->forest_arena = NULL;
+    decoder->sample_pool = v2f_forest_registry_table(entry->sample_pool);
+    decoder->sample_pool_16 = v2f_forest_registry_table(entry->sample_pool_16);
+    decoder->sample_pool_size = entry->sample_pool_size;
+    decoder->words = v2f_forest_registry_table(entry->words);
+    decoder->word_count = entry->word_count;
+    decoder->initial_state = entry->initial_state;
+    decoder->forest_cache = NULL;
+    decoder->forest_cache_size = 0;
+    decoder->forest_id = forest_id;
+
+    return V2F_E_NONE;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file v2f_forest_registry.h
+ *
+ * @brief Forests built into the library, selected by the forest_id field of codec headers.
+ *
+ * The compiled tables of built-in forests are constant data, so using them
+ * requires neither parsing nor allocation.
+ */
+
+#ifndef V2F_FOREST_REGISTRY_H
+#define V2F_FOREST_REGISTRY_H
+
+#include "v2f.h"
+
+/**
+ * Number of built-in forests. Their ids are 1 to this value.
+ *
+ * - 1: minimal forest for 1 byte per word (see v2f_build_minimal_forest()).
+ * - 2: minimal forest for 2 bytes per word.
+ *
+ * Trained forests are added as new ids, after the existing ones, so that
+ * headers written with older versions keep selecting the same forest.
+ *
+ * @return the number of built-in forests
+ */
+uint32_t v2f_forest_registry_count(void);
+
+/**
+ * Initialize a coder/decoder pair that uses the tables of a built-in forest.
+ *
+ * The forest structure is not available, i.e., the roots of the pair are NULL, and
+ * the tables must not be modified. Nothing needs to be released after use.
+ *
+ * @param forest_id id of the built-in forest, between 1 and v2f_forest_registry_count()
+ * @param coder coder to be initialized
+ * @param decoder decoder to be initialized
+ *
+ * @return
+ *  - @ref V2F_E_NONE : The pair was initialized
+ *  - @ref V2F_E_INVALID_PARAMETER : NULL pointer or unknown forest_id
+ */
+v2f_error_t v2f_forest_registry_load(
+        uint32_t forest_id,
+        v2f_entropy_coder_t *const coder,
+        v2f_entropy_decoder_t *const decoder);
+
+#endif /* V2F_FOREST_REGISTRY_H */
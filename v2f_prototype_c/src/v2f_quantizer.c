@@ -14,6 +14,44 @@
 #include "timer.h"
 #include "common.h"
 
+/// Handle of the timer of v2f_quantizer_quantize() and v2f_quantizer_quantize_16()
+TIMER_DEFINE(v2f_quantizer_timer, "v2f_quantizer_quantize")
+
+/**
+ * Compute the reciprocal of a step size used by v2f_quantizer_divide(), so that
+ * samples can be divided by it with a multiplication and shifts instead of a division.
+ *
+ * The round-up method of Granlund and Montgomery is used, so that the quotients
+ * are exact for all 32-bit samples.
+ *
+ * @param step_size divisor, at least 2
+ * @param multiplier pointer where the 32-bit multiplier is stored
+ * @param shift pointer where the final shift is stored
+ */
+static void v2f_quantizer_reciprocal(v2f_sample_t step_size, uint32_t *const multiplier, uint32_t *const shift) {
+    assert(step_size >= 2);
+    uint32_t log2_step_size = 0;
+    while ((UINT64_C(1) << log2_step_size) < step_size) {
+        log2_step_size++;
+    }
+    *multiplier = (uint32_t) (((((UINT64_C(1) << log2_step_size) - step_size) << 32) / step_size) + 1);
+    *shift = log2_step_size - 1;
+}
+
+/**
+ * Divide a sample by a step size given its reciprocal.
+ *
+ * @param sample sample to be divided
+ * @param multiplier multiplier computed by v2f_quantizer_reciprocal() for the step size
+ * @param shift shift computed by v2f_quantizer_reciprocal() for the step size
+ *
+ * @return `sample` divided by the step size, rounded down
+ */
+static inline v2f_sample_t v2f_quantizer_divide(v2f_sample_t sample, uint32_t multiplier, uint32_t shift) {
+    const v2f_sample_t high_product = (v2f_sample_t) (((uint64_t) sample * multiplier) >> 32);
+    return (high_product + ((sample - high_product) >> 1)) >> shift;
+}
+
 v2f_error_t v2f_quantizer_create(
         v2f_quantizer_t *quantizer,
         v2f_quantizer_mode_t mode,
@@ -62,10 +100,10 @@ v2f_error_t v2f_quantizer_quantize(
         return V2F_E_INVALID_PARAMETER;
     }
 
-    timer_start("v2f_quantizer_quantize");
+    timer_start_handle(v2f_quantizer_timer());
 
     if (quantizer->mode == V2F_C_QUANTIZER_MODE_NONE || quantizer->step_size == 1) {
-        timer_stop("v2f_quantizer_quantize");
+        timer_stop_handle(v2f_quantizer_timer());
         return V2F_E_NONE;
     }
 
@@ -101,7 +139,7 @@ v2f_error_t v2f_quantizer_quantize(
             break; // LCOV_EXCL_LINE
     }
 
-    timer_stop("v2f_quantizer_quantize");
+    timer_stop_handle(v2f_quantizer_timer());
 
     return status;
 }
@@ -133,6 +171,72 @@ v2f_error_t v2f_quantizer_dequantize(
     return status;
 }
 
+v2f_error_t v2f_quantizer_quantize_16(
+        v2f_quantizer_t *const quantizer,
+        v2f_sample16_t *const input_samples,
+        uint64_t sample_count) {
+    if (quantizer == NULL || input_samples == NULL || sample_count < 1) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    if (quantizer->mode == V2F_C_QUANTIZER_MODE_NONE || quantizer->step_size == 1) {
+        return V2F_E_NONE;
+    }
+    if (quantizer->mode != V2F_C_QUANTIZER_MODE_UNIFORM) {
+        return V2F_E_INVALID_PARAMETER; // LCOV_EXCL_LINE
+    }
+
+    timer_start_handle(v2f_quantizer_timer());
+
+    // As in v2f_quantizer_quantize(), small power-of-two steps are applied with a shift
+    const v2f_sample_t step_size = quantizer->step_size;
+    const uint32_t shift = step_size == 2 ? 1 : (step_size == 4 ? 2 : (step_size == 8 ? 3 : 0));
+    if (shift > 0) {
+        for (uint64_t i = 0; i < sample_count; i++) {
+            input_samples[i] = (v2f_sample16_t) (input_samples[i] >> shift);
+        }
+    } else {
+        uint32_t multiplier;
+        uint32_t reciprocal_shift;
+        v2f_quantizer_reciprocal(step_size, &multiplier, &reciprocal_shift);
+        for (uint64_t i = 0; i < sample_count; i++) {
+            input_samples[i] = (v2f_sample16_t) v2f_quantizer_divide(input_samples[i], multiplier, reciprocal_shift);
+        }
+    }
+
+    timer_stop_handle(v2f_quantizer_timer());
+
+    return V2F_E_NONE;
+}
+
+v2f_error_t v2f_quantizer_dequantize_16(
+        v2f_quantizer_t *const quantizer,
+        v2f_sample16_t *const input_samples,
+        uint64_t sample_count) {
+    if (quantizer == NULL || input_samples == NULL || sample_count < 1) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    if (quantizer->mode == V2F_C_QUANTIZER_MODE_NONE || quantizer->step_size == 1) {
+        return V2F_E_NONE;
+    }
+    if (quantizer->mode != V2F_C_QUANTIZER_MODE_UNIFORM) {
+        return V2F_E_INVALID_PARAMETER; // LCOV_EXCL_LINE
+    }
+
+    // Reconstructions are computed with 32 bits and clipped to the dynamic range,
+    // which fits in 16 bits, so that the last incomplete quantization bin is handled
+    // as in v2f_quantizer_inverse_uniform().
+    const v2f_sample_t step_size = quantizer->step_size;
+    const v2f_sample_t half_step = step_size >> 1;
+    const v2f_sample_t max_sample_value = quantizer->max_sample_value;
+    assert(max_sample_value <= V2F_SAMPLE16_T_MAX);
+    for (uint64_t i = 0; i < sample_count; i++) {
+        const v2f_sample_t reconstruction = step_size * input_samples[i] + half_step;
+        input_samples[i] = (v2f_sample16_t) MIN(reconstruction, max_sample_value);
+    }
+
+    return V2F_E_NONE;
+}
+
 v2f_error_t v2f_quantizer_apply_uniform_division(
         v2f_sample_t step_size,
         v2f_sample_t *const input_samples,
@@ -143,8 +247,11 @@ v2f_error_t v2f_quantizer_apply_uniform_division(
         return V2F_E_INVALID_PARAMETER;
     }
 
+    uint32_t multiplier;
+    uint32_t shift;
+    v2f_quantizer_reciprocal(step_size, &multiplier, &shift);
     for (uint64_t i = 0; i < sample_count; i++) {
-        input_samples[i] /= step_size;
+        input_samples[i] = v2f_quantizer_divide(input_samples[i], multiplier, shift);
     }
 
     return V2F_E_NONE;
@@ -182,15 +289,11 @@ v2f_error_t v2f_quantizer_inverse_uniform(
     }
 
     assert(sample_count < UINT64_MAX);
+    const v2f_sample_t half_step = step_size >> 1;
     for (uint64_t i = 0; i < sample_count; i++) {
-        input_samples[i] = step_size * input_samples[i] + (step_size >> 1);
-        if (input_samples[i] > max_sample_value) {
-            // Avoid exceeding the dynamic range due to the last quantization
-            // bin being incomplete
-            assert(step_size > 1);
-//            assert((input_samples[i] - max_sample_value) <= (step_size >> 1));
-            input_samples[i] = max_sample_value;
-        }
+        // Avoid exceeding the dynamic range due to the last quantization
+        // bin being incomplete
+        input_samples[i] = MIN(step_size * input_samples[i] + half_step, max_sample_value);
     }
 
     return V2F_E_NONE;
@@ -61,7 +61,44 @@ v2f_error_t v2f_quantizer_dequantize(
         uint64_t sample_count);
 
 /**
- * Apply uniform quantization by dividing each sample
+ * Quantize all samples in the block, stored with 16 bits per sample.
+ *
+ * The result is identical to that of v2f_quantizer_quantize() for the same samples.
+ *
+ * @param quantizer pointer to the quantizer to be used.
+ * @param input_samples samples to be quantized.
+ * @param sample_count number of samples to quantize.
+ * @return
+ *  - @ref V2F_E_NONE : Quantization successful
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ */
+v2f_error_t v2f_quantizer_quantize_16(
+        v2f_quantizer_t *const quantizer,
+        v2f_sample16_t *const input_samples,
+        uint64_t sample_count);
+
+/**
+ * Dequantize all samples in the block, stored with 16 bits per sample.
+ *
+ * The result is identical to that of v2f_quantizer_dequantize() for the same samples.
+ *
+ * @param quantizer pointer to the quantizer to be used.
+ * @param input_samples quantization indices to be dequantized.
+ * @param sample_count number of samples to dequantize.
+ * @return
+ *  - @ref V2F_E_NONE : Dequantization successful
+ *  - @ref V2F_E_INVALID_PARAMETER : At least one invalid parameter
+ */
+v2f_error_t v2f_quantizer_dequantize_16(
+        v2f_quantizer_t *const quantizer,
+        v2f_sample16_t *const input_samples,
+        uint64_t sample_count);
+
+/**
+ * Apply uniform quantization by dividing each sample.
+ * The division is computed as a multiplication by a reciprocal of the step size,
+ * which gives the same results as integer division.
+ *
  * @param step_size number to be used when dividing
  * @param input_samples samples to be quantized
  * @param sample_count number of samples to be quantized
@@ -0,0 +1,1167 @@
+/**
+ * @file v2f_server.c
+ *
+ * Implementation of the compression service.
+ */
+
+// struct ucred, used to check the credentials of peers with SO_PEERCRED, is a GNU extension
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "v2f_server.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "log.h"
+
+/// Maximum number of pending connections of the listening socket
+#define V2F_SERVER_LISTEN_BACKLOG 64
+/// Maximum number of values of the shadow_y option. Each value takes at least 2 bytes of the request.
+#define V2F_SERVER_MAX_SHADOW_VALUE_COUNT (V2F_SERVER_MAX_REQUEST_SIZE / 2)
+
+/**
+ * @struct v2f_server_request_t
+ *
+ * Request received by the dispatcher.
+ */
+typedef struct {
+    /// Received bytes.
+    char buffer[V2F_SERVER_MAX_REQUEST_SIZE];
+    /// Number of received bytes.
+    size_t size;
+    /// Fields of the request, pointing into `buffer`.
+    char const *fields[V2F_SERVER_MAX_FIELD_COUNT];
+    /// Number of fields.
+    uint32_t field_count;
+    /// Descriptors passed with the request. Those already used by the job are set to -1.
+    int passed_fds[V2F_SERVER_MAX_PASSED_FD_COUNT];
+    /// Number of descriptors passed with the request.
+    uint32_t passed_fd_count;
+} v2f_server_request_t;
+
+/**
+ * @struct v2f_server_connection_t
+ *
+ * Connection of a client. While its job is queued or running, it is owned by the workers,
+ * and the dispatcher does not read from it.
+ */
+struct v2f_server_connection_t {
+    /// Connected socket, or -1 if the slot is free.
+    int fd;
+    /// Whether the job of the connection is queued or running.
+    bool is_busy;
+    /// Set by the worker when the connection must be closed after its job.
+    bool must_close;
+    /// Status of the reception of the request. The job is only run if the request was received.
+    v2f_error_t request_status;
+    /// Request being received, or request of the queued or running job.
+    v2f_server_request_t request;
+};
+
+/**
+ * @union v2f_server_control_t
+ *
+ * Buffer for the ancillary data with the descriptors passed with a request,
+ * aligned as required by the cmsghdr structure.
+ */
+typedef union {
+    /// Header of the ancillary data.
+    struct cmsghdr header;
+    /// Room for the header and the descriptors.
+    char buffer[CMSG_SPACE(sizeof(int) * V2F_SERVER_MAX_PASSED_FD_COUNT)];
+} v2f_server_control_t;
+
+/**
+ * Store a socket path into a Unix domain socket address.
+ *
+ * @param socket_path path of the socket
+ * @param address address to be filled
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the address was filled
+ *  - @ref V2F_E_INVALID_PARAMETER : the path is empty or too long
+ */
+static v2f_error_t v2f_server_fill_address(char const *const socket_path, struct sockaddr_un *const address) {
+    const size_t length = strlen(socket_path);
+    if (length == 0 || length >= sizeof(address->sun_path)) {
+        log_error("Invalid socket path %s", socket_path);
+        return V2F_E_INVALID_PARAMETER;
+    }
+    memset(address, 0, sizeof(struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+    memcpy(address->sun_path, socket_path, length + 1);
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Check that the process at the other end of a connected socket runs as the effective user
+ * of this process. Where peer credentials are not available, the permissions of the
+ * server socket are the only access control.
+ *
+ * @param socket_fd connected socket
+ *
+ * @return true if and only if the peer can be trusted
+ */
+static bool v2f_server_peer_is_trusted(int socket_fd) {
+#ifdef SO_PEERCRED
+    struct ucred credentials;
+    socklen_t size = sizeof(credentials);
+    if (getsockopt(socket_fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) != 0
+        || credentials.uid != geteuid()) {
+        log_warning("Rejected connection with a process of another user");
+        return false;
+    }
+#else
+    (void) socket_fd;
+#endif
+    return true;
+}
+
+/**
+ * Remove the socket left at a path by a server that is no longer running.
+ *
+ * @param address address of the socket
+ *
+ * @return
+ *  - @ref V2F_E_NONE : nothing remains at the path
+ *  - @ref V2F_E_IO : the path is not a socket, a server is listening on it, or it cannot be removed
+ */
+static v2f_error_t v2f_server_remove_stale_socket(struct sockaddr_un const *const address) {
+    struct stat socket_stat;
+    if (lstat(address->sun_path, &socket_stat) != 0) {
+        return V2F_E_NONE;
+    }
+    if (!S_ISSOCK(socket_stat.st_mode)) {
+        log_error("Refusing to replace %s, which is not a socket", address->sun_path);
+        return V2F_E_IO;
+    }
+    const int probe_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe_fd < 0) {
+        return V2F_E_IO; // LCOV_EXCL_LINE
+    }
+    const bool is_live = connect(probe_fd, (struct sockaddr const *) address, sizeof(struct sockaddr_un)) == 0;
+    close(probe_fd);
+    if (is_live) {
+        log_error("Another server is listening at %s", address->sun_path);
+        return V2F_E_IO;
+    }
+    if (unlink(address->sun_path) != 0) {
+        log_error("Cannot remove stale socket %s", address->sun_path);
+        return V2F_E_IO;
+    }
+    return V2F_E_NONE;
+}
+
+/**
+ * Set or clear the O_NONBLOCK flag of a descriptor.
+ *
+ * @param fd descriptor
+ * @param is_nonblocking whether the descriptor must be non-blocking
+ *
+ * @return true if and only if the flag could be set or cleared
+ */
+static bool v2f_server_set_nonblocking(int fd, bool is_nonblocking) {
+    const int flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && fcntl(fd, F_SETFL, is_nonblocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK) == 0;
+}
+
+/**
+ * Write a byte to the wake pipe of a server, so that its dispatcher wakes up.
+ *
+ * @param server server
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the dispatcher will wake up
+ *  - @ref V2F_E_IO : the pipe could not be written
+ */
+static v2f_error_t v2f_server_wake_dispatcher(v2f_server_t const *const server) {
+    const char byte = 0;
+    ssize_t result;
+    do {
+        result = write(server->wake_pipe[1], &byte, 1);
+    } while (result < 0 && errno == EINTR);
+    // A full pipe already wakes up the dispatcher
+    if (result != 1 && !(result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))) {
+        log_error("Cannot wake up the dispatcher"); // LCOV_EXCL_LINE
+        return V2F_E_IO; // LCOV_EXCL_LINE
+    }
+    return V2F_E_NONE;
+}
+
+/**
+ * Close the passed descriptors of a request that were not used by its job, and empty the request.
+ *
+ * @param request request to be reset
+ */
+static void v2f_server_reset_request(v2f_server_request_t *const request) {
+    for (uint32_t i = 0; i < request->passed_fd_count; i++) {
+        if (request->passed_fds[i] >= 0) {
+            close(request->passed_fds[i]);
+        }
+    }
+    request->size = 0;
+    request->field_count = 0;
+    request->passed_fd_count = 0;
+}
+
+/**
+ * Split the received bytes of a request into its fields.
+ *
+ * @param request request with the received bytes
+ * @param is_complete pointer where true is stored if the final empty field has been received
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the request is complete or more bytes are needed
+ *  - @ref V2F_E_CORRUPTED_DATA : too many fields, or bytes after the end of the request
+ */
+static v2f_error_t v2f_server_parse_fields(v2f_server_request_t *const request, bool *const is_complete) {
+    *is_complete = false;
+    request->field_count = 0;
+    size_t start = 0;
+    while (start < request->size) {
+        char const *const end = memchr(request->buffer + start, '\0', request->size - start);
+        if (end == NULL) {
+            break;
+        }
+        if (end == request->buffer + start) {
+            *is_complete = true;
+            return end + 1 == request->buffer + request->size ? V2F_E_NONE : V2F_E_CORRUPTED_DATA;
+        }
+        if (request->field_count == V2F_SERVER_MAX_FIELD_COUNT) {
+            return V2F_E_CORRUPTED_DATA;
+        }
+        request->fields[request->field_count] = request->buffer + start;
+        request->field_count++;
+        start = (size_t) (end - request->buffer) + 1;
+    }
+    return request->size < V2F_SERVER_MAX_REQUEST_SIZE ? V2F_E_NONE : V2F_E_CORRUPTED_DATA;
+}
+
+/**
+ * Receive the bytes of a request that are available without blocking, including its passed descriptors.
+ *
+ * @param connection_fd connected socket
+ * @param request request being received. Its passed descriptors must be closed by the caller
+ *   even if an error is returned.
+ * @param is_complete pointer where true is stored if the request is complete
+ * @param is_closed pointer where true is stored if the client closed the connection
+ *   before sending any part of a request
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the request is complete, more bytes are needed, or `is_closed` is true
+ *  - @ref V2F_E_CORRUPTED_DATA : the request is not valid
+ *  - @ref V2F_E_UNEXPECTED_END_OF_FILE : the connection was closed in the middle of a request
+ *  - @ref V2F_E_IO : the request could not be received
+ */
+static v2f_error_t v2f_server_receive_part(
+        int connection_fd,
+        v2f_server_request_t *const request,
+        bool *const is_complete,
+        bool *const is_closed) {
+    *is_complete = false;
+    *is_closed = false;
+
+    struct iovec io_vector = {
+            .iov_base = request->buffer + request->size,
+            .iov_len = V2F_SERVER_MAX_REQUEST_SIZE - request->size};
+    v2f_server_control_t control;
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &io_vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+    const ssize_t received_size = recvmsg(connection_fd, &message, MSG_DONTWAIT);
+    if (received_size < 0) {
+        // Nothing to receive yet: the connection is polled again
+        return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ? V2F_E_NONE : V2F_E_IO;
+    }
+
+    // Keep the passed descriptors, so that they are closed even if the request is not valid
+    bool fds_lost = (message.msg_flags & MSG_CTRUNC) != 0;
+    for (struct cmsghdr *header = CMSG_FIRSTHDR(&message); header != NULL;
+         header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        const size_t fd_count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < fd_count; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+            if (request->passed_fd_count < V2F_SERVER_MAX_PASSED_FD_COUNT) {
+                request->passed_fds[request->passed_fd_count] = fd;
+                request->passed_fd_count++;
+            } else {
+                close(fd);
+                fds_lost = true;
+            }
+        }
+    }
+    if (fds_lost) {
+        log_error("Too many descriptors passed with a request");
+        return V2F_E_CORRUPTED_DATA;
+    }
+
+    if (received_size == 0) {
+        if (request->size == 0 && request->passed_fd_count == 0) {
+            *is_closed = true;
+            return V2F_E_NONE;
+        }
+        return V2F_E_UNEXPECTED_END_OF_FILE;
+    }
+    request->size += (size_t) received_size;
+
+    return v2f_server_parse_fields(request, is_complete);
+}
+
+/**
+ * Parse the decimal value of a request option.
+ *
+ * @param value string with the value
+ * @param max_value maximum valid value
+ * @param output pointer where the value is stored
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the value is valid
+ *  - @ref V2F_E_INVALID_PARAMETER : the value is not a decimal integer between 0 and `max_value`
+ */
+static v2f_error_t v2f_server_parse_value(char const *value, uint64_t max_value, uint64_t *const output) {
+    if (*value == '\0') {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    uint64_t result = 0;
+    for (; *value != '\0'; value++) {
+        if (*value < '0' || *value > '9') {
+            return V2F_E_INVALID_PARAMETER;
+        }
+        result = 10 * result + (uint64_t) (*value - '0');
+        if (result > max_value) {
+            return V2F_E_INVALID_PARAMETER;
+        }
+    }
+    *output = result;
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Parse the value of the shadow_y or the rows option, and check that it describes
+ * non-overlapping row ranges in increasing order.
+ *
+ * @param value comma-separated list of start,end row pairs
+ * @param shadow_y_pairs buffer for @ref V2F_SERVER_MAX_SHADOW_VALUE_COUNT values
+ * @param y_shadow_count pointer where the number of regions is stored
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the list is valid
+ *  - @ref V2F_E_INVALID_PARAMETER : the list is not valid
+ */
+static v2f_error_t v2f_server_parse_shadow(
+        char const *const value,
+        uint32_t *const shadow_y_pairs,
+        uint32_t *const y_shadow_count) {
+    uint32_t value_count = 0;
+    char const *start = value;
+    while (true) {
+        char const *const end = strchr(start, ',');
+        const size_t length = end == NULL ? strlen(start) : (size_t) (end - start);
+        char number[11];
+        uint64_t parsed_value;
+        if (length == 0 || length >= sizeof(number) || value_count == V2F_SERVER_MAX_SHADOW_VALUE_COUNT) {
+            return V2F_E_INVALID_PARAMETER;
+        }
+        memcpy(number, start, length);
+        number[length] = '\0';
+        RETURN_IF_FAIL(v2f_server_parse_value(number, UINT32_MAX, &parsed_value));
+        shadow_y_pairs[value_count] = (uint32_t) parsed_value;
+        value_count++;
+        if (end == NULL) {
+            break;
+        }
+        start = end + 1;
+    }
+
+    if (value_count % 2 != 0) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    for (uint32_t i = 0; i + 1 < value_count; i++) {
+        // Regions are non-decreasing, and consecutive regions do not overlap
+        if (shadow_y_pairs[i] > shadow_y_pairs[i + 1]
+            || (i % 2 == 1 && shadow_y_pairs[i] >= shadow_y_pairs[i + 1])) {
+            return V2F_E_INVALID_PARAMETER;
+        }
+    }
+    *y_shadow_count = value_count / 2;
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Open the input or output file of a job.
+ *
+ * @param request request of the job
+ * @param field input or output field of the request
+ * @param mode mode passed to fopen() or fdopen()
+ * @param next_fd_index pointer to the index of the next passed descriptor to be used, updated when one is used
+ * @param file pointer where the open file is stored
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the file is open
+ *  - @ref V2F_E_INVALID_PARAMETER : no descriptor was passed for the field
+ *  - @ref V2F_E_IO : the file could not be opened
+ */
+static v2f_error_t v2f_server_open_file(
+        v2f_server_request_t *const request,
+        char const *const field,
+        char const *const mode,
+        uint32_t *const next_fd_index,
+        FILE **const file) {
+    if (strcmp(field, "-") != 0) {
+        *file = fopen(field, mode);
+        if (*file == NULL) {
+            log_error("Cannot open %s", field);
+            return V2F_E_IO;
+        }
+        return V2F_E_NONE;
+    }
+
+    if (*next_fd_index >= request->passed_fd_count) {
+        log_error("Missing passed descriptor");
+        return V2F_E_INVALID_PARAMETER;
+    }
+    *file = fdopen(request->passed_fds[*next_fd_index], mode);
+    if (*file == NULL) {
+        log_error("Cannot use passed descriptor");
+        return V2F_E_IO;
+    }
+    // The descriptor is now closed with the file
+    request->passed_fds[*next_fd_index] = -1;
+    (*next_fd_index)++;
+
+    return V2F_E_NONE;
+}
+
+/**
+ * Run the job of a complete request.
+ *
+ * The quantizer and decorrelator of the codec are copied before the options are applied,
+ * so that the shared codec is not modified.
+ *
+ * @param server server that received the request
+ * @param workspace block buffers of the worker
+ * @param request request of the job
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the job was successfully completed
+ *  - @ref V2F_E_INVALID_PARAMETER : the request is not valid
+ *  - Any error produced while compressing or decompressing
+ */
+static v2f_error_t v2f_server_run_job(
+        v2f_server_t const *const server,
+        v2f_file_workspace_t *const workspace,
+        v2f_server_request_t *const request) {
+    if (request->field_count < 4) {
+        log_error("Incomplete request");
+        return V2F_E_INVALID_PARAMETER;
+    }
+    const bool is_compression = strcmp(request->fields[0], "compress") == 0;
+    if (!is_compression && strcmp(request->fields[0], "decompress") != 0) {
+        log_error("Invalid operation %s", request->fields[0]);
+        return V2F_E_INVALID_PARAMETER;
+    }
+    v2f_server_codec_t const *codec = NULL;
+    for (uint32_t i = 0; i < server->codec_count && codec == NULL; i++) {
+        if (strcmp(server->codecs[i].name, request->fields[1]) == 0) {
+            codec = &(server->codecs[i]);
+        }
+    }
+    if (codec == NULL) {
+        log_error("Unknown codec %s", request->fields[1]);
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    v2f_quantizer_t quantizer = *(codec->compressor.quantizer);
+    v2f_decorrelator_t decorrelator = *(codec->compressor.decorrelator);
+    decorrelator.samples_per_row = 0;
+    uint32_t shadow_y_pairs[V2F_SERVER_MAX_SHADOW_VALUE_COUNT];
+    uint32_t y_shadow_count = 0;
+    uint64_t write_block_index = 0;
+    uint32_t selected_rows[V2F_SERVER_MAX_SHADOW_VALUE_COUNT] = {0};
+    uint32_t selected_range_count = 0;
+    for (uint32_t i = 4; i < request->field_count; i++) {
+        char const *const separator = strchr(request->fields[i], '=');
+        if (separator == NULL) {
+            log_error("Invalid option %s", request->fields[i]);
+            return V2F_E_INVALID_PARAMETER;
+        }
+        const size_t key_length = (size_t) (separator - request->fields[i]);
+        char const *const value = separator + 1;
+        uint64_t parsed_value = 0;
+        v2f_error_t status = V2F_E_INVALID_PARAMETER;
+        if (key_length == 14 && strncmp(request->fields[i], "quantizer_mode", key_length) == 0) {
+            status = v2f_server_parse_value(value, V2F_C_QUANTIZER_MODE_COUNT - 1, &parsed_value);
+            quantizer.mode = (v2f_quantizer_mode_t) parsed_value;
+        } else if (key_length == 9 && strncmp(request->fields[i], "step_size", key_length) == 0) {
+            status = v2f_server_parse_value(value, V2F_C_QUANTIZER_MODE_MAX_STEP_SIZE, &parsed_value);
+            quantizer.step_size = (v2f_sample_t) parsed_value;
+            if (parsed_value == 0) {
+                status = V2F_E_INVALID_PARAMETER;
+            }
+        } else if (key_length == 17 && strncmp(request->fields[i], "decorrelator_mode", key_length) == 0) {
+            status = v2f_server_parse_value(value, V2F_C_DECORRELATOR_MODE_COUNT - 1, &parsed_value);
+            decorrelator.mode = (v2f_decorrelator_mode_t) parsed_value;
+        } else if (key_length == 15 && strncmp(request->fields[i], "samples_per_row", key_length) == 0) {
+            status = v2f_server_parse_value(value, V2F_SAMPLE_T_MAX, &parsed_value);
+            decorrelator.samples_per_row = parsed_value;
+        } else if (key_length == 8 && strncmp(request->fields[i], "shadow_y", key_length) == 0 && is_compression) {
+            status = v2f_server_parse_shadow(value, shadow_y_pairs, &y_shadow_count);
+        } else if (key_length == 11 && strncmp(request->fields[i], "block_index", key_length) == 0 && is_compression) {
+            status = v2f_server_parse_value(value, 1, &write_block_index);
+        } else if (key_length == 4 && strncmp(request->fields[i], "rows", key_length) == 0 && !is_compression) {
+            status = v2f_server_parse_shadow(value, selected_rows, &selected_range_count);
+            if (selected_range_count != 1) {
+                status = V2F_E_INVALID_PARAMETER;
+            }
+        }
+        if (status != V2F_E_NONE) {
+            log_error("Invalid option %s", request->fields[i]);
+            return V2F_E_INVALID_PARAMETER;
+        }
+    }
+    if ((decorrelator.mode == V2F_C_DECORRELATOR_MODE_JPEG_LS || decorrelator.mode == V2F_C_DECORRELATOR_MODE_FGIJ
+         || y_shadow_count != 0 || selected_range_count != 0) && decorrelator.samples_per_row == 0) {
+        log_error("The number of samples per row is required by this request");
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    uint32_t next_fd_index = 0;
+    FILE *input_file;
+    FILE *output_file;
+    RETURN_IF_FAIL(v2f_server_open_file(request, request->fields[2], "r", &next_fd_index, &input_file));
+    v2f_error_t status = v2f_server_open_file(request, request->fields[3], "w", &next_fd_index, &output_file);
+    if (status != V2F_E_NONE) {
+        fclose(input_file);
+        return status;
+    }
+
+    if (is_compression) {
+        v2f_compressor_t compressor = {&quantizer, &decorrelator, codec->compressor.entropy_coder};
+        status = v2f_file_compress_with_codec(
+                input_file, output_file, &compressor, codec->decompressor.entropy_decoder->bytes_per_sample,
+                y_shadow_count > 0 ? shadow_y_pairs : NULL, y_shadow_count, write_block_index != 0, workspace);
+    } else {
+        v2f_decompressor_t decompressor = {&quantizer, &decorrelator, codec->decompressor.entropy_decoder};
+        status = v2f_file_decompress_with_codec(
+                input_file, output_file, &decompressor,
+                selected_range_count != 0, selected_rows[0], selected_rows[1], workspace);
+    }
+
+    fclose(input_file);
+    if (fclose(output_file) != 0 && status == V2F_E_NONE) {
+        log_error("Error writing the output of the job");
+        status = V2F_E_IO;
+    }
+    return status;
+}
+
+/**
+ * Send the status of a job as a 4-byte unsigned big-endian integer.
+ *
+ * @param connection_fd connected socket
+ * @param status status to be sent
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the status was sent
+ *  - @ref V2F_E_IO : the connection is broken
+ */
+static v2f_error_t v2f_server_send_status(int connection_fd, v2f_error_t status) {
+    const uint32_t value = (uint32_t) status;
+    const uint8_t reply[4] = {
+            (uint8_t) (value >> 24), (uint8_t) ((value >> 16) & 0xff),
+            (uint8_t) ((value >> 8) & 0xff), (uint8_t) (value & 0xff)};
+    size_t sent_size = 0;
+    while (sent_size < sizeof(reply)) {
+        const ssize_t result = send(connection_fd, reply + sent_size, sizeof(reply) - sent_size, MSG_NOSIGNAL);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return V2F_E_IO;
+        }
+        sent_size += (size_t) result;
+    }
+    return V2F_E_NONE;
+}
+
+/**
+ * Run the job of a connection and send its status to the client.
+ *
+ * @param server server
+ * @param workspace block buffers of the worker
+ * @param connection connection whose request has been received
+ *
+ * @return true if and only if the connection must be closed
+ */
+static bool v2f_server_serve_job(
+        v2f_server_t const *const server,
+        v2f_file_workspace_t *const workspace,
+        struct v2f_server_connection_t *const connection) {
+    v2f_server_request_t *const request = &(connection->request);
+    v2f_error_t status = connection->request_status;
+    if (status == V2F_E_NONE) {
+        status = v2f_server_run_job(server, workspace, request);
+        log_info("Job %s with codec %s completed with status %d",
+                 request->fields[0], request->field_count > 1 ? request->fields[1] : "", (int) status);
+    }
+    v2f_server_reset_request(request);
+
+    // The rest of the connection cannot be trusted after an invalid request
+    return v2f_server_send_status(connection->fd, status) != V2F_E_NONE || connection->request_status != V2F_E_NONE;
+}
+
+/**
+ * Main function of the worker threads: run queued jobs until the server is stopped.
+ *
+ * @param argument pointer to the v2f_server_worker_t of this thread
+ *
+ * @return NULL
+ */
+static void *v2f_server_worker_main(void *argument) {
+    v2f_server_worker_t *const worker = (v2f_server_worker_t *) argument;
+    v2f_server_t *const server = worker->server;
+
+    while (true) {
+        pthread_mutex_lock(&(server->mutex));
+        while (server->job_count == 0 && !server->is_stopping) {
+            pthread_cond_wait(&(server->job_available), &(server->mutex));
+        }
+        if (server->is_stopping) {
+            pthread_mutex_unlock(&(server->mutex));
+            break;
+        }
+        struct v2f_server_connection_t *const connection =
+                &(server->connections[server->job_queue[server->job_queue_start]]);
+        server->job_queue_start = (server->job_queue_start + 1) % V2F_SERVER_MAX_CONNECTION_COUNT;
+        server->job_count--;
+        pthread_mutex_unlock(&(server->mutex));
+
+        const bool must_close = v2f_server_serve_job(server, &(worker->workspace), connection);
+
+        // Return the connection to the dispatcher
+        pthread_mutex_lock(&(server->mutex));
+        connection->must_close = must_close;
+        connection->is_busy = false;
+        pthread_mutex_unlock(&(server->mutex));
+        if (v2f_server_wake_dispatcher(server) != V2F_E_NONE) {
+            break; // LCOV_EXCL_LINE
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Queue the job of a connection whose request has been received, even if it is not valid,
+ * so that a worker replies to it.
+ *
+ * @param server server
+ * @param connection_index index of the connection in `server->connections`
+ */
+static void v2f_server_queue_job(v2f_server_t *const server, uint32_t connection_index) {
+    pthread_mutex_lock(&(server->mutex));
+    server->connections[connection_index].is_busy = true;
+    // Each connection has at most one job, so the queue cannot overflow
+    server->job_queue[(server->job_queue_start + server->job_count) % V2F_SERVER_MAX_CONNECTION_COUNT] =
+            connection_index;
+    server->job_count++;
+    pthread_cond_signal(&(server->job_available));
+    pthread_mutex_unlock(&(server->mutex));
+}
+
+/**
+ * Accept a pending connection, if any, and store it in a free slot.
+ *
+ * @param server server
+ * @param connection_index index of a free slot in `server->connections`
+ */
+static void v2f_server_accept_connection(v2f_server_t *const server, uint32_t connection_index) {
+    // The listening socket is non-blocking, so this fails if the client already gave up
+    const int connection_fd = accept(server->listen_fd, NULL, NULL);
+    if (connection_fd < 0) {
+        return;
+    }
+    // Replies are sent by the workers with blocking writes
+    if (!v2f_server_peer_is_trusted(connection_fd) || !v2f_server_set_nonblocking(connection_fd, false)) {
+        close(connection_fd);
+        return;
+    }
+    struct v2f_server_connection_t *const connection = &(server->connections[connection_index]);
+    connection->fd = connection_fd;
+    connection->must_close = false;
+    v2f_server_reset_request(&(connection->request));
+}
+
+/**
+ * Main function of the dispatcher thread: accept connections and receive their requests
+ * until the server is stopped. Complete requests are queued for the workers.
+ *
+ * @param argument pointer to the v2f_server_t
+ *
+ * @return NULL
+ */
+static void *v2f_server_dispatcher_main(void *argument) {
+    v2f_server_t *const server = (v2f_server_t *) argument;
+    struct pollfd poll_fds[V2F_SERVER_MAX_CONNECTION_COUNT + 2];
+    uint32_t polled_indices[V2F_SERVER_MAX_CONNECTION_COUNT];
+
+    while (true) {
+        // Close the connections returned by the workers that must be closed, and find the idle ones
+        uint32_t polled_count = 0;
+        uint32_t free_index = V2F_SERVER_MAX_CONNECTION_COUNT;
+        pthread_mutex_lock(&(server->mutex));
+        const bool is_stopping = server->is_stopping;
+        for (uint32_t i = 0; i < V2F_SERVER_MAX_CONNECTION_COUNT; i++) {
+            struct v2f_server_connection_t *const connection = &(server->connections[i]);
+            if (connection->is_busy) {
+                continue;
+            }
+            if (connection->fd >= 0 && connection->must_close) {
+                close(connection->fd);
+                connection->fd = -1;
+            }
+            if (connection->fd < 0) {
+                free_index = i;
+            } else {
+                polled_indices[polled_count] = i;
+                polled_count++;
+            }
+        }
+        pthread_mutex_unlock(&(server->mutex));
+        if (is_stopping) {
+            break;
+        }
+
+        // New connections wait in the listening socket until a slot is free
+        poll_fds[0].fd = server->wake_pipe[0];
+        poll_fds[1].fd = free_index < V2F_SERVER_MAX_CONNECTION_COUNT ? server->listen_fd : -1;
+        for (uint32_t i = 0; i < polled_count; i++) {
+            poll_fds[i + 2].fd = server->connections[polled_indices[i]].fd;
+        }
+        for (uint32_t i = 0; i < polled_count + 2; i++) {
+            poll_fds[i].events = POLLIN;
+            poll_fds[i].revents = 0;
+        }
+        if (poll(poll_fds, polled_count + 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // LCOV_EXCL_START
+            log_error("Cannot wait for connections");
+            break;
+            // LCOV_EXCL_STOP
+        }
+
+        if (poll_fds[0].revents != 0) {
+            char buffer[64];
+            while (read(server->wake_pipe[0], buffer, sizeof(buffer)) > 0) {
+                // Drain the pipe
+            }
+        }
+        if (poll_fds[1].revents != 0) {
+            v2f_server_accept_connection(server, free_index);
+        }
+        for (uint32_t i = 0; i < polled_count; i++) {
+            if (poll_fds[i + 2].revents == 0) {
+                continue;
+            }
+            struct v2f_server_connection_t *const connection = &(server->connections[polled_indices[i]]);
+            bool is_complete;
+            bool is_closed;
+            const v2f_error_t status =
+                    v2f_server_receive_part(connection->fd, &(connection->request), &is_complete, &is_closed);
+            if (is_closed) {
+                close(connection->fd);
+                connection->fd = -1;
+            } else if (status != V2F_E_NONE || is_complete) {
+                connection->request_status = status;
+                v2f_server_queue_job(server, polled_indices[i]);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Close the socket and wake pipe of a server, if open.
+ *
+ * @param server server whose descriptors are closed
+ */
+static void v2f_server_close_fds(v2f_server_t *const server) {
+    int *const fds[3] = {&(server->listen_fd), &(server->wake_pipe[0]), &(server->wake_pipe[1])};
+    for (uint32_t i = 0; i < 3; i++) {
+        if (*fds[i] >= 0) {
+            close(*fds[i]);
+            *fds[i] = -1;
+        }
+    }
+}
+
+v2f_error_t v2f_server_create(
+        char const *const socket_path,
+        uint32_t worker_count,
+        v2f_server_t *const server) {
+    if (socket_path == NULL || server == NULL || worker_count < 1 || worker_count > V2F_C_MAX_THREAD_COUNT) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    struct sockaddr_un address;
+    RETURN_IF_FAIL(v2f_server_fill_address(socket_path, &address));
+    memcpy(server->socket_path, address.sun_path, sizeof(server->socket_path));
+    server->listen_fd = -1;
+    server->wake_pipe[0] = -1;
+    server->wake_pipe[1] = -1;
+    server->codec_count = 0;
+    server->running_count = 0;
+    server->worker_count = worker_count;
+    server->job_queue_start = 0;
+    server->job_count = 0;
+    server->is_stopping = false;
+
+    v2f_error_t status = V2F_E_NONE;
+    uint32_t workspace_count = 0;
+    bool has_mutex = false;
+    bool has_condition = false;
+    server->workers = (v2f_server_worker_t *) malloc(sizeof(v2f_server_worker_t) * worker_count);
+    server->connections = (struct v2f_server_connection_t *) malloc(
+            sizeof(struct v2f_server_connection_t) * V2F_SERVER_MAX_CONNECTION_COUNT);
+    server->job_queue = (uint32_t *) malloc(sizeof(uint32_t) * V2F_SERVER_MAX_CONNECTION_COUNT);
+    if (server->workers == NULL || server->connections == NULL || server->job_queue == NULL) {
+        // LCOV_EXCL_START
+        status = V2F_E_OUT_OF_MEMORY;
+        goto cleanup;
+        // LCOV_EXCL_STOP
+    }
+    for (uint32_t i = 0; i < V2F_SERVER_MAX_CONNECTION_COUNT; i++) {
+        server->connections[i].fd = -1;
+        server->connections[i].is_busy = false;
+        server->connections[i].must_close = false;
+        server->connections[i].request.passed_fd_count = 0;
+    }
+    has_mutex = pthread_mutex_init(&(server->mutex), NULL) == 0;
+    has_condition = has_mutex && pthread_cond_init(&(server->job_available), NULL) == 0;
+    if (!has_condition) {
+        // LCOV_EXCL_START
+        status = V2F_E_IO;
+        goto cleanup;
+        // LCOV_EXCL_STOP
+    }
+    for (; workspace_count < worker_count; workspace_count++) {
+        server->workers[workspace_count].server = server;
+        status = v2f_file_create_workspace(&(server->workers[workspace_count].workspace));
+        if (status != V2F_E_NONE) {
+            goto cleanup; // LCOV_EXCL_LINE
+        }
+    }
+
+    // A stale socket of a previous server is replaced, but no other kind of file
+    status = v2f_server_remove_stale_socket(&address);
+    if (status != V2F_E_NONE) {
+        goto cleanup;
+    }
+    status = V2F_E_IO;
+    if (pipe(server->wake_pipe) != 0
+        || !v2f_server_set_nonblocking(server->wake_pipe[0], true)
+        || !v2f_server_set_nonblocking(server->wake_pipe[1], true)
+        || (server->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+        || bind(server->listen_fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+        log_error("Cannot create socket %s", socket_path);
+        goto cleanup;
+    }
+    // Only the owner can connect. Nobody can connect before listen(), so there is no window with other permissions.
+    if (chmod(socket_path, S_IRUSR | S_IWUSR) != 0
+        || !v2f_server_set_nonblocking(server->listen_fd, true)
+        || listen(server->listen_fd, V2F_SERVER_LISTEN_BACKLOG) != 0) {
+        // LCOV_EXCL_START
+        log_error("Cannot listen on socket %s", socket_path);
+        unlink(socket_path);
+        goto cleanup;
+        // LCOV_EXCL_STOP
+    }
+
+    return V2F_E_NONE;
+
+    cleanup:
+    v2f_server_close_fds(server);
+    if (has_condition) {
+        pthread_cond_destroy(&(server->job_available));
+    }
+    if (has_mutex) {
+        pthread_mutex_destroy(&(server->mutex));
+    }
+    for (uint32_t i = 0; i < workspace_count; i++) {
+        v2f_file_destroy_workspace(&(server->workers[i].workspace));
+    }
+    free(server->workers);
+    server->workers = NULL;
+    free(server->connections);
+    server->connections = NULL;
+    free(server->job_queue);
+    server->job_queue = NULL;
+    return status;
+}
+
+v2f_error_t v2f_server_add_codec(
+        v2f_server_t *const server,
+        char const *const name,
+        char const *const header_path,
+        char const *const forest_cache_path) {
+    if (server == NULL || name == NULL || header_path == NULL || server->running_count > 0
+        || server->codec_count == V2F_SERVER_MAX_CODEC_COUNT
+        || strlen(name) == 0 || strlen(name) >= V2F_SERVER_MAX_NAME_SIZE) {
+        log_error("Cannot add codec %s", name == NULL ? "" : name);
+        return V2F_E_INVALID_PARAMETER;
+    }
+    for (uint32_t i = 0; i < server->codec_count; i++) {
+        if (strcmp(server->codecs[i].name, name) == 0) {
+            log_error("Repeated codec name %s", name);
+            return V2F_E_INVALID_PARAMETER;
+        }
+    }
+
+    FILE *header_file = fopen(header_path, "r");
+    if (header_file == NULL) {
+        log_error("Cannot open V2F header file %s for reading", header_path);
+        return V2F_E_IO;
+    }
+    v2f_server_codec_t *const codec = &(server->codecs[server->codec_count]);
+    const v2f_error_t status = v2f_file_read_codec_cached(
+            header_file, forest_cache_path, &(codec->compressor), &(codec->decompressor));
+    fclose(header_file);
+    RETURN_IF_FAIL(status);
+    memcpy(codec->name, name, strlen(name) + 1);
+    server->codec_count++;
+    log_info("Loaded codec %s from %s", name, header_path);
+
+    return V2F_E_NONE;
+}
+
+v2f_error_t v2f_server_start(v2f_server_t *const server) {
+    if (server == NULL || server->running_count > 0) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    server->is_stopping = false;
+    while (server->running_count < server->worker_count
+           && pthread_create(&(server->workers[server->running_count].thread), NULL,
+                             v2f_server_worker_main, &(server->workers[server->running_count])) == 0) {
+        server->running_count++;
+    }
+    if (server->running_count == 0) {
+        log_error("Cannot start any worker thread");
+        return V2F_E_IO;
+    }
+    if (pthread_create(&(server->dispatcher), NULL, v2f_server_dispatcher_main, server) != 0) {
+        // LCOV_EXCL_START
+        log_error("Cannot start the dispatcher thread");
+        pthread_mutex_lock(&(server->mutex));
+        server->is_stopping = true;
+        pthread_cond_broadcast(&(server->job_available));
+        pthread_mutex_unlock(&(server->mutex));
+        for (uint32_t i = 0; i < server->running_count; i++) {
+            pthread_join(server->workers[i].thread, NULL);
+        }
+        server->running_count = 0;
+        return V2F_E_IO;
+        // LCOV_EXCL_STOP
+    }
+    if (server->running_count < server->worker_count) {
+        log_warning("Could only start %u out of %u workers", server->running_count, server->worker_count);
+    }
+
+    return V2F_E_NONE;
+}
+
+v2f_error_t v2f_server_stop(v2f_server_t *const server) {
+    if (server == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    if (server->running_count == 0) {
+        return V2F_E_NONE;
+    }
+
+    // Running jobs are completed, but queued ones are not started
+    pthread_mutex_lock(&(server->mutex));
+    server->is_stopping = true;
+    pthread_cond_broadcast(&(server->job_available));
+    pthread_mutex_unlock(&(server->mutex));
+    RETURN_IF_FAIL(v2f_server_wake_dispatcher(server));
+    pthread_join(server->dispatcher, NULL);
+    for (uint32_t i = 0; i < server->running_count; i++) {
+        pthread_join(server->workers[i].thread, NULL);
+    }
+    server->running_count = 0;
+
+    // Leave the pipe empty for the next start
+    char buffer[64];
+    ssize_t result;
+    do {
+        result = read(server->wake_pipe[0], buffer, sizeof(buffer));
+    } while (result > 0 || (result < 0 && errno == EINTR));
+    if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        log_error("Cannot reset the wake pipe"); // LCOV_EXCL_LINE
+        return V2F_E_IO; // LCOV_EXCL_LINE
+    }
+
+    // Connections are not resumed by the next start
+    for (uint32_t i = 0; i < V2F_SERVER_MAX_CONNECTION_COUNT; i++) {
+        struct v2f_server_connection_t *const connection = &(server->connections[i]);
+        if (connection->fd >= 0) {
+            close(connection->fd);
+            connection->fd = -1;
+        }
+        connection->is_busy = false;
+        v2f_server_reset_request(&(connection->request));
+    }
+    server->job_queue_start = 0;
+    server->job_count = 0;
+
+    return V2F_E_NONE;
+}
+
+v2f_error_t v2f_server_destroy(v2f_server_t *const server) {
+    if (server == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    RETURN_IF_FAIL(v2f_server_stop(server));
+
+    v2f_server_close_fds(server);
+    unlink(server->socket_path);
+    for (uint32_t i = 0; i < server->codec_count; i++) {
+        v2f_file_destroy_read_codec(&(server->codecs[i].compressor), &(server->codecs[i].decompressor));
+    }
+    server->codec_count = 0;
+    for (uint32_t i = 0; i < server->worker_count; i++) {
+        v2f_file_destroy_workspace(&(server->workers[i].workspace));
+    }
+    free(server->workers);
+    server->workers = NULL;
+    server->worker_count = 0;
+    free(server->connections);
+    server->connections = NULL;
+    free(server->job_queue);
+    server->job_queue = NULL;
+    pthread_cond_destroy(&(server->job_available));
+    pthread_mutex_destroy(&(server->mutex));
+
+    return V2F_E_NONE;
+}
+
+v2f_error_t v2f_server_connect(char const *const socket_path, int *const socket_fd) {
+    if (socket_path == NULL || socket_fd == NULL) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+    struct sockaddr_un address;
+    RETURN_IF_FAIL(v2f_server_fill_address(socket_path, &address));
+
+    *socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (*socket_fd < 0) {
+        return V2F_E_IO; // LCOV_EXCL_LINE
+    }
+    // Requests may name files to be read and written, so they are only sent to servers of the same user
+    if (connect(*socket_fd, (struct sockaddr *) &address, sizeof(address)) != 0
+        || !v2f_server_peer_is_trusted(*socket_fd)) {
+        log_error("Cannot connect to %s", socket_path);
+        close(*socket_fd);
+        *socket_fd = -1;
+        return V2F_E_IO;
+    }
+
+    return V2F_E_NONE;
+}
+
+v2f_error_t v2f_server_submit(
+        int socket_fd,
+        char const *const *const fields,
+        uint32_t field_count,
+        int const *const passed_fds,
+        uint32_t passed_fd_count,
+        v2f_error_t *const job_status) {
+    if (fields == NULL || job_status == NULL || field_count < 1 || field_count > V2F_SERVER_MAX_FIELD_COUNT
+        || passed_fd_count > V2F_SERVER_MAX_PASSED_FD_COUNT || (passed_fds == NULL && passed_fd_count > 0)) {
+        return V2F_E_INVALID_PARAMETER;
+    }
+
+    // Serialize the fields, followed by an empty field
+    char request[V2F_SERVER_MAX_REQUEST_SIZE];
+    size_t request_size = 0;
+    for (uint32_t i = 0; i < field_count; i++) {
+        if (fields[i] == NULL) {
+            return V2F_E_INVALID_PARAMETER;
+        }
+        const size_t length = strlen(fields[i]);
+        if (length == 0 || request_size + length + 2 > V2F_SERVER_MAX_REQUEST_SIZE) {
+            log_error("Invalid request field");
+            return V2F_E_INVALID_PARAMETER;
+        }
+        memcpy(request + request_size, fields[i], length + 1);
+        request_size += length + 1;
+    }
+    request[request_size] = '\0';
+    request_size++;
+
+    // The descriptors are attached to the first bytes of the request
+    size_t sent_size = 0;
+    while (sent_size < request_size) {
+        struct iovec io_vector = {.iov_base = request + sent_size, .iov_len = request_size - sent_size};
+        v2f_server_control_t control;
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = &io_vector;
+        message.msg_iovlen = 1;
+        if (sent_size == 0 && passed_fd_count > 0) {
+            memset(&control, 0, sizeof(control));
+            message.msg_control = control.buffer;
+            message.msg_controllen = CMSG_SPACE(sizeof(int) * passed_fd_count);
+            struct cmsghdr *const header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(sizeof(int) * passed_fd_count);
+            memcpy(CMSG_DATA(header), passed_fds, sizeof(int) * passed_fd_count);
+        }
+        const ssize_t result = sendmsg(socket_fd, &message, MSG_NOSIGNAL);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            log_error("Cannot send the request");
+            return V2F_E_IO;
+        }
+        sent_size += (size_t) result;
+    }
+
+    uint8_t reply[4];
+    size_t received_size = 0;
+    while (received_size < sizeof(reply)) {
+        const ssize_t result = recv(socket_fd, reply + received_size, sizeof(reply) - received_size, 0);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            log_error("No reply received from the server");
+            return V2F_E_IO;
+        }
+        received_size += (size_t) result;
+    }
+    *job_status = (v2f_error_t) (((uint32_t) reply[0] << 24) | ((uint32_t) reply[1] << 16)
+                                 | ((uint32_t) reply[2] << 8) | (uint32_t) reply[3]);
+
+    return V2F_E_NONE;
+}
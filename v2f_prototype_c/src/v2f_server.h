@@ -0,0 +1,253 @@
+/**
+ * @file v2f_server.h
+ *
+ * @brief Long-running compression service that keeps codecs loaded across jobs.
+ *
+ * A server listens on a Unix domain socket and runs compression and decompression
+ * jobs on a pool of worker threads. Codecs are read once, when they are added to
+ * the server, and shared read-only by all workers. Each worker keeps its own
+ * block buffers (see v2f_file_workspace_t) across jobs, so jobs allocate no block buffers.
+ *
+ * A dispatcher thread accepts connections and receives their requests. Each complete request
+ * is queued as a job, which is run by the next idle worker, so open connections without a
+ * pending request do not hold any worker. Each connection can submit any number of jobs,
+ * one after the other. A job request is a sequence of \\0-terminated fields, ended by an empty field:
+ *
+ * 1. operation: `compress` or `decompress`.
+ * 2. codec name: name given to v2f_server_add_codec().
+ * 3. input: path of the input file, or `-` to use the next descriptor passed with the request.
+ * 4. output: path of the output file, or `-` to use the next descriptor passed with the request.
+ * 5. zero or more options `key=value`, with the meaning of the equivalent parameters
+ *    of v2f_file_compress_from_path() and v2f_file_decompress_from_path():
+ *    `quantizer_mode`, `step_size`, `decorrelator_mode`, `samples_per_row`,
+ *    when compressing, `shadow_y` (a comma-separated list of start,end row pairs)
+ *    and `block_index` (0 or 1), and, when decompressing, `rows` (a first,last row pair).
+ *
+ * Only processes of the user that runs the server can connect to it: the socket is created
+ * with mode 0600, and the credentials of each peer are checked where SO_PEERCRED is available.
+ * Clients check the credentials of the server in the same way.
+ *
+ * Descriptors are passed as SCM_RIGHTS ancillary data of the request,
+ * in the order in which the `-` fields appear. Paths are opened by the server,
+ * relative to its working directory.
+ *
+ * The server replies to each request with the resulting v2f_error_t,
+ * as a 4-byte unsigned big-endian integer, once the output has been completely written.
+ * Requests must not be sent before the reply to the previous one is received.
+ */
+
+#ifndef V2F_SERVER_H
+#define V2F_SERVER_H
+
+#include <pthread.h>
+#include <sys/un.h>
+
+#include "v2f.h"
+#include "v2f_file.h"
+
+/// Socket path used by the server and client tools when none is given
+#define V2F_SERVER_DEFAULT_SOCKET_PATH "/tmp/v2f_server.sock"
+/// Maximum number of codecs kept by a server
+#define V2F_SERVER_MAX_CODEC_COUNT 64
+/// Maximum size of a codec name, including the terminating \\0
+#define V2F_SERVER_MAX_NAME_SIZE 64
+/// Maximum size of a request in bytes, including all field terminators
+#define V2F_SERVER_MAX_REQUEST_SIZE 8192
+/// Maximum number of fields in a request, not including the final empty field
+#define V2F_SERVER_MAX_FIELD_COUNT 16
+/// Maximum number of descriptors passed with a request
+#define V2F_SERVER_MAX_PASSED_FD_COUNT 2
+/// Maximum number of open connections of a server. Further connections wait until one is closed.
+#define V2F_SERVER_MAX_CONNECTION_COUNT 64
+
+/**
+ * @struct v2f_server_codec_t
+ *
+ * Codec loaded by a server, identified by its name.
+ */
+typedef struct {
+    /// Name used by requests to select this codec.
+    char name[V2F_SERVER_MAX_NAME_SIZE];
+    /// Compressor read from the codec file.
+    v2f_compressor_t compressor;
+    /// Decompressor read from the codec file.
+    v2f_decompressor_t decompressor;
+} v2f_server_codec_t;
+
+struct v2f_server_t;
+struct v2f_server_connection_t;
+
+/**
+ * @struct v2f_server_worker_t
+ *
+ * Worker thread of a server and the buffers it reuses across jobs.
+ */
+typedef struct {
+    /// Server of this worker.
+    struct v2f_server_t *server;
+    /// Thread identifier.
+    pthread_t thread;
+    /// Block buffers used by all jobs of this worker.
+    v2f_file_workspace_t workspace;
+} v2f_server_worker_t;
+
+/**
+ * @struct v2f_server_t
+ *
+ * Compression service listening on a Unix domain socket.
+ */
+typedef struct v2f_server_t {
+    /// Path of the listening socket.
+    char socket_path[sizeof(((struct sockaddr_un *) 0)->sun_path)];
+    /// Listening socket.
+    int listen_fd;
+    /// Non-blocking pipe written to wake up the dispatcher when a connection is returned or the server stops.
+    int wake_pipe[2];
+    /// Loaded codecs.
+    v2f_server_codec_t codecs[V2F_SERVER_MAX_CODEC_COUNT];
+    /// Number of loaded codecs.
+    uint32_t codec_count;
+    /// Workers of the pool.
+    v2f_server_worker_t *workers;
+    /// Number of workers in the pool.
+    uint32_t worker_count;
+    /// Number of running worker threads. The dispatcher runs if and only if it is not 0.
+    uint32_t running_count;
+    /// Thread that accepts connections and receives requests.
+    pthread_t dispatcher;
+    /// Slots for @ref V2F_SERVER_MAX_CONNECTION_COUNT connections.
+    struct v2f_server_connection_t *connections;
+    /// Circular queue with the indices in `connections` of the connections whose job is pending.
+    uint32_t *job_queue;
+    /// Position in `job_queue` of the next job.
+    uint32_t job_queue_start;
+    /// Number of pending jobs.
+    uint32_t job_count;
+    /// Set when the server is being stopped.
+    bool is_stopping;
+    /// Mutex that protects the job queue, `is_stopping` and the ownership of connections.
+    pthread_mutex_t mutex;
+    /// Signaled when a job is queued or the server is being stopped.
+    pthread_cond_t job_available;
+} v2f_server_t;
+
+/**
+ * Create a server listening on a Unix domain socket. Jobs are not served
+ * until v2f_server_start() is called.
+ *
+ * If a socket already exists at `socket_path`, it is replaced, unless a server is listening on it.
+ * Any other kind of file at `socket_path` is left untouched, and the server is not created.
+ *
+ * @param socket_path path of the listening socket
+ * @param worker_count number of worker threads, between 1 and @ref V2F_C_MAX_THREAD_COUNT
+ * @param server server to be initialized
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the server is listening
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameters, or the path is too long
+ *  - @ref V2F_E_IO : the socket could not be created, or `socket_path` is in use
+ *  - @ref V2F_E_OUT_OF_MEMORY : not enough memory for the workers or the connections
+ */
+v2f_error_t v2f_server_create(
+        char const *const socket_path,
+        uint32_t worker_count,
+        v2f_server_t *const server);
+
+/**
+ * Read a codec file and make it available to requests with the given name.
+ * Codecs can only be added before the server is started.
+ *
+ * @param server server, not started yet
+ * @param name name of the codec, non-empty and shorter than @ref V2F_SERVER_MAX_NAME_SIZE
+ * @param header_path path of the codec (typically .v2fc) file
+ * @param forest_cache_path if not NULL, forest cache used as in v2f_file_read_codec_cached()
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the codec was added
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid or repeated name, too many codecs, or the server is running
+ *  - @ref V2F_E_IO : the codec file could not be opened
+ *  - Any error returned by v2f_file_read_codec_cached()
+ */
+v2f_error_t v2f_server_add_codec(
+        v2f_server_t *const server,
+        char const *const name,
+        char const *const header_path,
+        char const *const forest_cache_path);
+
+/**
+ * Start the worker threads and the dispatcher of a server.
+ *
+ * If only some workers can be started, the server runs with fewer workers.
+ *
+ * @param server server to be started
+ *
+ * @return
+ *  - @ref V2F_E_NONE : at least one worker is running
+ *  - @ref V2F_E_INVALID_PARAMETER : the server is already running
+ *  - @ref V2F_E_IO : no worker or the dispatcher could be started
+ */
+v2f_error_t v2f_server_start(v2f_server_t *const server);
+
+/**
+ * Stop the workers and the dispatcher of a server. Running jobs are completed,
+ * and all connections are closed. Jobs that were queued but not started are not run,
+ * and their clients receive no reply.
+ *
+ * @param server server to be stopped
+ *
+ * @return
+ *  - @ref V2F_E_NONE : all workers have stopped
+ *  - @ref V2F_E_INVALID_PARAMETER : `server` is NULL
+ *  - @ref V2F_E_IO : the dispatcher could not be woken up, or the server cannot be restarted
+ */
+v2f_error_t v2f_server_stop(v2f_server_t *const server);
+
+/**
+ * Stop a server if needed, remove its socket and free all its resources.
+ *
+ * @param server server to be destroyed
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the server was destroyed
+ *  - @ref V2F_E_INVALID_PARAMETER : `server` is NULL
+ *  - @ref V2F_E_IO : the server could not be stopped (see v2f_server_stop()). It is not destroyed.
+ */
+v2f_error_t v2f_server_destroy(v2f_server_t *const server);
+
+/**
+ * Connect to a server run by the same user.
+ *
+ * @param socket_path path of the socket of the server
+ * @param socket_fd pointer where the connected socket is stored. It must be closed with close() after use.
+ *
+ * @return
+ *  - @ref V2F_E_NONE : connected
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameters, or the path is too long
+ *  - @ref V2F_E_IO : could not connect, or the server is run by another user
+ */
+v2f_error_t v2f_server_connect(char const *const socket_path, int *const socket_fd);
+
+/**
+ * Submit a job to a server and wait for its completion.
+ *
+ * @param socket_fd socket connected with v2f_server_connect()
+ * @param fields request fields (see v2f_server.h), without the final empty field
+ * @param field_count number of fields, between 1 and @ref V2F_SERVER_MAX_FIELD_COUNT
+ * @param passed_fds descriptors passed with the request, or NULL if `passed_fd_count` is 0
+ * @param passed_fd_count number of descriptors, at most @ref V2F_SERVER_MAX_PASSED_FD_COUNT
+ * @param job_status pointer where the status of the job reported by the server is stored
+ *
+ * @return
+ *  - @ref V2F_E_NONE : the job was run, and its status is stored in `job_status`
+ *  - @ref V2F_E_INVALID_PARAMETER : invalid parameters, or the request is too large
+ *  - @ref V2F_E_IO : the request could not be sent, or no reply was received
+ */
+v2f_error_t v2f_server_submit(
+        int socket_fd,
+        char const *const *const fields,
+        uint32_t field_count,
+        int const *const passed_fds,
+        uint32_t passed_fd_count,
+        v2f_error_t *const job_status);
+
+#endif /* V2F_SERVER_H */
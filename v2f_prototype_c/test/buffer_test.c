@@ -0,0 +1,446 @@
+/**
+ * @file
+ *
+ * Test suite for the buffer-to-buffer interface.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "CUExtension.h"
+#include "test_common.h"
+
+#include "../src/v2f.h"
+#include "../src/v2f_build.h"
+#include "../src/v2f_file.h"
+
+/// Number of samples per row of the test images. Images have more than one block.
+#define BUFFER_TEST_SAMPLES_PER_ROW 1000
+/// Number of rows of the test images
+#define BUFFER_TEST_ROW_COUNT 1400
+/// Number of threads sharing a forest
+#define BUFFER_TEST_THREAD_COUNT 8
+/// Number of rows of the images compressed by each thread sharing a forest
+#define BUFFER_TEST_SHARED_ROW_COUNT 100
+/// Number of times each thread sharing a forest compresses and decompresses its image
+#define BUFFER_TEST_SHARED_ITERATION_COUNT 5
+
+/**
+ * Test that buffers are compressed and decompressed into the same bytes as
+ * files with v2f_file_compress_from_path() and v2f_file_decompress_from_path(),
+ * with codecs loaded from a path and from memory.
+ */
+void test_buffer_round_trip(void);
+
+/**
+ * Test that invalid parameters, small output buffers and corrupted data are reported.
+ */
+void test_buffer_invalid_parameters(void);
+
+/**
+ * Test that codecs created from one forest can be used concurrently with different parameters,
+ * and that the forest remains available until its last codec is destroyed.
+ */
+void test_buffer_shared_forest(void);
+
+/**
+ * @struct buffer_test_job_t
+ *
+ * Work of one of the threads that share a forest.
+ */
+typedef struct {
+    /// Codec used by the thread, destroyed when the thread finishes.
+    v2f_buffer_codec_t *codec;
+    /// Big-endian samples to be compressed.
+    uint8_t const *raw_data;
+    /// Number of bytes of `raw_data`.
+    uint64_t raw_size;
+    /// Expected compressed data.
+    uint8_t const *expected_data;
+    /// Number of bytes of `expected_data`.
+    uint64_t expected_size;
+    /// Set by the thread to true if all its results were as expected.
+    bool success;
+} buffer_test_job_t;
+
+/**
+ * Create an empty temporary file and store its path.
+ *
+ * @param path buffer of at least 32 bytes where the path is stored
+ */
+static void buffer_test_create_path(char *const path) {
+    strcpy(path, "/tmp/v2f_buffer_test_XXXXXX");
+    const int fd = mkstemp(path);
+    CU_ASSERT_FATAL(fd >= 0);
+    close(fd);
+}
+
+/**
+ * Read all contents of a file.
+ *
+ * @param path path of the file
+ * @param size pointer where the number of read bytes is stored
+ *
+ * @return a buffer with the contents, to be freed by the caller
+ */
+static uint8_t *buffer_test_read_contents(char const *const path, uint64_t *const size) {
+    FILE *file = fopen(path, "r");
+    CU_ASSERT_FATAL(file != NULL);
+    CU_ASSERT_EQUAL_FATAL(fseeko(file, 0, SEEK_END), 0);
+    const off_t end = ftello(file);
+    CU_ASSERT_FATAL(end >= 0);
+    *size = (uint64_t) end;
+    uint8_t *const contents = (uint8_t *) malloc(*size + 1);
+    CU_ASSERT_FATAL(contents != NULL);
+    CU_ASSERT_EQUAL_FATAL(fseeko(file, 0, SEEK_SET), 0);
+    CU_ASSERT_EQUAL_FATAL(fread(contents, 1, *size, file), *size);
+    fclose(file);
+    return contents;
+}
+
+/**
+ * Write a minimal codec into a file.
+ *
+ * @param bytes_per_word number of bytes per word of the codec
+ * @param header_path path of the file where the codec is written
+ */
+static void buffer_test_write_codec(uint8_t bytes_per_word, char const *const header_path) {
+    v2f_compressor_t compressor;
+    v2f_decompressor_t decompressor;
+    FAIL_IF_FAIL(v2f_build_minimal_codec(bytes_per_word, &compressor, &decompressor));
+    FILE *header_file = fopen(header_path, "w");
+    CU_ASSERT_FATAL(header_file != NULL);
+    FAIL_IF_FAIL(v2f_file_write_codec(header_file, &compressor, &decompressor));
+    fclose(header_file);
+    FAIL_IF_FAIL(v2f_build_destroy_minimal_codec(&compressor, &decompressor));
+}
+
+void test_buffer_round_trip(void) {
+    char header_path[32];
+    char raw_path[32];
+    char compressed_path[32];
+    char reconstructed_path[32];
+    buffer_test_create_path(header_path);
+    buffer_test_create_path(raw_path);
+    buffer_test_create_path(compressed_path);
+    buffer_test_create_path(reconstructed_path);
+    const uint64_t sample_count = BUFFER_TEST_ROW_COUNT * BUFFER_TEST_SAMPLES_PER_ROW;
+    v2f_sample_t *const samples = (v2f_sample_t *) malloc(sizeof(v2f_sample_t) * sample_count);
+    CU_ASSERT_FATAL(samples != NULL);
+
+    for (uint8_t bytes_per_word = 1; bytes_per_word <= 2; bytes_per_word++) {
+        // Codec, loaded from its path and from memory
+        buffer_test_write_codec(bytes_per_word, header_path);
+        uint64_t header_size;
+        uint8_t *const header_data = buffer_test_read_contents(header_path, &header_size);
+        v2f_buffer_codec_t *codec;
+        v2f_buffer_codec_t *memory_codec;
+        FAIL_IF_FAIL(v2f_buffer_load_codec(header_path, &codec));
+        FAIL_IF_FAIL(v2f_buffer_load_codec_from_memory(header_data, header_size, &memory_codec));
+        free(header_data);
+        for (uint32_t i = 0; i < 2; i++) {
+            FAIL_IF_FAIL(v2f_buffer_configure_codec(
+                    i == 0 ? codec : memory_codec, false, V2F_C_QUANTIZER_MODE_NONE, false, 1,
+                    true, V2F_C_DECORRELATOR_MODE_JPEG_LS, BUFFER_TEST_SAMPLES_PER_ROW));
+        }
+
+        // Raw image and the compressed file used as reference
+        const v2f_sample_t max_sample_value = bytes_per_word == 1 ? 0xff : 0xffff;
+        for (uint64_t i = 0; i < sample_count; i++) {
+            samples[i] = (v2f_sample_t) ((i / 7 + (i % BUFFER_TEST_SAMPLES_PER_ROW)) % (max_sample_value + 1));
+        }
+        FILE *raw_file = fopen(raw_path, "w");
+        CU_ASSERT_FATAL(raw_file != NULL);
+        FAIL_IF_FAIL(v2f_file_write_big_endian(raw_file, samples, sample_count, bytes_per_word));
+        fclose(raw_file);
+        uint64_t raw_size;
+        uint8_t *const raw_data = buffer_test_read_contents(raw_path, &raw_size);
+        CU_ASSERT_EQUAL_FATAL(raw_size, sample_count * bytes_per_word);
+        CU_ASSERT_EQUAL_FATAL(v2f_file_compress_from_path(
+                raw_path, header_path, compressed_path, false, V2F_C_QUANTIZER_MODE_NONE, false, 1,
+                true, V2F_C_DECORRELATOR_MODE_JPEG_LS, BUFFER_TEST_SAMPLES_PER_ROW, NULL, 0, NULL), 0);
+        uint64_t reference_size;
+        uint8_t *const reference = buffer_test_read_contents(compressed_path, &reference_size);
+
+        // Compression with the worst-case capacity, and with exactly the needed capacity
+        uint64_t max_compressed_size;
+        FAIL_IF_FAIL(v2f_buffer_get_max_compressed_size(codec, raw_size, &max_compressed_size));
+        CU_ASSERT_FATAL(max_compressed_size >= reference_size);
+        uint8_t *const compressed_data = (uint8_t *) malloc(max_compressed_size);
+        CU_ASSERT_FATAL(compressed_data != NULL);
+        uint64_t compressed_size;
+        FAIL_IF_FAIL(v2f_buffer_compress(
+                codec, raw_data, raw_size, compressed_data, max_compressed_size, &compressed_size));
+        CU_ASSERT_EQUAL_FATAL(compressed_size, reference_size);
+        CU_ASSERT_EQUAL_FATAL(memcmp(compressed_data, reference, reference_size), 0);
+        memset(compressed_data, 0, max_compressed_size);
+        FAIL_IF_FAIL(v2f_buffer_compress(
+                memory_codec, raw_data, raw_size, compressed_data, reference_size, &compressed_size));
+        CU_ASSERT_EQUAL_FATAL(compressed_size, reference_size);
+        CU_ASSERT_EQUAL_FATAL(memcmp(compressed_data, reference, reference_size), 0);
+        CU_ASSERT_EQUAL_FATAL(v2f_buffer_compress(
+                codec, raw_data, raw_size, compressed_data, reference_size - 1, &compressed_size),
+                              V2F_E_INVALID_PARAMETER);
+
+        // Decompression into exactly the needed capacity
+        uint64_t reconstructed_size;
+        FAIL_IF_FAIL(v2f_buffer_get_reconstructed_size(codec, reference, reference_size, &reconstructed_size));
+        CU_ASSERT_EQUAL_FATAL(reconstructed_size, raw_size);
+        uint8_t *const reconstructed_data = (uint8_t *) malloc(raw_size);
+        CU_ASSERT_FATAL(reconstructed_data != NULL);
+        for (uint32_t i = 0; i < 2; i++) {
+            memset(reconstructed_data, 0, raw_size);
+            FAIL_IF_FAIL(v2f_buffer_decompress(
+                    i == 0 ? codec : memory_codec, reference, reference_size,
+                    reconstructed_data, raw_size, &reconstructed_size));
+            CU_ASSERT_EQUAL_FATAL(reconstructed_size, raw_size);
+            CU_ASSERT_EQUAL_FATAL(memcmp(reconstructed_data, raw_data, raw_size), 0);
+        }
+        CU_ASSERT_EQUAL_FATAL(v2f_buffer_decompress(
+                codec, reference, reference_size, reconstructed_data, raw_size - 1, &reconstructed_size),
+                              V2F_E_INVALID_PARAMETER);
+        free(reference);
+
+        // Files with shadow regions and a block index are decompressed as with files
+        uint32_t shadow_y_pairs[] = {3, 5, 1200, 1300};
+        v2f_file_options_t options;
+        FAIL_IF_FAIL(v2f_file_init_options(&options));
+        options.write_block_index = true;
+        CU_ASSERT_EQUAL_FATAL(v2f_file_compress_from_path(
+                raw_path, header_path, compressed_path, false, V2F_C_QUANTIZER_MODE_NONE, false, 1,
+                true, V2F_C_DECORRELATOR_MODE_JPEG_LS, BUFFER_TEST_SAMPLES_PER_ROW, shadow_y_pairs, 2, &options), 0);
+        CU_ASSERT_EQUAL_FATAL(v2f_file_decompress_from_path(
+                compressed_path, header_path, reconstructed_path, false, V2F_C_QUANTIZER_MODE_NONE, false, 1,
+                true, V2F_C_DECORRELATOR_MODE_JPEG_LS, BUFFER_TEST_SAMPLES_PER_ROW, NULL), 0);
+        uint64_t shadow_compressed_size;
+        uint8_t *const shadow_compressed = buffer_test_read_contents(compressed_path, &shadow_compressed_size);
+        uint64_t expected_size;
+        uint8_t *const expected = buffer_test_read_contents(reconstructed_path, &expected_size);
+        CU_ASSERT_EQUAL_FATAL(expected_size, raw_size);
+        FAIL_IF_FAIL(v2f_buffer_decompress(
+                codec, shadow_compressed, shadow_compressed_size, reconstructed_data, raw_size, &reconstructed_size));
+        CU_ASSERT_EQUAL_FATAL(reconstructed_size, raw_size);
+        CU_ASSERT_EQUAL_FATAL(memcmp(reconstructed_data, expected, raw_size), 0);
+        free(shadow_compressed);
+        free(expected);
+
+        // Empty buffers
+        FAIL_IF_FAIL(v2f_buffer_compress(codec, NULL, 0, NULL, 0, &compressed_size));
+        CU_ASSERT_EQUAL_FATAL(compressed_size, 0);
+        FAIL_IF_FAIL(v2f_buffer_decompress(codec, NULL, 0, NULL, 0, &reconstructed_size));
+        CU_ASSERT_EQUAL_FATAL(reconstructed_size, 0);
+
+        free(raw_data);
+        free(compressed_data);
+        free(reconstructed_data);
+        FAIL_IF_FAIL(v2f_buffer_destroy_codec(codec));
+        FAIL_IF_FAIL(v2f_buffer_destroy_codec(memory_codec));
+    }
+
+    free(samples);
+    unlink(header_path);
+    unlink(raw_path);
+    unlink(compressed_path);
+    unlink(reconstructed_path);
+}
+
+void test_buffer_invalid_parameters(void) {
+    char header_path[32];
+    buffer_test_create_path(header_path);
+    buffer_test_write_codec(2, header_path);
+    uint64_t header_size;
+    uint8_t *const header_data = buffer_test_read_contents(header_path, &header_size);
+
+    // Loading
+    v2f_buffer_codec_t *codec;
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_load_codec(NULL, &codec), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_load_codec(header_path, NULL), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_load_codec("/nonexistent/v2f_buffer_test", &codec), V2F_E_IO);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_load_codec_from_memory(NULL, header_size, &codec), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_load_codec_from_memory(header_data, 0, &codec), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_NOT_EQUAL_FATAL(v2f_buffer_load_codec_from_memory(header_data, header_size / 2, &codec), V2F_E_NONE);
+    FAIL_IF_FAIL(v2f_buffer_load_codec_from_memory(header_data, header_size, &codec));
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_destroy_codec(NULL), V2F_E_INVALID_PARAMETER);
+
+    // Configuration
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_configure_codec(
+            NULL, false, V2F_C_QUANTIZER_MODE_NONE, false, 1, false, V2F_C_DECORRELATOR_MODE_NONE, 0),
+                          V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_configure_codec(
+            codec, true, V2F_C_QUANTIZER_MODE_COUNT, false, 1, false, V2F_C_DECORRELATOR_MODE_NONE, 0),
+                          V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_configure_codec(
+            codec, false, V2F_C_QUANTIZER_MODE_NONE, true, 0, false, V2F_C_DECORRELATOR_MODE_NONE, 0),
+                          V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_configure_codec(
+            codec, false, V2F_C_QUANTIZER_MODE_NONE, false, 1, true, V2F_C_DECORRELATOR_MODE_COUNT, 0),
+                          V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_configure_codec(
+            codec, false, V2F_C_QUANTIZER_MODE_NONE, false, 1, true, V2F_C_DECORRELATOR_MODE_FGIJ, 0),
+                          V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_configure_codec(
+            codec, false, V2F_C_QUANTIZER_MODE_NONE, false, 1, false, V2F_C_DECORRELATOR_MODE_NONE,
+            V2F_C_MAX_BLOCK_SIZE + 1), V2F_E_INVALID_PARAMETER);
+    FAIL_IF_FAIL(v2f_buffer_configure_codec(
+            codec, false, V2F_C_QUANTIZER_MODE_NONE, false, 1, true, V2F_C_DECORRELATOR_MODE_LEFT, 10));
+
+    // Sizes that are not a multiple of the sample size or of the row size
+    uint8_t raw_data[40] = {0};
+    uint8_t compressed_data[256];
+    uint64_t size;
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_get_max_compressed_size(codec, 3, &size), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_get_max_compressed_size(NULL, 2, &size), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_get_max_compressed_size(codec, UINT64_MAX - 1, &size), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_compress(codec, raw_data, 3, compressed_data, sizeof(compressed_data), &size),
+                          V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_compress(codec, raw_data, 22, compressed_data, sizeof(compressed_data), &size),
+                          V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_compress(codec, NULL, 20, compressed_data, sizeof(compressed_data), &size),
+                          V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_compress(codec, raw_data, 20, compressed_data, 7, &size),
+                          V2F_E_INVALID_PARAMETER);
+
+    // Corrupted compressed data
+    uint64_t compressed_size;
+    FAIL_IF_FAIL(v2f_buffer_compress(
+            codec, raw_data, sizeof(raw_data), compressed_data, sizeof(compressed_data), &compressed_size));
+    uint8_t reconstructed_data[40];
+    FAIL_IF_FAIL(v2f_buffer_get_reconstructed_size(codec, compressed_data, compressed_size, &size));
+    CU_ASSERT_EQUAL_FATAL(size, sizeof(raw_data));
+    for (uint64_t truncated_size = 1; truncated_size < compressed_size; truncated_size++) {
+        CU_ASSERT_EQUAL_FATAL(v2f_buffer_get_reconstructed_size(codec, compressed_data, truncated_size, &size),
+                              V2F_E_CORRUPTED_DATA);
+        CU_ASSERT_EQUAL_FATAL(v2f_buffer_decompress(
+                codec, compressed_data, truncated_size, reconstructed_data, sizeof(reconstructed_data), &size),
+                              V2F_E_CORRUPTED_DATA);
+    }
+    // Sample count larger than the maximum block size
+    compressed_data[4] = 0xff;
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_decompress(
+            codec, compressed_data, compressed_size, reconstructed_data, sizeof(reconstructed_data), &size),
+                          V2F_E_CORRUPTED_DATA);
+
+    FAIL_IF_FAIL(v2f_buffer_destroy_codec(codec));
+    free(header_data);
+    unlink(header_path);
+}
+
+/**
+ * Compress and decompress the image of a job several times, checking the results,
+ * and destroy the job's codec.
+ *
+ * @param argument pointer to the buffer_test_job_t instance
+ *
+ * @return NULL
+ */
+static void *buffer_test_run_job(void *argument) {
+    buffer_test_job_t *const job = (buffer_test_job_t *) argument;
+    job->success = false;
+    uint64_t capacity;
+    if (v2f_buffer_get_max_compressed_size(job->codec, job->raw_size, &capacity) != V2F_E_NONE) {
+        return NULL;
+    }
+    uint8_t *const compressed_data = (uint8_t *) malloc(capacity);
+    uint8_t *const reconstructed_data = (uint8_t *) malloc(job->raw_size);
+    bool success = compressed_data != NULL && reconstructed_data != NULL;
+    for (uint32_t i = 0; i < BUFFER_TEST_SHARED_ITERATION_COUNT && success; i++) {
+        uint64_t compressed_size;
+        uint64_t reconstructed_size;
+        success = v2f_buffer_compress(
+                job->codec, job->raw_data, job->raw_size, compressed_data, capacity, &compressed_size) == V2F_E_NONE
+                  && compressed_size == job->expected_size
+                  && memcmp(compressed_data, job->expected_data, compressed_size) == 0
+                  && v2f_buffer_decompress(
+                job->codec, compressed_data, compressed_size, reconstructed_data, job->raw_size,
+                &reconstructed_size) == V2F_E_NONE
+                  && reconstructed_size == job->raw_size
+                  && memcmp(reconstructed_data, job->raw_data, job->raw_size) == 0;
+    }
+    free(compressed_data);
+    free(reconstructed_data);
+    job->success = success && v2f_buffer_destroy_codec(job->codec) == V2F_E_NONE;
+    return NULL;
+}
+
+void test_buffer_shared_forest(void) {
+    char header_path[32];
+    buffer_test_create_path(header_path);
+    buffer_test_write_codec(2, header_path);
+    v2f_buffer_forest_t *forest;
+    FAIL_IF_FAIL(v2f_buffer_load_forest(header_path, &forest));
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_load_forest(NULL, &forest), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_load_forest_from_memory(NULL, 1, &forest), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_release_forest(NULL), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_create_codec(NULL, NULL), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_buffer_create_codec(forest, NULL), V2F_E_INVALID_PARAMETER);
+
+    // Image shared by all threads
+    const uint64_t sample_count = BUFFER_TEST_SHARED_ROW_COUNT * BUFFER_TEST_SAMPLES_PER_ROW;
+    const uint64_t raw_size = 2 * sample_count;
+    uint8_t *const raw_data = (uint8_t *) malloc(raw_size);
+    CU_ASSERT_FATAL(raw_data != NULL);
+    for (uint64_t i = 0; i < sample_count; i++) {
+        const uint64_t value = (i / 3 + (i % BUFFER_TEST_SAMPLES_PER_ROW) * 5) % 0x10000;
+        raw_data[2 * i] = (uint8_t) (value >> 8);
+        raw_data[2 * i + 1] = (uint8_t) value;
+    }
+
+    // Each thread uses its own decorrelator mode. Expected results are computed
+    // sequentially with codecs that do not share the forest.
+    buffer_test_job_t jobs[BUFFER_TEST_THREAD_COUNT];
+    uint8_t *expected_data[V2F_C_DECORRELATOR_MODE_COUNT];
+    uint64_t expected_sizes[V2F_C_DECORRELATOR_MODE_COUNT];
+    for (uint32_t mode = 0; mode < V2F_C_DECORRELATOR_MODE_COUNT; mode++) {
+        v2f_buffer_codec_t *codec;
+        FAIL_IF_FAIL(v2f_buffer_load_codec(header_path, &codec));
+        FAIL_IF_FAIL(v2f_buffer_configure_codec(
+                codec, false, V2F_C_QUANTIZER_MODE_NONE, false, 1,
+                true, (v2f_decorrelator_mode_t) mode, BUFFER_TEST_SAMPLES_PER_ROW));
+        uint64_t capacity;
+        FAIL_IF_FAIL(v2f_buffer_get_max_compressed_size(codec, raw_size, &capacity));
+        expected_data[mode] = (uint8_t *) malloc(capacity);
+        CU_ASSERT_FATAL(expected_data[mode] != NULL);
+        FAIL_IF_FAIL(v2f_buffer_compress(
+                codec, raw_data, raw_size, expected_data[mode], capacity, &(expected_sizes[mode])));
+        FAIL_IF_FAIL(v2f_buffer_destroy_codec(codec));
+    }
+    for (uint32_t i = 0; i < BUFFER_TEST_THREAD_COUNT; i++) {
+        const uint32_t mode = i % V2F_C_DECORRELATOR_MODE_COUNT;
+        FAIL_IF_FAIL(v2f_buffer_create_codec(forest, &(jobs[i].codec)));
+        FAIL_IF_FAIL(v2f_buffer_configure_codec(
+                jobs[i].codec, false, V2F_C_QUANTIZER_MODE_NONE, false, 1,
+                true, (v2f_decorrelator_mode_t) mode, BUFFER_TEST_SAMPLES_PER_ROW));
+        jobs[i].raw_data = raw_data;
+        jobs[i].raw_size = raw_size;
+        jobs[i].expected_data = expected_data[mode];
+        jobs[i].expected_size = expected_sizes[mode];
+    }
+
+    // The forest is released before its codecs are used, and destroyed with the last of them
+    FAIL_IF_FAIL(v2f_buffer_release_forest(forest));
+    pthread_t threads[BUFFER_TEST_THREAD_COUNT];
+    for (uint32_t i = 0; i < BUFFER_TEST_THREAD_COUNT; i++) {
+        CU_ASSERT_EQUAL_FATAL(pthread_create(&(threads[i]), NULL, buffer_test_run_job, &(jobs[i])), 0);
+    }
+    for (uint32_t i = 0; i < BUFFER_TEST_THREAD_COUNT; i++) {
+        CU_ASSERT_EQUAL_FATAL(pthread_join(threads[i], NULL), 0);
+    }
+    for (uint32_t i = 0; i < BUFFER_TEST_THREAD_COUNT; i++) {
+        CU_ASSERT_FATAL(jobs[i].success);
+    }
+
+    for (uint32_t mode = 0; mode < V2F_C_DECORRELATOR_MODE_COUNT; mode++) {
+        free(expected_data[mode]);
+    }
+    free(raw_data);
+    unlink(header_path);
+}
+
+CU_START_REGISTRATION(buffer)
+    CU_QADD_TEST(test_buffer_round_trip)
+    CU_QADD_TEST(test_buffer_invalid_parameters)
+    CU_QADD_TEST(test_buffer_shared_forest)
+CU_END_REGISTRATION()
@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "CUExtension.h"
@@ -18,6 +19,7 @@
 #include "../src/v2f_entropy_coder.h"
 #include "../src/v2f_entropy_decoder.h"
 #include "../src/v2f_build.h"
+#include "../src/common.h"
 
 /**
  * Exercise code creation and destruction functions.
@@ -45,6 +47,33 @@ void test_compression_decompression_steps(void);
  */
 void test_compression_decompression_minimal_codec(void);
 
+/**
+ * Test that the 16-bit pipeline produces exactly the same compressed data
+ * and reconstructed samples as the 32-bit pipeline,
+ * for all quantization step and decorrelation mode combinations.
+ *
+ * @req V2F-1.1, V2F-1.2, V2F-1.3, V2F-1.4
+ */
+void test_compression_decompression_16_bit(void);
+
+/**
+ * Test that the fused pipeline of the compressor produces exactly the same compressed
+ * data as applying each stage to the whole block, for blocks of several tiles
+ * whose rows span tile boundaries.
+ *
+ * @req V2F-1.1, V2F-1.3, V2F-2.1
+ */
+void test_compression_fused_tiles(void);
+
+/**
+ * Test that the fused pipeline of the decompressor reconstructs exactly the same samples
+ * as applying each inverse stage to the whole block, for blocks of several tiles
+ * whose rows span tile boundaries.
+ *
+ * @req V2F-1.2, V2F-1.4, V2F-2.1
+ */
+void test_decompression_fused_tiles(void);
+
 void test_compressor_decompressor_create_destroy(void) {
     v2f_quantizer_t quantizer;
     v2f_decorrelator_t decorrelator;
@@ -342,9 +371,256 @@ void test_compression_decompression_minimal_codec(void) {
     }
 }
 
+void test_compression_decompression_16_bit(void) {
+    timer_reset();
+    srand(0);
+
+    const uint64_t samples_per_row = 512;
+    const uint64_t sample_count = 64 * samples_per_row;
+    v2f_sample_t *samples = malloc(sizeof(v2f_sample_t) * sample_count);
+    v2f_sample16_t *samples_16 = malloc(sizeof(v2f_sample16_t) * sample_count);
+    uint8_t *output_buffer = malloc(V2F_C_MAX_BYTES_PER_WORD * sample_count);
+    uint8_t *output_buffer_16 = malloc(V2F_C_MAX_BYTES_PER_WORD * sample_count);
+    CU_ASSERT_NOT_EQUAL_FATAL(samples, NULL);
+    CU_ASSERT_NOT_EQUAL_FATAL(samples_16, NULL);
+    CU_ASSERT_NOT_EQUAL_FATAL(output_buffer, NULL);
+    CU_ASSERT_NOT_EQUAL_FATAL(output_buffer_16, NULL);
+
+    for (uint8_t bytes_per_word = V2F_C_MIN_BYTES_PER_WORD;
+         bytes_per_word <= V2F_C_MAX_BYTES_PER_WORD;
+         bytes_per_word++) {
+        const v2f_sample_t max_sample_value =
+                (v2f_sample_t) ((1 << (8 * bytes_per_word)) - 1);
+        v2f_entropy_coder_t entropy_coder;
+        v2f_entropy_decoder_t entropy_decoder;
+        FAIL_IF_FAIL(v2f_build_minimal_forest(
+                bytes_per_word, &entropy_coder, &entropy_decoder));
+
+        for (v2f_decorrelator_mode_t decorrelator_mode = V2F_C_DECORRELATOR_MODE_NONE;
+             decorrelator_mode < V2F_C_DECORRELATOR_MODE_COUNT;
+             decorrelator_mode++) {
+            for (v2f_sample_t qstep = 1; qstep <= 8; qstep++) {
+                v2f_quantizer_t quantizer;
+                FAIL_IF_FAIL(v2f_quantizer_create(
+                        &quantizer,
+                        qstep == 1 ? V2F_C_QUANTIZER_MODE_NONE : V2F_C_QUANTIZER_MODE_UNIFORM,
+                        qstep, max_sample_value));
+                v2f_decorrelator_t decorrelator;
+                FAIL_IF_FAIL(v2f_decorrelator_create(
+                        &decorrelator, decorrelator_mode, max_sample_value, samples_per_row));
+                v2f_compressor_t compressor;
+                v2f_decompressor_t decompressor;
+                FAIL_IF_FAIL(v2f_compressor_create(
+                        &compressor, &quantizer, &decorrelator, &entropy_coder));
+                FAIL_IF_FAIL(v2f_decompressor_create(
+                        &decompressor, &quantizer, &decorrelator, &entropy_decoder));
+
+                // Smooth data with some noise, including the extremes of the dynamic range
+                for (uint64_t i = 0; i < sample_count; i++) {
+                    const int64_t value = (int64_t) ((i % samples_per_row) * max_sample_value / samples_per_row)
+                                          + (rand() % 17) - 8;
+                    samples[i] = (v2f_sample_t) (value < 0 ? 0 : MIN(value, (int64_t) max_sample_value));
+                    samples_16[i] = (v2f_sample16_t) samples[i];
+                }
+                samples[3] = samples_16[3] = 0;
+                samples[5] = max_sample_value;
+                samples_16[5] = (v2f_sample16_t) max_sample_value;
+
+                uint64_t written_byte_count;
+                uint64_t written_byte_count_16;
+                FAIL_IF_FAIL(v2f_compressor_compress_block(
+                        &compressor, samples, sample_count, output_buffer, &written_byte_count));
+                FAIL_IF_FAIL(v2f_compressor_compress_block_16(
+                        &compressor, samples_16, sample_count, output_buffer_16, &written_byte_count_16));
+                CU_ASSERT_EQUAL_FATAL(written_byte_count, written_byte_count_16);
+                CU_ASSERT_EQUAL_FATAL(memcmp(output_buffer, output_buffer_16, written_byte_count), 0);
+
+                uint64_t written_sample_count;
+                uint64_t written_sample_count_16;
+                FAIL_IF_FAIL(v2f_decompressor_decompress_block(
+                        &decompressor, output_buffer, written_byte_count, sample_count,
+                        samples, &written_sample_count));
+                FAIL_IF_FAIL(v2f_decompressor_decompress_block_16(
+                        &decompressor, output_buffer_16, written_byte_count_16, sample_count,
+                        samples_16, &written_sample_count_16));
+                CU_ASSERT_EQUAL_FATAL(written_sample_count, sample_count);
+                CU_ASSERT_EQUAL_FATAL(written_sample_count_16, sample_count);
+                for (uint64_t i = 0; i < sample_count; i++) {
+                    CU_ASSERT_EQUAL_FATAL(samples[i], samples_16[i]);
+                }
+            }
+        }
+
+        v2f_build_destroy_minimal_forest(&entropy_coder, &entropy_decoder);
+    }
+
+    free(samples);
+    free(samples_16);
+    free(output_buffer);
+    free(output_buffer_16);
+}
+
+void test_compression_fused_tiles(void) {
+    const uint64_t samples_per_row = 1000;
+    const uint64_t sample_count = 25 * samples_per_row;
+    const v2f_sample_t max_sample_value = 65535;
+    const v2f_sample_t step_sizes[] = {1, 3, 4, 7};
+    v2f_sample_t *const samples = malloc(sizeof(v2f_sample_t) * sample_count);
+    v2f_sample_t *const stage_samples = malloc(sizeof(v2f_sample_t) * sample_count);
+    v2f_sample16_t *const samples_16 = malloc(sizeof(v2f_sample16_t) * sample_count);
+    uint8_t *const output_buffer = malloc(2 * sample_count);
+    uint8_t *const stage_output_buffer = malloc(2 * sample_count);
+    uint8_t *const output_buffer_16 = malloc(2 * sample_count);
+    CU_ASSERT_FATAL(samples != NULL && stage_samples != NULL && samples_16 != NULL);
+    CU_ASSERT_FATAL(output_buffer != NULL && stage_output_buffer != NULL && output_buffer_16 != NULL);
+
+    v2f_entropy_coder_t entropy_coder;
+    v2f_entropy_decoder_t entropy_decoder;
+    FAIL_IF_FAIL(v2f_build_minimal_forest(2, &entropy_coder, &entropy_decoder));
+
+    for (v2f_decorrelator_mode_t decorrelator_mode = V2F_C_DECORRELATOR_MODE_NONE;
+         decorrelator_mode < V2F_C_DECORRELATOR_MODE_COUNT;
+         decorrelator_mode++) {
+        for (uint32_t step_index = 0; step_index < sizeof(step_sizes) / sizeof(v2f_sample_t); step_index++) {
+            v2f_quantizer_t quantizer;
+            FAIL_IF_FAIL(v2f_quantizer_create(
+                    &quantizer,
+                    step_sizes[step_index] == 1 ? V2F_C_QUANTIZER_MODE_NONE : V2F_C_QUANTIZER_MODE_UNIFORM,
+                    step_sizes[step_index], max_sample_value));
+            v2f_decorrelator_t decorrelator;
+            FAIL_IF_FAIL(v2f_decorrelator_create(
+                    &decorrelator, decorrelator_mode, max_sample_value, samples_per_row));
+            v2f_compressor_t compressor;
+            FAIL_IF_FAIL(v2f_compressor_create(&compressor, &quantizer, &decorrelator, &entropy_coder));
+
+            for (uint64_t i = 0; i < sample_count; i++) {
+                samples[i] = (v2f_sample_t) (((i % samples_per_row) * 60 + (i / samples_per_row) * 7
+                                              + (uint64_t) (rand() % 97)) % (max_sample_value + 1));
+                stage_samples[i] = samples[i];
+                samples_16[i] = (v2f_sample16_t) samples[i];
+            }
+
+            uint64_t stage_written_byte_count;
+            FAIL_IF_FAIL(v2f_quantizer_quantize(&quantizer, stage_samples, sample_count));
+            FAIL_IF_FAIL(v2f_decorrelator_decorrelate_block(&decorrelator, stage_samples, sample_count));
+            FAIL_IF_FAIL(v2f_entropy_coder_compress_block(
+                    &entropy_coder, stage_samples, sample_count, stage_output_buffer, &stage_written_byte_count));
+
+            uint64_t written_byte_count;
+            uint64_t written_byte_count_16;
+            FAIL_IF_FAIL(v2f_compressor_compress_block(
+                    &compressor, samples, sample_count, output_buffer, &written_byte_count));
+            FAIL_IF_FAIL(v2f_compressor_compress_block_16(
+                    &compressor, samples_16, sample_count, output_buffer_16, &written_byte_count_16));
+            CU_ASSERT_EQUAL_FATAL(written_byte_count, stage_written_byte_count);
+            CU_ASSERT_EQUAL_FATAL(written_byte_count_16, stage_written_byte_count);
+            CU_ASSERT_EQUAL_FATAL(memcmp(output_buffer, stage_output_buffer, written_byte_count), 0);
+            CU_ASSERT_EQUAL_FATAL(memcmp(output_buffer_16, stage_output_buffer, written_byte_count), 0);
+        }
+    }
+
+    v2f_build_destroy_minimal_forest(&entropy_coder, &entropy_decoder);
+    free(samples);
+    free(stage_samples);
+    free(samples_16);
+    free(output_buffer);
+    free(stage_output_buffer);
+    free(output_buffer_16);
+}
+
+void test_decompression_fused_tiles(void) {
+    const uint64_t samples_per_row = 1000;
+    const uint64_t sample_count = 25 * samples_per_row;
+    const v2f_sample_t max_sample_value = 65535;
+    const v2f_sample_t step_sizes[] = {1, 3, 4, 7};
+    v2f_sample_t *const samples = malloc(sizeof(v2f_sample_t) * sample_count);
+    v2f_sample_t *const stage_samples = malloc(sizeof(v2f_sample_t) * sample_count);
+    v2f_sample16_t *const samples_16 = malloc(sizeof(v2f_sample16_t) * sample_count);
+    uint8_t *const compressed_data = malloc(2 * sample_count);
+    CU_ASSERT_FATAL(samples != NULL && stage_samples != NULL && samples_16 != NULL && compressed_data != NULL);
+
+    v2f_entropy_coder_t entropy_coder;
+    v2f_entropy_decoder_t entropy_decoder;
+    FAIL_IF_FAIL(v2f_build_minimal_forest(2, &entropy_coder, &entropy_decoder));
+
+    for (v2f_decorrelator_mode_t decorrelator_mode = V2F_C_DECORRELATOR_MODE_NONE;
+         decorrelator_mode < V2F_C_DECORRELATOR_MODE_COUNT;
+         decorrelator_mode++) {
+        for (uint32_t step_index = 0; step_index < sizeof(step_sizes) / sizeof(v2f_sample_t); step_index++) {
+            v2f_quantizer_t quantizer;
+            FAIL_IF_FAIL(v2f_quantizer_create(
+                    &quantizer,
+                    step_sizes[step_index] == 1 ? V2F_C_QUANTIZER_MODE_NONE : V2F_C_QUANTIZER_MODE_UNIFORM,
+                    step_sizes[step_index], max_sample_value));
+            v2f_decorrelator_t decorrelator;
+            FAIL_IF_FAIL(v2f_decorrelator_create(
+                    &decorrelator, decorrelator_mode, max_sample_value, samples_per_row));
+            v2f_decompressor_t decompressor;
+            FAIL_IF_FAIL(v2f_decompressor_create(&decompressor, &quantizer, &decorrelator, &entropy_decoder));
+
+            for (uint64_t i = 0; i < sample_count; i++) {
+                samples[i] = (v2f_sample_t) (((i % samples_per_row) * 60 + (i / samples_per_row) * 7
+                                              + (uint64_t) (rand() % 97)) % (max_sample_value + 1));
+            }
+            uint64_t compressed_size;
+            FAIL_IF_FAIL(v2f_quantizer_quantize(&quantizer, samples, sample_count));
+            FAIL_IF_FAIL(v2f_decorrelator_decorrelate_block(&decorrelator, samples, sample_count));
+            FAIL_IF_FAIL(v2f_entropy_coder_compress_block(
+                    &entropy_coder, samples, sample_count, compressed_data, &compressed_size));
+
+            uint64_t stage_written_sample_count;
+            FAIL_IF_FAIL(v2f_entropy_decoder_decompress_block(
+                    &entropy_decoder, compressed_data, compressed_size, stage_samples, sample_count,
+                    &stage_written_sample_count));
+            CU_ASSERT_EQUAL_FATAL(stage_written_sample_count, sample_count);
+            FAIL_IF_FAIL(v2f_decorrelator_invert_block(&decorrelator, stage_samples, sample_count));
+            FAIL_IF_FAIL(v2f_quantizer_dequantize(&quantizer, stage_samples, sample_count));
+
+            uint64_t written_sample_count;
+            uint64_t written_sample_count_16;
+            FAIL_IF_FAIL(v2f_decompressor_decompress_block(
+                    &decompressor, compressed_data, compressed_size, sample_count, samples,
+                    &written_sample_count));
+            FAIL_IF_FAIL(v2f_decompressor_decompress_block_16(
+                    &decompressor, compressed_data, compressed_size, sample_count, samples_16,
+                    &written_sample_count_16));
+            CU_ASSERT_EQUAL_FATAL(written_sample_count, sample_count);
+            CU_ASSERT_EQUAL_FATAL(written_sample_count_16, sample_count);
+            CU_ASSERT_EQUAL_FATAL(memcmp(samples, stage_samples, sizeof(v2f_sample_t) * sample_count), 0);
+            for (uint64_t i = 0; i < sample_count; i++) {
+                CU_ASSERT_EQUAL_FATAL(samples_16[i], stage_samples[i]);
+            }
+
+            // Incomplete rows are rejected by two-dimensional modes only
+            const v2f_error_t expected_status =
+                    decorrelator_mode == V2F_C_DECORRELATOR_MODE_JPEG_LS
+                    || decorrelator_mode == V2F_C_DECORRELATOR_MODE_FGIJ ?
+                    V2F_E_INVALID_PARAMETER : V2F_E_NONE;
+            CU_ASSERT_EQUAL_FATAL(v2f_decompressor_decompress_block(
+                    &decompressor, compressed_data, compressed_size, sample_count - 1, samples,
+                    &written_sample_count), expected_status);
+            CU_ASSERT_EQUAL_FATAL(v2f_decompressor_decompress_block_16(
+                    &decompressor, compressed_data, compressed_size, sample_count - 1, samples_16,
+                    &written_sample_count_16), expected_status);
+            if (expected_status == V2F_E_NONE) {
+                CU_ASSERT_EQUAL_FATAL(written_sample_count, sample_count - 1);
+                CU_ASSERT_EQUAL_FATAL(memcmp(samples, stage_samples, sizeof(v2f_sample_t) * (sample_count - 1)), 0);
+            }
+        }
+    }
+
+    v2f_build_destroy_minimal_forest(&entropy_coder, &entropy_decoder);
+    free(samples);
+    free(stage_samples);
+    free(samples_16);
+    free(compressed_data);
+}
 
 CU_START_REGISTRATION(compressor_decompressor)
     CU_QADD_TEST(test_compressor_decompressor_create_destroy)
     CU_QADD_TEST(test_compression_decompression_steps)
     CU_QADD_TEST(test_compression_decompression_minimal_codec)
+    CU_QADD_TEST(test_compression_decompression_16_bit)
+    CU_QADD_TEST(test_compression_fused_tiles)
+    CU_QADD_TEST(test_decompression_fused_tiles)
 CU_END_REGISTRATION()
@@ -36,6 +36,22 @@ void test_decorrelator_prediction_mapping(void);
  */
 void test_decorrelator_lossless(void);
 
+/**
+ * Test that all decorrelation modes are lossless and produce the same results
+ * with 32 and 16 bits per sample for row lengths around the chunk size of the kernels.
+ *
+ * @req V2F-1.1
+ */
+void test_decorrelator_chunk_boundaries(void);
+
+/**
+ * Test that the JPEG-LS inverse produces the same results with several threads
+ * as with one, with 32 and 16 bits per sample.
+ *
+ * @req V2F-1.1
+ */
+void test_decorrelator_wavefront(void);
+
 void test_decorrelator_create(void) {
     printf("\n:: BEGIN - errors expected ----------------------\n");
 
@@ -150,8 +166,100 @@ void test_decorrelator_lossless(void) {
 
 }
 
+void test_decorrelator_chunk_boundaries(void) {
+    const uint64_t row_lengths[] = {3, 255, 256, 257, 511, 513, 1000};
+    const uint64_t row_count = 3;
+    const v2f_sample_t max_sample_value = 4095;
+    const uint64_t max_sample_count = 1000 * row_count;
+    v2f_sample_t *const original_samples = malloc(sizeof(v2f_sample_t) * max_sample_count);
+    v2f_sample_t *const samples = malloc(sizeof(v2f_sample_t) * max_sample_count);
+    v2f_sample16_t *const samples_16 = malloc(sizeof(v2f_sample16_t) * max_sample_count);
+    CU_ASSERT_FATAL(original_samples != NULL && samples != NULL && samples_16 != NULL);
+    for (uint64_t i = 0; i < max_sample_count; i++) {
+        original_samples[i] = (v2f_sample_t) ((i * i * 7919 + i * 31) % (max_sample_value + 1));
+    }
+
+    for (uint32_t mode_id = 0; mode_id < V2F_C_DECORRELATOR_MODE_COUNT; mode_id++) {
+        for (uint32_t length_index = 0; length_index < sizeof(row_lengths) / sizeof(uint64_t); length_index++) {
+            const uint64_t samples_per_row = row_lengths[length_index];
+            const uint64_t sample_count = samples_per_row * row_count;
+            for (uint64_t i = 0; i < sample_count; i++) {
+                samples[i] = original_samples[i];
+                samples_16[i] = (v2f_sample16_t) original_samples[i];
+            }
+
+            v2f_decorrelator_t decorrelator;
+            FAIL_IF_FAIL(v2f_decorrelator_create(&decorrelator, mode_id, max_sample_value, samples_per_row));
+            FAIL_IF_FAIL(v2f_decorrelator_decorrelate_block(&decorrelator, samples, sample_count));
+            FAIL_IF_FAIL(v2f_decorrelator_decorrelate_block_16(&decorrelator, samples_16, sample_count));
+            for (uint64_t i = 0; i < sample_count; i++) {
+                CU_ASSERT_FATAL(samples[i] <= max_sample_value);
+                CU_ASSERT_EQUAL_FATAL(samples[i], samples_16[i]);
+            }
+
+            FAIL_IF_FAIL(v2f_decorrelator_invert_block(&decorrelator, samples, sample_count));
+            CU_ASSERT_EQUAL_FATAL(memcmp(original_samples, samples, sizeof(v2f_sample_t) * sample_count), 0);
+        }
+    }
+
+    free(original_samples);
+    free(samples);
+    free(samples_16);
+}
+
+void test_decorrelator_wavefront(void) {
+    const uint64_t row_lengths[] = {3, 2047, 2048, 5000};
+    const uint32_t thread_counts[] = {2, 3, 8};
+    const uint64_t row_count = 17;
+    const v2f_sample_t max_sample_value = 65535;
+    const uint64_t max_sample_count = 5000 * row_count;
+    v2f_sample_t *const expected_samples = malloc(sizeof(v2f_sample_t) * max_sample_count);
+    v2f_sample_t *const samples = malloc(sizeof(v2f_sample_t) * max_sample_count);
+    v2f_sample16_t *const samples_16 = malloc(sizeof(v2f_sample16_t) * max_sample_count);
+    CU_ASSERT_FATAL(expected_samples != NULL && samples != NULL && samples_16 != NULL);
+
+    for (uint32_t length_index = 0; length_index < sizeof(row_lengths) / sizeof(uint64_t); length_index++) {
+        const uint64_t samples_per_row = row_lengths[length_index];
+        const uint64_t sample_count = samples_per_row * row_count;
+        v2f_decorrelator_t decorrelator;
+        FAIL_IF_FAIL(v2f_decorrelator_create(
+                &decorrelator, V2F_C_DECORRELATOR_MODE_JPEG_LS, max_sample_value, samples_per_row));
+        CU_ASSERT_EQUAL_FATAL(decorrelator.thread_count, 1);
+        for (uint64_t i = 0; i < sample_count; i++) {
+            expected_samples[i] = (v2f_sample_t) ((i * i * 7919 + i * 31) % (max_sample_value + 1));
+        }
+        FAIL_IF_FAIL(v2f_decorrelator_invert_block(&decorrelator, expected_samples, sample_count));
+
+        for (uint32_t thread_index = 0; thread_index < sizeof(thread_counts) / sizeof(uint32_t); thread_index++) {
+            for (uint64_t i = 0; i < sample_count; i++) {
+                samples[i] = (v2f_sample_t) ((i * i * 7919 + i * 31) % (max_sample_value + 1));
+                samples_16[i] = (v2f_sample16_t) samples[i];
+            }
+            decorrelator.thread_count = thread_counts[thread_index];
+            FAIL_IF_FAIL(v2f_decorrelator_invert_block(&decorrelator, samples, sample_count));
+            FAIL_IF_FAIL(v2f_decorrelator_invert_block_16(&decorrelator, samples_16, sample_count));
+            CU_ASSERT_EQUAL_FATAL(memcmp(expected_samples, samples, sizeof(v2f_sample_t) * sample_count), 0);
+            for (uint64_t i = 0; i < sample_count; i++) {
+                CU_ASSERT_EQUAL_FATAL(samples_16[i], expected_samples[i]);
+            }
+        }
+
+        decorrelator.thread_count = V2F_C_MAX_THREAD_COUNT + 1;
+        CU_ASSERT_EQUAL_FATAL(v2f_decorrelator_invert_block(&decorrelator, samples, sample_count),
+                              V2F_E_INVALID_PARAMETER);
+        CU_ASSERT_EQUAL_FATAL(v2f_decorrelator_invert_block_16(&decorrelator, samples_16, sample_count),
+                              V2F_E_INVALID_PARAMETER);
+    }
+
+    free(expected_samples);
+    free(samples);
+    free(samples_16);
+}
+
 CU_START_REGISTRATION(decorrelator)
     CU_QADD_TEST(test_decorrelator_create)
     CU_QADD_TEST(test_decorrelator_lossless)
     CU_QADD_TEST(test_decorrelator_prediction_mapping)
+    CU_QADD_TEST(test_decorrelator_chunk_boundaries)
+    CU_QADD_TEST(test_decorrelator_wavefront)
 CU_END_REGISTRATION()
@@ -20,6 +20,18 @@ void test_create_destroy(void);
  */
 void test_coder_basic(void);
 
+/**
+ * Test the compilation of a multi-level forest into a transition table,
+ * and coding with it.
+ */
+void test_coder_compiled_table(void);
+
+/**
+ * Test the compilation of the decoder word table and sample pool,
+ * and decoding with it.
+ */
+void test_decoder_compiled_table(void);
+
 void test_create_destroy(void) {
     v2f_entropy_coder_t coder;
     const uint32_t entry_count = 256;
@@ -159,7 +171,175 @@ void test_coder_basic(void) {
 //    timer_report_csv(stdout);
 }
 
+void test_coder_compiled_table(void) {
+    // Binary forest with a single full root: "0" -> {"00", "01"}, "1"
+    uint8_t word_00[] = {0};
+    uint8_t word_01[] = {1};
+    uint8_t word_1[] = {2};
+    v2f_entropy_coder_entry_t *null_children[] = {NULL};
+    v2f_entropy_coder_entry_t entry_00 = {
+            .children_entries = null_children, .children_count = 0, .word_bytes = word_00};
+    v2f_entropy_coder_entry_t entry_01 = {
+            .children_entries = null_children, .children_count = 0, .word_bytes = word_01};
+    v2f_entropy_coder_entry_t entry_1 = {
+            .children_entries = null_children, .children_count = 0, .word_bytes = word_1};
+    v2f_entropy_coder_entry_t *children_0[] = {&entry_00, &entry_01};
+    v2f_entropy_coder_entry_t entry_0 = {
+            .children_entries = children_0, .children_count = 2, .word_bytes = NULL};
+    v2f_entropy_coder_entry_t *root_children[] = {&entry_0, &entry_1};
+    v2f_entropy_coder_entry_t root = {
+            .children_entries = root_children, .children_count = 2, .word_bytes = NULL};
+    v2f_entropy_coder_entry_t *roots[] = {&root, &root};
+
+    v2f_entropy_coder_t coder;
+    FAIL_IF_FAIL(v2f_entropy_coder_create(&coder, 1, 1, roots, 2));
+
+    const v2f_sample_t samples[] = {0, 0, 1, 0, 1, 0};
+    const uint64_t sample_count = sizeof(samples) / sizeof(v2f_sample_t);
+    uint8_t output_buffer[sizeof(samples) / sizeof(v2f_sample_t)];
+    uint64_t written_byte_count;
+
+    // The table must be compiled before coding
+    CU_ASSERT_EQUAL_FATAL(v2f_entropy_coder_compress_block(
+            &coder, samples, sample_count, output_buffer, &written_byte_count),
+                          V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_entropy_coder_compile(NULL), V2F_E_INVALID_PARAMETER);
+
+    FAIL_IF_FAIL(v2f_entropy_coder_compile(&coder));
+    CU_ASSERT_EQUAL_FATAL(coder.state_count, 5);
+    CU_ASSERT_EQUAL_FATAL(coder.transition_count, 4);
+
+    // Compiling twice replaces the table
+    FAIL_IF_FAIL(v2f_entropy_coder_compile(&coder));
+    CU_ASSERT_EQUAL_FATAL(coder.state_count, 5);
+
+    FAIL_IF_FAIL(v2f_entropy_coder_compress_block(
+            &coder, samples, sample_count, output_buffer, &written_byte_count));
+    const uint8_t expected_output[] = {0, 2, 1, 0};
+    CU_ASSERT_EQUAL_FATAL(written_byte_count, sizeof(expected_output));
+    for (uint64_t i = 0; i < sizeof(expected_output); i++) {
+        CU_ASSERT_EQUAL_FATAL(output_buffer[i], expected_output[i]);
+    }
+    FAIL_IF_FAIL(v2f_entropy_coder_destroy(&coder));
+    CU_ASSERT_EQUAL_FATAL(coder.states, NULL);
+
+    // The first root must be full
+    root.children_count = 1;
+    root.children_entries = &(root_children[1]);
+    FAIL_IF_FAIL(v2f_entropy_coder_create(&coder, 1, 1, roots, 2));
+    CU_ASSERT_EQUAL_FATAL(v2f_entropy_coder_compile(&coder), V2F_E_CORRUPTED_DATA);
+    CU_ASSERT_EQUAL_FATAL(coder.states, NULL);
+    FAIL_IF_FAIL(v2f_entropy_coder_destroy(&coder));
+}
+
+void test_decoder_compiled_table(void) {
+    v2f_entropy_coder_t coder;
+    v2f_entropy_decoder_t decoder;
+    FAIL_IF_FAIL(v2f_build_minimal_forest(1, &coder, &decoder));
+
+    // One word and one sample per symbol, shared by all (aliased) roots,
+    // plus the invalid words of the root and of the error root
+    CU_ASSERT_EQUAL_FATAL(decoder.word_count, 256 + 2);
+    CU_ASSERT_EQUAL_FATAL(decoder.sample_pool_size, 256);
+    for (uint32_t w = 0; w < 256; w++) {
+        v2f_entropy_decoder_word_t const *const word = &(decoder.words[decoder.roots[0]->first_word + w]);
+        CU_ASSERT_EQUAL_FATAL(word->sample_count, 1);
+        CU_ASSERT_EQUAL_FATAL(decoder.sample_pool[word->sample_offset], w);
+        CU_ASSERT_EQUAL_FATAL(word->next_first_word, decoder.roots[0]->first_word);
+        CU_ASSERT_EQUAL_FATAL(word->next_included_count, 256);
+    }
+
+    const uint8_t compressed_block[] = {3, 1, 4, 1, 5};
+    v2f_sample_t reconstructed_samples[sizeof(compressed_block)];
+    uint64_t written_sample_count;
+
+    // Output is limited to max_output_sample_count samples
+    FAIL_IF_FAIL(v2f_entropy_decoder_decompress_block(
+            &decoder, compressed_block, sizeof(compressed_block),
+            reconstructed_samples, 3, &written_sample_count));
+    CU_ASSERT_EQUAL_FATAL(written_sample_count, 3);
+    FAIL_IF_FAIL(v2f_entropy_decoder_decompress_block(
+            &decoder, compressed_block, sizeof(compressed_block),
+            reconstructed_samples, sizeof(compressed_block), &written_sample_count));
+    CU_ASSERT_EQUAL_FATAL(written_sample_count, sizeof(compressed_block));
+    for (uint32_t i = 0; i < sizeof(compressed_block); i++) {
+        CU_ASSERT_EQUAL_FATAL(reconstructed_samples[i], compressed_block[i]);
+    }
+
+    uint32_t samples_written;
+    v2f_entropy_decoder_state_t state = decoder.initial_state;
+    CU_ASSERT_EQUAL_FATAL(state.first_word, decoder.roots[0]->first_word);
+    FAIL_IF_FAIL(v2f_entropy_decoder_decode_next_index(
+            &decoder, compressed_block, reconstructed_samples, &samples_written, &state));
+    CU_ASSERT_EQUAL_FATAL(samples_written, 1);
+    CU_ASSERT_EQUAL_FATAL(reconstructed_samples[0], 3);
+    CU_ASSERT_EQUAL_FATAL(state.first_word, decoder.roots[0]->first_word);
+    CU_ASSERT_EQUAL_FATAL(state.included_count, decoder.roots[0]->root_included_count);
+
+    // The table is needed for decoding
+    v2f_entropy_decoder_word_t *const words = decoder.words;
+    decoder.words = NULL;
+    CU_ASSERT_EQUAL_FATAL(v2f_entropy_decoder_decompress_block(
+            &decoder, compressed_block, sizeof(compressed_block),
+            reconstructed_samples, sizeof(compressed_block), &written_sample_count),
+                          V2F_E_INVALID_PARAMETER);
+    decoder.words = words;
+    CU_ASSERT_EQUAL_FATAL(v2f_entropy_decoder_compile(NULL), V2F_E_INVALID_PARAMETER);
+
+    FAIL_IF_FAIL(v2f_build_destroy_minimal_forest(&coder, &decoder));
+
+    // Single binary tree with words 0 ("0") and 1 ("1"), aliased for both roots
+    v2f_sample_t samples_0[] = {0};
+    v2f_sample_t samples_1[] = {1};
+    v2f_entropy_decoder_entry_t entries[] = {
+            {.samples = samples_0, .sample_count = 1, .children_count = 0, .coder_entry = NULL},
+            {.samples = samples_1, .sample_count = 1, .children_count = 1, .coder_entry = NULL}};
+    v2f_entropy_decoder_entry_t *entries_by_word[] = {&(entries[0]), &(entries[1])};
+    v2f_entropy_decoder_root_t root = {
+            .entries_by_index = entries, .root_entry_count = 2,
+            .entries_by_word = entries_by_word, .root_included_count = 2};
+    v2f_entropy_decoder_root_t *roots[] = {&root, &root};
+    FAIL_IF_FAIL(v2f_entropy_decoder_create(&decoder, roots, 2, 1, 1));
+    FAIL_IF_FAIL(v2f_entropy_decoder_compile(&decoder));
+
+    // Invalid words are detected
+    const uint8_t valid_block[] = {1, 0, 1};
+    const uint8_t invalid_block[] = {1, 2, 0};
+    FAIL_IF_FAIL(v2f_entropy_decoder_decompress_block(
+            &decoder, valid_block, sizeof(valid_block),
+            reconstructed_samples, sizeof(valid_block), &written_sample_count));
+    CU_ASSERT_EQUAL_FATAL(written_sample_count, sizeof(valid_block));
+    CU_ASSERT_EQUAL_FATAL(v2f_entropy_decoder_decompress_block(
+            &decoder, invalid_block, sizeof(invalid_block),
+            reconstructed_samples, sizeof(invalid_block), &written_sample_count),
+                          V2F_E_CORRUPTED_DATA);
+    state = decoder.initial_state;
+    CU_ASSERT_EQUAL_FATAL(v2f_entropy_decoder_decode_next_index(
+            &decoder, invalid_block + 1, reconstructed_samples, &samples_written, &state),
+                          V2F_E_CORRUPTED_DATA);
+    FAIL_IF_FAIL(v2f_entropy_decoder_destroy(&decoder));
+
+    // Words must lead to an existing root
+    entries[1].children_count = 2;
+    FAIL_IF_FAIL(v2f_entropy_decoder_create(&decoder, roots, 2, 1, 1));
+    CU_ASSERT_EQUAL_FATAL(v2f_entropy_decoder_compile(&decoder), V2F_E_CORRUPTED_DATA);
+    CU_ASSERT_EQUAL_FATAL(decoder.words, NULL);
+    FAIL_IF_FAIL(v2f_entropy_decoder_destroy(&decoder));
+
+    // A missing first root is detected even if no word leads to it
+    entries[0].children_count = 1;
+    entries[1].children_count = 1;
+    FAIL_IF_FAIL(v2f_entropy_decoder_create(&decoder, roots, 2, 1, 1));
+    roots[0] = NULL;
+    CU_ASSERT_EQUAL_FATAL(v2f_entropy_decoder_compile(&decoder), V2F_E_CORRUPTED_DATA);
+    CU_ASSERT_EQUAL_FATAL(decoder.words, NULL);
+    roots[0] = &root;
+    FAIL_IF_FAIL(v2f_entropy_decoder_destroy(&decoder));
+}
+
 CU_START_REGISTRATION(entropy_codec)
     CU_QADD_TEST(test_create_destroy)
     CU_QADD_TEST(test_coder_basic)
+    CU_QADD_TEST(test_coder_compiled_table)
+    CU_QADD_TEST(test_decoder_compiled_table)
 CU_END_REGISTRATION()
@@ -5,7 +5,9 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 #include "CUExtension.h"
 #include "test_common.h"
@@ -14,21 +16,71 @@
 #include "../src/log.h"
 #include "../src/v2f_file.h"
 #include "../src/v2f_build.h"
+#include "../src/v2f_entropy_coder.h"
+#include "../src/v2f_entropy_decoder.h"
 #include "test_samples.h"
 
 /// Exercise file I/O
 void test_sample_io(void);
 
+/// Test that samples are written and read in big endian order for all supported sizes
+void test_big_endian_io(void);
+
 /**
  * Test that entropy coders/decoders can be properly dumped and loaded
  */
 void test_minimal_forest_dump(void);
 
+/**
+ * Test that reading a truncated forest fails without leaking the partially read forest
+ */
+void test_truncated_forest_read(void);
+
 /**
  * Test that compressor/decompressor pairs (codecs) can be properly dumped and loaded
  */
 void test_minimal_codec_dump(void);
 
+/**
+ * Test that pipelined and multi-threaded compression and decompression produce exactly
+ * the same output as their sequential counterparts
+ */
+void test_parallel_codec(void);
+
+/**
+ * Test that forest caches are written, mapped, and rejected when stale or corrupted,
+ * and that mapped forests produce the same results as read ones
+ */
+void test_forest_cache(void);
+
+/**
+ * Test that row ranges are decompressed identically with and without a block index,
+ * that the index does not change the envelopes, and that corrupted indices are ignored
+ */
+void test_block_index(void);
+
+/**
+ * Test that compression and decompression with mapped files produce the same output as with stdio,
+ * including row selection, errors in the compressed data and files that cannot be mapped.
+ */
+void test_mapped_files(void);
+
+/**
+ * Test that a single JPEG-LS block decompressed with several threads, which invert its prediction
+ * as a row wavefront, is reconstructed exactly as with a single thread
+ */
+void test_single_block_wavefront(void);
+
+/**
+ * Read all contents of a file.
+ *
+ * @param file file to be read. It is read from its beginning.
+ * @param size pointer where the number of bytes is stored
+ *
+ * @return a buffer with the contents, which must be freed by the caller
+ */
+static uint8_t *file_test_read_contents(FILE *file, uint64_t *const size);
+
 void test_sample_io(void) {
     for (uint32_t i = 0; i < V2F_C_TEST_SAMPLE_COUNT; i++) {
         v2f_test_sample_t *sample_info = &(all_test_samples[i]);
@@ -86,6 +138,63 @@ void test_sample_io(void) {
     }
 }
 
+void test_big_endian_io(void) {
+    // Enough samples to need several output chunks, the last one being partial
+    const uint64_t sample_count = 3 * 4096 + 17;
+    v2f_sample_t *samples = malloc(sizeof(v2f_sample_t) * sample_count);
+    v2f_sample_t *read_samples = malloc(sizeof(v2f_sample_t) * sample_count);
+    CU_ASSERT_NOT_EQUAL_FATAL(samples, NULL);
+    CU_ASSERT_NOT_EQUAL_FATAL(read_samples, NULL);
+
+    for (uint8_t bytes_per_sample = 1; bytes_per_sample <= 4; bytes_per_sample++) {
+        const uint64_t max_value = (UINT64_C(1) << (8 * bytes_per_sample)) - 1;
+        for (uint64_t i = 0; i < sample_count; i++) {
+            samples[i] = (v2f_sample_t) ((i * 2654435761u) & max_value);
+        }
+
+        FILE *tmp = tmpfile();
+        CU_ASSERT_NOT_EQUAL_FATAL(tmp, NULL);
+        FAIL_IF_FAIL(v2f_file_write_big_endian(tmp, samples, sample_count, bytes_per_sample));
+        CU_ASSERT_EQUAL_FATAL(ftello(tmp), (off_t) (sample_count * bytes_per_sample));
+
+        // Most significant byte first
+        CU_ASSERT_EQUAL_FATAL(fseeko(tmp, 0, SEEK_SET), 0);
+        const int first_byte = fgetc(tmp);
+        CU_ASSERT_EQUAL_FATAL((v2f_sample_t) first_byte, samples[0] >> (8 * (bytes_per_sample - 1)));
+
+        CU_ASSERT_EQUAL_FATAL(fseeko(tmp, 0, SEEK_SET), 0);
+        uint64_t read_sample_count;
+        FAIL_IF_FAIL(v2f_file_read_big_endian(
+                tmp, read_samples, sample_count, bytes_per_sample, &read_sample_count));
+        CU_ASSERT_EQUAL_FATAL(read_sample_count, sample_count);
+        for (uint64_t i = 0; i < sample_count; i++) {
+            CU_ASSERT_EQUAL_FATAL(read_samples[i], samples[i]);
+        }
+
+        // Reading past the end of file is signaled, and misaligned ends are errors
+        CU_ASSERT_EQUAL_FATAL(fseeko(tmp, 0, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(v2f_file_read_big_endian(
+                tmp, read_samples, sample_count + 1, bytes_per_sample, &read_sample_count),
+                              V2F_E_UNEXPECTED_END_OF_FILE);
+        CU_ASSERT_EQUAL_FATAL(read_sample_count, sample_count);
+        if (bytes_per_sample > 1) {
+            CU_ASSERT_EQUAL_FATAL(fseeko(tmp, 1, SEEK_SET), 0);
+            CU_ASSERT_EQUAL_FATAL(v2f_file_read_big_endian(
+                    tmp, read_samples, sample_count, bytes_per_sample, &read_sample_count), V2F_E_IO);
+        }
+
+        fclose(tmp);
+    }
+
+    CU_ASSERT_EQUAL_FATAL(v2f_file_write_big_endian(stdout, samples, 1, 0), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_file_write_big_endian(stdout, samples, 1, 5), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_file_write_big_endian(stdout, NULL, 1, 1), V2F_E_INVALID_PARAMETER);
+    FAIL_IF_FAIL(v2f_file_write_big_endian(stdout, NULL, 0, 1));
+
+    free(samples);
+    free(read_samples);
+}
+
 void test_minimal_forest_dump(void) {
     v2f_entropy_coder_t coder;
     v2f_entropy_decoder_t decoder;
@@ -115,6 +224,37 @@ void test_minimal_forest_dump(void) {
     }
 }
 
+void test_truncated_forest_read(void) {
+    v2f_entropy_coder_t coder;
+    v2f_entropy_decoder_t decoder;
+
+    FAIL_IF_FAIL(v2f_build_minimal_forest(1, &coder, &decoder));
+    FILE *full = tmpfile();
+    CU_ASSERT_PTR_NOT_NULL(full);
+    FAIL_IF_FAIL(v2f_file_write_forest(full, &coder, &decoder, 1));
+    FAIL_IF_FAIL(v2f_build_destroy_minimal_forest(&coder, &decoder));
+
+    const off_t full_size = ftello(full);
+    CU_ASSERT_FATAL(full_size > 0);
+    uint8_t *const contents = malloc((size_t) full_size);
+    CU_ASSERT_PTR_NOT_NULL(contents);
+    CU_ASSERT_EQUAL_FATAL(fseeko(full, 0, SEEK_SET), 0);
+    CU_ASSERT_EQUAL_FATAL(fread(contents, 1, (size_t) full_size, full), (size_t) full_size);
+    fclose(full);
+
+    for (uint32_t k = 0; k < 16; k++) {
+        const size_t truncated_size = (size_t) (full_size * k / 16);
+        FILE *truncated = tmpfile();
+        CU_ASSERT_PTR_NOT_NULL(truncated);
+        CU_ASSERT_EQUAL_FATAL(fwrite(contents, 1, truncated_size, truncated), truncated_size);
+        CU_ASSERT_EQUAL_FATAL(fseeko(truncated, 0, SEEK_SET), 0);
+        CU_ASSERT_NOT_EQUAL_FATAL(v2f_file_read_forest(truncated, &coder, &decoder), V2F_E_NONE);
+        fclose(truncated);
+    }
+
+    free(contents);
+}
+
 void test_minimal_codec_dump(void) {
     v2f_compressor_t compressor1;
     v2f_decompressor_t decompressor1;
@@ -143,8 +283,579 @@ void test_minimal_codec_dump(void) {
     }
 }
 
+void test_parallel_codec(void) {
+    v2f_compressor_t compressor;
+    v2f_decompressor_t decompressor;
+    FAIL_IF_FAIL(v2f_build_minimal_codec(1, &compressor, &decompressor));
+    FILE *header_file = tmpfile();
+    CU_ASSERT_NOT_EQUAL_FATAL(header_file, NULL);
+    FAIL_IF_FAIL(v2f_file_write_codec(header_file, &compressor, &decompressor));
+    FAIL_IF_FAIL(v2f_build_destroy_minimal_codec(&compressor, &decompressor));
+
+    // Several full blocks plus a partial one, with shadow regions in between
+    const v2f_sample_t samples_per_row = 1024;
+    const uint64_t sample_count = 5 * (uint64_t) V2F_C_MAX_BLOCK_SIZE / 2;
+    uint32_t shadow_y_pairs[] = {5, 9, 2000, 2100};
+    FILE *raw_file = tmpfile();
+    CU_ASSERT_NOT_EQUAL_FATAL(raw_file, NULL);
+    uint32_t seed = 1;
+    for (uint64_t i = 0; i < sample_count; i++) {
+        seed = seed * 1103515245 + 12345;
+        CU_ASSERT_NOT_EQUAL_FATAL(fputc((int) ((seed >> 16) % 7), raw_file), EOF);
+    }
+
+    // Sequential, pipelined with one worker and pipelined with several workers
+    FILE *output_files[3];
+    const uint32_t thread_counts[3] = {1, 1, 4};
+    const bool pipelines[3] = {false, true, false};
+    v2f_file_options_t options;
+    FAIL_IF_FAIL(v2f_file_init_options(&options));
+    for (uint32_t i = 0; i < 3; i++) {
+        options.thread_count = thread_counts[i];
+        options.pipeline = pipelines[i];
+        output_files[i] = tmpfile();
+        CU_ASSERT_NOT_EQUAL_FATAL(output_files[i], NULL);
+        CU_ASSERT_EQUAL_FATAL(fseeko(raw_file, 0, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(v2f_file_compress_from_file(
+                raw_file, header_file, output_files[i],
+                false, 0, false, 0, false, 0, samples_per_row,
+                shadow_y_pairs, 2, &options), 0);
+        CU_ASSERT_FATAL(ftello(output_files[i]) > (off_t) (8 * 4));
+        CU_ASSERT_EQUAL_FATAL(fseeko(output_files[i], 0, SEEK_SET), 0);
+    }
+    int c0;
+    do {
+        c0 = fgetc(output_files[0]);
+        CU_ASSERT_EQUAL_FATAL(c0, fgetc(output_files[1]));
+        CU_ASSERT_EQUAL_FATAL(c0, fgetc(output_files[2]));
+    } while (c0 != EOF);
+
+    FILE *reconstructed_files[3];
+    for (uint32_t i = 0; i < 3; i++) {
+        options.thread_count = thread_counts[i];
+        options.pipeline = pipelines[i];
+        reconstructed_files[i] = tmpfile();
+        CU_ASSERT_NOT_EQUAL_FATAL(reconstructed_files[i], NULL);
+        CU_ASSERT_EQUAL_FATAL(fseeko(output_files[0], 0, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(v2f_file_decompress_from_file(
+                output_files[0], header_file, reconstructed_files[i],
+                false, 0, false, 0, false, 0, samples_per_row, &options), 0);
+        CU_ASSERT_EQUAL_FATAL(fseeko(reconstructed_files[i], 0, SEEK_SET), 0);
+    }
+    CU_ASSERT_EQUAL_FATAL(fseeko(raw_file, 0, SEEK_SET), 0);
+    for (uint64_t i = 0; i < sample_count; i++) {
+        const int original = fgetc(raw_file);
+        const int reconstructed = fgetc(reconstructed_files[0]);
+        CU_ASSERT_EQUAL_FATAL(reconstructed, fgetc(reconstructed_files[1]));
+        CU_ASSERT_EQUAL_FATAL(reconstructed, fgetc(reconstructed_files[2]));
+        const uint64_t y = i / samples_per_row;
+        const bool is_shadow = (y >= shadow_y_pairs[0] && y <= shadow_y_pairs[1])
+                               || (y >= shadow_y_pairs[2] && y <= shadow_y_pairs[3]);
+        CU_ASSERT_EQUAL_FATAL(reconstructed, is_shadow ? 0 : original);
+    }
+    CU_ASSERT_EQUAL_FATAL(fgetc(reconstructed_files[1]), EOF);
+    CU_ASSERT_EQUAL_FATAL(fgetc(reconstructed_files[2]), EOF);
+
+    // Errors found by the reader after several blocks are in flight are reported
+    for (uint32_t i = 0; i < 3; i++) {
+        options.thread_count = thread_counts[i];
+        options.pipeline = pipelines[i];
+        CU_ASSERT_EQUAL_FATAL(fseeko(raw_file, 0, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(v2f_file_compress_from_file(
+                raw_file, header_file, output_files[i],
+                false, 0, false, 0, false, 0, 1000,
+                NULL, 0, &options), V2F_E_CORRUPTED_DATA);
+    }
+
+    // Envelopes larger than any valid one for this codec do not overflow the slot buffers
+    FILE *oversized_file = tmpfile();
+    CU_ASSERT_NOT_EQUAL_FATAL(oversized_file, NULL);
+    v2f_sample_t envelope_header[2] = {V2F_C_MAX_BLOCK_SIZE + 1, V2F_C_MAX_BLOCK_SIZE};
+    FAIL_IF_FAIL(v2f_file_write_big_endian(oversized_file, envelope_header, 2, 4));
+    for (uint32_t i = 0; i < envelope_header[0]; i++) {
+        CU_ASSERT_NOT_EQUAL_FATAL(fputc(0xff, oversized_file), EOF);
+    }
+    for (uint32_t i = 0; i < 3; i++) {
+        options.thread_count = thread_counts[i];
+        options.pipeline = pipelines[i];
+        CU_ASSERT_EQUAL_FATAL(fseeko(oversized_file, 0, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(v2f_file_decompress_from_file(
+                oversized_file, header_file, reconstructed_files[i],
+                false, 0, false, 0, false, 0, samples_per_row, &options), V2F_E_NONE);
+    }
+    fclose(oversized_file);
+
+    // Too many threads
+    options.thread_count = V2F_C_MAX_THREAD_COUNT + 1;
+    CU_ASSERT_NOT_EQUAL_FATAL(v2f_file_compress_from_file(
+            raw_file, header_file, output_files[0],
+            false, 0, false, 0, false, 0, samples_per_row,
+            NULL, 0, &options), 0);
+    CU_ASSERT_NOT_EQUAL_FATAL(v2f_file_decompress_from_file(
+            output_files[0], header_file, reconstructed_files[0],
+            false, 0, false, 0, false, 0, samples_per_row, &options), 0);
+    CU_ASSERT_EQUAL_FATAL(v2f_file_init_options(NULL), V2F_E_INVALID_PARAMETER);
+
+    fclose(output_files[0]);
+    fclose(output_files[1]);
+    fclose(output_files[2]);
+    fclose(reconstructed_files[0]);
+    fclose(reconstructed_files[1]);
+    fclose(reconstructed_files[2]);
+    fclose(raw_file);
+    fclose(header_file);
+}
+
+void test_forest_cache(void) {
+    v2f_compressor_t compressor;
+    v2f_decompressor_t decompressor;
+    FAIL_IF_FAIL(v2f_build_minimal_codec(2, &compressor, &decompressor));
+    FILE *header_file = tmpfile();
+    CU_ASSERT_PTR_NOT_NULL(header_file);
+    FAIL_IF_FAIL(v2f_file_write_codec(header_file, &compressor, &decompressor));
+    FAIL_IF_FAIL(v2f_build_destroy_minimal_codec(&compressor, &decompressor));
+    uint64_t content_hash;
+    FAIL_IF_FAIL(v2f_file_hash_contents(header_file, &content_hash));
+
+    char cache_path[] = "/tmp/v2f_forest_cache_XXXXXX";
+    const int fd = mkstemp(cache_path);
+    CU_ASSERT_FATAL(fd >= 0);
+    close(fd);
+    CU_ASSERT_EQUAL_FATAL(unlink(cache_path), 0);
+
+    // Without cache, the forest is read and the cache is written.
+    // With it, the forest is mapped.
+    v2f_compressor_t read_compressor;
+    v2f_decompressor_t read_decompressor;
+    CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+    FAIL_IF_FAIL(v2f_file_read_codec_cached(header_file, cache_path, &read_compressor, &read_decompressor));
+    CU_ASSERT_EQUAL_FATAL(read_decompressor.entropy_decoder->forest_cache, NULL);
+    v2f_compressor_t mapped_compressor;
+    v2f_decompressor_t mapped_decompressor;
+    CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+    FAIL_IF_FAIL(v2f_file_read_codec_cached(header_file, cache_path, &mapped_compressor, &mapped_decompressor));
+    CU_ASSERT_NOT_EQUAL_FATAL(mapped_decompressor.entropy_decoder->forest_cache, NULL);
+    CU_ASSERT_EQUAL_FATAL(mapped_decompressor.entropy_decoder->roots, NULL);
+    struct stat cache_status;
+    CU_ASSERT_EQUAL_FATAL(stat(cache_path, &cache_status), 0);
+    CU_ASSERT_EQUAL_FATAL(cache_status.st_mode & 0777, S_IRUSR | S_IWUSR);
+
+    // Both produce the same results
+    const uint64_t sample_count = 1000;
+    v2f_sample_t samples[1000];
+    const v2f_sample_t max_expected_value = read_compressor.entropy_coder->max_expected_value;
+    for (uint64_t i = 0; i < sample_count; i++) {
+        samples[i] = (v2f_sample_t) ((i * 7919) % ((uint64_t) max_expected_value + 1));
+    }
+    uint8_t read_bitstream[2 * 1000 + 2];
+    uint8_t mapped_bitstream[2 * 1000 + 2];
+    uint64_t read_size;
+    uint64_t mapped_size;
+    FAIL_IF_FAIL(v2f_entropy_coder_compress_block(
+            read_compressor.entropy_coder, samples, sample_count, read_bitstream, &read_size));
+    FAIL_IF_FAIL(v2f_entropy_coder_compress_block(
+            mapped_compressor.entropy_coder, samples, sample_count, mapped_bitstream, &mapped_size));
+    CU_ASSERT_EQUAL_FATAL(read_size, mapped_size);
+    CU_ASSERT_EQUAL_FATAL(memcmp(read_bitstream, mapped_bitstream, read_size), 0);
+
+    v2f_sample_t reconstructed_samples[1000];
+    v2f_sample16_t reconstructed_samples_16[1000];
+    uint64_t written_sample_count;
+    FAIL_IF_FAIL(v2f_entropy_decoder_decompress_block(
+            mapped_decompressor.entropy_decoder, mapped_bitstream, mapped_size,
+            reconstructed_samples, sample_count, &written_sample_count));
+    CU_ASSERT_EQUAL_FATAL(written_sample_count, sample_count);
+    FAIL_IF_FAIL(v2f_entropy_decoder_decompress_block_16(
+            mapped_decompressor.entropy_decoder, mapped_bitstream, mapped_size,
+            reconstructed_samples_16, sample_count, &written_sample_count));
+    CU_ASSERT_EQUAL_FATAL(written_sample_count, sample_count);
+    for (uint64_t i = 0; i < sample_count; i++) {
+        CU_ASSERT_EQUAL_FATAL(reconstructed_samples[i], samples[i]);
+        CU_ASSERT_EQUAL_FATAL(reconstructed_samples_16[i], samples[i]);
+    }
+
+    FAIL_IF_FAIL(v2f_file_destroy_read_codec(&read_compressor, &read_decompressor));
+    FAIL_IF_FAIL(v2f_file_destroy_read_codec(&mapped_compressor, &mapped_decompressor));
+
+    // Stale caches are rejected
+    v2f_entropy_coder_t coder;
+    v2f_entropy_decoder_t decoder;
+    CU_ASSERT_EQUAL_FATAL(v2f_file_map_forest_cache(cache_path, content_hash + 1, &coder, &decoder),
+                          V2F_E_CORRUPTED_DATA);
+    FAIL_IF_FAIL(v2f_file_map_forest_cache(cache_path, content_hash, &coder, &decoder));
+    FAIL_IF_FAIL(v2f_file_destroy_read_forest(&coder, &decoder));
+
+    // So are corrupted ones. The last bytes are part of the 16-bit sample pool.
+    FILE *cache_file = fopen(cache_path, "r+");
+    CU_ASSERT_PTR_NOT_NULL(cache_file);
+    CU_ASSERT_EQUAL_FATAL(fseeko(cache_file, -1, SEEK_END), 0);
+    const int last_byte = fgetc(cache_file);
+    CU_ASSERT_NOT_EQUAL_FATAL(last_byte, EOF);
+    CU_ASSERT_EQUAL_FATAL(fseeko(cache_file, -1, SEEK_END), 0);
+    CU_ASSERT_NOT_EQUAL_FATAL(fputc(~last_byte & 0xff, cache_file), EOF);
+    fclose(cache_file);
+    CU_ASSERT_EQUAL_FATAL(v2f_file_map_forest_cache(cache_path, content_hash, &coder, &decoder),
+                          V2F_E_CORRUPTED_DATA);
+    CU_ASSERT_EQUAL_FATAL(truncate(cache_path, 100), 0);
+    CU_ASSERT_EQUAL_FATAL(v2f_file_map_forest_cache(cache_path, content_hash, &coder, &decoder),
+                          V2F_E_CORRUPTED_DATA);
+
+    // Invalid caches are rewritten when the codec is read
+    CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+    FAIL_IF_FAIL(v2f_file_read_codec_cached(header_file, cache_path, &read_compressor, &read_decompressor));
+    FAIL_IF_FAIL(v2f_file_destroy_read_codec(&read_compressor, &read_decompressor));
+    FAIL_IF_FAIL(v2f_file_map_forest_cache(cache_path, content_hash, &coder, &decoder));
+    FAIL_IF_FAIL(v2f_file_destroy_read_forest(&coder, &decoder));
+
+    // Initial words whose position wraps around when added to their count are rejected.
+    // The first word is stored after 10 32-bit and 5 64-bit fields of the header.
+    const uint64_t wrapping_first_word = UINT64_MAX;
+    cache_file = fopen(cache_path, "r+");
+    CU_ASSERT_PTR_NOT_NULL(cache_file);
+    CU_ASSERT_EQUAL_FATAL(fseeko(cache_file, 10 * 4 + 5 * 8, SEEK_SET), 0);
+    CU_ASSERT_EQUAL_FATAL(fwrite(&wrapping_first_word, sizeof(wrapping_first_word), 1, cache_file), 1);
+    fclose(cache_file);
+    CU_ASSERT_EQUAL_FATAL(v2f_file_map_forest_cache(cache_path, content_hash, &coder, &decoder),
+                          V2F_E_CORRUPTED_DATA);
+
+    // Caches that others can modify are not mapped, and are replaced by private ones
+    CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+    FAIL_IF_FAIL(v2f_file_read_codec_cached(header_file, cache_path, &read_compressor, &read_decompressor));
+    FAIL_IF_FAIL(v2f_file_destroy_read_codec(&read_compressor, &read_decompressor));
+    CU_ASSERT_EQUAL_FATAL(chmod(cache_path, 0666), 0);
+    CU_ASSERT_EQUAL_FATAL(v2f_file_map_forest_cache(cache_path, content_hash, &coder, &decoder),
+                          V2F_E_CORRUPTED_DATA);
+    CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+    FAIL_IF_FAIL(v2f_file_read_codec_cached(header_file, cache_path, &read_compressor, &read_decompressor));
+    CU_ASSERT_EQUAL_FATAL(read_decompressor.entropy_decoder->forest_cache, NULL);
+    FAIL_IF_FAIL(v2f_file_destroy_read_codec(&read_compressor, &read_decompressor));
+    CU_ASSERT_EQUAL_FATAL(stat(cache_path, &cache_status), 0);
+    CU_ASSERT_EQUAL_FATAL(cache_status.st_mode & 0777, S_IRUSR | S_IWUSR);
+    FAIL_IF_FAIL(v2f_file_map_forest_cache(cache_path, content_hash, &coder, &decoder));
+    FAIL_IF_FAIL(v2f_file_destroy_read_forest(&coder, &decoder));
+
+    CU_ASSERT_EQUAL_FATAL(unlink(cache_path), 0);
+    CU_ASSERT_EQUAL_FATAL(v2f_file_map_forest_cache(cache_path, content_hash, &coder, &decoder), V2F_E_IO);
+    fclose(header_file);
+}
+
+static uint8_t *file_test_read_contents(FILE *file, uint64_t *const size) {
+    CU_ASSERT_EQUAL_FATAL(fseeko(file, 0, SEEK_END), 0);
+    const off_t end = ftello(file);
+    CU_ASSERT_FATAL(end >= 0);
+    *size = (uint64_t) end;
+    uint8_t *const contents = (uint8_t *) malloc(*size + 1);
+    CU_ASSERT_FATAL(contents != NULL);
+    CU_ASSERT_EQUAL_FATAL(fseeko(file, 0, SEEK_SET), 0);
+    CU_ASSERT_EQUAL_FATAL(fread(contents, 1, *size, file), *size);
+    return contents;
+}
+
+void test_block_index(void) {
+    v2f_compressor_t compressor;
+    v2f_decompressor_t decompressor;
+    FAIL_IF_FAIL(v2f_build_minimal_codec(1, &compressor, &decompressor));
+    FILE *header_file = tmpfile();
+    CU_ASSERT_FATAL(header_file != NULL);
+    FAIL_IF_FAIL(v2f_file_write_codec(header_file, &compressor, &decompressor));
+    FAIL_IF_FAIL(v2f_build_destroy_minimal_codec(&compressor, &decompressor));
+
+    // Several full blocks plus a partial one, with shadow regions in between
+    const v2f_sample_t samples_per_row = 1024;
+    const uint64_t sample_count = 5 * (uint64_t) V2F_C_MAX_BLOCK_SIZE / 2;
+    uint32_t shadow_y_pairs[] = {5, 9, 2000, 2100};
+    FILE *raw_file = tmpfile();
+    CU_ASSERT_FATAL(raw_file != NULL);
+    uint32_t seed = 7;
+    for (uint64_t i = 0; i < sample_count; i++) {
+        seed = seed * 1103515245 + 12345;
+        CU_ASSERT_NOT_EQUAL_FATAL(fputc((int) ((seed >> 16) % 5), raw_file), EOF);
+    }
+
+    // Without and with index. The latter is preceded by other data,
+    // so that the compressed data do not start at the beginning of the file
+    const off_t data_positions[2] = {0, 3};
+    FILE *compressed_files[2];
+    v2f_file_options_t options;
+    FAIL_IF_FAIL(v2f_file_init_options(&options));
+    options.thread_count = 2;
+    for (uint32_t i = 0; i < 2; i++) {
+        options.write_block_index = i == 1;
+        compressed_files[i] = tmpfile();
+        CU_ASSERT_FATAL(compressed_files[i] != NULL);
+        CU_ASSERT_EQUAL_FATAL(fwrite("V2F", 1, (size_t) data_positions[i], compressed_files[i]),
+                              (size_t) data_positions[i]);
+        CU_ASSERT_EQUAL_FATAL(fseeko(raw_file, 0, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(v2f_file_compress_from_file(
+                raw_file, header_file, compressed_files[i],
+                false, 0, false, 0, false, 0, samples_per_row,
+                shadow_y_pairs, 2, &options), 0);
+    }
+    uint64_t compressed_sizes[2];
+    uint8_t *compressed_contents[2];
+    for (uint32_t i = 0; i < 2; i++) {
+        compressed_contents[i] = file_test_read_contents(compressed_files[i], &(compressed_sizes[i]));
+    }
+    CU_ASSERT_FATAL(compressed_sizes[1] > compressed_sizes[0] + 3);
+    CU_ASSERT_EQUAL_FATAL(memcmp(compressed_contents[0], compressed_contents[1] + 3, compressed_sizes[0]), 0);
+
+    // Reference: all rows
+    FILE *reconstructed_file = tmpfile();
+    CU_ASSERT_FATAL(reconstructed_file != NULL);
+    CU_ASSERT_EQUAL_FATAL(fseeko(compressed_files[1], data_positions[1], SEEK_SET), 0);
+    CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+    CU_ASSERT_EQUAL_FATAL(v2f_file_decompress_from_file(
+            compressed_files[1], header_file, reconstructed_file,
+            false, 0, false, 0, false, 0, samples_per_row, NULL), 0);
+    uint64_t reference_size;
+    uint8_t *const reference = file_test_read_contents(reconstructed_file, &reference_size);
+    CU_ASSERT_EQUAL_FATAL(reference_size, sample_count);
+    fclose(reconstructed_file);
+
+    // Row ranges within a block, across blocks, in shadow regions, and beyond the end
+    const uint32_t row_count = (uint32_t) (sample_count / samples_per_row);
+    const uint32_t row_ranges[][2] = {
+            {0, 0}, {3, 7}, {1279, 1280}, {1300, 2050}, {2101, row_count - 1},
+            {row_count - 1, row_count + 10}, {row_count + 10, row_count + 20}};
+    for (uint32_t corrupted = 0; corrupted < 2; corrupted++) {
+        for (uint32_t r = 0; r < sizeof(row_ranges) / sizeof(row_ranges[0]); r++) {
+            const uint64_t first_sample = row_ranges[r][0] * (uint64_t) samples_per_row;
+            uint64_t end_sample = (row_ranges[r][1] + UINT64_C(1)) * samples_per_row;
+            end_sample = end_sample < sample_count ? end_sample : sample_count;
+            const uint64_t expected_size = first_sample < end_sample ? end_sample - first_sample : 0;
+            options.select_rows = true;
+            options.first_row = row_ranges[r][0];
+            options.last_row = row_ranges[r][1];
+            for (uint32_t i = 0; i < 4; i++) {
+                options.thread_count = i < 2 ? 1 : 4;
+                reconstructed_file = tmpfile();
+                CU_ASSERT_FATAL(reconstructed_file != NULL);
+                CU_ASSERT_EQUAL_FATAL(fseeko(compressed_files[i % 2], data_positions[i % 2], SEEK_SET), 0);
+                CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+                CU_ASSERT_EQUAL_FATAL(v2f_file_decompress_from_file(
+                        compressed_files[i % 2], header_file, reconstructed_file,
+                        false, 0, false, 0, false, 0, samples_per_row, &options), 0);
+                uint64_t reconstructed_size;
+                uint8_t *const reconstructed = file_test_read_contents(reconstructed_file, &reconstructed_size);
+                CU_ASSERT_EQUAL_FATAL(reconstructed_size, expected_size);
+                CU_ASSERT_EQUAL_FATAL(memcmp(reconstructed, reference + first_sample, expected_size), 0);
+                free(reconstructed);
+                fclose(reconstructed_file);
+            }
+        }
+
+        // Corrupt the first_sample field of the second index entry, so that the index is ignored
+        CU_ASSERT_EQUAL_FATAL(fseeko(compressed_files[1],
+                                     data_positions[1] + (off_t) compressed_sizes[0] + 8 + 20 + 8 + 7, SEEK_SET), 0);
+        CU_ASSERT_NOT_EQUAL_FATAL(fputc(0xff, compressed_files[1]), EOF);
+    }
+
+    // Invalid row selections
+    options.first_row = 0;
+    options.last_row = 1;
+    CU_ASSERT_NOT_EQUAL_FATAL(v2f_file_decompress_from_file(
+            compressed_files[1], header_file, raw_file,
+            false, 0, false, 0, false, 0, 0, &options), 0);
+    options.first_row = 2;
+    CU_ASSERT_NOT_EQUAL_FATAL(v2f_file_decompress_from_file(
+            compressed_files[1], header_file, raw_file,
+            false, 0, false, 0, false, 0, samples_per_row, &options), 0);
+
+    free(reference);
+    for (uint32_t i = 0; i < 2; i++) {
+        free(compressed_contents[i]);
+        fclose(compressed_files[i]);
+    }
+    fclose(raw_file);
+    fclose(header_file);
+}
+
+void test_mapped_files(void) {
+    v2f_compressor_t compressor;
+    v2f_decompressor_t decompressor;
+    FAIL_IF_FAIL(v2f_build_minimal_codec(1, &compressor, &decompressor));
+    FILE *header_file = tmpfile();
+    CU_ASSERT_FATAL(header_file != NULL);
+    FAIL_IF_FAIL(v2f_file_write_codec(header_file, &compressor, &decompressor));
+    FAIL_IF_FAIL(v2f_build_destroy_minimal_codec(&compressor, &decompressor));
+
+    // Several full blocks plus a partial one, with shadow regions in between
+    const v2f_sample_t samples_per_row = 1024;
+    const uint64_t sample_count = 5 * (uint64_t) V2F_C_MAX_BLOCK_SIZE / 2;
+    uint32_t shadow_y_pairs[] = {5, 9, 2000, 2100};
+    FILE *raw_file = tmpfile();
+    CU_ASSERT_FATAL(raw_file != NULL);
+    uint32_t seed = 3;
+    for (uint64_t i = 0; i < sample_count; i++) {
+        seed = seed * 1103515245 + 12345;
+        CU_ASSERT_NOT_EQUAL_FATAL(fputc((int) ((seed >> 16) % 5), raw_file), EOF);
+    }
+
+    // Compressed files, with stdio and mapped, with and without block index
+    FILE *compressed_files[2][2];
+    v2f_file_options_t options;
+    FAIL_IF_FAIL(v2f_file_init_options(&options));
+    for (uint32_t map = 0; map < 2; map++) {
+        options.pipeline = map == 1;
+        options.map_files = map == 1;
+        for (uint32_t index = 0; index < 2; index++) {
+            options.write_block_index = index == 1;
+            compressed_files[map][index] = tmpfile();
+            CU_ASSERT_FATAL(compressed_files[map][index] != NULL);
+            CU_ASSERT_EQUAL_FATAL(fseeko(raw_file, 0, SEEK_SET), 0);
+            CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+            CU_ASSERT_EQUAL_FATAL(v2f_file_compress_from_file(
+                    raw_file, header_file, compressed_files[map][index],
+                    false, 0, false, 0, false, 0, samples_per_row,
+                    shadow_y_pairs, 2, &options), 0);
+        }
+    }
+    for (uint32_t index = 0; index < 2; index++) {
+        CU_ASSERT_EQUAL_FATAL(fseeko(compressed_files[0][index], 0, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(fseeko(compressed_files[1][index], 0, SEEK_SET), 0);
+        CU_ASSERT_FATAL(test_assert_files_are_equal(compressed_files[0][index], compressed_files[1][index]));
+    }
+
+    // Full and partial reconstructions, and a truncated compressed file.
+    // After an error, the samples of the blocks decompressed before are kept in both cases.
+    const off_t compressed_size = get_file_size(compressed_files[0][0]);
+    FILE *truncated_file = tmpfile();
+    CU_ASSERT_FATAL(truncated_file != NULL);
+    CU_ASSERT_EQUAL_FATAL(fseeko(compressed_files[0][0], 0, SEEK_SET), 0);
+    for (off_t i = 0; i < compressed_size - 100; i++) {
+        CU_ASSERT_NOT_EQUAL_FATAL(fputc(fgetc(compressed_files[0][0]), truncated_file), EOF);
+    }
+    FILE *const decompressed_inputs[] = {
+            compressed_files[0][0], compressed_files[0][1], compressed_files[0][1], truncated_file};
+    const bool select_rows[] = {false, false, true, true};
+    const uint32_t row_ranges[][2] = {{0, 0}, {0, 0}, {1500, 2050}, {10, 10000}};
+    for (uint32_t i = 0; i < sizeof(select_rows) / sizeof(select_rows[0]); i++) {
+        FILE *reconstructed_files[2];
+        int statuses[2];
+        options.select_rows = select_rows[i];
+        options.first_row = row_ranges[i][0];
+        options.last_row = row_ranges[i][1];
+        for (uint32_t map = 0; map < 2; map++) {
+            options.thread_count = 2 * map;
+            options.pipeline = false;
+            options.map_files = map == 1;
+            reconstructed_files[map] = tmpfile();
+            CU_ASSERT_FATAL(reconstructed_files[map] != NULL);
+            CU_ASSERT_EQUAL_FATAL(fseeko(decompressed_inputs[i], 0, SEEK_SET), 0);
+            CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+            statuses[map] = v2f_file_decompress_from_file(
+                    decompressed_inputs[i], header_file, reconstructed_files[map],
+                    false, 0, false, 0, false, 0, samples_per_row, &options);
+            CU_ASSERT_EQUAL_FATAL(fseeko(reconstructed_files[map], 0, SEEK_SET), 0);
+        }
+        CU_ASSERT_EQUAL_FATAL(statuses[0], statuses[1]);
+        CU_ASSERT_EQUAL_FATAL(statuses[0] != 0, decompressed_inputs[i] == truncated_file);
+        CU_ASSERT_FATAL(get_file_size(reconstructed_files[0]) > 0);
+        CU_ASSERT_FATAL(test_assert_files_are_equal(reconstructed_files[0], reconstructed_files[1]));
+        fclose(reconstructed_files[0]);
+        fclose(reconstructed_files[1]);
+    }
+
+    // Empty files cannot be mapped, and are processed with stdio
+    FILE *empty_file = tmpfile();
+    FILE *output_file = tmpfile();
+    CU_ASSERT_FATAL(empty_file != NULL && output_file != NULL);
+    FAIL_IF_FAIL(v2f_file_init_options(&options));
+    options.thread_count = 1;
+    options.map_files = true;
+    CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+    CU_ASSERT_EQUAL_FATAL(v2f_file_compress_from_file(
+            empty_file, header_file, output_file, false, 0, false, 0, false, 0, samples_per_row,
+            NULL, 0, &options), 0);
+    CU_ASSERT_EQUAL_FATAL(get_file_size(output_file), 0);
+    CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+    CU_ASSERT_EQUAL_FATAL(v2f_file_decompress_from_file(
+            empty_file, header_file, output_file, false, 0, false, 0, false, 0, samples_per_row, &options), 0);
+    CU_ASSERT_EQUAL_FATAL(get_file_size(output_file), 0);
+
+    fclose(empty_file);
+    fclose(output_file);
+    fclose(truncated_file);
+    for (uint32_t map = 0; map < 2; map++) {
+        fclose(compressed_files[map][0]);
+        fclose(compressed_files[map][1]);
+    }
+    fclose(raw_file);
+    fclose(header_file);
+}
+
+void test_single_block_wavefront(void) {
+    v2f_compressor_t compressor;
+    v2f_decompressor_t decompressor;
+    FAIL_IF_FAIL(v2f_build_minimal_codec(1, &compressor, &decompressor));
+    FILE *header_file = tmpfile();
+    CU_ASSERT_FATAL(header_file != NULL);
+    FAIL_IF_FAIL(v2f_file_write_codec(header_file, &compressor, &decompressor));
+    FAIL_IF_FAIL(v2f_build_destroy_minimal_codec(&compressor, &decompressor));
+
+    // One full block of complete rows
+    const v2f_sample_t samples_per_row = 1024;
+    const uint64_t sample_count = V2F_C_MAX_BLOCK_SIZE;
+    FILE *raw_file = tmpfile();
+    CU_ASSERT_FATAL(raw_file != NULL);
+    uint32_t seed = 5;
+    for (uint64_t i = 0; i < sample_count; i++) {
+        seed = seed * 1103515245 + 12345;
+        CU_ASSERT_NOT_EQUAL_FATAL(fputc((int) ((seed >> 16) % 9), raw_file), EOF);
+    }
+    FILE *compressed_file = tmpfile();
+    CU_ASSERT_FATAL(compressed_file != NULL);
+    CU_ASSERT_EQUAL_FATAL(fseeko(raw_file, 0, SEEK_SET), 0);
+    CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+    CU_ASSERT_EQUAL_FATAL(v2f_file_compress_from_file(
+            raw_file, header_file, compressed_file,
+            false, 0, false, 0, true, V2F_C_DECORRELATOR_MODE_JPEG_LS, samples_per_row,
+            NULL, 0, NULL), 0);
+
+    // Sequential, and with 4 threads for the block, read with stdio and mapped
+    const uint32_t thread_counts[3] = {1, 4, 4};
+    const bool map_files[3] = {false, false, true};
+    FILE *reconstructed_files[3];
+    v2f_file_options_t options;
+    FAIL_IF_FAIL(v2f_file_init_options(&options));
+    for (uint32_t i = 0; i < 3; i++) {
+        options.thread_count = thread_counts[i];
+        options.map_files = map_files[i];
+        reconstructed_files[i] = tmpfile();
+        CU_ASSERT_FATAL(reconstructed_files[i] != NULL);
+        CU_ASSERT_EQUAL_FATAL(fseeko(compressed_file, 0, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(v2f_file_decompress_from_file(
+                compressed_file, header_file, reconstructed_files[i],
+                false, 0, false, 0, true, V2F_C_DECORRELATOR_MODE_JPEG_LS, samples_per_row, &options), 0);
+    }
+    CU_ASSERT_FATAL(test_assert_files_are_equal(raw_file, reconstructed_files[0]));
+    for (uint32_t i = 1; i < 3; i++) {
+        CU_ASSERT_FATAL(test_assert_files_are_equal(reconstructed_files[0], reconstructed_files[i]));
+    }
+
+    for (uint32_t i = 0; i < 3; i++) {
+        fclose(reconstructed_files[i]);
+    }
+    fclose(compressed_file);
+    fclose(raw_file);
+    fclose(header_file);
+}
+
 CU_START_REGISTRATION(file)
     CU_QADD_TEST(test_sample_io)
+    CU_QADD_TEST(test_big_endian_io)
     CU_QADD_TEST(test_minimal_forest_dump)
+    CU_QADD_TEST(test_truncated_forest_read)
     CU_QADD_TEST(test_minimal_codec_dump)
+    CU_QADD_TEST(test_parallel_codec)
+    CU_QADD_TEST(test_forest_cache)
+    CU_QADD_TEST(test_block_index)
+    CU_QADD_TEST(test_mapped_files)
+    CU_QADD_TEST(test_single_block_wavefront)
 CU_END_REGISTRATION()
@@ -0,0 +1,155 @@
+/**
+ * @file
+ *
+ * Test suite for the built-in forest registry.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "CUExtension.h"
+#include "test_common.h"
+
+#include "../src/v2f_forest_registry.h"
+#include "../src/v2f_build.h"
+#include "../src/v2f_file.h"
+#include "../src/v2f_entropy_coder.h"
+#include "../src/v2f_entropy_decoder.h"
+
+/**
+ * Test that the tables of built-in forests 1 and 2 are those of the compiled minimal
+ * forests for 1 and 2 bytes per word, and that invalid ids are rejected.
+ */
+void test_forest_registry_tables(void);
+
+/**
+ * Test that codecs with a built-in forest are written with their forest_id only,
+ * and read back without the forest definition.
+ */
+void test_forest_registry_codec(void);
+
+void test_forest_registry_tables(void) {
+    v2f_entropy_coder_t coder;
+    v2f_entropy_decoder_t decoder;
+    CU_ASSERT_FATAL(v2f_forest_registry_count() >= 1);
+    CU_ASSERT_EQUAL_FATAL(v2f_forest_registry_load(0, &coder, &decoder), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_forest_registry_load(v2f_forest_registry_count() + 1, &coder, &decoder),
+                          V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_forest_registry_load(1, NULL, &decoder), V2F_E_INVALID_PARAMETER);
+
+    // The minimal forest for n bytes per word has id n
+    for (uint32_t forest_id = 1; forest_id <= 2; forest_id++) {
+        v2f_entropy_coder_t minimal_coder;
+        v2f_entropy_decoder_t minimal_decoder;
+        FAIL_IF_FAIL(v2f_build_minimal_forest((uint8_t) forest_id, &minimal_coder, &minimal_decoder));
+        FAIL_IF_FAIL(v2f_forest_registry_load(forest_id, &coder, &decoder));
+        CU_ASSERT_EQUAL_FATAL(decoder.forest_id, forest_id);
+
+        CU_ASSERT_EQUAL_FATAL(coder.bytes_per_word, minimal_coder.bytes_per_word);
+        CU_ASSERT_EQUAL_FATAL(coder.max_expected_value, minimal_coder.max_expected_value);
+        CU_ASSERT_EQUAL_FATAL(coder.root_count, minimal_coder.root_count);
+        CU_ASSERT_EQUAL_FATAL(coder.state_count, minimal_coder.state_count);
+        CU_ASSERT_EQUAL_FATAL(coder.transition_count, minimal_coder.transition_count);
+        for (uint32_t i = 0; i < coder.state_count; i++) {
+            CU_ASSERT_EQUAL_FATAL(coder.states[i].first_transition, minimal_coder.states[i].first_transition);
+            CU_ASSERT_EQUAL_FATAL(coder.states[i].children_count, minimal_coder.states[i].children_count);
+            CU_ASSERT_EQUAL_FATAL(memcmp(coder.states[i].word_bytes, minimal_coder.states[i].word_bytes,
+                                         coder.bytes_per_word), 0);
+        }
+        CU_ASSERT_EQUAL_FATAL(memcmp(coder.transitions, minimal_coder.transitions,
+                                     sizeof(uint32_t) * coder.transition_count), 0);
+        CU_ASSERT_EQUAL_FATAL(memcmp(coder.root_transition_offsets, minimal_coder.root_transition_offsets,
+                                     sizeof(uint64_t) * (coder.max_expected_value + 2)), 0);
+
+        CU_ASSERT_EQUAL_FATAL(decoder.bytes_per_word, minimal_decoder.bytes_per_word);
+        CU_ASSERT_EQUAL_FATAL(decoder.bytes_per_sample, minimal_decoder.bytes_per_sample);
+        CU_ASSERT_EQUAL_FATAL(decoder.root_count, minimal_decoder.root_count);
+        CU_ASSERT_EQUAL_FATAL(decoder.word_count, minimal_decoder.word_count);
+        for (uint64_t i = 0; i < decoder.word_count; i++) {
+            CU_ASSERT_EQUAL_FATAL(decoder.words[i].sample_offset, minimal_decoder.words[i].sample_offset);
+            CU_ASSERT_EQUAL_FATAL(decoder.words[i].sample_count, minimal_decoder.words[i].sample_count);
+            CU_ASSERT_EQUAL_FATAL(decoder.words[i].next_first_word, minimal_decoder.words[i].next_first_word);
+            CU_ASSERT_EQUAL_FATAL(decoder.words[i].next_included_count,
+                                  minimal_decoder.words[i].next_included_count);
+        }
+        CU_ASSERT_EQUAL_FATAL(decoder.sample_pool_size, minimal_decoder.sample_pool_size);
+        CU_ASSERT_EQUAL_FATAL(memcmp(decoder.sample_pool, minimal_decoder.sample_pool,
+                                     sizeof(v2f_sample_t) * decoder.sample_pool_size), 0);
+        CU_ASSERT_NOT_EQUAL_FATAL(minimal_decoder.sample_pool_16, NULL);
+        CU_ASSERT_EQUAL_FATAL(memcmp(decoder.sample_pool_16, minimal_decoder.sample_pool_16,
+                                     sizeof(v2f_sample16_t) * decoder.sample_pool_size), 0);
+        CU_ASSERT_EQUAL_FATAL(decoder.initial_state.first_word, minimal_decoder.initial_state.first_word);
+        CU_ASSERT_EQUAL_FATAL(decoder.initial_state.included_count, minimal_decoder.initial_state.included_count);
+
+        FAIL_IF_FAIL(v2f_build_destroy_minimal_forest(&minimal_coder, &minimal_decoder));
+    }
+}
+
+void test_forest_registry_codec(void) {
+    // Replace the forest of a minimal codec by the equivalent built-in one
+    v2f_compressor_t compressor;
+    v2f_decompressor_t decompressor;
+    FAIL_IF_FAIL(v2f_build_minimal_codec(1, &compressor, &decompressor));
+    v2f_entropy_coder_t *const minimal_coder = compressor.entropy_coder;
+    v2f_entropy_decoder_t *const minimal_decoder = decompressor.entropy_decoder;
+    v2f_entropy_coder_t coder;
+    v2f_entropy_decoder_t decoder;
+    FAIL_IF_FAIL(v2f_forest_registry_load(1, &coder, &decoder));
+    compressor.entropy_coder = &coder;
+    decompressor.entropy_decoder = &decoder;
+
+    // Only the forest id is written
+    FILE *header_file = tmpfile();
+    CU_ASSERT_PTR_NOT_NULL(header_file);
+    FAIL_IF_FAIL(v2f_file_write_codec(header_file, &compressor, &decompressor));
+    CU_ASSERT_EQUAL_FATAL(ftello(header_file), 1 + 4 + 2 + 4 + 4);
+
+    v2f_compressor_t read_compressor;
+    v2f_decompressor_t read_decompressor;
+    CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+    FAIL_IF_FAIL(v2f_file_read_codec(header_file, &read_compressor, &read_decompressor));
+    CU_ASSERT_EQUAL_FATAL(read_decompressor.entropy_decoder->forest_id, 1);
+    CU_ASSERT_EQUAL_FATAL(read_decompressor.entropy_decoder->words, decoder.words);
+    CU_ASSERT_EQUAL_FATAL(read_compressor.entropy_coder->transitions, coder.transitions);
+
+    // The read codec produces the same results as the minimal one
+    v2f_sample_t samples[1000];
+    for (uint32_t i = 0; i < 1000; i++) {
+        samples[i] = (i * 7919) % 256;
+    }
+    uint8_t expected_bitstream[1000];
+    uint8_t bitstream[1000];
+    uint64_t expected_size;
+    uint64_t size;
+    FAIL_IF_FAIL(v2f_entropy_coder_compress_block(minimal_coder, samples, 1000, expected_bitstream, &expected_size));
+    FAIL_IF_FAIL(v2f_entropy_coder_compress_block(
+            read_compressor.entropy_coder, samples, 1000, bitstream, &size));
+    CU_ASSERT_EQUAL_FATAL(size, expected_size);
+    CU_ASSERT_EQUAL_FATAL(memcmp(bitstream, expected_bitstream, size), 0);
+    v2f_sample_t reconstructed_samples[1000];
+    uint64_t written_sample_count;
+    FAIL_IF_FAIL(v2f_entropy_decoder_decompress_block(
+            read_decompressor.entropy_decoder, bitstream, size, reconstructed_samples, 1000,
+            &written_sample_count));
+    CU_ASSERT_EQUAL_FATAL(written_sample_count, 1000);
+    CU_ASSERT_EQUAL_FATAL(memcmp(reconstructed_samples, samples, sizeof(samples)), 0);
+    FAIL_IF_FAIL(v2f_file_destroy_read_codec(&read_compressor, &read_decompressor));
+
+    // Unknown forest ids are rejected
+    CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 1 + 4 + 2 + 4, SEEK_SET), 0);
+    v2f_sample_t forest_id = v2f_forest_registry_count() + 1;
+    FAIL_IF_FAIL(v2f_file_write_big_endian(header_file, &forest_id, 1, 4));
+    CU_ASSERT_EQUAL_FATAL(fseeko(header_file, 0, SEEK_SET), 0);
+    CU_ASSERT_EQUAL_FATAL(v2f_file_read_codec(header_file, &read_compressor, &read_decompressor),
+                          V2F_E_FEATURE_NOT_IMPLEMENTED);
+    fclose(header_file);
+
+    compressor.entropy_coder = minimal_coder;
+    decompressor.entropy_decoder = minimal_decoder;
+    FAIL_IF_FAIL(v2f_build_destroy_minimal_codec(&compressor, &decompressor));
+}
+
+CU_START_REGISTRATION(forest_registry)
+    CU_QADD_TEST(test_forest_registry_tables)
+    CU_QADD_TEST(test_forest_registry_codec)
+CU_END_REGISTRATION()
@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #include "CUExtension.h"
@@ -22,6 +23,15 @@
 
 void test_quantizer_create(void);
 
+/**
+ * Test that quantization with every step size gives the same indices as integer
+ * division, and that dequantization reconstructs the bin midpoints within the dynamic range,
+ * with 32 and 16 bits per sample.
+ *
+ * @req V2F-2.1
+ */
+void test_quantizer_uniform(void);
+
 void test_quantizer_create(void) {
 
     printf("\n:: BEGIN - errors expected ----------------------\n");
@@ -67,6 +77,51 @@ void test_quantizer_create(void) {
     printf(":: END - errors expected ------------------------\n");
 }
 
+void test_quantizer_uniform(void) {
+    const uint64_t sample_count = 65536 + 4;
+    const v2f_sample_t max_sample_value = 65535;
+    v2f_sample_t *const samples = malloc(sizeof(v2f_sample_t) * sample_count);
+    v2f_sample16_t *const samples_16 = malloc(sizeof(v2f_sample16_t) * 65536);
+    CU_ASSERT_FATAL(samples != NULL && samples_16 != NULL);
+
+    for (v2f_sample_t step_size = 2; step_size <= V2F_C_QUANTIZER_MODE_MAX_STEP_SIZE; step_size++) {
+        // All 16-bit values, and the largest 32-bit ones
+        for (uint64_t i = 0; i < 65536; i++) {
+            samples[i] = (v2f_sample_t) i;
+            samples_16[i] = (v2f_sample16_t) i;
+        }
+        for (uint64_t i = 65536; i < sample_count; i++) {
+            samples[i] = UINT32_MAX - (v2f_sample_t) (i - 65536) * step_size;
+        }
+        FAIL_IF_FAIL(v2f_quantizer_apply_uniform_division(step_size, samples, sample_count));
+        for (uint64_t i = 0; i < 65536; i++) {
+            CU_ASSERT_EQUAL_FATAL(samples[i], (v2f_sample_t) i / step_size);
+        }
+        for (uint64_t i = 65536; i < sample_count; i++) {
+            CU_ASSERT_EQUAL_FATAL(samples[i], (UINT32_MAX - (v2f_sample_t) (i - 65536) * step_size) / step_size);
+        }
+
+        v2f_quantizer_t quantizer;
+        FAIL_IF_FAIL(v2f_quantizer_create(&quantizer, V2F_C_QUANTIZER_MODE_UNIFORM, step_size, max_sample_value));
+        FAIL_IF_FAIL(v2f_quantizer_quantize_16(&quantizer, samples_16, 65536));
+        for (uint64_t i = 0; i < 65536; i++) {
+            CU_ASSERT_EQUAL_FATAL(samples_16[i], samples[i]);
+        }
+
+        FAIL_IF_FAIL(v2f_quantizer_dequantize(&quantizer, samples, 65536));
+        FAIL_IF_FAIL(v2f_quantizer_dequantize_16(&quantizer, samples_16, 65536));
+        for (uint64_t i = 0; i < 65536; i++) {
+            const v2f_sample_t expected = (v2f_sample_t) (i / step_size) * step_size + step_size / 2;
+            CU_ASSERT_EQUAL_FATAL(samples[i], expected < max_sample_value ? expected : max_sample_value);
+            CU_ASSERT_EQUAL_FATAL(samples_16[i], samples[i]);
+        }
+    }
+
+    free(samples);
+    free(samples_16);
+}
+
 CU_START_REGISTRATION(quantizer)
     CU_QADD_TEST(test_quantizer_create)
+    CU_QADD_TEST(test_quantizer_uniform)
 CU_END_REGISTRATION()
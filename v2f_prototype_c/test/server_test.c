@@ -0,0 +1,199 @@
+/**
+ * @file
+ *
+ * Test suite for the compression service.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "CUExtension.h"
+#include "test_common.h"
+
+#include "../src/v2f_server.h"
+#include "../src/v2f_build.h"
+#include "../src/v2f_file.h"
+
+/// Number of rows of the test image
+#define SERVER_TEST_ROW_COUNT 40
+/// Number of samples per row of the test image
+#define SERVER_TEST_SAMPLES_PER_ROW 100
+
+/**
+ * Test that jobs submitted with paths and with passed descriptors produce the same
+ * files as v2f_file_compress_from_path() and v2f_file_decompress_from_path(),
+ * that invalid requests are rejected without closing the connection,
+ * and that the socket is private and never replaces files in use.
+ */
+void test_server_jobs(void);
+
+/**
+ * Create an empty temporary file and store its path.
+ *
+ * @param path buffer of at least 32 bytes where the path is stored
+ */
+static void server_test_create_path(char *const path) {
+    strcpy(path, "/tmp/v2f_server_test_XXXXXX");
+    const int fd = mkstemp(path);
+    CU_ASSERT_FATAL(fd >= 0);
+    close(fd);
+}
+
+void test_server_jobs(void) {
+    // Codec and input image
+    char header_path[32];
+    char raw_path[32];
+    char reference_path[32];
+    char compressed_path[32];
+    char socket_path[40];
+    server_test_create_path(header_path);
+    server_test_create_path(raw_path);
+    server_test_create_path(reference_path);
+    server_test_create_path(compressed_path);
+    server_test_create_path(socket_path);
+    CU_ASSERT_EQUAL_FATAL(unlink(socket_path), 0);
+    strcat(socket_path, ".sock");
+
+    v2f_compressor_t compressor;
+    v2f_decompressor_t decompressor;
+    FAIL_IF_FAIL(v2f_build_minimal_codec(2, &compressor, &decompressor));
+    FILE *header_file = fopen(header_path, "w");
+    CU_ASSERT_FATAL(header_file != NULL);
+    FAIL_IF_FAIL(v2f_file_write_codec(header_file, &compressor, &decompressor));
+    fclose(header_file);
+    const uint8_t bytes_per_sample = decompressor.entropy_decoder->bytes_per_sample;
+    const v2f_sample_t max_sample_value = compressor.entropy_coder->max_expected_value;
+    FAIL_IF_FAIL(v2f_build_destroy_minimal_codec(&compressor, &decompressor));
+
+    v2f_sample_t samples[SERVER_TEST_ROW_COUNT * SERVER_TEST_SAMPLES_PER_ROW];
+    for (uint32_t i = 0; i < SERVER_TEST_ROW_COUNT * SERVER_TEST_SAMPLES_PER_ROW; i++) {
+        samples[i] = (v2f_sample_t) ((i / 7 + (i % SERVER_TEST_SAMPLES_PER_ROW)) % ((uint64_t) max_sample_value + 1));
+    }
+    FILE *raw_file = fopen(raw_path, "w+");
+    CU_ASSERT_FATAL(raw_file != NULL);
+    FAIL_IF_FAIL(v2f_file_write_big_endian(
+            raw_file, samples, SERVER_TEST_ROW_COUNT * SERVER_TEST_SAMPLES_PER_ROW, bytes_per_sample));
+    CU_ASSERT_EQUAL_FATAL(fflush(raw_file), 0);
+    uint32_t shadow_y_pairs[] = {3, 5, 10, 10};
+    CU_ASSERT_EQUAL_FATAL(v2f_file_compress_from_path(
+            raw_path, header_path, reference_path, false, V2F_C_QUANTIZER_MODE_NONE, false, 1,
+            true, V2F_C_DECORRELATOR_MODE_JPEG_LS, SERVER_TEST_SAMPLES_PER_ROW, shadow_y_pairs, 2, NULL), 0);
+
+    // Server
+    v2f_server_t server;
+    CU_ASSERT_EQUAL_FATAL(v2f_server_create(socket_path, 0, &server), V2F_E_INVALID_PARAMETER);
+    // Nothing is leaked when the socket cannot be created
+    CU_ASSERT_EQUAL_FATAL(v2f_server_create("/nonexistent/v2f_server_test.sock", 2, &server), V2F_E_IO);
+    CU_ASSERT_EQUAL_FATAL(server.workers, NULL);
+    // A single worker serves all connections, since idle connections do not hold it
+    FAIL_IF_FAIL(v2f_server_create(socket_path, 1, &server));
+    // Only the owner can connect, and neither live sockets nor other files are replaced
+    struct stat socket_stat;
+    CU_ASSERT_EQUAL_FATAL(stat(socket_path, &socket_stat), 0);
+    CU_ASSERT_EQUAL_FATAL(socket_stat.st_mode & 0777, S_IRUSR | S_IWUSR);
+    v2f_server_t other_server;
+    CU_ASSERT_EQUAL_FATAL(v2f_server_create(socket_path, 1, &other_server), V2F_E_IO);
+    CU_ASSERT_EQUAL_FATAL(v2f_server_create(header_path, 1, &other_server), V2F_E_IO);
+    CU_ASSERT_EQUAL_FATAL(access(header_path, F_OK), 0);
+    FAIL_IF_FAIL(v2f_server_add_codec(&server, "minimal", header_path, NULL));
+    CU_ASSERT_EQUAL_FATAL(v2f_server_add_codec(&server, "minimal", header_path, NULL), V2F_E_INVALID_PARAMETER);
+    CU_ASSERT_EQUAL_FATAL(v2f_server_add_codec(&server, "missing", "/nonexistent/v2f_server_test", NULL), V2F_E_IO);
+    FAIL_IF_FAIL(v2f_server_start(&server));
+    CU_ASSERT_EQUAL_FATAL(v2f_server_add_codec(&server, "other", header_path, NULL), V2F_E_INVALID_PARAMETER);
+
+    // Compression with paths
+    int socket_fd;
+    v2f_error_t job_status;
+    FAIL_IF_FAIL(v2f_server_connect(socket_path, &socket_fd));
+    char const *compress_fields[] = {
+            "compress", "minimal", raw_path, compressed_path,
+            "decorrelator_mode=3", "samples_per_row=100", "shadow_y=3,5,10,10"};
+    FAIL_IF_FAIL(v2f_server_submit(socket_fd, compress_fields, 7, NULL, 0, &job_status));
+    CU_ASSERT_EQUAL_FATAL(job_status, V2F_E_NONE);
+    FILE *reference_file = fopen(reference_path, "r");
+    FILE *compressed_file = fopen(compressed_path, "r");
+    CU_ASSERT_FATAL(reference_file != NULL);
+    CU_ASSERT_FATAL(compressed_file != NULL);
+    CU_ASSERT_FATAL(test_assert_files_are_equal(reference_file, compressed_file));
+    fclose(reference_file);
+
+    // Decompression with passed descriptors, from another connection
+    int other_socket_fd;
+    FAIL_IF_FAIL(v2f_server_connect(socket_path, &other_socket_fd));
+    FILE *reconstructed_file = tmpfile();
+    CU_ASSERT_FATAL(reconstructed_file != NULL);
+    char const *decompress_fields[] = {"decompress", "minimal", "-", "-", "decorrelator_mode=3", "samples_per_row=100"};
+    // Passed descriptors share their offset with the client's
+    CU_ASSERT_EQUAL_FATAL(fseeko(compressed_file, 0, SEEK_SET), 0);
+    int passed_fds[] = {fileno(compressed_file), fileno(reconstructed_file)};
+    FAIL_IF_FAIL(v2f_server_submit(other_socket_fd, decompress_fields, 6, passed_fds, 2, &job_status));
+    CU_ASSERT_EQUAL_FATAL(job_status, V2F_E_NONE);
+    for (uint32_t y = 0; y < SERVER_TEST_ROW_COUNT; y++) {
+        // Shadow rows are reconstructed as zeros
+        if ((y >= 3 && y <= 5) || y == 10) {
+            memset(samples + y * SERVER_TEST_SAMPLES_PER_ROW, 0, sizeof(v2f_sample_t) * SERVER_TEST_SAMPLES_PER_ROW);
+        }
+    }
+    FILE *expected_file = tmpfile();
+    FAIL_IF_FAIL(v2f_file_write_big_endian(
+            expected_file, samples, SERVER_TEST_ROW_COUNT * SERVER_TEST_SAMPLES_PER_ROW, bytes_per_sample));
+    CU_ASSERT_FATAL(test_assert_files_are_equal(expected_file, reconstructed_file));
+    fclose(expected_file);
+    fclose(reconstructed_file);
+    close(other_socket_fd);
+
+    // Invalid jobs are reported, and the connection remains usable
+    char const *invalid_requests[][5] = {
+            {"compress", "unknown", raw_path, compressed_path, "step_size=1"},
+            {"transcode", "minimal", raw_path, compressed_path, "step_size=1"},
+            {"compress", "minimal", raw_path, compressed_path, "step_size=0"},
+            {"compress", "minimal", raw_path, compressed_path, "quantizer_mode=x"},
+            {"compress", "minimal", raw_path, compressed_path, "decorrelator_mode=4"},
+            {"compress", "minimal", raw_path, compressed_path, "shadow_y=5,3"},
+            {"decompress", "minimal", raw_path, compressed_path, "shadow_y=1,2"},
+            {"compress", "minimal", raw_path, compressed_path, "block_index=2"},
+            {"decompress", "minimal", compressed_path, raw_path, "rows=1,2,3,4"},
+            {"decompress", "minimal", compressed_path, raw_path, "rows=1,2"},
+            {"compress", "minimal", "-", compressed_path, "step_size=2"},
+    };
+    for (uint32_t i = 0; i < sizeof(invalid_requests) / sizeof(invalid_requests[0]); i++) {
+        FAIL_IF_FAIL(v2f_server_submit(socket_fd, invalid_requests[i], 5, NULL, 0, &job_status));
+        CU_ASSERT_EQUAL_FATAL(job_status, V2F_E_INVALID_PARAMETER);
+    }
+    char const *missing_input[] = {"compress", "minimal", "/nonexistent/v2f_server_test", compressed_path};
+    FAIL_IF_FAIL(v2f_server_submit(socket_fd, missing_input, 4, NULL, 0, &job_status));
+    CU_ASSERT_EQUAL_FATAL(job_status, V2F_E_IO);
+    FAIL_IF_FAIL(v2f_server_submit(socket_fd, compress_fields, 7, NULL, 0, &job_status));
+    CU_ASSERT_EQUAL_FATAL(job_status, V2F_E_NONE);
+    char const *empty_field[] = {"compress", ""};
+    CU_ASSERT_EQUAL_FATAL(v2f_server_submit(socket_fd, empty_field, 2, NULL, 0, &job_status),
+                          V2F_E_INVALID_PARAMETER);
+
+    // Open connections do not prevent the server from stopping, and are closed by it
+    FAIL_IF_FAIL(v2f_server_stop(&server));
+    CU_ASSERT_EQUAL_FATAL(v2f_server_submit(socket_fd, compress_fields, 7, NULL, 0, &job_status), V2F_E_IO);
+    close(socket_fd);
+    // A restarted server accepts new connections
+    FAIL_IF_FAIL(v2f_server_start(&server));
+    FAIL_IF_FAIL(v2f_server_connect(socket_path, &socket_fd));
+    FAIL_IF_FAIL(v2f_server_submit(socket_fd, compress_fields, 7, NULL, 0, &job_status));
+    CU_ASSERT_EQUAL_FATAL(job_status, V2F_E_NONE);
+    FAIL_IF_FAIL(v2f_server_destroy(&server));
+    CU_ASSERT_NOT_EQUAL_FATAL(access(socket_path, F_OK), 0);
+    CU_ASSERT_EQUAL_FATAL(v2f_server_submit(socket_fd, compress_fields, 7, NULL, 0, &job_status), V2F_E_IO);
+    close(socket_fd);
+    CU_ASSERT_EQUAL_FATAL(v2f_server_connect(socket_path, &socket_fd), V2F_E_IO);
+
+    fclose(compressed_file);
+    fclose(raw_file);
+    unlink(header_path);
+    unlink(raw_path);
+    unlink(reference_path);
+    unlink(compressed_path);
+}
+
+CU_START_REGISTRATION(server)
+    CU_QADD_TEST(test_server_jobs)
+CU_END_REGISTRATION()
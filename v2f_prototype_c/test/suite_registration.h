@@ -29,6 +29,11 @@ void register_entropy_codec(void);
  */
 void register_file(void);
 
+/**
+ * Register the built-in forest registry suite
+ */
+void register_forest_registry(void);
+
 /**
  * Register the quantization suite
  */
@@ -49,6 +54,16 @@ void register_compressor_decompressor(void);
  */
 void register_bin_common(void);
 
+/**
+ * Register the compression service suite
+ */
+void register_server(void);
+
+/**
+ * Register the buffer-to-buffer interface suite
+ */
+void register_buffer(void);
+
 
 #endif
 
@@ -41,10 +41,13 @@ int main(void) {
     register_build();
     register_entropy_codec();
     register_file();
+    register_forest_registry();
     register_quantizer();
     register_decorrelator();
     register_compressor_decompressor();
     register_bin_common();
+    register_server();
+    register_buffer();
 
     //CU_basic_set_mode(CU_BRM_NORMAL);
     CU_basic_set_mode(CU_BRM_VERBOSE);
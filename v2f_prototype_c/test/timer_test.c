@@ -5,12 +5,18 @@
  */
 
 #include <stdio.h>
+#include <pthread.h>
 #include "CUExtension.h"
 #include "test_common.h"
 #include "math.h"
 
 #include "../src/timer.h"
 
+/// Number of threads used by test_thread_merge()
+#define TIMER_TEST_THREAD_COUNT 4
+/// Number of start/stop cycles of each thread in test_thread_merge()
+#define TIMER_TEST_CYCLE_COUNT 100
+
 /**
  * Test the timer with at most one repetition per label.
  */
@@ -21,6 +27,23 @@ void test_basic_usage(void);
  */
 void test_multiple_count(void);
 
+/**
+ * Test that the measurements of several threads using the same handle are merged,
+ * including those of threads that have exited.
+ */
+void test_thread_merge(void);
+
+/**
+ * Sleep for a number of milliseconds.
+ *
+ * @param milliseconds time to sleep
+ */
+static void timer_test_sleep(long milliseconds) {
+    struct timespec duration = {0, milliseconds * 1000000};
+    while (nanosleep(&duration, &duration) != 0) {
+    }
+}
+
 void test_basic_usage() {
     char *names[] = {
             "n",
@@ -31,32 +54,53 @@ void test_basic_usage() {
             "",
     };
     const uint8_t name_count = sizeof(names) / sizeof(char *);
+    timer_handle_t handles[sizeof(names) / sizeof(char *)];
 
     timer_reset();
 
     for (uint16_t i = 0; i < name_count; i++) {
         CU_ASSERT_EQUAL_FATAL(
                 timer_get_cpu_s(names[i]), (double) -1);
-        timer_start(names[i]);
-    }
-    for (uint16_t i = 0; i < name_count; i++) {
-        CU_ASSERT_EQUAL_FATAL(
-                0, strcmp(global_timer.entries[i].name, names[i]))
+        handles[i] = timer_register(names[i]);
+        CU_ASSERT_NOT_EQUAL_FATAL(handles[i], TIMER_INVALID_HANDLE);
+        for (uint16_t j = 0; j < i; j++) {
+            CU_ASSERT_NOT_EQUAL_FATAL(handles[i], handles[j]);
+        }
+        CU_ASSERT_EQUAL_FATAL(timer_register(names[i]), handles[i]);
+        timer_start_handle(handles[i]);
     }
+    timer_test_sleep(5);
     for (uint16_t i = 0; i < name_count; i++) {
         timer_stop(names[i]);
-        global_timer.entries[i].clock_before =
-                global_timer.entries[i].clock_after - CLOCKS_PER_SEC * i;
-        global_timer.entries[i].wall_before =
-                global_timer.entries[i].wall_after - i;
     }
     for (uint16_t i = 0; i < name_count; i++) {
-        double time_diff = fabs(timer_get_cpu_s(names[i]) - (double) i);
-        CU_ASSERT_FATAL(time_diff < TIMER_TOLERANCE);
+        CU_ASSERT_EQUAL_FATAL(timer_get_count(names[i]), 1);
+        CU_ASSERT_FATAL(timer_get_wall_s(names[i]) >= 0.005);
+        CU_ASSERT_FATAL(timer_get_wall_s(names[i]) < 0.005 + 1);
+        CU_ASSERT_FATAL(timer_get_cpu_s(names[i]) >= 0);
+        CU_ASSERT_FATAL(timer_get_cpu_s(names[i]) < TIMER_TOLERANCE);
     }
+
+    // Timers that are not running, or cannot be registered, are ignored
+    timer_stop_handle(handles[0]);
+    CU_ASSERT_EQUAL_FATAL(timer_get_count(names[0]), 1);
+    char long_name[NAME_SIZE + 1];
+    memset(long_name, 'a', NAME_SIZE);
+    long_name[NAME_SIZE] = '\0';
+    CU_ASSERT_EQUAL_FATAL(timer_register(long_name), TIMER_INVALID_HANDLE);
+    timer_start_handle(TIMER_INVALID_HANDLE);
+    timer_stop_handle(TIMER_INVALID_HANDLE);
+    CU_ASSERT_EQUAL_FATAL(timer_get_count("not registered"), 0);
+
     FILE *tmp_file = tmpfile();
     timer_report_csv(tmp_file);
+    timer_report_human(tmp_file);
     fclose(tmp_file);
+
+    timer_reset();
+    CU_ASSERT_EQUAL_FATAL(timer_get_count(names[0]), 0);
+    CU_ASSERT_EQUAL_FATAL(timer_get_wall_s(names[0]), 0);
+    CU_ASSERT_EQUAL_FATAL(timer_register(names[0]), handles[0]);
 }
 
 void test_multiple_count(void) {
@@ -74,22 +118,67 @@ void test_multiple_count(void) {
     timer_reset();
     for (uint8_t i = 0; i < name_count; i++) {
         const uint16_t repetition_count = (uint16_t) (10 * (1 + (uint16_t) i));
-        CU_ASSERT_EQUAL_FATAL(global_timer.entry_count, i);
+        const timer_handle_t handle = timer_register(names[i]);
         for (uint16_t j = 0; j < repetition_count; j++) {
-            timer_start(names[i]);
-            CU_ASSERT_EQUAL_FATAL(global_timer.entries[i].count, j);
-            global_timer.entries[i].wall_before -= 1;
-            global_timer.entries[i].clock_before -= CLOCKS_PER_SEC;
-            timer_stop(names[i]);
-            CU_ASSERT_EQUAL_FATAL(global_timer.entries[i].count, j + 1);
+            CU_ASSERT_EQUAL_FATAL(timer_get_count(names[i]), (uint64_t) j);
+            timer_start_handle(handle);
+            timer_stop_handle(handle);
+            CU_ASSERT_EQUAL_FATAL(timer_get_count(names[i]), (uint64_t) j + 1);
         }
-        CU_ASSERT_FATAL(fabs(global_timer.entries[i].total_wall_s - repetition_count) < TIMER_TOLERANCE);
-        CU_ASSERT_FATAL(fabs(global_timer.entries[i].total_cpu_s - repetition_count) < TIMER_TOLERANCE);
+        CU_ASSERT_FATAL(timer_get_wall_s(names[i]) < TIMER_TOLERANCE);
+    }
+
+    // Nested runs are measured once, from the first start until the last stop
+    const timer_handle_t handle = timer_register(names[0]);
+    timer_reset();
+    timer_start_handle(handle);
+    timer_start_handle(handle);
+    timer_test_sleep(5);
+    timer_stop_handle(handle);
+    CU_ASSERT_EQUAL_FATAL(timer_get_count(names[0]), 1);
+    CU_ASSERT_EQUAL_FATAL(timer_get_wall_s(names[0]), 0);
+    timer_stop_handle(handle);
+    CU_ASSERT_EQUAL_FATAL(timer_get_count(names[0]), 2);
+    CU_ASSERT_FATAL(timer_get_wall_s(names[0]) >= 0.005);
+}
+
+/**
+ * Start and stop a timer @ref TIMER_TEST_CYCLE_COUNT times.
+ *
+ * @param handle_pointer pointer to the handle of the timer
+ * @return NULL
+ */
+static void *timer_test_thread(void *handle_pointer) {
+    const timer_handle_t handle = *((timer_handle_t *) handle_pointer);
+    for (uint32_t i = 0; i < TIMER_TEST_CYCLE_COUNT; i++) {
+        timer_start_handle(handle);
+        timer_stop_handle(handle);
     }
+    return NULL;
+}
+
+void test_thread_merge(void) {
+    timer_reset();
+    timer_handle_t handle = timer_register("threads");
+    CU_ASSERT_NOT_EQUAL_FATAL(handle, TIMER_INVALID_HANDLE);
+
+    pthread_t threads[TIMER_TEST_THREAD_COUNT];
+    for (uint32_t i = 0; i < TIMER_TEST_THREAD_COUNT; i++) {
+        CU_ASSERT_EQUAL_FATAL(pthread_create(&threads[i], NULL, timer_test_thread, &handle), 0);
+    }
+    timer_test_thread(&handle);
+    for (uint32_t i = 0; i < TIMER_TEST_THREAD_COUNT; i++) {
+        CU_ASSERT_EQUAL_FATAL(pthread_join(threads[i], NULL), 0);
+    }
+    CU_ASSERT_EQUAL_FATAL(timer_get_count("threads"), (TIMER_TEST_THREAD_COUNT + 1) * TIMER_TEST_CYCLE_COUNT);
+
+    timer_reset();
+    CU_ASSERT_EQUAL_FATAL(timer_get_count("threads"), 0);
 }
 
 
 CU_START_REGISTRATION(timer)
     CU_QADD_TEST(test_basic_usage)
     CU_QADD_TEST(test_multiple_count)
+    CU_QADD_TEST(test_thread_merge)
 CU_END_REGISTRATION()